@@ -23,5 +23,11 @@ if(DEFINED DEV_MODE)
 else()
 endif()
 
+# Count lock acquires, failed tries, and wait cycles in mutex pools
+if(DEFINED LOCK_STATS)
+  message("Lock contention statistics enabled.")
+  add_definitions(-DSPLATT_LOCK_STATS=${LOCK_STATS})
+endif()
+
 include(cmake/warnings.cmake)
 
@@ -24,3 +24,7 @@ if (${CMAKE_SYSTEM_NAME} MATCHES "Darwin")
   set(SPLATT_LIBS ${SPLATT_LIBS} argp)
 endif()
 
+
+# threads for asynchronous I/O (checkpointing)
+find_package(Threads REQUIRED)
+set(SPLATT_LIBS ${SPLATT_LIBS} ${CMAKE_THREAD_LIBS_INIT})
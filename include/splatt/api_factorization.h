@@ -45,6 +45,121 @@ int splatt_cpd_als(
     splatt_kruskal * factored);
 
 
+/**
+* @brief Compute the CPD using alternating least squares, starting from a
+*        previous factorization instead of a random initialization. This is
+*        useful for resuming a factorization or refining it after the tensor
+*        has been updated.
+*
+*        The tensor may have grown since 'init' was computed: rows beyond
+*        init->dims[m] are initialized randomly. Likewise, if nfactors exceeds
+*        init->rank, the new columns are initialized randomly.
+*
+* @param tensors An array of splatt_csf created by SPLATT.
+* @param nfactors The rank of the decomposition to perform. Must be at least
+*                 init->rank.
+* @param options Options array for SPLATT.
+* @param init The initial factorization, e.g., from splatt_kruskal_load(). If
+*             NULL, this is equivalent to splatt_cpd_als().
+* @param[out] factored The factored tensor in Kruskal format.
+*
+* @return SPLATT error code (splatt_error_t). SPLATT_SUCCESS on success.
+*/
+int splatt_cpd_als_warm(
+    splatt_csf const * const tensors,
+    splatt_idx_t const nfactors,
+    double const * const options,
+    splatt_kruskal const * const init,
+    splatt_kruskal * factored);
+
+
+/**
+* @brief Compute the CPD from 'nstarts' random initializations and keep the
+*        factorization with the best fit. This guards against poor local
+*        minima without re-reading the tensor or rebuilding its CSF: all
+*        starts share the same (read-only) 'tensors'.
+*
+*        The options[SPLATT_OPTION_NTHREADS] threads are divided evenly among
+*        up to that many concurrent starts, so with T threads and N starts,
+*        min(N,T) starts run at once with T/min(N,T) threads each.
+*
+* @param tensors An array of splatt_csf created by SPLATT.
+* @param nfactors The rank of the decomposition to perform.
+* @param nstarts The number of random initializations to try.
+* @param options Options array for SPLATT.
+* @param[out] factored The best factored tensor in Kruskal format.
+*
+* @return SPLATT error code (splatt_error_t). SPLATT_SUCCESS on success.
+*/
+int splatt_cpd_als_multistart(
+    splatt_csf const * const tensors,
+    splatt_idx_t const nfactors,
+    splatt_idx_t const nstarts,
+    double const * const options,
+    splatt_kruskal * factored);
+
+
+/**
+* @brief Compute the CPD at each of a non-decreasing sequence of ranks, e.g.,
+*        to choose a model rank. Each rank is seeded from the factors of the
+*        previous one plus new random columns (see splatt_cpd_als_warm()), and
+*        the thread structures and MTTKRP workspace are allocated once for the
+*        largest rank and shared by every factorization.
+*
+* @param tensors An array of splatt_csf created by SPLATT.
+* @param ranks The ranks to compute, in non-decreasing order.
+* @param nranks The length of 'ranks'.
+* @param options Options array for SPLATT.
+* @param[out] factored An array of length 'nranks'. factored[r] is the
+*                      factorization at rank ranks[r]; each must be freed
+*                      with splatt_free_kruskal().
+* @param[out] seconds If not NULL, seconds[r] is the time spent on rank
+*                     ranks[r].
+*
+* @return SPLATT error code (splatt_error_t). SPLATT_SUCCESS on success.
+*/
+int splatt_cpd_als_sweep(
+    splatt_csf const * const tensors,
+    splatt_idx_t const * const ranks,
+    splatt_idx_t const nranks,
+    double const * const options,
+    splatt_kruskal * factored,
+    double * seconds);
+
+
+/**
+* @brief Compute the Tucker decomposition using higher-order orthogonal
+*        iteration (HOOI). Each iteration computes a tensor-times-matrix chain
+*        (TTMc) for each mode and replaces the factor with the leading left
+*        singular vectors of the result.
+*
+*        'tensors' must have been allocated with SPLATT_CSF_ALLMODE and without
+*        tiling, so that tensors[m] is rooted at mode m.
+*
+* @param tensors An array of splatt_csf created by SPLATT.
+* @param ranks The rank of each mode. A rank larger than the mode's dimension
+*              or the product of the other ranks is reduced to fit.
+* @param options Options array for SPLATT.
+* @param[out] factored The factored tensor in Tucker format.
+*
+* @return SPLATT error code (splatt_error_t). SPLATT_SUCCESS on success.
+*/
+int splatt_tucker_hooi(
+    splatt_csf const * const tensors,
+    splatt_idx_t const * const ranks,
+    double const * const options,
+    splatt_tucker * factored);
+
+
+/**
+* @brief Free a splatt_tucker allocated by splatt_tucker_hooi().
+*
+* @param factored The factored tensor to free.
+*/
+void splatt_free_tucker(
+    splatt_tucker * factored);
+
+
 /** @} */
 
 
@@ -62,6 +62,37 @@ typedef struct
    */
   splatt_val_t * * privatize_buffer;
 
+  /** @brief Locks which protect the rows of the output when a mode is not
+   *         privatized. It is sized for the longest mode and the number of
+   *         threads, see mutex_alloc_sized(). */
+  struct splatt_mutex_pool * pool;
+
+  /*
+   * Factor sparsity information. Constrained factorizations often produce
+   * factors which are mostly zero. Once a factor's density drops below
+   * 'sparse_thresh', its non-zero pattern is stored in CSR form and MTTKRP
+   * skips the zero columns of each row. A pattern is trusted from
+   * mttkrp_refresh_factor() until the next refresh or
+   * mttkrp_invalidate_factor() of its mode, and only for the values it was
+   * built from.
+   */
+
+  /** @brief The density below which a factor is treated as sparse. */
+  double sparse_thresh;
+  /** @brief Marks if a factor currently has a sparse pattern. */
+  bool is_sparse_factor[SPLATT_MAX_NMODES];
+  /** @brief Row pointer of each factor's non-zero pattern. */
+  splatt_idx_t * factor_rowptr[SPLATT_MAX_NMODES];
+  /** @brief Column indices of each factor's non-zero pattern. */
+  splatt_idx_t * factor_colind[SPLATT_MAX_NMODES];
+  /** @brief The allocated lengths of factor_rowptr and factor_colind. The
+   *         workspace may be reused for factors with more rows or columns
+   *         (e.g., in a rank sweep), so these grow as needed. */
+  splatt_idx_t factor_rowptr_cap[SPLATT_MAX_NMODES];
+  splatt_idx_t factor_colind_cap[SPLATT_MAX_NMODES];
+  /** @brief The factor values which each pattern was built from. */
+  splatt_val_t const * factor_vals[SPLATT_MAX_NMODES];
+
   /** @brief The time spent on the latest privatized reduction.*/
   double reduction_time;
 } splatt_mttkrp_ws;
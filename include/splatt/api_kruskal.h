@@ -34,6 +34,25 @@ extern "C" {
 void splatt_free_kruskal(
     splatt_kruskal * factored);
 
+
+/**
+* @brief Load a Kruskal tensor which was written by `splatt cpd`. The factors
+*        are read from '<stem>.mode<m>.mat' and the weights from
+*        '<stem>.lambda.mat'.
+*
+* @param stem The file stem used when writing. If NULL, './mode<m>.mat' and
+*             './lambda.mat' are read.
+* @param nmodes The number of modes to read.
+* @param[out] kruskal The loaded tensor. Must be freed with
+*                     splatt_free_kruskal().
+*
+* @return SPLATT error code (splatt_error_t). SPLATT_SUCCESS on success.
+*/
+int splatt_kruskal_load(
+    char const * const stem,
+    splatt_idx_t const nmodes,
+    splatt_kruskal * kruskal);
+
 /** @} */
 
 
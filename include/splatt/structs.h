@@ -44,6 +44,34 @@ typedef struct splatt_kruskal
 } splatt_kruskal;
 
 
+/**
+* @brief Tucker tensors are the output of the Tucker decomposition. Each mode
+*        of the tensor is represented as a matrix with orthonormal columns, and
+*        the dense core tensor captures the interactions between them.
+*/
+typedef struct splatt_tucker
+{
+  /** @brief The number of modes in the tensor. */
+  splatt_idx_t nmodes;
+
+  /** @brief The number of rows in each factor. */
+  splatt_idx_t dims[SPLATT_MAX_NMODES];
+
+  /** @brief The number of columns in each factor. */
+  splatt_idx_t ranks[SPLATT_MAX_NMODES];
+
+  /** @brief The row-major matrix factors for each mode. */
+  splatt_val_t * factors[SPLATT_MAX_NMODES];
+
+  /** @brief The ranks[0] x ... x ranks[nmodes-1] core, with the last mode
+   *         varying fastest. */
+  splatt_val_t * core;
+
+  /** @brief The quality [0,1] of the decomposition. */
+  double fit;
+} splatt_tucker;
+
+
 
 /**
 * @brief The sparsity pattern of a CSF (sub-)tensor.
@@ -108,6 +108,17 @@ typedef enum
   SPLATT_OPTION_REGULARIZE, /* Regularization parameter. */
   SPLATT_OPTION_NITER,      /* Maximum number of iterations to perform. */
   SPLATT_OPTION_VERBOSITY,  /* Verbosity level */
+  SPLATT_OPTION_NNCPD,      /* Non-negative CPD. */
+  SPLATT_OPTION_LINESEARCH, /* Extrapolate factors between ALS iterations. */
+  SPLATT_OPTION_L1,         /* L1 penalty (sparsity) for constrained CPD. */
+  SPLATT_OPTION_NNSOLVER,   /* Factor update used for constrained CPD. */
+  SPLATT_OPTION_LEARNRATE,  /* Initial step size of SGD-based solvers. */
+  SPLATT_OPTION_FORGET,     /* Forgetting factor of streaming CPD. */
+  SPLATT_OPTION_WINDOW,     /* Batches remembered by streaming CPD (0: all). */
+  SPLATT_OPTION_LOSS,       /* Elementwise loss of generalized CPD. */
+  SPLATT_OPTION_PPTOL,      /* Factor change below which ALS uses pairwise
+                               perturbation (0: exact MTTKRP only). */
+  SPLATT_OPTION_INIT,       /* How CPD-ALS initializes factors. */
 
   /* low level options */
   SPLATT_OPTION_RANDSEED,   /* Random number seed */
@@ -115,6 +126,9 @@ typedef enum
   SPLATT_OPTION_TILE,       /* Use cache tiling during MTTKRP. */
   SPLATT_OPTION_TILELEVEL,  /* How many levels of the CSF are tiled? */
   SPLATT_OPTION_PRIVTHRESH, /* Threshold for privatizing a mode. */
+  SPLATT_OPTION_SPFACTOR,   /* Density below which factors are sparse. */
+  SPLATT_OPTION_NSAMPLES,   /* Fibers sampled per randomized update. */
+  SPLATT_OPTION_FITFREQ,    /* Iterations between exact fits (randomized). */
 
   SPLATT_OPTION_DECOMP,     /* Decomposition to use on distributed systems */
   SPLATT_OPTION_COMM,       /* Communication pattern to use */
@@ -173,6 +187,40 @@ typedef enum
 } splatt_csf_type;
 
 
+/**
+* @brief Factor updates available for constrained (non-negative or L1) CPD.
+*/
+typedef enum
+{
+  SPLATT_NNSOLVER_ADMM, /** AO-ADMM, an exact solve per factor update. */
+  SPLATT_NNSOLVER_HALS, /** Hierarchical ALS, one cheap pass over columns. */
+} splatt_nnsolver_type;
+
+
+/**
+* @brief Factor initializations available for CPD-ALS.
+*/
+typedef enum
+{
+  SPLATT_INIT_RAND, /** Uniformly random factors. */
+  SPLATT_INIT_SVD,  /** Leading left singular vectors of each unfolding,
+                        estimated with a randomized sketch. */
+} splatt_init_type;
+
+
+/**
+* @brief Elementwise losses available for generalized CPD (GCP). Each is the
+*        negative log-likelihood of an entry given the model value m.
+*/
+typedef enum
+{
+  SPLATT_LOSS_GAUSSIAN,  /** (x - m)^2, for real-valued data. */
+  SPLATT_LOSS_BERNOULLI, /** log(1 + e^m) - x*m, for binary data (logit). */
+  SPLATT_LOSS_POISSON,   /** e^m - x*m, for count data (log link). */
+  SPLATT_LOSS_GAMMA,     /** x/m + log(m), for positive data (m >= 0). */
+} splatt_loss_type;
+
+
 /**
 * @brief Tensor decomposition schemes.
 */
@@ -0,0 +1,238 @@
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "admm.h"
+#include "splatt_lapack.h"
+#include "timer.h"
+
+#include <math.h>
+
+
+
+/******************************************************************************
+ * TYPES / MACROS
+ *****************************************************************************/
+
+/* The number of rows which are updated together by one thread. */
+#ifndef ADMM_BLOCK_SIZE
+#define ADMM_BLOCK_SIZE 50
+#endif
+
+/* Maximum number of inner iterations per factor update. */
+#ifndef ADMM_MAX_ITS
+#define ADMM_MAX_ITS 25
+#endif
+
+/* Relative tolerance on the primal and dual residuals. */
+#ifndef ADMM_TOL
+#define ADMM_TOL 1e-3
+#endif
+
+
+
+/******************************************************************************
+ * PRIVATE FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief The proximity operator of the L1 penalty and (optionally) the
+*        non-negativity constraint.
+*
+* @param v The value to project.
+* @param thresh The soft-thresholding parameter, l1 / rho.
+* @param nonneg Whether to project onto the non-negative orthant.
+*
+* @return The projected value.
+*/
+static inline val_t p_prox(
+    val_t const v,
+    val_t const thresh,
+    int const nonneg)
+{
+  if(nonneg) {
+    return SS_MAX(v - thresh, 0.);
+  }
+  if(v > thresh) {
+    return v - thresh;
+  }
+  if(v < -thresh) {
+    return v + thresh;
+  }
+  return 0.;
+}
+
+
+/**
+* @brief Run ADMM on a block of rows until the block converges.
+*
+* @param chol The Cholesky factor of (G + rho * I), lower triangular.
+* @param rank The number of columns.
+* @param nrows The number of rows in this block.
+* @param rho The ADMM penalty parameter.
+* @param thresh The soft-thresholding parameter.
+* @param nonneg Whether to enforce non-negativity.
+* @param mttkrp The MTTKRP rows of this block.
+* @param primal The factor rows of this block.
+* @param dual The dual rows of this block.
+* @param aux Workspace rows for this block.
+*
+* @return The number of inner iterations performed.
+*/
+static idx_t p_admm_block(
+    val_t * const chol,
+    splatt_blas_int const rank,
+    splatt_blas_int const nrows,
+    val_t const rho,
+    val_t const thresh,
+    int const nonneg,
+    val_t const * const restrict mttkrp,
+    val_t * const restrict primal,
+    val_t * const restrict dual,
+    val_t * const restrict aux)
+{
+  idx_t const len = (idx_t) nrows * (idx_t) rank;
+
+  char uplo = 'L';
+  splatt_blas_int order = rank;
+  splatt_blas_int nrhs = nrows;
+  splatt_blas_int lda = rank;
+  splatt_blas_int ldb = rank;
+  splatt_blas_int info;
+
+  idx_t it;
+  for(it=0; it < ADMM_MAX_ITS; ++it) {
+    /* aux = (G + rho * I)^-1 * (M + rho * (H + U)) */
+    for(idx_t x=0; x < len; ++x) {
+      aux[x] = mttkrp[x] + rho * (primal[x] + dual[x]);
+    }
+    SPLATT_BLAS(potrs)(&uplo, &order, &nrhs, chol, &lda, aux, &ldb, &info);
+
+    /* proximity step and dual update */
+    val_t primal_res = 0.;
+    val_t dual_res = 0.;
+    val_t primal_norm = 0.;
+    val_t dual_norm = 0.;
+    for(idx_t x=0; x < len; ++x) {
+      val_t const old = primal[x];
+      val_t const h = p_prox(aux[x] - dual[x], thresh, nonneg);
+      primal[x] = h;
+      dual[x] += h - aux[x];
+
+      primal_res += (h - aux[x]) * (h - aux[x]);
+      dual_res += (h - old) * (h - old);
+      primal_norm += h * h;
+      dual_norm += dual[x] * dual[x];
+    }
+
+    /* residuals are squared, so the tolerance is too */
+    val_t const tol = ADMM_TOL * ADMM_TOL;
+    if(primal_res <= tol * primal_norm &&
+        dual_res <= tol * SS_MAX(dual_norm, primal_norm)) {
+      ++it;
+      break;
+    }
+  }
+
+  return it;
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+int admm_is_constrained(
+    double const * const opts)
+{
+  return opts[SPLATT_OPTION_NNCPD] != 0 || opts[SPLATT_OPTION_L1] > 0.;
+}
+
+
+idx_t admm_solve(
+    idx_t const mode,
+    idx_t const nmodes,
+    matrix_t * * aTa,
+    matrix_t const * const mttkrp,
+    matrix_t * const primal,
+    matrix_t * const dual,
+    matrix_t * const aux,
+    double const * const opts)
+{
+  timer_start(&timers[TIMER_INV]);
+
+  idx_t const rank = primal->J;
+  idx_t const nrows = primal->I;
+  val_t * const restrict gram = aTa[MAX_NMODES]->vals;
+
+  mat_form_gram(aTa[MAX_NMODES], aTa, mode, nmodes);
+
+  /* rho = trace(G) / rank is the step size suggested for AO-ADMM */
+  val_t rho = 0.;
+  for(idx_t f=0; f < rank; ++f) {
+    rho += gram[f + (f*rank)];
+  }
+  rho /= (val_t) rank;
+  if(rho <= 0.) {
+    rho = 1.;
+  }
+
+  /* the L2 penalty lives on the diagonal, so it is folded into the solve */
+  val_t const l2 = opts[SPLATT_OPTION_REGULARIZE];
+  for(idx_t f=0; f < rank; ++f) {
+    gram[f + (f*rank)] += rho + l2;
+  }
+
+  /* factor once and reuse for all inner iterations */
+  char uplo = 'L';
+  splatt_blas_int order = (splatt_blas_int) rank;
+  splatt_blas_int lda = (splatt_blas_int) rank;
+  splatt_blas_int info;
+  SPLATT_BLAS(potrf)(&uplo, &order, gram, &lda, &info);
+  if(info) {
+    fprintf(stderr, "SPLATT: ADMM DPOTRF returned %d\n", info);
+    timer_stop(&timers[TIMER_INV]);
+    return 0;
+  }
+
+  val_t const thresh = opts[SPLATT_OPTION_L1] / rho;
+  int const nonneg = opts[SPLATT_OPTION_NNCPD] != 0;
+
+  idx_t const nblocks = (nrows + ADMM_BLOCK_SIZE - 1) / ADMM_BLOCK_SIZE;
+  idx_t total_its = 0;
+
+  #pragma omp parallel for schedule(dynamic, 1) reduction(+:total_its)
+  for(idx_t b=0; b < nblocks; ++b) {
+    idx_t const start = b * ADMM_BLOCK_SIZE;
+    idx_t const stop = SS_MIN(start + ADMM_BLOCK_SIZE, nrows);
+    idx_t const offset = start * rank;
+
+    total_its += p_admm_block(gram, (splatt_blas_int) rank,
+        (splatt_blas_int) (stop - start), rho, thresh, nonneg,
+        mttkrp->vals + offset, primal->vals + offset, dual->vals + offset,
+        aux->vals + offset);
+  }
+
+  timer_stop(&timers[TIMER_INV]);
+  return total_its;
+}
+
+
+void admm_rescale_dual(
+    matrix_t * const dual,
+    val_t const * const lambda)
+{
+  idx_t const I = dual->I;
+  idx_t const J = dual->J;
+  val_t * const restrict vals = dual->vals;
+
+  #pragma omp parallel for schedule(static)
+  for(idx_t i=0; i < I; ++i) {
+    for(idx_t j=0; j < J; ++j) {
+      if(lambda[j] > 0.) {
+        vals[j + (i*J)] /= lambda[j];
+      }
+    }
+  }
+}
@@ -0,0 +1,82 @@
+#ifndef SPLATT_ADMM_H
+#define SPLATT_ADMM_H
+
+#include "base.h"
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "matrix.h"
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+#define admm_is_constrained splatt_admm_is_constrained
+/**
+* @brief Determine whether the factorization is constrained, i.e., whether
+*        factor updates should use admm_solve() instead of the unconstrained
+*        mat_solve_normals().
+*
+* @param opts SPLATT options array.
+*
+* @return 1 if SPLATT_OPTION_NNCPD or SPLATT_OPTION_L1 is set, 0 otherwise.
+*/
+int admm_is_constrained(
+    double const * const opts);
+
+
+#define admm_solve splatt_admm_solve
+/**
+* @brief Update a factor matrix subject to constraints with AO-ADMM. We solve:
+*
+*          min_H 1/2 ||X_(m) - H * KR^T||^2 + l1 * ||H||_1 + l2/2 * ||H||^2
+*
+*        optionally with H >= 0. The Cholesky factorization of (G + rho * I) is
+*        computed once and reused for every inner iteration. Rows are split
+*        into independent blocks which each iterate to their own convergence
+*        in parallel.
+*
+*        The penalties are opts[SPLATT_OPTION_L1] and
+*        opts[SPLATT_OPTION_REGULARIZE], and non-negativity is enforced if
+*        opts[SPLATT_OPTION_NNCPD] is set.
+*
+* @param mode The mode we are updating.
+* @param nmodes The number of modes in the tensor.
+* @param aTa The A^T * A matrices. aTa[MAX_NMODES] is used as workspace.
+* @param mttkrp The MTTKRP result for this mode.
+* @param[out] primal The factor to update. Its current value is used as the
+*                    starting point.
+* @param dual The scaled dual variables, which carry over between calls.
+* @param aux Workspace with at least as many rows as 'primal'.
+* @param opts SPLATT options array.
+*
+* @return The total number of inner iterations, summed over row blocks.
+*/
+idx_t admm_solve(
+    idx_t const mode,
+    idx_t const nmodes,
+    matrix_t * * aTa,
+    matrix_t const * const mttkrp,
+    matrix_t * const primal,
+    matrix_t * const dual,
+    matrix_t * const aux,
+    double const * const opts);
+
+
+#define admm_rescale_dual splatt_admm_rescale_dual
+/**
+* @brief Scale the dual variables after the primal variables have been
+*        normalized with mat_normalize(). Column 'f' is divided by lambda[f].
+*
+* @param dual The dual variables to scale.
+* @param lambda The column norms returned by mat_normalize().
+*/
+void admm_rescale_dual(
+    matrix_t * const dual,
+    val_t const * const lambda);
+
+#endif
@@ -3,10 +3,203 @@
  * INCLUDES
  *****************************************************************************/
 #include "base.h"
+#include "util.h"
 
 
 /* for `posix_memalign()` errors */
 #include <errno.h>
+#include <stdint.h>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#endif
+
+
+
+/******************************************************************************
+ * PRIVATE STRUCTURES
+ *****************************************************************************/
+
+/**
+* @brief A counted allocation. The table is open-addressed by pointer with
+*        linear probing; an empty slot has ptr == NULL.
+*/
+typedef struct
+{
+  void * ptr;
+  size_t bytes;
+  splatt_mem_tag tag;
+} mem_entry;
+
+static mem_entry * mem_table = NULL;
+static size_t mem_capacity = 0;
+static size_t mem_count = 0;
+
+/* the last entry of each is the total */
+static size_t mem_current[SPLATT_MEM_NTAGS + 1];
+static size_t mem_peak[SPLATT_MEM_NTAGS + 1];
+
+static char const * const mem_names[SPLATT_MEM_NTAGS + 1] = {
+  [SPLATT_MEM_MISC]   = "MISC",
+  [SPLATT_MEM_COORD]  = "COORD",
+  [SPLATT_MEM_CSF]    = "CSF",
+  [SPLATT_MEM_MATRIX] = "MATRIX",
+  [SPLATT_MEM_MTTKRP] = "MTTKRP",
+  [SPLATT_MEM_NTAGS]  = "TOTAL"
+};
+
+
+
+/******************************************************************************
+ * PRIVATE FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief The home slot of a pointer in the accounting table.
+*/
+static inline size_t p_mem_slot(
+    void const * const ptr)
+{
+  /* allocations are at least 64-byte aligned, so skip the low bits */
+  uint64_t const key = ((uint64_t) (uintptr_t) ptr) >> 6;
+  return (size_t) (key * 0x9E3779B97F4A7C15ULL) & (mem_capacity - 1);
+}
+
+
+/**
+* @brief Charge or refund an allocation.
+*/
+static void p_mem_charge(
+    splatt_mem_tag const tag,
+    size_t const bytes,
+    bool const alloc)
+{
+  if(alloc) {
+    mem_current[tag] += bytes;
+    mem_current[SPLATT_MEM_NTAGS] += bytes;
+    mem_peak[tag] = SS_MAX(mem_peak[tag], mem_current[tag]);
+    mem_peak[SPLATT_MEM_NTAGS] = SS_MAX(mem_peak[SPLATT_MEM_NTAGS],
+        mem_current[SPLATT_MEM_NTAGS]);
+  } else {
+    mem_current[tag] -= bytes;
+    mem_current[SPLATT_MEM_NTAGS] -= bytes;
+  }
+}
+
+
+/**
+* @brief Check whether an allocation may be in the accounting table, without
+*        taking the 'splatt_mem' lock. The allocator already knows the size of
+*        each block, and blocks smaller than SPLATT_MEM_TRACK_BYTES are never
+*        tracked. Where the size is unavailable, every block is checked.
+*/
+static inline bool p_mem_maybe_tracked(
+    void * const ptr)
+{
+#if defined(__GLIBC__)
+  return malloc_usable_size(ptr) >= SPLATT_MEM_TRACK_BYTES;
+#elif defined(__APPLE__)
+  return malloc_size(ptr) >= SPLATT_MEM_TRACK_BYTES;
+#else
+  return true;
+#endif
+}
+
+
+/**
+* @brief Remove a pointer from the accounting table, refunding its bytes.
+*        Must be called from within the 'splatt_mem' critical section.
+*
+* @param ptr The pointer to remove.
+*
+* @return Whether the pointer was found.
+*/
+static bool p_mem_remove(
+    void const * const ptr)
+{
+  if(mem_count == 0) {
+    return false;
+  }
+
+  size_t slot = p_mem_slot(ptr);
+  while(mem_table[slot].ptr != ptr) {
+    if(mem_table[slot].ptr == NULL) {
+      return false;
+    }
+    slot = (slot + 1) & (mem_capacity - 1);
+  }
+  p_mem_charge(mem_table[slot].tag, mem_table[slot].bytes, false);
+  --mem_count;
+
+  /* backward-shift the rest of the cluster into the hole */
+  size_t hole = slot;
+  size_t next = (slot + 1) & (mem_capacity - 1);
+  while(mem_table[next].ptr != NULL) {
+    size_t const home = p_mem_slot(mem_table[next].ptr);
+    /* move it if its home is not cyclically within (hole, next] */
+    if(((next - home) & (mem_capacity - 1)) >=
+       ((next - hole) & (mem_capacity - 1))) {
+      mem_table[hole] = mem_table[next];
+      hole = next;
+    }
+    next = (next + 1) & (mem_capacity - 1);
+  }
+  mem_table[hole].ptr = NULL;
+  return true;
+}
+
+
+/**
+* @brief Add an allocation to the accounting table. Must be called from
+*        within the 'splatt_mem' critical section.
+*/
+static void p_mem_insert(
+    void * const ptr,
+    size_t const bytes,
+    splatt_mem_tag const tag)
+{
+  /* A pointer which is still present was released with a bare free() (e.g.,
+   * by a library user), and the allocator has handed its memory back out. */
+  p_mem_remove(ptr);
+
+  /* keep the load at most one half */
+  if(2 * (mem_count + 1) > mem_capacity) {
+    mem_entry * const old = mem_table;
+    size_t const old_capacity = mem_capacity;
+    mem_capacity = SS_MAX(1024, 2 * old_capacity);
+    mem_table = calloc(mem_capacity, sizeof(*mem_table));
+    if(mem_table == NULL) {
+      fprintf(stderr, "SPLATT: could not grow the memory accounting table.\n");
+      abort();
+    }
+    for(size_t s=0; s < old_capacity; ++s) {
+      if(old[s].ptr != NULL) {
+        size_t slot = p_mem_slot(old[s].ptr);
+        while(mem_table[slot].ptr != NULL) {
+          slot = (slot + 1) & (mem_capacity - 1);
+        }
+        mem_table[slot] = old[s];
+      }
+    }
+    free(old);
+  }
+
+  size_t slot = p_mem_slot(ptr);
+  while(mem_table[slot].ptr != NULL) {
+    slot = (slot + 1) & (mem_capacity - 1);
+  }
+  mem_table[slot].ptr = ptr;
+  mem_table[slot].bytes = bytes;
+  mem_table[slot].tag = tag;
+  ++mem_count;
+  p_mem_charge(tag, bytes, true);
+}
 
 
 
@@ -42,8 +235,19 @@ int splatt_version_subminor(void)
 void * splatt_malloc(
     size_t const bytes)
 {
+  return splatt_malloc_tag(bytes, SPLATT_MEM_MISC);
+}
+
+
+void * splatt_malloc_tag(
+    size_t const bytes,
+    splatt_mem_tag const tag)
+{
+  bool const huge = (bytes >= SPLATT_HUGEPAGE_BYTES);
+
   void * ptr;
-  int const success = posix_memalign(&ptr, 64, bytes);
+  int const success = posix_memalign(&ptr, huge ? SPLATT_HUGEPAGE_BYTES : 64,
+      bytes);
 
   if(success != 0) {
     switch(success) {
@@ -60,7 +264,21 @@ void * splatt_malloc(
       break;
     }
 
-    ptr = NULL;
+    return NULL;
+  }
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+  /* only whole huge pages; this is a hint, so failure is harmless */
+  if(huge) {
+    madvise(ptr, bytes - (bytes % SPLATT_HUGEPAGE_BYTES), MADV_HUGEPAGE);
+  }
+#endif
+
+  if(bytes >= SPLATT_MEM_TRACK_BYTES) {
+    #pragma omp critical (splatt_mem)
+    {
+      p_mem_insert(ptr, bytes, tag);
+    }
   }
 
   return ptr;
@@ -70,7 +288,50 @@ void * splatt_malloc(
 void splatt_free(
     void * ptr)
 {
+  if(ptr == NULL) {
+    return;
+  }
+
+  /* small blocks are freed without serializing on the table */
+  if(p_mem_maybe_tracked(ptr)) {
+    #pragma omp critical (splatt_mem)
+    {
+      p_mem_remove(ptr);
+    }
+  }
   free(ptr);
 }
 
 
+void splatt_mem_usage(
+    splatt_mem_tag const tag,
+    size_t * const current,
+    size_t * const peak)
+{
+  #pragma omp critical (splatt_mem)
+  {
+    *current = mem_current[tag];
+    *peak = mem_peak[tag];
+  }
+}
+
+
+void splatt_mem_report(void)
+{
+  printf("Memory ---------------------------------------------------------\n");
+  for(int t=0; t <= SPLATT_MEM_NTAGS; ++t) {
+    size_t current;
+    size_t peak;
+    splatt_mem_usage((splatt_mem_tag) t, &current, &peak);
+    if(peak == 0) {
+      continue;
+    }
+
+    char * cstr = bytes_str(current);
+    char * pstr = bytes_str(peak);
+    printf("  %-10s current: %-12s peak: %s\n", mem_names[t], cstr, pstr);
+    free(cstr);
+    free(pstr);
+  }
+}
+
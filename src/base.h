@@ -49,8 +49,34 @@ static int const DEFAULT_TILE = 0;
  * MEMORY ALLOCATION
  *****************************************************************************/
 
+/* allocations at least this large are aligned to (and hinted as) huge pages */
+#ifndef SPLATT_HUGEPAGE_BYTES
+#define SPLATT_HUGEPAGE_BYTES (2 * 1024 * 1024)
+#endif
+
+/* allocations at least this large are counted by the memory accounting */
+#ifndef SPLATT_MEM_TRACK_BYTES
+#define SPLATT_MEM_TRACK_BYTES 4096
+#endif
+
+
 /**
-* @brief Allocate 'bytes' memory, 64-bit aligned. Returns a pointer to memory.
+* @brief The subsystems which allocations are charged to.
+*/
+typedef enum
+{
+  SPLATT_MEM_MISC,    /* anything not tagged */
+  SPLATT_MEM_COORD,   /* coordinate tensors */
+  SPLATT_MEM_CSF,     /* CSF tensors */
+  SPLATT_MEM_MATRIX,  /* dense matrices, including the factors */
+  SPLATT_MEM_MTTKRP,  /* MTTKRP workspace, e.g., privatization buffers */
+  SPLATT_MEM_NTAGS
+} splatt_mem_tag;
+
+
+/**
+* @brief Allocate 'bytes' memory, 64-byte aligned, and charge it to
+*        SPLATT_MEM_MISC. See splatt_malloc_tag().
 *
 * @param bytes The number of bytes to allocate.
 *
@@ -61,7 +87,26 @@ void * splatt_malloc(
 
 
 /**
-* @brief Free memory allocated by splatt_malloc().
+* @brief Allocate 'bytes' memory and charge it to a subsystem. Memory is
+*        64-byte aligned. Allocations of at least SPLATT_HUGEPAGE_BYTES are
+*        instead aligned to that size and, where supported, advised to use
+*        transparent huge pages. Allocations of at least SPLATT_MEM_TRACK_BYTES
+*        are counted until they are passed to splatt_free().
+*
+* @param bytes The number of bytes to allocate.
+* @param tag The subsystem to charge.
+*
+* @return The allocated memory.
+*/
+void * splatt_malloc_tag(
+    size_t const bytes,
+    splatt_mem_tag const tag);
+
+
+/**
+* @brief Free memory allocated by splatt_malloc(). Memory which is released
+*        with a bare free() instead stays charged until splatt_malloc() hands
+*        out the same address again.
 *
 * @param ptr The pointer to free.
 */
@@ -69,4 +114,23 @@ void splatt_free(
     void * ptr);
 
 
+/**
+* @brief Query the memory charged to a subsystem.
+*
+* @param tag The subsystem, or SPLATT_MEM_NTAGS for the total.
+* @param[out] current The bytes allocated now.
+* @param[out] peak The most bytes allocated at any one time.
+*/
+void splatt_mem_usage(
+    splatt_mem_tag const tag,
+    size_t * const current,
+    size_t * const peak);
+
+
+/**
+* @brief Print the current and peak memory of each subsystem to STDOUT.
+*/
+void splatt_mem_report(void);
+
+
 #endif
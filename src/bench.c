@@ -63,10 +63,9 @@ void bench_splatt(
   sp_timer_t itertime;
   sp_timer_t modetime;
 
-  /* add 64 bytes to avoid false sharing */
   thd_info * thds = thd_init(threads[nruns-1], 2,
-    mats[0]->J * sizeof(val_t) + 64,
-    (mats[0]->J * TILE_SIZES[0] * sizeof(val_t)) + 64);
+    mats[0]->J * sizeof(val_t),
+    (mats[0]->J * TILE_SIZES[0] * sizeof(val_t)));
 
   unsigned long ft_bytes = 0;
   ftensor_t ft[MAX_NMODES];
@@ -152,11 +151,10 @@ void bench_csf(
   cpd_opts[SPLATT_OPTION_NTHREADS] = threads[nruns-1];
 
   idx_t const nfactors = mats[0]->J;
-  /* add 64 bytes to avoid false sharing */
   thd_info * thds = thd_init(threads[nruns-1], 3,
-    (nfactors * nfactors * sizeof(val_t)) + 64,
-    TILE_SIZES[0] * nfactors * sizeof(val_t) + 64,
-    (tt->nmodes * nfactors * sizeof(val_t)) + 64);
+    (nfactors * nfactors * sizeof(val_t)),
+    TILE_SIZES[0] * nfactors * sizeof(val_t),
+    (tt->nmodes * nfactors * sizeof(val_t)));
 
   splatt_csf * cs = csf_alloc(tt, cpd_opts);
 
@@ -217,7 +215,7 @@ void bench_csf(
   /* clean up */
   csf_free(cs, cpd_opts);
   thd_free(thds, threads[nruns-1]);
-  free(cpd_opts);
+  splatt_free_opts(cpd_opts);
 
   /* fix any matrices that we shuffled */
   p_shuffle_mats(mats, opts->perm->iperms, tt->nmodes);
@@ -291,7 +289,7 @@ void bench_giga(
     mat_free(colmats[m]);
   }
   mat_free(colmats[MAX_NMODES]);
-  free(scratch);
+  splatt_free(scratch);
 
   /* fix any matrices that we shuffled */
   p_shuffle_mats(mats, opts->perm->iperms, tt->nmodes);
@@ -423,7 +421,7 @@ void bench_ttbox(
   timer_stop(&timers[TIMER_TTBOX]);
 
   thd_free(thds, threads[nruns-1]);
-  free(scratch);
+  splatt_free(scratch);
   for(idx_t m=0; m < tt->nmodes; ++m) {
     mat_free(colmats[m]);
   }
@@ -0,0 +1,274 @@
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "checkpoint.h"
+#include "io.h"
+#include "timer.h"
+
+
+
+/******************************************************************************
+ * PRIVATE FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief Append 'bytes' bytes of 'src' to the checkpoint buffer.
+*
+* @param chkpt The checkpoint whose buffer we append to.
+* @param src The data to append.
+* @param bytes The number of bytes to append.
+*/
+static void p_buf_append(
+    cpd_checkpoint * const chkpt,
+    void const * const src,
+    size_t const bytes)
+{
+  memcpy(chkpt->buf + chkpt->buf_bytes, src, bytes);
+  chkpt->buf_bytes += bytes;
+}
+
+
+/**
+* @brief The body of the writer thread. Write the serialized checkpoint to a
+*        temporary file and rename it over the real one.
+*
+* @param arg The cpd_checkpoint structure.
+*
+* @return NULL.
+*/
+static void * p_write_thread(
+    void * arg)
+{
+  cpd_checkpoint const * const chkpt = arg;
+
+  char * tmpname = NULL;
+  asprintf(&tmpname, "%s.tmp", chkpt->fname);
+
+  FILE * fout = fopen(tmpname, "wb");
+  if(fout == NULL) {
+    fprintf(stderr, "SPLATT ERROR: failed to open '%s' for checkpointing.\n",
+        tmpname);
+    free(tmpname);
+    return NULL;
+  }
+
+  size_t const written = fwrite(chkpt->buf, 1, chkpt->buf_bytes, fout);
+  int const err = fclose(fout);
+  if(written != chkpt->buf_bytes || err != 0) {
+    fprintf(stderr, "SPLATT ERROR: failed to write checkpoint '%s'.\n",
+        tmpname);
+    remove(tmpname);
+  } else if(rename(tmpname, chkpt->fname) != 0) {
+    fprintf(stderr, "SPLATT ERROR: failed to rename '%s' to '%s'.\n",
+        tmpname, chkpt->fname);
+  }
+
+  free(tmpname);
+  return NULL;
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+cpd_checkpoint * chkpt_alloc(
+    char const * const fname,
+    idx_t const every_its,
+    double const every_secs)
+{
+  cpd_checkpoint * chkpt = splatt_malloc(sizeof(*chkpt));
+
+  chkpt->fname = strdup(fname);
+  chkpt->every_its = every_its;
+  chkpt->every_secs = every_secs;
+
+  chkpt->start_it = 0;
+  chkpt->start_fit = 0.;
+
+  chkpt->last_write = monotonic_seconds();
+  chkpt->pending = 0;
+  chkpt->buf = NULL;
+  chkpt->buf_bytes = 0;
+  chkpt->buf_alloc = 0;
+
+  return chkpt;
+}
+
+
+void chkpt_free(
+    cpd_checkpoint * chkpt)
+{
+  if(chkpt == NULL) {
+    return;
+  }
+  chkpt_wait(chkpt);
+  splatt_free(chkpt->buf);
+  free(chkpt->fname);
+  splatt_free(chkpt);
+}
+
+
+int chkpt_due(
+    cpd_checkpoint const * const chkpt,
+    idx_t const its)
+{
+  if(chkpt == NULL) {
+    return 0;
+  }
+
+  if(chkpt->every_its > 0 && its % chkpt->every_its == 0) {
+    return 1;
+  }
+
+  if(chkpt->every_secs > 0. &&
+      monotonic_seconds() - chkpt->last_write >= chkpt->every_secs) {
+    return 1;
+  }
+
+  return 0;
+}
+
+
+void chkpt_write(
+    cpd_checkpoint * const chkpt,
+    idx_t const nmodes,
+    matrix_t ** mats,
+    val_t const * const lambda,
+    idx_t const its,
+    double const fit)
+{
+  /* the buffer is still being written */
+  chkpt_wait(chkpt);
+
+  idx_t const rank = mats[0]->J;
+
+  /* header + nmodes + rank + dims + its + fit + lambda + factors */
+  size_t bytes = sizeof(int32_t) + 2 * sizeof(uint64_t);
+  bytes += (3 + nmodes) * sizeof(idx_t);
+  bytes += (1 + rank) * sizeof(val_t);
+  for(idx_t m=0; m < nmodes; ++m) {
+    bytes += mats[m]->I * rank * sizeof(val_t);
+  }
+  if(bytes > chkpt->buf_alloc) {
+    splatt_free(chkpt->buf);
+    chkpt->buf = splatt_malloc(bytes);
+    chkpt->buf_alloc = bytes;
+  }
+
+  /* serialize */
+  chkpt->buf_bytes = 0;
+  int32_t const magic = SPLATT_BIN_CHKPT;
+  uint64_t const idx_width = sizeof(idx_t);
+  uint64_t const val_width = sizeof(val_t);
+  p_buf_append(chkpt, &magic, sizeof(magic));
+  p_buf_append(chkpt, &idx_width, sizeof(idx_width));
+  p_buf_append(chkpt, &val_width, sizeof(val_width));
+
+  p_buf_append(chkpt, &nmodes, sizeof(nmodes));
+  p_buf_append(chkpt, &rank, sizeof(rank));
+  for(idx_t m=0; m < nmodes; ++m) {
+    p_buf_append(chkpt, &(mats[m]->I), sizeof(mats[m]->I));
+  }
+  p_buf_append(chkpt, &its, sizeof(its));
+
+  val_t const vfit = fit;
+  p_buf_append(chkpt, &vfit, sizeof(vfit));
+  p_buf_append(chkpt, lambda, rank * sizeof(*lambda));
+  for(idx_t m=0; m < nmodes; ++m) {
+    p_buf_append(chkpt, mats[m]->vals, mats[m]->I * rank * sizeof(val_t));
+  }
+  assert(chkpt->buf_bytes == bytes);
+
+  chkpt->last_write = monotonic_seconds();
+
+  /* hand off to the writer */
+  if(pthread_create(&(chkpt->writer), NULL, p_write_thread, chkpt) == 0) {
+    chkpt->pending = 1;
+  } else {
+    /* fall back to a synchronous write */
+    p_write_thread(chkpt);
+  }
+}
+
+
+void chkpt_wait(
+    cpd_checkpoint * const chkpt)
+{
+  if(chkpt != NULL && chkpt->pending) {
+    pthread_join(chkpt->writer, NULL);
+    chkpt->pending = 0;
+  }
+}
+
+
+int chkpt_read(
+    cpd_checkpoint * const chkpt,
+    splatt_kruskal * const kruskal)
+{
+  timer_start(&timers[TIMER_IO]);
+
+  FILE * fin = fopen(chkpt->fname, "rb");
+  if(fin == NULL) {
+    fprintf(stderr, "SPLATT ERROR: failed to open checkpoint '%s'.\n",
+        chkpt->fname);
+    timer_stop(&timers[TIMER_IO]);
+    return SPLATT_ERROR_BADINPUT;
+  }
+
+  bin_header header;
+  read_binary_header(fin, &header);
+  if(header.magic != SPLATT_BIN_CHKPT) {
+    fprintf(stderr, "SPLATT ERROR: '%s' is not a SPLATT checkpoint.\n",
+        chkpt->fname);
+    fclose(fin);
+    timer_stop(&timers[TIMER_IO]);
+    return SPLATT_ERROR_BADINPUT;
+  }
+
+  idx_t nmodes;
+  idx_t rank;
+  fill_binary_idx(&nmodes, 1, &header, fin);
+  fill_binary_idx(&rank, 1, &header, fin);
+  if(nmodes > MAX_NMODES) {
+    fprintf(stderr, "SPLATT ERROR: checkpoint has %"SPLATT_PF_IDX" modes.\n",
+        nmodes);
+    fclose(fin);
+    timer_stop(&timers[TIMER_IO]);
+    return SPLATT_ERROR_BADINPUT;
+  }
+  fill_binary_idx(kruskal->dims, nmodes, &header, fin);
+
+  idx_t its;
+  val_t fit;
+  fill_binary_idx(&its, 1, &header, fin);
+  fill_binary_val(&fit, 1, &header, fin);
+
+  kruskal->nmodes = nmodes;
+  kruskal->rank = rank;
+  kruskal->fit = fit;
+  kruskal->lambda = splatt_malloc(rank * sizeof(*(kruskal->lambda)));
+  fill_binary_val(kruskal->lambda, rank, &header, fin);
+  for(idx_t m=0; m < nmodes; ++m) {
+    idx_t const len = kruskal->dims[m] * rank;
+    kruskal->factors[m] = splatt_malloc(len * sizeof(val_t));
+    fill_binary_val(kruskal->factors[m], len, &header, fin);
+  }
+
+  int const truncated = feof(fin) || ferror(fin);
+  fclose(fin);
+  timer_stop(&timers[TIMER_IO]);
+
+  if(truncated) {
+    fprintf(stderr, "SPLATT ERROR: checkpoint '%s' is truncated.\n",
+        chkpt->fname);
+    splatt_free_kruskal(kruskal);
+    return SPLATT_ERROR_BADINPUT;
+  }
+
+  chkpt->start_it = its;
+  chkpt->start_fit = fit;
+  return SPLATT_SUCCESS;
+}
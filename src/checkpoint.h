@@ -0,0 +1,142 @@
+#ifndef SPLATT_CHECKPOINT_H
+#define SPLATT_CHECKPOINT_H
+
+#include "base.h"
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include <pthread.h>
+
+
+/******************************************************************************
+ * STRUCTURES
+ *****************************************************************************/
+
+/**
+* @brief Periodic checkpointing of CPD-ALS state. A checkpoint holds the
+*        factor matrices, lambda, the number of completed iterations, and the
+*        fit. Writes are performed asynchronously: the state is copied into a
+*        private buffer and a helper thread writes it to a temporary file which
+*        is then renamed over 'fname'. A crash mid-write thus never corrupts
+*        the previous checkpoint.
+*/
+typedef struct
+{
+  char * fname;       /** File to checkpoint to. */
+  idx_t every_its;    /** Checkpoint every 'every_its' iterations (0 = off). */
+  double every_secs;  /** Checkpoint every 'every_secs' seconds (0 = off). */
+
+  idx_t start_it;     /** Iterations completed before a restart. */
+  double start_fit;   /** Fit at the time of the restart checkpoint. */
+
+  /* private */
+  double last_write;  /** Time of the last checkpoint. */
+  int pending;        /** Is a write in flight? */
+  pthread_t writer;   /** The thread performing the write. */
+  char * buf;         /** Serialized checkpoint. */
+  size_t buf_bytes;   /** Size of the serialized checkpoint. */
+  size_t buf_alloc;   /** Allocated size of 'buf'. */
+} cpd_checkpoint;
+
+
+/* matrix.h pulls in splatt_mpi.h, which needs cpd_checkpoint */
+#include "matrix.h"
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+#define chkpt_alloc splatt_chkpt_alloc
+/**
+* @brief Allocate a checkpoint structure. If both 'every_its' and 'every_secs'
+*        are zero, no checkpoints are written but the structure may still be
+*        used to restart.
+*
+* @param fname The file to write checkpoints to.
+* @param every_its Write a checkpoint every 'every_its' iterations.
+* @param every_secs Write a checkpoint every 'every_secs' seconds.
+*
+* @return The allocated checkpoint, to be freed with chkpt_free().
+*/
+cpd_checkpoint * chkpt_alloc(
+    char const * const fname,
+    idx_t const every_its,
+    double const every_secs);
+
+
+#define chkpt_free splatt_chkpt_free
+/**
+* @brief Wait for any pending writes and free a checkpoint structure.
+*
+* @param chkpt The checkpoint to free.
+*/
+void chkpt_free(
+    cpd_checkpoint * chkpt);
+
+
+#define chkpt_due splatt_chkpt_due
+/**
+* @brief Determine whether a checkpoint should be written.
+*
+* @param chkpt The checkpoint structure. May be NULL.
+* @param its The number of completed iterations.
+*
+* @return 1 if a checkpoint is due, 0 otherwise.
+*/
+int chkpt_due(
+    cpd_checkpoint const * const chkpt,
+    idx_t const its);
+
+
+#define chkpt_write splatt_chkpt_write
+/**
+* @brief Snapshot the current state and write it in the background. If a
+*        previous write is still in flight, we first wait for it to finish.
+*
+* @param chkpt The checkpoint structure.
+* @param nmodes The number of modes.
+* @param mats The factor matrices.
+* @param lambda The column weights.
+* @param its The number of completed iterations.
+* @param fit The current fit.
+*/
+void chkpt_write(
+    cpd_checkpoint * const chkpt,
+    idx_t const nmodes,
+    matrix_t ** mats,
+    val_t const * const lambda,
+    idx_t const its,
+    double const fit);
+
+
+#define chkpt_wait splatt_chkpt_wait
+/**
+* @brief Block until any pending checkpoint write has finished.
+*
+* @param chkpt The checkpoint structure. May be NULL.
+*/
+void chkpt_wait(
+    cpd_checkpoint * const chkpt);
+
+
+#define chkpt_read splatt_chkpt_read
+/**
+* @brief Read a checkpoint written by chkpt_write(). The iteration count and
+*        fit are stored in chkpt->start_it and chkpt->start_fit so that
+*        CPD-ALS resumes where it left off.
+*
+* @param chkpt The checkpoint structure. chkpt->fname is read.
+* @param[out] kruskal The stored factorization. Must be freed with
+*                     splatt_free_kruskal().
+*
+* @return SPLATT_SUCCESS on success.
+*/
+int chkpt_read(
+    cpd_checkpoint * const chkpt,
+    splatt_kruskal * const kruskal);
+
+#endif
@@ -275,7 +275,7 @@ int splatt_bench(
   }
 
   perm_free(opts.perm);
-  free(opts.threads);
+  splatt_free(opts.threads);
   for(idx_t m=0; m < tt->nmodes; ++m) {
     mat_free(mats[m]);
   }
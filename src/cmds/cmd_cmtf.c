@@ -0,0 +1,316 @@
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "splatt_cmds.h"
+#include "../io.h"
+#include "../sptensor.h"
+#include "../stats.h"
+#include "../cmtf.h"
+
+
+/******************************************************************************
+ * SPLATT CMTF
+ *****************************************************************************/
+static char cmtf_args_doc[] = "TENSOR";
+static char cmtf_doc[] =
+  "splatt-cmtf -- Compute a coupled matrix-tensor factorization.\n\n"
+  "Each --couple=MODE:FILE names a sparse matrix (in coordinate format, one\n"
+  "'row col value' per line) whose rows are the indices of MODE. The matrix\n"
+  "shares its factor with MODE of TENSOR.\n";
+
+#define TT_COUPLE 251
+#define TT_REG 252
+#define TT_SEED 253
+#define TT_NOWRITE 254
+#define TT_TOL 255
+static struct argp_option cmtf_options[] = {
+  {"iters", 'i', "NITERS", 0, "maximum number of iterations to use "
+                              "(default: 50)"},
+  {"tol", TT_TOL, "TOLERANCE", 0, "minimum change for convergence "
+                                  "(default: 1e-5)"},
+  {"reg", TT_REG, "REGULARIZATION", 0, "regularization parameter "
+                                       "(default: 0)"},
+  {"rank", 'r', "RANK", 0, "rank of decomposition to find (default: 10)"},
+  {"threads", 't', "NTHREADS", 0, "number of threads to use (default: #cores)"},
+  {"couple", TT_COUPLE, "MODE:FILE", 0, "couple a matrix to MODE (may be "
+                                        "repeated, once per mode)"},
+  {"nowrite", TT_NOWRITE, 0, 0, "do not write output to file"},
+  {"seed", TT_SEED, "SEED", 0, "random seed (default: system time)"},
+  {"verbose", 'v', 0, 0, "turn on verbose output (default: no)"},
+  {"stem", 's', "PATH", 0, "file stem for output files (default: ./)"},
+  { 0 }
+};
+
+
+typedef struct
+{
+  char * ifname;   /** file that we read the tensor from */
+  char * couplenames[MAX_NMODES]; /** coupled matrix of each mode, or NULL */
+  char * stem;     /** file stem */
+  int write;       /** do we write output to file? */
+  double * opts;   /** splatt options */
+  idx_t nfactors;
+} cmtf_cmd_args;
+
+
+/**
+* @brief Fill a cmtf_cmd_args struct with default values.
+*
+* @param args The struct to fill.
+*/
+static void default_cmtf_opts(
+  cmtf_cmd_args * args)
+{
+  args->opts = splatt_default_opts();
+  args->ifname    = NULL;
+  args->stem      = NULL;
+  args->write     = DEFAULT_WRITE;
+  args->nfactors  = DEFAULT_NFACTORS;
+  for(idx_t m=0; m < MAX_NMODES; ++m) {
+    args->couplenames[m] = NULL;
+  }
+}
+
+
+static error_t parse_cmtf_opt(
+  int key,
+  char * arg,
+  struct argp_state * state)
+{
+  cmtf_cmd_args * args = state->input;
+  char * colon = NULL;
+  int mode;
+
+  /* -i=50 should also work... */
+  if(arg != NULL && arg[0] == '=') {
+    ++arg;
+  }
+
+  switch(key) {
+  case 'i':
+    args->opts[SPLATT_OPTION_NITER] = (double) atoi(arg);
+    break;
+  case TT_TOL:
+    args->opts[SPLATT_OPTION_TOLERANCE] = atof(arg);
+    break;
+  case TT_REG:
+    args->opts[SPLATT_OPTION_REGULARIZE] = atof(arg);
+    break;
+  case 't':
+    args->opts[SPLATT_OPTION_NTHREADS] = (double) atoi(arg);
+    splatt_omp_set_num_threads((int)args->opts[SPLATT_OPTION_NTHREADS]);
+    break;
+  case 'v':
+    timer_inc_verbose();
+    args->opts[SPLATT_OPTION_VERBOSITY] += 1;
+    break;
+  case TT_NOWRITE:
+    args->write = 0;
+    break;
+  case 'r':
+    args->nfactors = atoi(arg);
+    break;
+  case 's':
+    args->stem = arg;
+    break;
+  case TT_COUPLE:
+    colon = strchr(arg, ':');
+    mode = atoi(arg);
+    if(colon == NULL || colon[1] == '\0' || mode < 1 ||
+        (idx_t) mode > MAX_NMODES) {
+      fprintf(stderr, "SPLATT: --couple expects MODE:FILE.\n");
+      argp_usage(state);
+      break;
+    }
+    if(args->couplenames[mode-1] != NULL) {
+      fprintf(stderr, "SPLATT: mode %d is already coupled.\n", mode);
+      argp_usage(state);
+      break;
+    }
+    args->couplenames[mode-1] = colon + 1;
+    break;
+  case TT_SEED:
+    args->opts[SPLATT_OPTION_RANDSEED] = atoi(arg);
+    break;
+
+  case ARGP_KEY_ARG:
+    if(args->ifname != NULL) {
+      argp_usage(state);
+      break;
+    }
+    args->ifname = arg;
+    break;
+  case ARGP_KEY_END:
+    if(args->ifname == NULL) {
+      argp_usage(state);
+      break;
+    }
+  }
+  return 0;
+}
+
+static struct argp cmtf_argp =
+  {cmtf_options, parse_cmtf_opt, cmtf_args_doc, cmtf_doc};
+
+
+/**
+* @brief Read a coupled matrix stored as a two-mode coordinate tensor.
+*
+* @param fname The file to read.
+* @param nrows The length of the coupled mode. The matrix may not have more
+*              rows, and rows which do not appear in the file are empty.
+*
+* @return The matrix in CSR format, or NULL on error.
+*/
+static spmatrix_t * p_read_coupled(
+  char const * const fname,
+  idx_t const nrows)
+{
+  sptensor_t * tt = tt_read(fname);
+  if(tt == NULL) {
+    return NULL;
+  }
+  if(tt->nmodes != 2 || tt->dims[0] > nrows) {
+    fprintf(stderr, "SPLATT ERROR: '%s' must be a matrix with at most "
+        "%"SPLATT_PF_IDX" rows.\n", fname, nrows);
+    tt_free(tt);
+    return NULL;
+  }
+  tt->dims[0] = nrows;
+  spmatrix_t * mat = tt_unfold(tt, 0);
+  tt_free(tt);
+  return mat;
+}
+
+
+/******************************************************************************
+ * SPLATT-CMTF
+ *****************************************************************************/
+int splatt_cmtf_cmd(
+  int argc,
+  char ** argv)
+{
+  /* assign defaults and parse arguments */
+  cmtf_cmd_args args;
+  default_cmtf_opts(&args);
+  argp_parse(&cmtf_argp, argc, argv, ARGP_IN_ORDER, 0, &args);
+  srand(args.opts[SPLATT_OPTION_RANDSEED]);
+
+  print_header();
+
+  sptensor_t * tt = tt_read(args.ifname);
+  if(tt == NULL) {
+    return SPLATT_ERROR_BADINPUT;
+  }
+  idx_t const nmodes = tt->nmodes;
+
+  spmatrix_t * coupled[MAX_NMODES];
+  for(idx_t m=0; m < MAX_NMODES; ++m) {
+    coupled[m] = NULL;
+  }
+  for(idx_t m=0; m < MAX_NMODES; ++m) {
+    if(args.couplenames[m] == NULL) {
+      continue;
+    }
+    if(m >= nmodes) {
+      fprintf(stderr, "SPLATT ERROR: cannot couple mode %"SPLATT_PF_IDX" of "
+          "a %"SPLATT_PF_IDX"-mode tensor.\n", m+1, nmodes);
+      return SPLATT_ERROR_BADINPUT;
+    }
+    coupled[m] = p_read_coupled(args.couplenames[m], tt->dims[m]);
+    if(coupled[m] == NULL) {
+      return SPLATT_ERROR_BADINPUT;
+    }
+  }
+
+  splatt_verbosity_type which_verb = args.opts[SPLATT_OPTION_VERBOSITY];
+  if(which_verb >= SPLATT_VERBOSITY_LOW) {
+    stats_tt(tt, args.ifname, STATS_BASIC, 0, NULL);
+    for(idx_t m=0; m < nmodes; ++m) {
+      if(coupled[m] != NULL) {
+        printf("COUPLED MODE=%"SPLATT_PF_IDX" FILE=%s DIMS=%"SPLATT_PF_IDX"x"
+            "%"SPLATT_PF_IDX" NNZ=%"SPLATT_PF_IDX"\n", m+1,
+            args.couplenames[m], coupled[m]->I, coupled[m]->J,
+            coupled[m]->nnz);
+      }
+    }
+    printf("\nFactoring "
+           "------------------------------------------------------\n");
+    printf("NFACTORS=%"SPLATT_PF_IDX" MAXITS=%"SPLATT_PF_IDX" TOL=%0.1e "
+           "REG=%0.1e SEED=%d THREADS=%"SPLATT_PF_IDX"\n\n", args.nfactors,
+        (idx_t) args.opts[SPLATT_OPTION_NITER],
+        args.opts[SPLATT_OPTION_TOLERANCE],
+        args.opts[SPLATT_OPTION_REGULARIZE],
+        (int) args.opts[SPLATT_OPTION_RANDSEED],
+        (idx_t) args.opts[SPLATT_OPTION_NTHREADS]);
+  }
+
+  splatt_csf * csf = splatt_csf_alloc(tt, args.opts);
+  tt_free(tt);
+
+  splatt_kruskal model;
+  matrix_t * side[MAX_NMODES];
+  int ret = cmtf_factorize(csf, coupled, args.nfactors, args.opts, &model,
+      side);
+  if(ret != SPLATT_SUCCESS) {
+    fprintf(stderr, "splatt_cmtf_factorize returned %d. Aborting.\n", ret);
+    return ret;
+  }
+  printf("Final fit: %0.5f\n", model.fit);
+
+  /* write output */
+  if(args.write == 1) {
+    char * lambda_name = NULL;
+    if(args.stem) {
+      asprintf(&lambda_name, "%s.lambda.mat", args.stem);
+    } else {
+      asprintf(&lambda_name, "lambda.mat");
+    }
+    vec_write(model.lambda, args.nfactors, lambda_name);
+    free(lambda_name);
+
+    for(idx_t m=0; m < nmodes; ++m) {
+      char * matfname = NULL;
+      if(args.stem) {
+        asprintf(&matfname, "%s.mode%"SPLATT_PF_IDX".mat", args.stem, m+1);
+      } else {
+        asprintf(&matfname, "mode%"SPLATT_PF_IDX".mat", m+1);
+      }
+
+      matrix_t tmpmat;
+      tmpmat.rowmajor = 1;
+      tmpmat.I = model.dims[m];
+      tmpmat.J = args.nfactors;
+      tmpmat.vals = model.factors[m];
+
+      mat_write(&tmpmat, matfname);
+      free(matfname);
+
+      /* Y ~= modeM * coupledM^T */
+      if(side[m] != NULL) {
+        if(args.stem) {
+          asprintf(&matfname, "%s.coupled%"SPLATT_PF_IDX".mat", args.stem,
+              m+1);
+        } else {
+          asprintf(&matfname, "coupled%"SPLATT_PF_IDX".mat", m+1);
+        }
+        mat_write(side[m], matfname);
+        free(matfname);
+      }
+    }
+  }
+
+  /* cleanup */
+  for(idx_t m=0; m < nmodes; ++m) {
+    if(coupled[m] != NULL) {
+      spmat_free(coupled[m]);
+      mat_free(side[m]);
+    }
+  }
+  splatt_free_csf(csf, args.opts);
+  splatt_free_opts(args.opts);
+  splatt_free_kruskal(&model);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,265 @@
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "splatt_cmds.h"
+#include "../io.h"
+#include "../sptensor.h"
+#include "../stats.h"
+#include "../completion.h"
+
+
+/******************************************************************************
+ * SPLATT COMPLETE
+ *****************************************************************************/
+static char complete_args_doc[] = "TRAIN";
+static char complete_doc[] =
+  "splatt-complete -- Complete a tensor with missing entries.\n\n"
+  "Entries which are not in TRAIN are treated as unknown, not zero.\n";
+
+#define TT_STEP 249
+#define TT_VALID 250
+#define TT_ALG 251
+#define TT_REG 252
+#define TT_SEED 253
+#define TT_NOWRITE 254
+#define TT_TOL 255
+static struct argp_option complete_options[] = {
+  {"iters", 'i', "NITERS", 0, "maximum number of epochs (default: 50)"},
+  {"tol", TT_TOL, "TOLERANCE", 0, "minimum change in RMSE for convergence "
+                                  "(default: 1e-5)"},
+  {"reg", TT_REG, "REGULARIZATION", 0, "regularization parameter "
+                                       "(default: 1e-2)"},
+  {"rank", 'r', "RANK", 0, "rank of the model (default: 10)"},
+  {"threads", 't', "NTHREADS", 0, "number of threads to use (default: #cores)"},
+  {"alg", TT_ALG, "ALG", 0, "completion algorithm {als,sgd,ccd} "
+                            "default: als"},
+  {"valid", TT_VALID, "FILE", 0, "held-out entries used to measure RMSE and "
+                                 "convergence"},
+  {"step", TT_STEP, "STEP", 0, "sgd: initial step size (default: 1e-3)"},
+  {"nowrite", TT_NOWRITE, 0, 0, "do not write output to file"},
+  {"seed", TT_SEED, "SEED", 0, "random seed (default: system time)"},
+  {"verbose", 'v', 0, 0, "turn on verbose output (default: no)"},
+  {"stem", 's', "PATH", 0, "file stem for output files (default: ./)"},
+  { 0 }
+};
+
+
+typedef struct
+{
+  char * ifname;   /** file that we read the training tensor from */
+  char * valname;  /** file that we read the validation tensor from */
+  char * stem;     /** file stem */
+  splatt_tc_type alg; /** which algorithm to use */
+  int write;       /** do we write output to file? */
+  double * opts;   /** splatt options */
+  idx_t nfactors;
+} complete_cmd_args;
+
+
+/**
+* @brief Fill a complete_cmd_args struct with default values.
+*
+* @param args The struct to fill.
+*/
+static void default_complete_opts(
+  complete_cmd_args * args)
+{
+  args->opts = splatt_default_opts();
+  /* unregularized completion is ill-posed for rarely observed rows */
+  args->opts[SPLATT_OPTION_REGULARIZE] = 1e-2;
+  args->ifname    = NULL;
+  args->valname   = NULL;
+  args->stem      = NULL;
+  args->alg       = SPLATT_TC_ALS;
+  args->write     = DEFAULT_WRITE;
+  args->nfactors  = DEFAULT_NFACTORS;
+}
+
+
+static error_t parse_complete_opt(
+  int key,
+  char * arg,
+  struct argp_state * state)
+{
+  complete_cmd_args * args = state->input;
+
+  /* -i=50 should also work... */
+  if(arg != NULL && arg[0] == '=') {
+    ++arg;
+  }
+
+  switch(key) {
+  case 'i':
+    args->opts[SPLATT_OPTION_NITER] = (double) atoi(arg);
+    break;
+  case TT_TOL:
+    args->opts[SPLATT_OPTION_TOLERANCE] = atof(arg);
+    break;
+  case TT_REG:
+    args->opts[SPLATT_OPTION_REGULARIZE] = atof(arg);
+    break;
+  case 't':
+    args->opts[SPLATT_OPTION_NTHREADS] = (double) atoi(arg);
+    splatt_omp_set_num_threads((int)args->opts[SPLATT_OPTION_NTHREADS]);
+    break;
+  case 'v':
+    timer_inc_verbose();
+    args->opts[SPLATT_OPTION_VERBOSITY] += 1;
+    break;
+  case TT_NOWRITE:
+    args->write = 0;
+    break;
+  case 'r':
+    args->nfactors = atoi(arg);
+    break;
+  case 's':
+    args->stem = arg;
+    break;
+  case TT_VALID:
+    args->valname = arg;
+    break;
+  case TT_STEP:
+    args->opts[SPLATT_OPTION_LEARNRATE] = atof(arg);
+    break;
+  case TT_ALG:
+    if(strcmp("als", arg) == 0) {
+      args->alg = SPLATT_TC_ALS;
+    } else if(strcmp("sgd", arg) == 0) {
+      args->alg = SPLATT_TC_SGD;
+    } else if(strcmp("ccd", arg) == 0) {
+      args->alg = SPLATT_TC_CCD;
+    } else {
+      fprintf(stderr, "SPLATT: --alg option '%s' not recognized.\n", arg);
+      argp_usage(state);
+    }
+    break;
+  case TT_SEED:
+    args->opts[SPLATT_OPTION_RANDSEED] = atoi(arg);
+    break;
+
+  case ARGP_KEY_ARG:
+    if(args->ifname != NULL) {
+      argp_usage(state);
+      break;
+    }
+    args->ifname = arg;
+    break;
+  case ARGP_KEY_END:
+    if(args->ifname == NULL) {
+      argp_usage(state);
+      break;
+    }
+  }
+  return 0;
+}
+
+static struct argp complete_argp =
+  {complete_options, parse_complete_opt, complete_args_doc, complete_doc};
+
+
+/******************************************************************************
+ * SPLATT-COMPLETE
+ *****************************************************************************/
+int splatt_complete_cmd(
+  int argc,
+  char ** argv)
+{
+  /* assign defaults and parse arguments */
+  complete_cmd_args args;
+  default_complete_opts(&args);
+  argp_parse(&complete_argp, argc, argv, ARGP_IN_ORDER, 0, &args);
+  srand(args.opts[SPLATT_OPTION_RANDSEED]);
+
+  print_header();
+
+  sptensor_t * train = tt_read(args.ifname);
+  if(train == NULL) {
+    return SPLATT_ERROR_BADINPUT;
+  }
+  sptensor_t * validate = NULL;
+  if(args.valname != NULL) {
+    validate = tt_read(args.valname);
+    if(validate == NULL) {
+      return SPLATT_ERROR_BADINPUT;
+    }
+  }
+
+  splatt_verbosity_type which_verb = args.opts[SPLATT_OPTION_VERBOSITY];
+  if(which_verb >= SPLATT_VERBOSITY_LOW) {
+    stats_tt(train, args.ifname, STATS_BASIC, 0, NULL);
+    if(validate != NULL) {
+      printf("VALIDATION=%s NNZ=%"SPLATT_PF_IDX"\n\n", args.valname,
+          validate->nnz);
+    }
+
+    char const * const algs[] = { "ALS", "SGD", "CCD++" };
+    printf("Completing "
+           "-----------------------------------------------------\n");
+    printf("NFACTORS=%"SPLATT_PF_IDX" MAXITS=%"SPLATT_PF_IDX" TOL=%0.1e "
+           "REG=%0.1e ALG=%s ", args.nfactors,
+        (idx_t) args.opts[SPLATT_OPTION_NITER],
+        args.opts[SPLATT_OPTION_TOLERANCE],
+        args.opts[SPLATT_OPTION_REGULARIZE], algs[args.alg]);
+    if(args.alg == SPLATT_TC_SGD) {
+      printf("STEP=%0.1e ", args.opts[SPLATT_OPTION_LEARNRATE]);
+    }
+    printf("SEED=%d THREADS=%"SPLATT_PF_IDX"\n\n",
+        (int) args.opts[SPLATT_OPTION_RANDSEED],
+        (idx_t) args.opts[SPLATT_OPTION_NTHREADS]);
+  }
+
+  splatt_kruskal model;
+  int ret = tc_complete(train, validate, args.nfactors, args.alg, args.opts,
+      &model);
+  if(ret != SPLATT_SUCCESS) {
+    fprintf(stderr, "splatt_tc_complete returned %d. Aborting.\n", ret);
+    return ret;
+  }
+
+  if(validate != NULL) {
+    printf("Final validation RMSE: %0.5e\n", model.fit);
+  } else {
+    printf("Final training RMSE: %0.5e\n", model.fit);
+  }
+
+  /* write output */
+  if(args.write == 1) {
+    char * lambda_name = NULL;
+    if(args.stem) {
+      asprintf(&lambda_name, "%s.lambda.mat", args.stem);
+    } else {
+      asprintf(&lambda_name, "lambda.mat");
+    }
+    vec_write(model.lambda, args.nfactors, lambda_name);
+    free(lambda_name);
+
+    for(idx_t m=0; m < model.nmodes; ++m) {
+      char * matfname = NULL;
+      if(args.stem) {
+        asprintf(&matfname, "%s.mode%"SPLATT_PF_IDX".mat", args.stem, m+1);
+      } else {
+        asprintf(&matfname, "mode%"SPLATT_PF_IDX".mat", m+1);
+      }
+
+      matrix_t tmpmat;
+      tmpmat.rowmajor = 1;
+      tmpmat.I = model.dims[m];
+      tmpmat.J = args.nfactors;
+      tmpmat.vals = model.factors[m];
+
+      mat_write(&tmpmat, matfname);
+      free(matfname);
+    }
+  }
+
+  /* cleanup */
+  tt_free(train);
+  if(validate != NULL) {
+    tt_free(validate);
+  }
+  splatt_free_opts(args.opts);
+  splatt_free_kruskal(&model);
+
+  return EXIT_SUCCESS;
+}
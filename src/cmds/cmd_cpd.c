@@ -8,15 +8,44 @@
 #include "../stats.h"
 #include "../thd_info.h"
 #include "../cpd.h"
+#include "../cprand.h"
+#include "../cpapr.h"
+#include "../gcp.h"
 
 
 /******************************************************************************
  * SPLATT CPD
  *****************************************************************************/
+/* The available CPD algorithms. */
+typedef enum
+{
+  CPD_ALG_ALS,  /** alternating least squares */
+  CPD_ALG_RAND, /** randomized (sketched) ALS */
+  CPD_ALG_HALS, /** non-negative hierarchical ALS */
+  CPD_ALG_APR,  /** Poisson CP-APR for count data */
+  CPD_ALG_GCP   /** generalized CPD with a selectable loss */
+} cpd_alg_type;
+
 static char cpd_args_doc[] = "TENSOR";
 static char cpd_doc[] =
   "splatt-cpd -- Compute the CPD of a sparse tensor.\n";
 
+#define TT_SVDINIT 234
+#define TT_PP 235
+#define TT_STEP 236
+#define TT_LOSS 237
+#define TT_RANKS 238
+#define TT_RESTARTS 239
+#define TT_L1 240
+#define TT_FITFREQ 241
+#define TT_SAMPLES 242
+#define TT_ALG 243
+#define TT_LINESEARCH 244
+#define TT_RESTART 245
+#define TT_CHKPT_SECS 246
+#define TT_CHKPT_ITS 247
+#define TT_CHKPT 248
+#define TT_INIT 249
 #define TT_CSF 250
 #define TT_REG 251
 #define TT_SEED 252
@@ -36,6 +65,43 @@ static struct argp_option cpd_options[] = {
   {"verbose", 'v', 0, 0, "turn on verbose output (default: no)"},
   {"stem", 's', "PATH", 0, "file stem for factorization output files (default: ./)"},
   {"nncpd", 'n', 0, 0, "perform non-negative cpd"},
+  {"l1", TT_L1, "PENALTY", 0, "L1 penalty to encourage sparse factors "
+                              "(default: 0)"},
+  {"init", TT_INIT, "STEM", 0, "initialize from factors previously written "
+                               "with --stem=STEM"},
+  {"checkpoint", TT_CHKPT, "FILE", 0, "periodically checkpoint to FILE"},
+  {"chkpt-its", TT_CHKPT_ITS, "NITERS", 0, "checkpoint every NITERS iterations "
+                                           "(default: 10)"},
+  {"chkpt-secs", TT_CHKPT_SECS, "SECONDS", 0, "checkpoint every SECONDS "
+                                              "seconds"},
+  {"restart", TT_RESTART, 0, 0, "resume from the --checkpoint FILE"},
+  {"ranks", TT_RANKS, "FIRST:LAST[:STEP]", 0, "factor at each rank from FIRST "
+                                              "to LAST, seeding each from the "
+                                              "last (default STEP: 1)"},
+  {"restarts", TT_RESTARTS, "NSTARTS", 0, "run NSTARTS random "
+                                         "initializations concurrently and "
+                                         "keep the best (default: 1)"},
+  {"linesearch", TT_LINESEARCH, 0, 0, "extrapolate factors between "
+                                      "iterations to accelerate convergence"},
+  {"svd-init", TT_SVDINIT, 0, 0, "als: start from the leading singular "
+                                 "vectors of each unfolding instead of "
+                                 "random factors"},
+  {"pp", TT_PP, "TOL", 0, "approximate MTTKRP by pairwise perturbation once "
+                          "factors change by less than TOL per iteration "
+                          "(e.g., 0.1; default: off)"},
+  {"alg", TT_ALG, "ALG", 0, "CPD algorithm {als,rand,hals,apr,gcp} "
+                            "default: als"},
+  {"samples", TT_SAMPLES, "NSAMPLES", 0, "rand: fibers sampled per factor "
+                                         "update (default: 10% of fibers); "
+                                         "gcp: nonzeros and zeros sampled "
+                                         "per step (default: 1% of nnz)"},
+  {"loss", TT_LOSS, "LOSS", 0, "gcp: elementwise loss "
+                               "{gaussian,bernoulli,poisson,gamma} "
+                               "default: gaussian"},
+  {"step", TT_STEP, "STEP", 0, "gcp: initial Adam step size "
+                               "(default: 1e-3)"},
+  {"fit-freq", TT_FITFREQ, "NITERS", 0, "rand: iterations between exact fit "
+                                        "computations (default: 5)"},
   { 0 }
 };
 
@@ -44,6 +110,14 @@ typedef struct
 {
   char * ifname;   /** file that we read the tensor from */
   char * stem;   /** file stem */
+  char * init;     /** file stem of initial factors */
+  char * chkpt;    /** checkpoint file */
+  idx_t chkpt_its; /** checkpoint frequency (iterations) */
+  double chkpt_secs; /** checkpoint frequency (seconds) */
+  int restart;     /** restart from checkpoint? */
+  idx_t nstarts;   /** number of random initializations */
+  idx_t sweep[3];  /** first, last, and step of a rank sweep (0 if none) */
+  cpd_alg_type alg; /** which algorithm to use */
   int write;       /** do we write output to file? */
   double * opts;   /** splatt_cpd options */
   idx_t nfactors;
@@ -60,6 +134,16 @@ static void default_cpd_opts(
 {
   args->opts = splatt_default_opts();
   args->stem = NULL;
+  args->init = NULL;
+  args->chkpt = NULL;
+  args->chkpt_its = 0;
+  args->chkpt_secs = 0.;
+  args->restart = 0;
+  args->nstarts = 1;
+  args->sweep[0] = 0;
+  args->sweep[1] = 0;
+  args->sweep[2] = 1;
+  args->alg = CPD_ALG_ALS;
   args->ifname    = NULL;
   args->write     = DEFAULT_WRITE;
   args->nfactors  = DEFAULT_NFACTORS;
@@ -81,6 +165,7 @@ static error_t parse_cpd_opt(
   cpd_cmd_args * args = state->input;
   char * buf;
   int cnt = 0;
+  splatt_loss_type loss;
 
   /* -i=50 should also work... */
   if(arg != NULL && arg[0] == '=') {
@@ -114,12 +199,87 @@ static error_t parse_cpd_opt(
   case 'n':
     args->opts[SPLATT_OPTION_NNCPD] = 1;
     break;
+  case TT_L1:
+    args->opts[SPLATT_OPTION_L1] = atof(arg);
+    break;
   case 'r':
     args->nfactors = atoi(arg);
     break;
   case 's':
     args->stem = arg;
     break;
+  case TT_INIT:
+    args->init = arg;
+    break;
+  case TT_CHKPT:
+    args->chkpt = arg;
+    break;
+  case TT_CHKPT_ITS:
+    args->chkpt_its = atoi(arg);
+    break;
+  case TT_CHKPT_SECS:
+    args->chkpt_secs = atof(arg);
+    break;
+  case TT_RESTART:
+    args->restart = 1;
+    break;
+  case TT_RANKS:
+    buf = strtok(arg, ":");
+    while(buf != NULL && cnt < 3) {
+      args->sweep[cnt++] = strtoull(buf, NULL, 10);
+      buf = strtok(NULL, ":");
+    }
+    if(cnt < 2 || args->sweep[0] == 0 || args->sweep[1] < args->sweep[0] ||
+        args->sweep[2] == 0) {
+      fprintf(stderr, "SPLATT: --ranks expects FIRST:LAST[:STEP] with "
+                      "0 < FIRST <= LAST and STEP > 0.\n");
+      argp_usage(state);
+    }
+    break;
+  case TT_RESTARTS:
+    args->nstarts = atoi(arg);
+    break;
+  case TT_LINESEARCH:
+    args->opts[SPLATT_OPTION_LINESEARCH] = 1;
+    break;
+  case TT_PP:
+    args->opts[SPLATT_OPTION_PPTOL] = atof(arg);
+    break;
+  case TT_SVDINIT:
+    args->opts[SPLATT_OPTION_INIT] = SPLATT_INIT_SVD;
+    break;
+  case TT_ALG:
+    if(strcmp("als", arg) == 0) {
+      args->alg = CPD_ALG_ALS;
+    } else if(strcmp("rand", arg) == 0) {
+      args->alg = CPD_ALG_RAND;
+    } else if(strcmp("hals", arg) == 0) {
+      args->alg = CPD_ALG_HALS;
+    } else if(strcmp("apr", arg) == 0) {
+      args->alg = CPD_ALG_APR;
+    } else if(strcmp("gcp", arg) == 0) {
+      args->alg = CPD_ALG_GCP;
+    } else {
+      fprintf(stderr, "SPLATT: --alg option '%s' not recognized.\n", arg);
+      argp_usage(state);
+    }
+    break;
+  case TT_SAMPLES:
+    args->opts[SPLATT_OPTION_NSAMPLES] = (double) atoi(arg);
+    break;
+  case TT_FITFREQ:
+    args->opts[SPLATT_OPTION_FITFREQ] = (double) atoi(arg);
+    break;
+  case TT_LOSS:
+    if(!gcp_parse_loss(arg, &loss)) {
+      fprintf(stderr, "SPLATT: --loss option '%s' not recognized.\n", arg);
+      argp_usage(state);
+    }
+    args->opts[SPLATT_OPTION_LOSS] = loss;
+    break;
+  case TT_STEP:
+    args->opts[SPLATT_OPTION_LEARNRATE] = atof(arg);
+    break;
   case TT_CSF:
     if(strcmp("one", arg) == 0) {
       args->opts[SPLATT_OPTION_CSF_ALLOC] = SPLATT_CSF_ONEMODE;
@@ -149,6 +309,81 @@ static error_t parse_cpd_opt(
       argp_usage(state);
       break;
     }
+    if(args->restart && args->chkpt == NULL) {
+      fprintf(stderr, "SPLATT: --restart requires --checkpoint.\n");
+      argp_usage(state);
+      break;
+    }
+    if(args->restart && args->init != NULL) {
+      fprintf(stderr, "SPLATT: --restart and --init are exclusive.\n");
+      argp_usage(state);
+      break;
+    }
+    if(args->nstarts == 0) {
+      fprintf(stderr, "SPLATT: --restarts must be at least 1.\n");
+      argp_usage(state);
+      break;
+    }
+    if(args->nstarts > 1 && (args->init || args->chkpt ||
+        args->alg == CPD_ALG_RAND || args->alg == CPD_ALG_APR ||
+        args->alg == CPD_ALG_GCP)) {
+      fprintf(stderr, "SPLATT: --restarts requires --alg=als or --alg=hals "
+                      "and does not support --init or --checkpoint.\n");
+      argp_usage(state);
+      break;
+    }
+    if(args->sweep[0] > 0 && (args->init || args->chkpt ||
+        args->nstarts > 1 || args->alg == CPD_ALG_RAND ||
+        args->alg == CPD_ALG_APR || args->alg == CPD_ALG_GCP)) {
+      fprintf(stderr, "SPLATT: --ranks requires --alg=als or --alg=hals "
+                      "and does not support --init, --checkpoint, or "
+                      "--restarts.\n");
+      argp_usage(state);
+      break;
+    }
+    if(args->chkpt && args->chkpt_its == 0 && args->chkpt_secs == 0.) {
+      args->chkpt_its = 10;
+    }
+    /* options which only the ALS loop understands */
+    bool const als_only = args->init || args->chkpt ||
+        args->opts[SPLATT_OPTION_INIT] == SPLATT_INIT_SVD ||
+        args->opts[SPLATT_OPTION_PPTOL] > 0.;
+    if(args->alg == CPD_ALG_RAND) {
+      if(als_only) {
+        fprintf(stderr, "SPLATT: --alg=rand does not support --init, "
+                        "--svd-init, --checkpoint, or --pp.\n");
+        argp_usage(state);
+        break;
+      }
+      /* one tensor per mode, each with that mode at the leaves */
+      args->opts[SPLATT_OPTION_CSF_ALLOC] = SPLATT_CSF_ALLMODE;
+      args->opts[SPLATT_OPTION_TILE] = SPLATT_NOTILE;
+    }
+    if(args->alg == CPD_ALG_HALS) {
+      /* HALS is an ALS variant for non-negative factors */
+      args->opts[SPLATT_OPTION_NNCPD] = 1;
+      args->opts[SPLATT_OPTION_NNSOLVER] = SPLATT_NNSOLVER_HALS;
+    }
+    if(args->alg == CPD_ALG_APR) {
+      if(als_only) {
+        fprintf(stderr, "SPLATT: --alg=apr does not support --init, "
+                        "--svd-init, --checkpoint, or --pp.\n");
+        argp_usage(state);
+        break;
+      }
+      /* each mode is updated from the tensor rooted at that mode */
+      args->opts[SPLATT_OPTION_CSF_ALLOC] = SPLATT_CSF_ALLMODE;
+    }
+    if(args->alg == CPD_ALG_GCP) {
+      if(als_only) {
+        fprintf(stderr, "SPLATT: --alg=gcp does not support --init, "
+                        "--svd-init, --checkpoint, or --pp.\n");
+        argp_usage(state);
+        break;
+      }
+      /* GCP samples the coordinate tensor; CSF is only used for stats */
+      args->opts[SPLATT_OPTION_CSF_ALLOC] = SPLATT_CSF_ONEMODE;
+    }
   }
   return 0;
 }
@@ -157,6 +392,57 @@ static struct argp cpd_argp =
   {cpd_options, parse_cpd_opt, cpd_args_doc, cpd_doc};
 
 
+/**
+* @brief Factor at each rank of a sweep and print fit and time versus rank.
+*        Only the largest factorization is kept.
+*
+* @param csf The tensor to factor.
+* @param args The parsed arguments. args->nfactors is set to the final rank.
+* @param[out] factored The factorization at the largest rank.
+*
+* @return SPLATT error code.
+*/
+static int p_rank_sweep(
+  splatt_csf const * const csf,
+  cpd_cmd_args * const args,
+  splatt_kruskal * factored)
+{
+  idx_t const nranks = 1 + ((args->sweep[1] - args->sweep[0]) / args->sweep[2]);
+  idx_t * ranks = splatt_malloc(nranks * sizeof(*ranks));
+  for(idx_t r=0; r < nranks; ++r) {
+    ranks[r] = args->sweep[0] + (r * args->sweep[2]);
+  }
+
+  splatt_kruskal * all = splatt_malloc(nranks * sizeof(*all));
+  double * seconds = splatt_malloc(nranks * sizeof(*seconds));
+
+  int const ret = splatt_cpd_als_sweep(csf, ranks, nranks, args->opts, all,
+      seconds);
+  if(ret == SPLATT_SUCCESS) {
+    printf("Rank sweep -----------------------------------------------------\n");
+    printf("  %6s  %9s  %11s  %10s\n", "RANK", "FIT", "DELTA", "TIME");
+    for(idx_t r=0; r < nranks; ++r) {
+      double const delta = (r > 0) ? all[r].fit - all[r-1].fit : all[r].fit;
+      printf("  %6"SPLATT_PF_IDX"  %9.5f  %+11.4e  %9.3fs\n", ranks[r],
+          all[r].fit, delta, seconds[r]);
+    }
+    printf("\n");
+
+    for(idx_t r=0; r < nranks-1; ++r) {
+      splatt_free_kruskal(all + r);
+    }
+    *factored = all[nranks-1];
+    args->nfactors = ranks[nranks-1];
+  }
+
+  splatt_free(ranks);
+  splatt_free(all);
+  splatt_free(seconds);
+  return ret;
+}
+
+
+
 /******************************************************************************
  * SPLATT-CPD
  *****************************************************************************/
@@ -185,10 +471,20 @@ int splatt_cpd_cmd(
     stats_tt(tt, args.ifname, STATS_BASIC, 0, NULL);
   }
 
-  splatt_csf * csf = splatt_csf_alloc(tt, args.opts);
+  splatt_csf * csf = NULL;
+  if(args.alg == CPD_ALG_RAND) {
+    csf = cprand_csf_alloc(tt, args.opts);
+  } else {
+    csf = splatt_csf_alloc(tt, args.opts);
+  }
 
   idx_t nmodes = tt->nmodes;
-  tt_free(tt);
+
+  /* GCP samples the coordinates of nonzeros, so keep them until it is done */
+  if(args.alg != CPD_ALG_GCP) {
+    tt_free(tt);
+    tt = NULL;
+  }
 
   /* print CPD stats? */
   if(which_verb >= SPLATT_VERBOSITY_LOW) {
@@ -196,15 +492,73 @@ int splatt_cpd_cmd(
   }
 
   splatt_kruskal factored;
+  splatt_kruskal init;
+  splatt_kruskal * initp = NULL;
+  int ret;
+
+  cpd_checkpoint * chkpt = NULL;
+  if(args.chkpt) {
+    chkpt = chkpt_alloc(args.chkpt, args.chkpt_its, args.chkpt_secs);
+  }
+
+  /* load initial factors */
+  if(args.restart) {
+    ret = chkpt_read(chkpt, &init);
+    if(ret != SPLATT_SUCCESS) {
+      return ret;
+    }
+    printf("Restarting from '%s' after %"SPLATT_PF_IDX" iterations.\n",
+        args.chkpt, chkpt->start_it);
+    initp = &init;
+  } else if(args.init) {
+    ret = splatt_kruskal_load(args.init, nmodes, &init);
+    if(ret != SPLATT_SUCCESS) {
+      fprintf(stderr, "SPLATT: could not load initial factors '%s'.\n",
+          args.init);
+      return ret;
+    }
+    initp = &init;
+  }
 
   /* do the factorization! */
-  int ret = splatt_cpd_als(csf, args.nfactors, args.opts, &factored);
+  if(args.alg == CPD_ALG_RAND) {
+    ret = cprand_cpd(csf, args.nfactors, args.opts, &factored);
+  } else if(args.alg == CPD_ALG_APR) {
+    ret = cpapr_cpd(csf, args.nfactors, args.opts, &factored);
+  } else if(args.alg == CPD_ALG_GCP) {
+    ret = gcp_cpd(tt, args.nfactors, args.opts, &factored);
+    tt_free(tt);
+  } else if(args.sweep[0] > 0) {
+    ret = p_rank_sweep(csf, &args, &factored);
+  } else if(args.nstarts > 1) {
+    ret = splatt_cpd_als_multistart(csf, args.nfactors, args.nstarts,
+        args.opts, &factored);
+  } else {
+    ret = cpd_als_chkpt(csf, args.nfactors, args.opts, initp, chkpt,
+        &factored);
+  }
+  if(initp != NULL) {
+    splatt_free_kruskal(initp);
+  }
+  chkpt_free(chkpt);
   if(ret != SPLATT_SUCCESS) {
     fprintf(stderr, "splatt_cpd_als returned %d. Aborting.\n", ret);
     return ret;
   }
 
-  printf("Final fit: %0.5"SPLATT_PF_VAL"\n", factored.fit);
+  if(args.alg == CPD_ALG_APR) {
+    printf("Final log-likelihood: %0.5e\n", factored.fit);
+  } else if(args.alg == CPD_ALG_GCP) {
+    printf("Final loss: %0.5e\n", factored.fit);
+  } else {
+    printf("Final fit: %0.5"SPLATT_PF_VAL"\n", factored.fit);
+  }
+
+  /* where the memory went */
+  if(which_verb >= SPLATT_VERBOSITY_HIGH) {
+    printf("\n");
+    splatt_mem_report();
+  }
 
   /* write output */
   if(args.write == 1) {
@@ -0,0 +1,363 @@
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "splatt_cmds.h"
+#include "../io.h"
+#include "../sort.h"
+#include "../sptensor.h"
+#include "../stats.h"
+#include "../stream.h"
+#include "../timer.h"
+
+
+/******************************************************************************
+ * SPLATT STREAM
+ *****************************************************************************/
+static char stream_args_doc[] = "TENSOR";
+static char stream_doc[] =
+  "splatt-stream -- Compute a CPD of a tensor which grows along a time mode.\n\n"
+  "TENSOR is replayed in batches of consecutive time steps. The first batch is\n"
+  "factored with CPD-ALS and each later batch only updates the model.\n";
+
+#define TT_FORGET 247
+#define TT_WINDOW 248
+#define TT_INIT 249
+#define TT_BATCH 250
+#define TT_TIME 251
+#define TT_REG 252
+#define TT_SEED 253
+#define TT_NOWRITE 254
+#define TT_TOL 255
+static struct argp_option stream_options[] = {
+  {"iters", 'i', "NITERS", 0, "maximum number of iterations per batch "
+                              "(default: 50)"},
+  {"tol", TT_TOL, "TOLERANCE", 0, "minimum change in fit for convergence "
+                                  "(default: 1e-5)"},
+  {"reg", TT_REG, "REGULARIZATION", 0, "regularization parameter "
+                                       "(default: 0)"},
+  {"rank", 'r', "RANK", 0, "rank of decomposition to find (default: 10)"},
+  {"threads", 't', "NTHREADS", 0, "number of threads to use (default: #cores)"},
+  {"time", TT_TIME, "MODE", 0, "the mode which grows (default: last mode)"},
+  {"batch", TT_BATCH, "STEPS", 0, "time steps per batch (default: 1)"},
+  {"init", TT_INIT, "STEPS", 0, "time steps in the first batch "
+                                "(default: 10)"},
+  {"forget", TT_FORGET, "MU", 0, "weight of the history after each batch, "
+                                 "in (0, 1] (default: 1)"},
+  {"window", TT_WINDOW, "BATCHES", 0, "number of batches remembered "
+                                      "(default: 0, all)"},
+  {"nowrite", TT_NOWRITE, 0, 0, "do not write output to file"},
+  {"seed", TT_SEED, "SEED", 0, "random seed (default: system time)"},
+  {"verbose", 'v', 0, 0, "turn on verbose output (default: no)"},
+  {"stem", 's', "PATH", 0, "file stem for output files (default: ./)"},
+  { 0 }
+};
+
+
+typedef struct
+{
+  char * ifname;   /** file that we read the tensor from */
+  char * stem;     /** file stem */
+  int write;       /** do we write output to file? */
+  double * opts;   /** splatt options */
+  idx_t nfactors;
+  idx_t time_mode; /** 1-indexed, or 0 for the last mode */
+  idx_t batch;     /** time steps per batch */
+  idx_t init;      /** time steps in the first batch */
+} stream_cmd_args;
+
+
+/**
+* @brief Fill a stream_cmd_args struct with default values.
+*
+* @param args The struct to fill.
+*/
+static void default_stream_opts(
+  stream_cmd_args * args)
+{
+  args->opts = splatt_default_opts();
+  args->ifname    = NULL;
+  args->stem      = NULL;
+  args->write     = DEFAULT_WRITE;
+  args->nfactors  = DEFAULT_NFACTORS;
+  args->time_mode = 0;
+  args->batch     = 1;
+  args->init      = 10;
+}
+
+
+static error_t parse_stream_opt(
+  int key,
+  char * arg,
+  struct argp_state * state)
+{
+  stream_cmd_args * args = state->input;
+
+  /* -i=50 should also work... */
+  if(arg != NULL && arg[0] == '=') {
+    ++arg;
+  }
+
+  switch(key) {
+  case 'i':
+    args->opts[SPLATT_OPTION_NITER] = (double) atoi(arg);
+    break;
+  case TT_TOL:
+    args->opts[SPLATT_OPTION_TOLERANCE] = atof(arg);
+    break;
+  case TT_REG:
+    args->opts[SPLATT_OPTION_REGULARIZE] = atof(arg);
+    break;
+  case 't':
+    args->opts[SPLATT_OPTION_NTHREADS] = (double) atoi(arg);
+    splatt_omp_set_num_threads((int)args->opts[SPLATT_OPTION_NTHREADS]);
+    break;
+  case 'v':
+    timer_inc_verbose();
+    args->opts[SPLATT_OPTION_VERBOSITY] += 1;
+    break;
+  case TT_NOWRITE:
+    args->write = 0;
+    break;
+  case 'r':
+    args->nfactors = atoi(arg);
+    break;
+  case 's':
+    args->stem = arg;
+    break;
+  case TT_TIME:
+    if(atoi(arg) < 1) {
+      fprintf(stderr, "SPLATT: --time must be a positive mode.\n");
+      argp_usage(state);
+    }
+    args->time_mode = atoi(arg);
+    break;
+  case TT_BATCH:
+    if(atoi(arg) < 1) {
+      fprintf(stderr, "SPLATT: --batch must be positive.\n");
+      argp_usage(state);
+    }
+    args->batch = atoi(arg);
+    break;
+  case TT_INIT:
+    if(atoi(arg) < 1) {
+      fprintf(stderr, "SPLATT: --init must be positive.\n");
+      argp_usage(state);
+    }
+    args->init = atoi(arg);
+    break;
+  case TT_FORGET:
+    args->opts[SPLATT_OPTION_FORGET] = atof(arg);
+    break;
+  case TT_WINDOW:
+    args->opts[SPLATT_OPTION_WINDOW] = (double) atoi(arg);
+    break;
+  case TT_SEED:
+    args->opts[SPLATT_OPTION_RANDSEED] = atoi(arg);
+    break;
+
+  case ARGP_KEY_ARG:
+    if(args->ifname != NULL) {
+      argp_usage(state);
+      break;
+    }
+    args->ifname = arg;
+    break;
+  case ARGP_KEY_END:
+    if(args->ifname == NULL) {
+      argp_usage(state);
+      break;
+    }
+  }
+  return 0;
+}
+
+static struct argp stream_argp =
+  {stream_options, parse_stream_opt, stream_args_doc, stream_doc};
+
+
+/**
+* @brief Copy the nonzeros [start, end) of a tensor sorted by its time mode
+*        into a new tensor whose time indices begin at 'first_step'. The other
+*        dimensions only cover the indices seen so far.
+*
+* @param tt The tensor, sorted by 'tmode'.
+* @param tmode The time mode.
+* @param start The first nonzero of the batch.
+* @param end One past the last nonzero of the batch.
+* @param first_step The first time step of the batch.
+* @param nsteps The number of time steps in the batch.
+* @param seen [IN/OUT] The dimensions seen so far, grown by this batch.
+*
+* @return The batch.
+*/
+static sptensor_t * p_slice_batch(
+  sptensor_t const * const tt,
+  idx_t const tmode,
+  idx_t const start,
+  idx_t const end,
+  idx_t const first_step,
+  idx_t const nsteps,
+  idx_t * const seen)
+{
+  idx_t const nnz = end - start;
+  sptensor_t * batch = tt_alloc(nnz, tt->nmodes);
+  memcpy(batch->vals, tt->vals + start, nnz * sizeof(*batch->vals));
+  for(idx_t m=0; m < tt->nmodes; ++m) {
+    idx_t * const restrict ind = batch->ind[m];
+    memcpy(ind, tt->ind[m] + start, nnz * sizeof(*ind));
+    if(m == tmode) {
+      for(idx_t n=0; n < nnz; ++n) {
+        ind[n] -= first_step;
+      }
+      batch->dims[m] = nsteps;
+    } else {
+      for(idx_t n=0; n < nnz; ++n) {
+        seen[m] = SS_MAX(seen[m], ind[n] + 1);
+      }
+      batch->dims[m] = seen[m];
+    }
+  }
+  return batch;
+}
+
+
+/******************************************************************************
+ * SPLATT-STREAM
+ *****************************************************************************/
+int splatt_stream_cmd(
+  int argc,
+  char ** argv)
+{
+  /* assign defaults and parse arguments */
+  stream_cmd_args args;
+  default_stream_opts(&args);
+  argp_parse(&stream_argp, argc, argv, ARGP_IN_ORDER, 0, &args);
+  srand(args.opts[SPLATT_OPTION_RANDSEED]);
+
+  print_header();
+
+  sptensor_t * tt = tt_read(args.ifname);
+  if(tt == NULL) {
+    return SPLATT_ERROR_BADINPUT;
+  }
+  if(args.time_mode > tt->nmodes) {
+    fprintf(stderr, "SPLATT: --time=%"SPLATT_PF_IDX" but the tensor has "
+        "%"SPLATT_PF_IDX" modes.\n", args.time_mode, tt->nmodes);
+    tt_free(tt);
+    return SPLATT_ERROR_BADINPUT;
+  }
+  idx_t const tmode = (args.time_mode > 0) ? args.time_mode - 1 :
+      tt->nmodes - 1;
+  idx_t const nsteps = tt->dims[tmode];
+
+  splatt_verbosity_type which_verb = args.opts[SPLATT_OPTION_VERBOSITY];
+  if(which_verb >= SPLATT_VERBOSITY_LOW) {
+    stats_tt(tt, args.ifname, STATS_BASIC, 0, NULL);
+    printf("Streaming "
+           "------------------------------------------------------\n");
+    printf("NFACTORS=%"SPLATT_PF_IDX" MAXITS=%"SPLATT_PF_IDX" TOL=%0.1e "
+           "REG=%0.1e TIME=%"SPLATT_PF_IDX" INIT=%"SPLATT_PF_IDX" "
+           "BATCH=%"SPLATT_PF_IDX" FORGET=%0.3f WINDOW=%"SPLATT_PF_IDX" ",
+        args.nfactors, (idx_t) args.opts[SPLATT_OPTION_NITER],
+        args.opts[SPLATT_OPTION_TOLERANCE],
+        args.opts[SPLATT_OPTION_REGULARIZE], tmode+1, args.init, args.batch,
+        args.opts[SPLATT_OPTION_FORGET],
+        (idx_t) args.opts[SPLATT_OPTION_WINDOW]);
+    printf("SEED=%d THREADS=%"SPLATT_PF_IDX"\n\n",
+        (int) args.opts[SPLATT_OPTION_RANDSEED],
+        (idx_t) args.opts[SPLATT_OPTION_NTHREADS]);
+  }
+
+  /* replay the tensor in time order */
+  tt_sort(tt, tmode, NULL);
+
+  idx_t seen[MAX_NMODES];
+  for(idx_t m=0; m < tt->nmodes; ++m) {
+    seen[m] = 0;
+  }
+
+  sp_timer_t timer;
+  stream_cpd * stream = NULL;
+  idx_t nnz_ptr = 0;
+  idx_t step = 0;
+  idx_t b = 0;
+  while(step < nsteps) {
+    idx_t const width = SS_MIN((b == 0) ? args.init : args.batch,
+        nsteps - step);
+    idx_t const start = nnz_ptr;
+    while(nnz_ptr < tt->nnz && tt->ind[tmode][nnz_ptr] < step + width) {
+      ++nnz_ptr;
+    }
+    sptensor_t * batch = p_slice_batch(tt, tmode, start, nnz_ptr, step, width,
+        seen);
+
+    timer_fstart(&timer);
+    idx_t niters = 0;
+    double fit;
+    if(b == 0) {
+      stream = stream_alloc(batch, args.nfactors, tmode, args.opts);
+      if(stream == NULL) {
+        tt_free(batch);
+        tt_free(tt);
+        splatt_free_opts(args.opts);
+        return SPLATT_ERROR_BADINPUT;
+      }
+      fit = stream->fit;
+    } else {
+      fit = stream_add(stream, batch, &niters);
+    }
+    timer_stop(&timer);
+
+    printf("  batch %5"SPLATT_PF_IDX"  steps %6"SPLATT_PF_IDX"-%-6"
+        SPLATT_PF_IDX"  nnz %9"SPLATT_PF_IDX"  its %3"SPLATT_PF_IDX
+        "  fit: %0.5f  (%0.3fs)\n", b+1, step+1, step+width, batch->nnz,
+        niters, fit, timer.seconds);
+
+    tt_free(batch);
+    step += width;
+    ++b;
+  }
+  tt_free(tt);
+
+  splatt_kruskal model;
+  stream_to_kruskal(stream, &model);
+  stream_free(stream);
+  printf("Final fit (last batch): %0.5f\n", model.fit);
+
+  /* write output */
+  if(args.write == 1) {
+    char * lambda_name = NULL;
+    if(args.stem) {
+      asprintf(&lambda_name, "%s.lambda.mat", args.stem);
+    } else {
+      asprintf(&lambda_name, "lambda.mat");
+    }
+    vec_write(model.lambda, args.nfactors, lambda_name);
+    free(lambda_name);
+
+    for(idx_t m=0; m < model.nmodes; ++m) {
+      char * matfname = NULL;
+      if(args.stem) {
+        asprintf(&matfname, "%s.mode%"SPLATT_PF_IDX".mat", args.stem, m+1);
+      } else {
+        asprintf(&matfname, "mode%"SPLATT_PF_IDX".mat", m+1);
+      }
+
+      matrix_t tmpmat;
+      tmpmat.rowmajor = 1;
+      tmpmat.I = model.dims[m];
+      tmpmat.J = args.nfactors;
+      tmpmat.vals = model.factors[m];
+
+      mat_write(&tmpmat, matfname);
+      free(matfname);
+    }
+  }
+
+  /* cleanup */
+  splatt_free_opts(args.opts);
+  splatt_free_kruskal(&model);
+
+  return EXIT_SUCCESS;
+}
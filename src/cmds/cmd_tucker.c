@@ -0,0 +1,249 @@
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "splatt_cmds.h"
+#include "../io.h"
+#include "../sptensor.h"
+#include "../stats.h"
+
+
+/******************************************************************************
+ * SPLATT TUCKER
+ *****************************************************************************/
+static char tucker_args_doc[] = "TENSOR";
+static char tucker_doc[] =
+  "splatt-tucker -- Compute the Tucker decomposition of a sparse tensor.\n\n"
+  "The rank may be a single value used for every mode or a comma-separated\n"
+  "list with one value per mode, e.g., -r 10,10,5. The core is written as a\n"
+  "matrix with one row per first-mode index and the remaining modes\n"
+  "flattened across the columns, last mode fastest.\n";
+
+#define TT_SEED 253
+#define TT_NOWRITE 254
+#define TT_TOL 255
+static struct argp_option tucker_options[] = {
+  {"iters", 'i', "NITERS", 0, "maximum number of iterations to use "
+                              "(default: 50)"},
+  {"tol", TT_TOL, "TOLERANCE", 0, "minimum change for convergence "
+                                  "(default: 1e-5)"},
+  {"rank", 'r', "RANK[,RANK...]", 0, "rank of each mode (default: 10)"},
+  {"threads", 't', "NTHREADS", 0, "number of threads to use (default: #cores)"},
+  {"nowrite", TT_NOWRITE, 0, 0, "do not write output to file"},
+  {"seed", TT_SEED, "SEED", 0, "random seed (default: system time)"},
+  {"verbose", 'v', 0, 0, "turn on verbose output (default: no)"},
+  {"stem", 's', "PATH", 0, "file stem for output files (default: ./)"},
+  { 0 }
+};
+
+
+typedef struct
+{
+  char * ifname;   /** file that we read the tensor from */
+  char * stem;     /** file stem */
+  int write;       /** do we write output to file? */
+  double * opts;   /** splatt options */
+  idx_t nranks;    /** 1, or the number of modes */
+  idx_t ranks[MAX_NMODES];
+} tucker_cmd_args;
+
+
+/**
+* @brief Fill a tucker_cmd_args struct with default values.
+*
+* @param args The struct to fill.
+*/
+static void default_tucker_opts(
+  tucker_cmd_args * args)
+{
+  args->opts = splatt_default_opts();
+  args->ifname    = NULL;
+  args->stem      = NULL;
+  args->write     = DEFAULT_WRITE;
+  args->nranks    = 1;
+  args->ranks[0]  = DEFAULT_NFACTORS;
+
+  /* HOOI computes a TTMc rooted at every mode */
+  args->opts[SPLATT_OPTION_CSF_ALLOC] = SPLATT_CSF_ALLMODE;
+  args->opts[SPLATT_OPTION_TILE] = SPLATT_NOTILE;
+}
+
+
+static error_t parse_tucker_opt(
+  int key,
+  char * arg,
+  struct argp_state * state)
+{
+  tucker_cmd_args * args = state->input;
+  char * buf;
+
+  /* -i=50 should also work... */
+  if(arg != NULL && arg[0] == '=') {
+    ++arg;
+  }
+
+  switch(key) {
+  case 'i':
+    args->opts[SPLATT_OPTION_NITER] = (double) atoi(arg);
+    break;
+  case TT_TOL:
+    args->opts[SPLATT_OPTION_TOLERANCE] = atof(arg);
+    break;
+  case 't':
+    args->opts[SPLATT_OPTION_NTHREADS] = (double) atoi(arg);
+    splatt_omp_set_num_threads((int)args->opts[SPLATT_OPTION_NTHREADS]);
+    break;
+  case 'v':
+    timer_inc_verbose();
+    args->opts[SPLATT_OPTION_VERBOSITY] += 1;
+    break;
+  case TT_NOWRITE:
+    args->write = 0;
+    break;
+  case 'r':
+    args->nranks = 0;
+    buf = strtok(arg, ",");
+    while(buf != NULL && args->nranks < MAX_NMODES) {
+      args->ranks[args->nranks++] = strtoull(buf, NULL, 10);
+      buf = strtok(NULL, ",");
+    }
+    for(idx_t m=0; m < args->nranks; ++m) {
+      if(args->ranks[m] == 0) {
+        args->nranks = 0;
+      }
+    }
+    if(args->nranks == 0) {
+      fprintf(stderr, "SPLATT: --rank expects positive RANK[,RANK...].\n");
+      argp_usage(state);
+    }
+    break;
+  case 's':
+    args->stem = arg;
+    break;
+  case TT_SEED:
+    args->opts[SPLATT_OPTION_RANDSEED] = atoi(arg);
+    break;
+
+  case ARGP_KEY_ARG:
+    if(args->ifname != NULL) {
+      argp_usage(state);
+      break;
+    }
+    args->ifname = arg;
+    break;
+  case ARGP_KEY_END:
+    if(args->ifname == NULL) {
+      argp_usage(state);
+      break;
+    }
+  }
+  return 0;
+}
+
+static struct argp tucker_argp =
+  {tucker_options, parse_tucker_opt, tucker_args_doc, tucker_doc};
+
+
+/******************************************************************************
+ * SPLATT-TUCKER
+ *****************************************************************************/
+int splatt_tucker_cmd(
+  int argc,
+  char ** argv)
+{
+  /* assign defaults and parse arguments */
+  tucker_cmd_args args;
+  default_tucker_opts(&args);
+  argp_parse(&tucker_argp, argc, argv, ARGP_IN_ORDER, 0, &args);
+  srand(args.opts[SPLATT_OPTION_RANDSEED]);
+
+  print_header();
+
+  sptensor_t * tt = tt_read(args.ifname);
+  if(tt == NULL) {
+    return SPLATT_ERROR_BADINPUT;
+  }
+  idx_t const nmodes = tt->nmodes;
+
+  if(args.nranks == 1) {
+    for(idx_t m=1; m < nmodes; ++m) {
+      args.ranks[m] = args.ranks[0];
+    }
+  } else if(args.nranks != nmodes) {
+    fprintf(stderr, "SPLATT ERROR: found %"SPLATT_PF_IDX" ranks for a %"
+        SPLATT_PF_IDX"-mode tensor.\n", args.nranks, nmodes);
+    tt_free(tt);
+    return SPLATT_ERROR_BADINPUT;
+  }
+
+  splatt_verbosity_type which_verb = args.opts[SPLATT_OPTION_VERBOSITY];
+  if(which_verb >= SPLATT_VERBOSITY_LOW) {
+    stats_tt(tt, args.ifname, STATS_BASIC, 0, NULL);
+    printf("\nFactoring "
+           "------------------------------------------------------\n");
+    printf("RANKS=%"SPLATT_PF_IDX, args.ranks[0]);
+    for(idx_t m=1; m < nmodes; ++m) {
+      printf("x%"SPLATT_PF_IDX, args.ranks[m]);
+    }
+    printf(" MAXITS=%"SPLATT_PF_IDX" TOL=%0.1e SEED=%d THREADS=%"SPLATT_PF_IDX
+        "\n\n",
+        (idx_t) args.opts[SPLATT_OPTION_NITER],
+        args.opts[SPLATT_OPTION_TOLERANCE],
+        (int) args.opts[SPLATT_OPTION_RANDSEED],
+        (idx_t) args.opts[SPLATT_OPTION_NTHREADS]);
+  }
+
+  splatt_csf * csf = splatt_csf_alloc(tt, args.opts);
+  tt_free(tt);
+
+  splatt_tucker model;
+  int ret = splatt_tucker_hooi(csf, args.ranks, args.opts, &model);
+  if(ret != SPLATT_SUCCESS) {
+    fprintf(stderr, "splatt_tucker_hooi returned %d. Aborting.\n", ret);
+    return ret;
+  }
+  printf("Final fit: %0.5f\n", model.fit);
+
+  /* write output */
+  if(args.write == 1) {
+    matrix_t tmpmat;
+    tmpmat.rowmajor = 1;
+
+    for(idx_t m=0; m < nmodes; ++m) {
+      char * matfname = NULL;
+      if(args.stem) {
+        asprintf(&matfname, "%s.mode%"SPLATT_PF_IDX".mat", args.stem, m+1);
+      } else {
+        asprintf(&matfname, "mode%"SPLATT_PF_IDX".mat", m+1);
+      }
+
+      tmpmat.I = model.dims[m];
+      tmpmat.J = model.ranks[m];
+      tmpmat.vals = model.factors[m];
+      mat_write(&tmpmat, matfname);
+      free(matfname);
+    }
+
+    char * corefname = NULL;
+    if(args.stem) {
+      asprintf(&corefname, "%s.core.mat", args.stem);
+    } else {
+      asprintf(&corefname, "core.mat");
+    }
+    tmpmat.I = model.ranks[0];
+    tmpmat.J = 1;
+    for(idx_t m=1; m < nmodes; ++m) {
+      tmpmat.J *= model.ranks[m];
+    }
+    tmpmat.vals = model.core;
+    mat_write(&tmpmat, corefname);
+    free(corefname);
+  }
+
+  /* cleanup */
+  splatt_free_csf(csf, args.opts);
+  splatt_free_opts(args.opts);
+  splatt_free_tucker(&model);
+
+  return EXIT_SUCCESS;
+}
@@ -19,6 +19,10 @@ static char cpd_args_doc[] = "TENSOR";
 static char cpd_doc[] =
   "splatt-cpd -- Compute the CPD of a sparse tensor.\n";
 
+#define TT_RESTART 245
+#define TT_CHKPT_SECS 246
+#define TT_CHKPT_ITS 247
+#define TT_CHKPT 248
 #define TT_REG 251
 #define TT_SEED 252
 #define TT_NOWRITE 253
@@ -42,6 +46,14 @@ static struct argp_option cpd_options[] = {
                                  "\t-d f to use fine-grained (-p required)\n"
                                  },
   {"partition", 'p', "FILE", 0, "MPI: partitioning file for fine-grained"},
+  {"checkpoint", TT_CHKPT, "FILE", 0, "periodically checkpoint to FILE.<rank>"},
+  {"chkpt-its", TT_CHKPT_ITS, "NITERS", 0, "checkpoint every NITERS iterations "
+                                           "(default: 10)"},
+  {"chkpt-secs", TT_CHKPT_SECS, "SECONDS", 0, "checkpoint every SECONDS "
+                                              "seconds"},
+  {"restart", TT_RESTART, 0, 0, "resume from the --checkpoint FILE. The "
+                                "number of ranks and the decomposition must "
+                                "match the checkpointed run"},
   { 0 }
 };
 
@@ -55,6 +67,10 @@ typedef struct
   splatt_decomp_type decomp;
   int mpi_dims[MAX_NMODES];
   char * pfname;   /** file that we read the partitioning from */
+  char * chkpt;    /** checkpoint file stem */
+  idx_t chkpt_its; /** checkpoint frequency (iterations) */
+  double chkpt_secs; /** checkpoint frequency (seconds) */
+  int restart;     /** restart from checkpoint? */
 } cpd_cmd_args;
 
 
@@ -71,6 +87,10 @@ static void default_cpd_opts(
   args->pfname    = NULL;
   args->write     = DEFAULT_WRITE;
   args->nfactors  = DEFAULT_NFACTORS;
+  args->chkpt     = NULL;
+  args->chkpt_its = 0;
+  args->chkpt_secs = 0.;
+  args->restart   = 0;
 
   args->decomp = DEFAULT_MPI_DISTRIBUTION;
   for(idx_t m=0; m < MAX_NMODES; ++m) {
@@ -146,6 +166,18 @@ static error_t parse_cpd_opt(
   case TT_SEED:
     args->opts[SPLATT_OPTION_RANDSEED] = atoi(arg);
     break;
+  case TT_CHKPT:
+    args->chkpt = arg;
+    break;
+  case TT_CHKPT_ITS:
+    args->chkpt_its = atoi(arg);
+    break;
+  case TT_CHKPT_SECS:
+    args->chkpt_secs = atof(arg);
+    break;
+  case TT_RESTART:
+    args->restart = 1;
+    break;
 
   case ARGP_KEY_ARG:
     if(args->ifname != NULL) {
@@ -159,6 +191,14 @@ static error_t parse_cpd_opt(
       argp_usage(state);
       break;
     }
+    if(args->restart && args->chkpt == NULL) {
+      fprintf(stderr, "SPLATT: --restart requires --checkpoint.\n");
+      argp_usage(state);
+      break;
+    }
+    if(args->chkpt && args->chkpt_its == 0 && args->chkpt_secs == 0.) {
+      args->chkpt_its = 10;
+    }
   }
   return 0;
 }
@@ -168,6 +208,55 @@ static struct argp cpd_argp =
 
 
 
+/**
+* @brief Load this rank's checkpoint shard into the factors it owns.
+*
+* @param chkpt The checkpoint structure.
+* @param globmats The owned factor rows to overwrite.
+* @param lambda The column weights to overwrite.
+* @param nmodes The number of modes.
+* @param nfactors The rank of the decomposition.
+*
+* @return SPLATT_SUCCESS on success.
+*/
+static int p_load_chkpt_shard(
+  cpd_checkpoint * const chkpt,
+  matrix_t ** globmats,
+  val_t * const lambda,
+  idx_t const nmodes,
+  idx_t const nfactors)
+{
+  splatt_kruskal shard;
+  int ret = chkpt_read(chkpt, &shard);
+  if(ret != SPLATT_SUCCESS) {
+    return ret;
+  }
+
+  if(shard.nmodes != nmodes || shard.rank != nfactors) {
+    ret = SPLATT_ERROR_BADINPUT;
+  }
+  for(idx_t m=0; m < nmodes && ret == SPLATT_SUCCESS; ++m) {
+    if(shard.dims[m] != globmats[m]->I) {
+      ret = SPLATT_ERROR_BADINPUT;
+    }
+  }
+
+  if(ret == SPLATT_SUCCESS) {
+    for(idx_t m=0; m < nmodes; ++m) {
+      memcpy(globmats[m]->vals, shard.factors[m],
+          globmats[m]->I * nfactors * sizeof(val_t));
+    }
+    memcpy(lambda, shard.lambda, nfactors * sizeof(val_t));
+  } else {
+    fprintf(stderr, "SPLATT ERROR: checkpoint '%s' does not match this "
+                    "decomposition.\n", chkpt->fname);
+  }
+
+  splatt_free_kruskal(&shard);
+  return ret;
+}
+
+
 /******************************************************************************
  * SPLATT-CPD
  *****************************************************************************/
@@ -310,9 +399,33 @@ int splatt_mpi_cpd_cmd(
 
   mpi_cpd_stats(csf, args.nfactors, args.opts, &rinfo);
 
+  /* each rank checkpoints the rows that it owns */
+  cpd_checkpoint * chkpt = NULL;
+  if(args.chkpt) {
+    char * fname = NULL;
+    asprintf(&fname, "%s.%d", args.chkpt, rinfo.rank);
+    chkpt = chkpt_alloc(fname, args.chkpt_its, args.chkpt_secs);
+    free(fname);
+
+    if(args.restart) {
+      int ret = p_load_chkpt_shard(chkpt, globmats, lambda, nmodes,
+          args.nfactors);
+      int allret;
+      MPI_Allreduce(&ret, &allret, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+      if(allret != SPLATT_SUCCESS) {
+        MPI_Abort(MPI_COMM_WORLD, allret);
+      }
+      if(rinfo.rank == 0) {
+        printf("Restarting from '%s' after %"SPLATT_PF_IDX" iterations.\n",
+            args.chkpt, chkpt->start_it);
+      }
+    }
+  }
+
   /* do the factorization! */
   mpi_cpd_als_iterate(csf, mats, globmats, lambda, args.nfactors, &rinfo,
-      args.opts);
+      args.opts, chkpt);
+  chkpt_free(chkpt);
 
   /* free up the ftensor allocations */
   splatt_csf_free(csf, args.opts);
@@ -329,8 +442,8 @@ int splatt_mpi_cpd_cmd(
     mat_free(globmats[m]);
   }
   mat_free(mats[MAX_NMODES]);
-  free(lambda);
-  free(args.opts);
+  splatt_free(lambda);
+  splatt_free_opts(args.opts);
 
   perm_free(perm);
   rank_free(rinfo, nmodes);
@@ -17,6 +17,10 @@ static char cmd_doc[] =
   "splatt -- the Surprisingly ParalleL spArse Tensor Toolkit\n\n"
   "The available commands are:\n"
   "  cpd\t\tCompute the Canonical Polyadic Decomposition.\n"
+  "  cmtf\t\tFactor a tensor together with coupled matrices.\n"
+  "  complete\tComplete a tensor with missing entries.\n"
+  "  stream\tCompute a CPD of a tensor which grows along a time mode.\n"
+  "  tucker\tCompute the Tucker decomposition.\n"
   "  bench\t\tBenchmark MTTKRP algorithms.\n"
   "  check\t\tCheck a tensor file for correctness.\n"
   "  convert\tConvert a tensor to different formats.\n"
@@ -53,6 +57,10 @@ int splatt_mpi_cpd_cmd(int argc, char ** argv);
 #else
 int splatt_cpd_cmd(int argc, char ** argv);
 #endif
+int splatt_cmtf_cmd(int argc, char ** argv);
+int splatt_complete_cmd(int argc, char ** argv);
+int splatt_stream_cmd(int argc, char ** argv);
+int splatt_tucker_cmd(int argc, char ** argv);
 int splatt_bench(int argc, char ** argv);
 int splatt_check(int argc, char ** argv);
 int splatt_convert(int argc, char ** argv);
@@ -81,6 +89,10 @@ static cmd_struct const splatt_cmds[] = {
   { "cpd", splatt_cpd_cmd },
 #endif
 
+  { "cmtf", splatt_cmtf_cmd },
+  { "complete", splatt_complete_cmd },
+  { "stream", splatt_stream_cmd },
+  { "tucker", splatt_tucker_cmd },
   { "bench", splatt_bench },
   { "check", splatt_check },
   { "convert", splatt_convert },
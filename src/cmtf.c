@@ -0,0 +1,332 @@
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "cmtf.h"
+#include "cpd.h"
+#include "csf.h"
+#include "mttkrp.h"
+#include "timer.h"
+#include "util.h"
+
+#include <math.h>
+
+
+
+/******************************************************************************
+ * PRIVATE FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief Compute <A, B> of two symmetric matrices stored as upper triangles.
+*
+* @param A The first matrix.
+* @param B The second matrix.
+*
+* @return sum_ij A_ij * B_ij.
+*/
+static double p_sym_inner(
+    matrix_t const * const A,
+    matrix_t const * const B)
+{
+  idx_t const R = A->J;
+  double inner = 0.;
+  for(idx_t i=0; i < R; ++i) {
+    inner += A->vals[i + (i*R)] * B->vals[i + (i*R)];
+    for(idx_t j=i+1; j < R; ++j) {
+      inner += 2. * A->vals[j + (i*R)] * B->vals[j + (i*R)];
+    }
+  }
+  return inner;
+}
+
+
+/**
+* @brief Update the factor of a coupled matrix, V = Y^T A (A^T A + reg I)^-1,
+*        and its Gram matrix.
+*
+* @param Yt The transpose of the coupled matrix.
+* @param A The (just updated) shared factor.
+* @param aTa The Gram matrices of the tensor factors. aTa[mode] is A^T A and
+*            aTa[MAX_NMODES] is used as workspace.
+* @param mode The shared mode.
+* @param reg Regularization parameter.
+* @param[out] V The coupled factor.
+* @param[out] VtV The Gram matrix of V.
+* @param ytav [OUT] <Y^T A, V>, used for the fit.
+* @param rinfo MPI rank information.
+* @param thds Thread structures.
+* @param nthreads The number of threads.
+*/
+static void p_update_side(
+    spmatrix_t const * const Yt,
+    matrix_t const * const A,
+    matrix_t ** aTa,
+    idx_t const mode,
+    val_t const reg,
+    matrix_t * const V,
+    matrix_t * const VtV,
+    double * const ytav,
+    rank_info * const rinfo,
+    thd_info * const thds,
+    idx_t const nthreads)
+{
+  idx_t const nvals = V->I * V->J;
+
+  spmat_matmul(Yt, A, V);
+  val_t * const YtA = splatt_malloc(nvals * sizeof(*YtA));
+  par_memcpy(YtA, V->vals, nvals * sizeof(*YtA));
+
+  /* the only Gram matrix in the product is A^T A */
+  matrix_t * grams[MAX_NMODES+1];
+  grams[0] = aTa[mode];
+  grams[1] = NULL;
+  grams[MAX_NMODES] = aTa[MAX_NMODES];
+  mat_solve_normals(1, 2, grams, V, reg);
+  mat_aTa(V, VtV, rinfo, thds, nthreads);
+
+  double inner = 0.;
+  #pragma omp parallel for schedule(static) reduction(+:inner)
+  for(idx_t x=0; x < nvals; ++x) {
+    inner += YtA[x] * V->vals[x];
+  }
+  *ytav = inner;
+  splatt_free(YtA);
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+double cmtf_als(
+  splatt_csf const * const tensors,
+  spmatrix_t ** coupled,
+  matrix_t ** mats,
+  matrix_t ** side,
+  idx_t const nfactors,
+  double const * const opts)
+{
+  idx_t const nmodes = tensors->nmodes;
+  idx_t const nthreads = (idx_t) opts[SPLATT_OPTION_NTHREADS];
+  val_t const reg = opts[SPLATT_OPTION_REGULARIZE];
+  splatt_omp_set_num_threads(nthreads);
+
+  rank_info rinfo;
+  rinfo.rank = 0;
+
+  thd_info * thds = cpd_alloc_thds(nmodes, nfactors, nthreads);
+  splatt_mttkrp_ws * ws = splatt_mttkrp_alloc_ws(tensors, nfactors, opts);
+
+  /* MTTKRP output is kept intact for the fit, coupled terms go in cbuf */
+  idx_t maxdim = 0;
+  matrix_t * local[MAX_NMODES+1];
+  for(idx_t m=0; m < nmodes; ++m) {
+    local[m] = mats[m];
+    maxdim = SS_MAX(maxdim, tensors->dims[m]);
+  }
+  local[MAX_NMODES] = mat_alloc(maxdim, nfactors);
+  matrix_t * const m1 = local[MAX_NMODES];
+  matrix_t * cbuf = mat_alloc(maxdim, nfactors);
+
+  matrix_t * aTa[MAX_NMODES+1];
+  for(idx_t m=0; m < nmodes; ++m) {
+    aTa[m] = mat_alloc(nfactors, nfactors);
+    mat_aTa(mats[m], aTa[m], &rinfo, thds, nthreads);
+  }
+  aTa[MAX_NMODES] = mat_alloc(nfactors, nfactors);
+
+  /* coupled matrices: transposes, Gram matrices, and norms */
+  spmatrix_t * coupledT[MAX_NMODES];
+  matrix_t * VtV[MAX_NMODES];
+  double ynormsq[MAX_NMODES];
+  double ytav[MAX_NMODES];
+  double totnormsq = csf_frobsq(tensors);
+  double const ttnormsq = totnormsq;
+  for(idx_t m=0; m < nmodes; ++m) {
+    coupledT[m] = NULL;
+    VtV[m] = NULL;
+    ynormsq[m] = 0.;
+    ytav[m] = 0.;
+    if(coupled[m] == NULL) {
+      continue;
+    }
+    coupledT[m] = spmat_transpose(coupled[m]);
+    VtV[m] = mat_alloc(nfactors, nfactors);
+    mat_aTa(side[m], VtV[m], &rinfo, thds, nthreads);
+    for(idx_t x=0; x < coupled[m]->nnz; ++x) {
+      ynormsq[m] += coupled[m]->vals[x] * coupled[m]->vals[x];
+    }
+    totnormsq += ynormsq[m];
+  }
+
+  val_t * ones = splatt_malloc(nfactors * sizeof(*ones));
+  for(idx_t f=0; f < nfactors; ++f) {
+    ones[f] = 1.;
+  }
+
+  sp_timer_t itertime;
+  timer_start(&timers[TIMER_CPD]);
+
+  double fit = 0.;
+  double oldfit = 0.;
+  idx_t const niters = (idx_t) opts[SPLATT_OPTION_NITER];
+  for(idx_t it=0; it < niters; ++it) {
+    timer_fstart(&itertime);
+    for(idx_t m=0; m < nmodes; ++m) {
+      idx_t const I = tensors->dims[m];
+      m1->I = I;
+
+      timer_start(&timers[TIMER_MTTKRP]);
+      mttkrp_csf(tensors, local, m, thds, ws, opts);
+      timer_stop(&timers[TIMER_MTTKRP]);
+      par_memcpy(mats[m]->vals, m1->vals, I * nfactors * sizeof(val_t));
+
+      if(coupled[m] != NULL) {
+        /* A = (MTTKRP + Y V) (hada(aTa) + V^T V)^-1 */
+        cbuf->I = I;
+        spmat_matmul(coupled[m], side[m], cbuf);
+        val_t * const restrict av = mats[m]->vals;
+        val_t const * const restrict cv = cbuf->vals;
+        #pragma omp parallel for schedule(static)
+        for(idx_t x=0; x < I * nfactors; ++x) {
+          av[x] += cv[x];
+        }
+        mat_solve_normals_coupled(m, nmodes, aTa, VtV[m], mats[m], reg);
+      } else {
+        mat_solve_normals(m, nmodes, aTa, mats[m], reg);
+      }
+      mat_aTa(mats[m], aTa[m], &rinfo, thds, nthreads);
+
+      if(coupled[m] != NULL) {
+        p_update_side(coupledT[m], mats[m], aTa, m, reg, side[m], VtV[m],
+            &(ytav[m]), &rinfo, thds, nthreads);
+      }
+    } /* foreach mode */
+
+    /* the tensor's residual, from the MTTKRP of the last mode */
+    double const tfit = cpd_calc_fit(nmodes, &rinfo, thds, ttnormsq, ones,
+        mats, m1, aTa);
+    double const tres = SS_MAX(0., 1. - tfit);
+    double residual = tres * tres * ttnormsq;
+    for(idx_t m=0; m < nmodes; ++m) {
+      if(coupled[m] != NULL) {
+        residual += SS_MAX(0., ynormsq[m] - (2. * ytav[m]) +
+            p_sym_inner(aTa[m], VtV[m]));
+      }
+    }
+    fit = 1. - sqrt(residual / totnormsq);
+    timer_stop(&itertime);
+
+    if(opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_NONE) {
+      printf("  its = %3"SPLATT_PF_IDX" (%0.3fs)  fit = %0.5f  "
+             "tensor = %0.5f  delta = %+0.4e\n", it+1, itertime.seconds, fit,
+             tfit, fit - oldfit);
+      if(opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_LOW) {
+        for(idx_t m=0; m < nmodes; ++m) {
+          if(coupled[m] == NULL) {
+            continue;
+          }
+          double const cres = SS_MAX(0., ynormsq[m] - (2. * ytav[m]) +
+              p_sym_inner(aTa[m], VtV[m]));
+          printf("     coupled mode = %1"SPLATT_PF_IDX"  fit = %0.5f\n", m+1,
+              1. - sqrt(cres / ynormsq[m]));
+        }
+      }
+    }
+
+    if(fit == 1. ||
+        (it > 0 && fabs(fit - oldfit) < opts[SPLATT_OPTION_TOLERANCE])) {
+      break;
+    }
+    oldfit = fit;
+  }
+  timer_stop(&timers[TIMER_CPD]);
+
+  /* clean up */
+  for(idx_t m=0; m < nmodes; ++m) {
+    mat_free(aTa[m]);
+    if(coupled[m] != NULL) {
+      spmat_free(coupledT[m]);
+      mat_free(VtV[m]);
+    }
+  }
+  mat_free(aTa[MAX_NMODES]);
+  mat_free(m1);
+  mat_free(cbuf);
+  splatt_free(ones);
+  splatt_mttkrp_free_ws(ws);
+  thd_free(thds, nthreads);
+
+  return fit;
+}
+
+
+int cmtf_factorize(
+  splatt_csf const * const tensors,
+  spmatrix_t ** coupled,
+  idx_t const nfactors,
+  double const * const opts,
+  splatt_kruskal * factored,
+  matrix_t ** side)
+{
+  idx_t const nmodes = tensors->nmodes;
+  for(idx_t m=0; m < nmodes; ++m) {
+    if(coupled[m] != NULL && coupled[m]->I != tensors->dims[m]) {
+      fprintf(stderr, "SPLATT ERROR: coupled matrix of mode %"SPLATT_PF_IDX
+          " has %"SPLATT_PF_IDX" rows but the mode has length %"SPLATT_PF_IDX
+          ".\n", m+1, coupled[m]->I, tensors->dims[m]);
+      return SPLATT_ERROR_BADINPUT;
+    }
+  }
+
+  matrix_t * mats[MAX_NMODES];
+  for(idx_t m=0; m < nmodes; ++m) {
+    mats[m] = mat_rand(tensors->dims[m], nfactors);
+    side[m] = (coupled[m] != NULL) ? mat_rand(coupled[m]->J, nfactors) : NULL;
+  }
+
+  factored->fit = cmtf_als(tensors, coupled, mats, side, nfactors, opts);
+
+  /* move the column norms into lambda; coupled factors keep the scaling of
+   * their shared factor */
+  val_t * lambda = splatt_malloc(nfactors * sizeof(*lambda));
+  for(idx_t f=0; f < nfactors; ++f) {
+    lambda[f] = 1.;
+  }
+  for(idx_t m=0; m < nmodes; ++m) {
+    val_t * const restrict av = mats[m]->vals;
+    idx_t const I = mats[m]->I;
+    for(idx_t f=0; f < nfactors; ++f) {
+      val_t norm = 0.;
+      for(idx_t i=0; i < I; ++i) {
+        norm += av[f + (i*nfactors)] * av[f + (i*nfactors)];
+      }
+      norm = sqrt(norm);
+      if(norm == 0.) {
+        continue;
+      }
+      lambda[f] *= norm;
+      for(idx_t i=0; i < I; ++i) {
+        av[f + (i*nfactors)] /= norm;
+      }
+      if(side[m] != NULL) {
+        for(idx_t k=0; k < side[m]->I; ++k) {
+          side[m]->vals[f + (k*nfactors)] *= norm;
+        }
+      }
+    }
+  }
+
+  factored->rank = nfactors;
+  factored->nmodes = nmodes;
+  factored->lambda = lambda;
+  for(idx_t m=0; m < nmodes; ++m) {
+    factored->dims[m] = tensors->dims[m];
+    factored->factors[m] = mats[m]->vals;
+    splatt_free(mats[m]); /* just the matrix_t ptr, data is in factored */
+  }
+
+  return SPLATT_SUCCESS;
+}
@@ -0,0 +1,81 @@
+#ifndef SPLATT_CMTF_H
+#define SPLATT_CMTF_H
+
+#include "base.h"
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "matrix.h"
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+#define cmtf_als splatt_cmtf_als
+/**
+* @brief Coupled matrix-tensor factorization with ALS. The tensor X is modeled
+*        by a CPD and each coupled matrix Y_m shares the factor of mode m:
+*
+*          min ||X - [[A_1, ..., A_N]]||^2 + sum_m ||Y_m - A_m V_m^T||^2
+*
+*        The update of a shared factor combines the tensor MTTKRP with the
+*        sparse-dense product Y_m V_m, and its normal equations add V_m^T V_m
+*        to the Hadamard product of the other Gram matrices:
+*
+*          A_m = (X_(m) (KRP) + Y_m V_m) (hada(A_n^T A_n) + V_m^T V_m)^-1
+*
+*        Each V_m is then updated from Y_m^T A_m. Both kernels are parallel.
+*        Factors are not normalized, since the scaling is shared between the
+*        tensor and the coupled matrices.
+*
+* @param tensors The CSF tensor(s) to factor.
+* @param coupled An array of length nmodes. coupled[m] is a CSR matrix with
+*                tensors->dims[m] rows, or NULL if mode m is not coupled.
+* @param mats [IN/OUT] The initialized factors of the tensor.
+* @param side [IN/OUT] The initialized factors of the coupled matrices.
+*             side[m] has coupled[m]->J rows and is ignored if coupled[m] is
+*             NULL.
+* @param nfactors The rank of the factorization.
+* @param opts SPLATT options array.
+*
+* @return The fit of the model to the tensor and the coupled matrices together,
+*         1 - sqrt(total residual / total norm).
+*/
+double cmtf_als(
+  splatt_csf const * const tensors,
+  spmatrix_t ** coupled,
+  matrix_t ** mats,
+  matrix_t ** side,
+  idx_t const nfactors,
+  double const * const opts);
+
+
+#define cmtf_factorize splatt_cmtf_factorize
+/**
+* @brief Compute a coupled matrix-tensor factorization from a random
+*        initialization (see cmtf_als()). The tensor factors are normalized into
+*        factored->lambda. Each coupled factor absorbs the column norms of the
+*        shared factor, so Y_m ~= factored->factors[m] * side[m]^T.
+*
+* @param tensors The CSF tensor(s) to factor.
+* @param coupled An array of length nmodes of coupled matrices (or NULL).
+* @param nfactors The rank of the factorization.
+* @param opts SPLATT options array.
+* @param[out] factored The tensor's model. factored->fit is the joint fit.
+* @param[out] side side[m] is allocated with the factor of coupled[m], or set
+*                  to NULL if mode m is not coupled. Free with mat_free().
+*
+* @return SPLATT error code.
+*/
+int cmtf_factorize(
+  splatt_csf const * const tensors,
+  spmatrix_t ** coupled,
+  idx_t const nfactors,
+  double const * const opts,
+  splatt_kruskal * factored,
+  matrix_t ** side);
+
+#endif
@@ -0,0 +1,803 @@
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "completion.h"
+#include "csf.h"
+#include "reorder.h"
+#include "splatt_lapack.h"
+#include "thd_info.h"
+#include "timer.h"
+#include "util.h"
+
+#include <math.h>
+
+
+
+/******************************************************************************
+ * TYPES / MACROS
+ *****************************************************************************/
+
+/* Stop after this many epochs without improving the best RMSE. */
+#ifndef TC_MAX_BAD_EPOCHS
+#define TC_MAX_BAD_EPOCHS 5
+#endif
+
+/* Bold driver step size adjustments for SGD. */
+#ifndef TC_SGD_GROW
+#define TC_SGD_GROW 1.05
+#endif
+#ifndef TC_SGD_SHRINK
+#define TC_SGD_SHRINK 0.5
+#endif
+
+
+/**
+* @brief Convergence state shared by the completion algorithms.
+*/
+typedef struct
+{
+  double best;  /** The best RMSE seen so far. */
+  double prev;  /** The RMSE of the previous epoch. */
+  idx_t nbad;   /** Consecutive epochs without a new best RMSE. */
+} tc_progress;
+
+
+
+/******************************************************************************
+ * PRIVATE FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief Initialize convergence tracking.
+*
+* @param prog The state to initialize.
+*/
+static void p_progress_init(
+    tc_progress * const prog)
+{
+  prog->best = INFINITY;
+  prog->prev = INFINITY;
+  prog->nbad = 0;
+}
+
+
+/**
+* @brief Report an epoch and check for convergence. We stop once the RMSE
+*        (validation if available, otherwise training) changes by less than
+*        opts[SPLATT_OPTION_TOLERANCE] or fails to improve for
+*        TC_MAX_BAD_EPOCHS epochs in a row.
+*
+* @param prog The convergence state.
+* @param epoch The epoch which was just completed.
+* @param seconds The time spent on the epoch.
+* @param train_rmse The training RMSE.
+* @param val_rmse The validation RMSE, or a negative value if not available.
+* @param opts SPLATT options array.
+*
+* @return true if we have converged.
+*/
+static bool p_progress_update(
+    tc_progress * const prog,
+    idx_t const epoch,
+    double const seconds,
+    double const train_rmse,
+    double const val_rmse,
+    double const * const opts)
+{
+  if(opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_NONE) {
+    printf("  epoch = %3"SPLATT_PF_IDX" (%0.3fs)  train-rmse = %0.5e",
+        epoch+1, seconds, train_rmse);
+    if(val_rmse >= 0.) {
+      printf("  val-rmse = %0.5e", val_rmse);
+    }
+    printf("\n");
+  }
+
+  double const rmse = (val_rmse >= 0.) ? val_rmse : train_rmse;
+  bool const stalled = fabs(prog->prev - rmse) < opts[SPLATT_OPTION_TOLERANCE];
+  prog->prev = rmse;
+
+  if(rmse < prog->best) {
+    prog->best = rmse;
+    prog->nbad = 0;
+  } else {
+    ++prog->nbad;
+  }
+
+  return stalled || prog->nbad >= TC_MAX_BAD_EPOCHS || !isfinite(rmse);
+}
+
+
+/**
+* @brief Predict one entry of a tensor from the model.
+*
+* @param tt The tensor.
+* @param n Which entry to predict.
+* @param mats The factor matrices.
+* @param buf Workspace of nfactors values.
+*
+* @return The predicted value.
+*/
+static inline val_t p_predict(
+    sptensor_t const * const tt,
+    idx_t const n,
+    matrix_t ** mats,
+    val_t * const restrict buf)
+{
+  idx_t const nfactors = mats[0]->J;
+
+  val_t const * const restrict first =
+      mats[0]->vals + (tt->ind[0][n] * nfactors);
+  for(idx_t r=0; r < nfactors; ++r) {
+    buf[r] = first[r];
+  }
+  for(idx_t m=1; m < tt->nmodes; ++m) {
+    val_t const * const restrict row =
+        mats[m]->vals + (tt->ind[m][n] * nfactors);
+    for(idx_t r=0; r < nfactors; ++r) {
+      buf[r] *= row[r];
+    }
+  }
+
+  val_t pred = 0.;
+  for(idx_t r=0; r < nfactors; ++r) {
+    pred += buf[r];
+  }
+  return pred;
+}
+
+
+/**
+* @brief Return the sum of the squared Frobenius norms of the factors.
+*
+* @param mats The factor matrices.
+* @param nmodes The number of factors.
+*
+* @return sum ||A_m||_F^2.
+*/
+static double p_factor_frobsq(
+    matrix_t ** mats,
+    idx_t const nmodes)
+{
+  double norm = 0.;
+  for(idx_t m=0; m < nmodes; ++m) {
+    val_t const * const restrict vals = mats[m]->vals;
+    idx_t const len = mats[m]->I * mats[m]->J;
+
+    #pragma omp parallel for schedule(static) reduction(+:norm)
+    for(idx_t x=0; x < len; ++x) {
+      norm += vals[x] * vals[x];
+    }
+  }
+  return norm;
+}
+
+
+/**
+* @brief Accumulate the normal equations of the observed entries below one
+*        fiber of a CSF tensor.
+*
+* @param ct The CSF tensor.
+* @param fiber The fiber (the nodes just above the leaves).
+* @param kr The Hadamard product of the rows at depths 1..nmodes-2, or NULL if
+*           the fiber is the root (a 2-mode tensor).
+* @param leafmat The factor at the leaves.
+* @param[out] gram The (row-major, lower triangle) Gram matrix.
+* @param[out] rhs The right-hand side.
+* @param krow Workspace of nfactors values.
+* @param nfactors The rank of the model.
+*/
+static void p_als_fiber(
+    splatt_csf const * const ct,
+    idx_t const fiber,
+    val_t const * const restrict kr,
+    val_t const * const restrict leafmat,
+    val_t * const restrict gram,
+    val_t * const restrict rhs,
+    val_t * const restrict krow,
+    idx_t const nfactors)
+{
+  idx_t const fdepth = ct->nmodes - 2;
+  idx_t const * const restrict fptr = ct->pt->fptr[fdepth];
+  idx_t const * const restrict inds = ct->pt->fids[fdepth+1];
+  val_t const * const restrict vals = ct->pt->vals;
+
+  for(idx_t jj=fptr[fiber]; jj < fptr[fiber+1]; ++jj) {
+    val_t const * const restrict lv = leafmat + (inds[jj] * nfactors);
+    for(idx_t r=0; r < nfactors; ++r) {
+      krow[r] = (kr != NULL) ? kr[r] * lv[r] : lv[r];
+    }
+
+    val_t const v = vals[jj];
+    for(idx_t i=0; i < nfactors; ++i) {
+      rhs[i] += v * krow[i];
+      for(idx_t j=0; j <= i; ++j) {
+        gram[j + (i*nfactors)] += krow[i] * krow[j];
+      }
+    }
+  }
+}
+
+
+/**
+* @brief Descend a CSF subtree, forming the partial Khatri-Rao products of
+*        each level, and accumulate the normal equations at the fibers.
+*
+* @param ct The CSF tensor.
+* @param depth The depth of 'node' (at least 1).
+* @param node The node to descend from.
+* @param mats The factor matrices.
+* @param[out] gram The Gram matrix of the root row.
+* @param[out] rhs The right-hand side of the root row.
+* @param bufs Workspace of (nmodes+1)*nfactors values.
+*/
+static void p_als_descend(
+    splatt_csf const * const ct,
+    idx_t const depth,
+    idx_t const node,
+    matrix_t ** mats,
+    val_t * const restrict gram,
+    val_t * const restrict rhs,
+    val_t * const restrict bufs)
+{
+  idx_t const nfactors = mats[0]->J;
+  idx_t const nmodes = ct->nmodes;
+  idx_t const fdepth = nmodes - 2;
+
+  idx_t const fid = ct->pt->fids[depth][node];
+  val_t const * const restrict row =
+      mats[csf_depth_to_mode(ct, depth)]->vals + (fid * nfactors);
+  val_t const * const restrict parent = bufs + ((depth-1) * nfactors);
+  val_t * const restrict kr = bufs + (depth * nfactors);
+
+  for(idx_t r=0; r < nfactors; ++r) {
+    kr[r] = (depth == 1) ? row[r] : parent[r] * row[r];
+  }
+
+  if(depth == fdepth) {
+    p_als_fiber(ct, node, kr, mats[csf_depth_to_mode(ct, nmodes-1)]->vals,
+        gram, rhs, bufs + (nmodes * nfactors), nfactors);
+    return;
+  }
+
+  idx_t const * const restrict fptr = ct->pt->fptr[depth];
+  for(idx_t c=fptr[node]; c < fptr[node+1]; ++c) {
+    p_als_descend(ct, depth+1, c, mats, gram, rhs, bufs);
+  }
+}
+
+
+/**
+* @brief Update one factor with ALS over the observed entries. Each root slice
+*        of 'ct' is one row of the factor, and rows are solved independently.
+*
+* @param ct The CSF tensor with 'mode' at the root.
+* @param mode The mode to update.
+* @param mats The factor matrices.
+* @param reg The regularization parameter.
+* @param partition A partitioning of the slices of 'ct' among threads.
+* @param thds Thread structures.
+*/
+static void p_als_update(
+    splatt_csf const * const ct,
+    idx_t const mode,
+    matrix_t ** mats,
+    val_t const reg,
+    idx_t const * const partition,
+    thd_info * const thds)
+{
+  idx_t const nfactors = mats[mode]->J;
+  val_t * const restrict avals = mats[mode]->vals;
+
+  idx_t const * const restrict sids = ct->pt->fids[0];
+  idx_t const * const restrict sptr = ct->pt->fptr[0];
+
+  #pragma omp parallel
+  {
+    int const tid = splatt_omp_get_thread_num();
+    val_t * const restrict gram = (val_t *) thds[tid].scratch[0];
+    val_t * const restrict rhs = gram + (nfactors * nfactors);
+    val_t * const restrict bufs = (val_t *) thds[tid].scratch[1];
+
+    char uplo = 'U';
+    splatt_blas_int order = (splatt_blas_int) nfactors;
+    splatt_blas_int nrhs = 1;
+    splatt_blas_int lda = (splatt_blas_int) nfactors;
+    splatt_blas_int info;
+
+    for(idx_t s=partition[tid]; s < partition[tid+1]; ++s) {
+      memset(gram, 0, nfactors * nfactors * sizeof(*gram));
+      memset(rhs, 0, nfactors * sizeof(*rhs));
+
+      if(ct->nmodes == 2) {
+        p_als_fiber(ct, s, NULL, mats[csf_depth_to_mode(ct, 1)]->vals, gram,
+            rhs, bufs, nfactors);
+      } else {
+        for(idx_t f=sptr[s]; f < sptr[s+1]; ++f) {
+          p_als_descend(ct, 1, f, mats, gram, rhs, bufs);
+        }
+      }
+      for(idx_t r=0; r < nfactors; ++r) {
+        gram[r + (r*nfactors)] += reg;
+      }
+
+      /* the row-major lower triangle is the column-major upper triangle */
+      SPLATT_BLAS(potrf)(&uplo, &order, gram, &lda, &info);
+      if(info != 0) {
+        /* too few observations for an unregularized solve */
+        continue;
+      }
+      SPLATT_BLAS(potrs)(&uplo, &order, &nrhs, gram, &lda, rhs, &lda, &info);
+
+      idx_t const fid = (sids == NULL) ? s : sids[s];
+      memcpy(avals + (fid * nfactors), rhs, nfactors * sizeof(*rhs));
+    }
+  } /* end omp parallel */
+}
+
+
+/**
+* @brief Build an index of the entries of each row of a mode.
+*
+* @param tt The tensor.
+* @param mode The mode to index.
+* @param[out] rowptr The entries of row 'i' are perm[rowptr[i]:rowptr[i+1]].
+* @param[out] perm The entries, grouped by row.
+*/
+static void p_index_rows(
+    sptensor_t const * const tt,
+    idx_t const mode,
+    idx_t ** rowptr,
+    idx_t ** perm)
+{
+  idx_t const dim = tt->dims[mode];
+  idx_t const * const restrict inds = tt->ind[mode];
+
+  idx_t * ptr = splatt_malloc((dim+1) * sizeof(*ptr));
+  idx_t * p = splatt_malloc(tt->nnz * sizeof(*p));
+  memset(ptr, 0, (dim+1) * sizeof(*ptr));
+
+  for(idx_t n=0; n < tt->nnz; ++n) {
+    ++ptr[inds[n]+1];
+  }
+  for(idx_t i=0; i < dim; ++i) {
+    ptr[i+1] += ptr[i];
+  }
+  for(idx_t n=0; n < tt->nnz; ++n) {
+    p[ptr[inds[n]]++] = n;
+  }
+  /* shift back */
+  for(idx_t i=dim; i > 0; --i) {
+    ptr[i] = ptr[i-1];
+  }
+  ptr[0] = 0;
+
+  *rowptr = ptr;
+  *perm = p;
+}
+
+
+/**
+* @brief Compute the contribution of rank-1 component 'r' to one entry.
+*
+* @param tt The tensor.
+* @param n The entry.
+* @param mats The factor matrices.
+* @param r The component.
+* @param skip A mode to leave out of the product, or tt->nmodes for none.
+*
+* @return prod_{m != skip} A_m(i_m, r).
+*/
+static inline val_t p_component(
+    sptensor_t const * const tt,
+    idx_t const n,
+    matrix_t ** mats,
+    idx_t const r,
+    idx_t const skip)
+{
+  idx_t const nfactors = mats[0]->J;
+  val_t prod = 1.;
+  for(idx_t m=0; m < tt->nmodes; ++m) {
+    if(m != skip) {
+      prod *= mats[m]->vals[r + (tt->ind[m][n] * nfactors)];
+    }
+  }
+  return prod;
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+double tc_rmse(
+  sptensor_t const * const tt,
+  matrix_t ** mats,
+  double const * const opts)
+{
+  if(tt->nnz == 0) {
+    return 0.;
+  }
+
+  idx_t const nfactors = mats[0]->J;
+  double err = 0.;
+
+  #pragma omp parallel num_threads((int) opts[SPLATT_OPTION_NTHREADS]) \
+      reduction(+:err)
+  {
+    val_t * buf = splatt_malloc(nfactors * sizeof(*buf));
+
+    #pragma omp for schedule(static)
+    for(idx_t n=0; n < tt->nnz; ++n) {
+      val_t const diff = tt->vals[n] - p_predict(tt, n, mats, buf);
+      err += diff * diff;
+    }
+
+    splatt_free(buf);
+  }
+
+  return sqrt(err / (double) tt->nnz);
+}
+
+
+double tc_als(
+  splatt_csf const * const tensors,
+  sptensor_t const * const train,
+  sptensor_t const * const validate,
+  matrix_t ** mats,
+  double const * const opts)
+{
+  idx_t const nmodes = tensors->nmodes;
+  idx_t const nfactors = mats[0]->J;
+  idx_t const nthreads = (idx_t) opts[SPLATT_OPTION_NTHREADS];
+  val_t const reg = opts[SPLATT_OPTION_REGULARIZE];
+
+  splatt_omp_set_num_threads(nthreads);
+  thd_info * thds = thd_init(nthreads, 2,
+      ((nfactors * nfactors) + nfactors) * sizeof(val_t),
+      ((nmodes + 1) * nfactors * sizeof(val_t)));
+
+  /* balance the non-zeros of each mode's slices among threads */
+  idx_t * partition[MAX_NMODES];
+  for(idx_t m=0; m < nmodes; ++m) {
+    assert(csf_mode_to_depth(tensors + m, m) == 0);
+    assert(tensors[m].ntiles == 1);
+    partition[m] = csf_partition_1d(tensors + m, 0, nthreads);
+  }
+
+  tc_progress prog;
+  p_progress_init(&prog);
+  double rmse = 0.;
+
+  sp_timer_t epoch_time;
+  timer_start(&timers[TIMER_CPD]);
+
+  idx_t const niters = (idx_t) opts[SPLATT_OPTION_NITER];
+  for(idx_t e=0; e < niters; ++e) {
+    timer_fstart(&epoch_time);
+    for(idx_t m=0; m < nmodes; ++m) {
+      p_als_update(tensors + m, m, mats, reg, partition[m], thds);
+    }
+    timer_stop(&epoch_time);
+
+    double const train_rmse = tc_rmse(train, mats, opts);
+    double const val_rmse = (validate != NULL) ?
+        tc_rmse(validate, mats, opts) : -1.;
+    rmse = (validate != NULL) ? val_rmse : train_rmse;
+    if(p_progress_update(&prog, e, epoch_time.seconds, train_rmse, val_rmse,
+          opts)) {
+      break;
+    }
+  }
+  timer_stop(&timers[TIMER_CPD]);
+
+  for(idx_t m=0; m < nmodes; ++m) {
+    splatt_free(partition[m]);
+  }
+  thd_free(thds, nthreads);
+
+  return rmse;
+}
+
+
+double tc_sgd(
+  sptensor_t const * const train,
+  sptensor_t const * const validate,
+  matrix_t ** mats,
+  double const * const opts)
+{
+  idx_t const nmodes = train->nmodes;
+  idx_t const nfactors = mats[0]->J;
+  idx_t const nnz = train->nnz;
+  idx_t const nthreads = (idx_t) opts[SPLATT_OPTION_NTHREADS];
+  val_t const reg = opts[SPLATT_OPTION_REGULARIZE];
+  val_t step = opts[SPLATT_OPTION_LEARNRATE];
+
+  splatt_omp_set_num_threads(nthreads);
+
+  idx_t * perm = splatt_malloc(nnz * sizeof(*perm));
+  for(idx_t n=0; n < nnz; ++n) {
+    perm[n] = n;
+  }
+
+  tc_progress prog;
+  p_progress_init(&prog);
+  double rmse = 0.;
+
+  double train_rmse = tc_rmse(train, mats, opts);
+  double loss = (train_rmse * train_rmse * nnz) +
+      (reg * p_factor_frobsq(mats, nmodes));
+
+  sp_timer_t epoch_time;
+  timer_start(&timers[TIMER_CPD]);
+
+  idx_t const niters = (idx_t) opts[SPLATT_OPTION_NITER];
+  for(idx_t e=0; e < niters; ++e) {
+    timer_fstart(&epoch_time);
+
+    /* visit the entries in a new random order each epoch */
+    shuffle_idx(perm, nnz);
+
+    #pragma omp parallel
+    {
+      /* grad[m] holds the product of all rows except mode m */
+      val_t * grad = splatt_malloc(nmodes * nfactors * sizeof(*grad));
+      val_t * rows[MAX_NMODES];
+
+      #pragma omp for schedule(static)
+      for(idx_t x=0; x < nnz; ++x) {
+        idx_t const n = perm[x];
+        for(idx_t m=0; m < nmodes; ++m) {
+          rows[m] = mats[m]->vals + (train->ind[m][n] * nfactors);
+        }
+
+        /* prefix products, then fold in the suffix products */
+        for(idx_t r=0; r < nfactors; ++r) {
+          grad[r] = 1.;
+        }
+        for(idx_t m=1; m < nmodes; ++m) {
+          for(idx_t r=0; r < nfactors; ++r) {
+            grad[r + (m*nfactors)] =
+                grad[r + ((m-1)*nfactors)] * rows[m-1][r];
+          }
+        }
+        for(idx_t r=0; r < nfactors; ++r) {
+          val_t suffix = 1.;
+          for(idx_t m=nmodes; m-- > 0; ) {
+            grad[r + (m*nfactors)] *= suffix;
+            suffix *= rows[m][r];
+          }
+        }
+
+        val_t pred = 0.;
+        for(idx_t r=0; r < nfactors; ++r) {
+          pred += rows[0][r] * grad[r];
+        }
+        val_t const err = train->vals[n] - pred;
+
+        /* Hogwild: rows are updated without locks */
+        for(idx_t m=0; m < nmodes; ++m) {
+          val_t const * const restrict g = grad + (m * nfactors);
+          for(idx_t r=0; r < nfactors; ++r) {
+            rows[m][r] += step * ((err * g[r]) - (reg * rows[m][r]));
+          }
+        }
+      }
+
+      splatt_free(grad);
+    } /* end omp parallel */
+    timer_stop(&epoch_time);
+
+    /* bold driver */
+    train_rmse = tc_rmse(train, mats, opts);
+    double const new_loss = (train_rmse * train_rmse * nnz) +
+        (reg * p_factor_frobsq(mats, nmodes));
+    if(new_loss < loss) {
+      step *= TC_SGD_GROW;
+    } else {
+      step *= TC_SGD_SHRINK;
+    }
+    loss = new_loss;
+
+    double const val_rmse = (validate != NULL) ?
+        tc_rmse(validate, mats, opts) : -1.;
+    rmse = (validate != NULL) ? val_rmse : train_rmse;
+    if(p_progress_update(&prog, e, epoch_time.seconds, train_rmse, val_rmse,
+          opts)) {
+      break;
+    }
+  }
+  timer_stop(&timers[TIMER_CPD]);
+
+  splatt_free(perm);
+
+  return rmse;
+}
+
+
+double tc_ccd(
+  sptensor_t const * const train,
+  sptensor_t const * const validate,
+  matrix_t ** mats,
+  double const * const opts)
+{
+  idx_t const nmodes = train->nmodes;
+  idx_t const nfactors = mats[0]->J;
+  idx_t const nnz = train->nnz;
+  idx_t const nthreads = (idx_t) opts[SPLATT_OPTION_NTHREADS];
+  val_t const reg = opts[SPLATT_OPTION_REGULARIZE];
+
+  splatt_omp_set_num_threads(nthreads);
+
+  idx_t * rowptr[MAX_NMODES];
+  idx_t * rowperm[MAX_NMODES];
+  for(idx_t m=0; m < nmodes; ++m) {
+    p_index_rows(train, m, rowptr + m, rowperm + m);
+  }
+
+  /* residual of each observed entry */
+  val_t * resid = splatt_malloc(nnz * sizeof(*resid));
+  #pragma omp parallel
+  {
+    val_t * buf = splatt_malloc(nfactors * sizeof(*buf));
+    #pragma omp for schedule(static)
+    for(idx_t n=0; n < nnz; ++n) {
+      resid[n] = train->vals[n] - p_predict(train, n, mats, buf);
+    }
+    splatt_free(buf);
+  }
+
+  tc_progress prog;
+  p_progress_init(&prog);
+  double rmse = 0.;
+
+  sp_timer_t epoch_time;
+  timer_start(&timers[TIMER_CPD]);
+
+  idx_t const niters = (idx_t) opts[SPLATT_OPTION_NITER];
+  for(idx_t e=0; e < niters; ++e) {
+    timer_fstart(&epoch_time);
+
+    for(idx_t r=0; r < nfactors; ++r) {
+      /* remove component r from the model */
+      #pragma omp parallel for schedule(static)
+      for(idx_t n=0; n < nnz; ++n) {
+        resid[n] += p_component(train, n, mats, r, nmodes);
+      }
+
+      /* closed-form update of column r of each factor */
+      for(idx_t m=0; m < nmodes; ++m) {
+        idx_t const * const restrict ptr = rowptr[m];
+        idx_t const * const restrict perm = rowperm[m];
+        val_t * const restrict avals = mats[m]->vals;
+
+        #pragma omp parallel for schedule(dynamic, 64)
+        for(idx_t i=0; i < train->dims[m]; ++i) {
+          val_t numer = 0.;
+          val_t denom = reg;
+          for(idx_t x=ptr[i]; x < ptr[i+1]; ++x) {
+            idx_t const n = perm[x];
+            val_t const p = p_component(train, n, mats, r, m);
+            numer += resid[n] * p;
+            denom += p * p;
+          }
+          avals[r + (i*nfactors)] = (denom > 0.) ? numer / denom : 0.;
+        }
+      }
+
+      /* add the updated component back */
+      #pragma omp parallel for schedule(static)
+      for(idx_t n=0; n < nnz; ++n) {
+        resid[n] -= p_component(train, n, mats, r, nmodes);
+      }
+    }
+    timer_stop(&epoch_time);
+
+    /* the residual gives the training error for free */
+    double err = 0.;
+    #pragma omp parallel for schedule(static) reduction(+:err)
+    for(idx_t n=0; n < nnz; ++n) {
+      err += resid[n] * resid[n];
+    }
+    double const train_rmse = (nnz > 0) ? sqrt(err / (double) nnz) : 0.;
+
+    double const val_rmse = (validate != NULL) ?
+        tc_rmse(validate, mats, opts) : -1.;
+    rmse = (validate != NULL) ? val_rmse : train_rmse;
+    if(p_progress_update(&prog, e, epoch_time.seconds, train_rmse, val_rmse,
+          opts)) {
+      break;
+    }
+  }
+  timer_stop(&timers[TIMER_CPD]);
+
+  splatt_free(resid);
+  for(idx_t m=0; m < nmodes; ++m) {
+    splatt_free(rowptr[m]);
+    splatt_free(rowperm[m]);
+  }
+
+  return rmse;
+}
+
+
+int tc_complete(
+  sptensor_t * const train,
+  sptensor_t const * const validate,
+  idx_t const nfactors,
+  splatt_tc_type const which,
+  double const * const opts,
+  splatt_kruskal * model)
+{
+  idx_t const nmodes = train->nmodes;
+
+  if(validate != NULL) {
+    if(validate->nmodes != nmodes) {
+      fprintf(stderr, "SPLATT: validation tensor has %"SPLATT_PF_IDX" modes, "
+                      "expected %"SPLATT_PF_IDX".\n", validate->nmodes, nmodes);
+      return SPLATT_ERROR_BADINPUT;
+    }
+    /* the model must cover the held-out indices too */
+    for(idx_t m=0; m < nmodes; ++m) {
+      train->dims[m] = SS_MAX(train->dims[m], validate->dims[m]);
+    }
+  }
+
+  /* scale the initial model to roughly match the mean observation */
+  double mean = 0.;
+  for(idx_t n=0; n < train->nnz; ++n) {
+    mean += train->vals[n];
+  }
+  mean = (train->nnz > 0) ? fabs(mean / (double) train->nnz) : 0.;
+  double scale = 1.;
+  if(mean > 0.) {
+    scale = pow(mean / (nfactors * pow(0.5, nmodes)), 1. / nmodes);
+  }
+
+  matrix_t * mats[MAX_NMODES+1];
+  for(idx_t m=0; m < nmodes; ++m) {
+    mats[m] = mat_alloc(train->dims[m], nfactors);
+    for(idx_t x=0; x < train->dims[m] * nfactors; ++x) {
+      mats[m]->vals[x] = scale * ((val_t) rand() / (val_t) RAND_MAX);
+    }
+  }
+
+  double rmse = 0.;
+  switch(which) {
+  case SPLATT_TC_ALS: {
+    /* one untiled tensor rooted at each mode */
+    double * csf_opts = splatt_default_opts();
+    memcpy(csf_opts, opts, SPLATT_OPTION_NOPTIONS * sizeof(*opts));
+    csf_opts[SPLATT_OPTION_CSF_ALLOC] = SPLATT_CSF_ALLMODE;
+    csf_opts[SPLATT_OPTION_TILE] = SPLATT_NOTILE;
+    splatt_csf * csf = csf_alloc(train, csf_opts);
+    rmse = tc_als(csf, train, validate, mats, opts);
+    csf_free(csf, csf_opts);
+    splatt_free_opts(csf_opts);
+    break;
+  }
+  case SPLATT_TC_SGD:
+    rmse = tc_sgd(train, validate, mats, opts);
+    break;
+  case SPLATT_TC_CCD:
+    rmse = tc_ccd(train, validate, mats, opts);
+    break;
+  }
+
+  model->rank = nfactors;
+  model->nmodes = nmodes;
+  model->fit = rmse;
+  model->lambda = splatt_malloc(nfactors * sizeof(*model->lambda));
+  for(idx_t f=0; f < nfactors; ++f) {
+    model->lambda[f] = 1.;
+  }
+  for(idx_t m=0; m < nmodes; ++m) {
+    model->dims[m] = train->dims[m];
+    model->factors[m] = mats[m]->vals;
+    splatt_free(mats[m]); /* just the matrix_t ptr, data is safely in model */
+  }
+
+  return SPLATT_SUCCESS;
+}
@@ -0,0 +1,149 @@
+#ifndef SPLATT_COMPLETION_H
+#define SPLATT_COMPLETION_H
+
+#include "base.h"
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "matrix.h"
+#include "sptensor.h"
+
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/**
+* @brief The available tensor completion algorithms.
+*/
+typedef enum
+{
+  SPLATT_TC_ALS, /** ALS restricted to the observed entries (CSF) */
+  SPLATT_TC_SGD, /** lock-free (Hogwild) stochastic gradient descent (COO) */
+  SPLATT_TC_CCD  /** cyclic coordinate descent, CCD++ (COO) */
+} splatt_tc_type;
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+#define tc_rmse splatt_tc_rmse
+/**
+* @brief Compute the root-mean-squared error of a model over a set of
+*        observed entries.
+*
+* @param tt The observed entries (e.g., a held-out validation set).
+* @param mats The factor matrices of the model.
+* @param opts SPLATT options array. This uses SPLATT_OPTION_NTHREADS.
+*
+* @return The RMSE, or 0 if 'tt' is empty.
+*/
+double tc_rmse(
+  sptensor_t const * const tt,
+  matrix_t ** mats,
+  double const * const opts);
+
+
+#define tc_als splatt_tc_als
+/**
+* @brief Complete a tensor with ALS, where each row of a factor is the
+*        regularized least-squares fit of only its observed entries:
+*
+*          (sum_{x in row i} k_x k_x^T + reg * I) a_i = sum_{x in row i} x k_x
+*
+*        where k_x is the row of the Khatri-Rao product for entry x. The
+*        normal equations of each row are accumulated by walking the CSF tree
+*        rooted at that mode, and rows are solved independently in parallel.
+*
+* @param tensors One CSF tensor per mode, with that mode at the root (i.e.,
+*                allocated with SPLATT_CSF_ALLMODE and SPLATT_NOTILE).
+* @param train The training entries, used to report the training RMSE.
+* @param validate Held-out entries used for convergence. May be NULL, in which
+*                 case the training RMSE is used.
+* @param mats [OUT] The factors, which must be initialized.
+* @param opts SPLATT options array.
+*
+* @return The final RMSE (validation if available, otherwise training).
+*/
+double tc_als(
+  splatt_csf const * const tensors,
+  sptensor_t const * const train,
+  sptensor_t const * const validate,
+  matrix_t ** mats,
+  double const * const opts);
+
+
+#define tc_sgd splatt_tc_sgd
+/**
+* @brief Complete a tensor with Hogwild stochastic gradient descent. Each epoch
+*        visits the observed entries in a random order and threads update the
+*        factors without locks. The step size starts at
+*        opts[SPLATT_OPTION_LEARNRATE] and follows the "bold driver" heuristic:
+*        it grows after epochs which reduce the training loss and is halved
+*        after epochs which do not.
+*
+* @param train The training entries.
+* @param validate Held-out entries used for convergence. May be NULL.
+* @param mats [OUT] The factors, which must be initialized.
+* @param opts SPLATT options array.
+*
+* @return The final RMSE (validation if available, otherwise training).
+*/
+double tc_sgd(
+  sptensor_t const * const train,
+  sptensor_t const * const validate,
+  matrix_t ** mats,
+  double const * const opts);
+
+
+#define tc_ccd splatt_tc_ccd
+/**
+* @brief Complete a tensor with CCD++. Each epoch updates the factors one rank-1
+*        component at a time, with a closed-form update of every entry of the
+*        component's columns. The residual of the observed entries is kept up
+*        to date so that each component costs O(nnz * nmodes). Rows are updated
+*        in parallel.
+*
+* @param train The training entries.
+* @param validate Held-out entries used for convergence. May be NULL.
+* @param mats [OUT] The factors, which must be initialized.
+* @param opts SPLATT options array.
+*
+* @return The final RMSE (validation if available, otherwise training).
+*/
+double tc_ccd(
+  sptensor_t const * const train,
+  sptensor_t const * const validate,
+  matrix_t ** mats,
+  double const * const opts);
+
+
+#define tc_complete splatt_tc_complete
+/**
+* @brief Complete a tensor from a random initialization. Missing entries are
+*        unknown rather than zero. The dimensions of 'train' are grown to
+*        cover the indices of 'validate'.
+*
+* @param train The training entries.
+* @param validate Held-out entries used for convergence. May be NULL.
+* @param nfactors The rank of the model.
+* @param which The completion algorithm to use.
+* @param opts SPLATT options array.
+* @param[out] model The completed model. All weights are one, and model->fit
+*                   holds the final RMSE.
+*
+* @return SPLATT error code.
+*/
+int tc_complete(
+  sptensor_t * const train,
+  sptensor_t const * const validate,
+  idx_t const nfactors,
+  splatt_tc_type const which,
+  double const * const opts,
+  splatt_kruskal * model);
+
+#endif
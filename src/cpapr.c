@@ -0,0 +1,608 @@
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "cpapr.h"
+#include "csf.h"
+#include "mttkrp.h"
+#include "mutex_pool.h"
+#include "thd_info.h"
+#include "tile.h"
+#include "timer.h"
+#include "util.h"
+
+#include <math.h>
+
+
+
+/******************************************************************************
+ * TYPES / MACROS
+ *****************************************************************************/
+
+/* Maximum number of multiplicative updates per factor. */
+#ifndef CPAPR_INNER_ITS
+#define CPAPR_INNER_ITS 10
+#endif
+
+/* Model values are clamped to at least this to avoid division by zero. */
+#ifndef CPAPR_EPS
+#define CPAPR_EPS 1e-10
+#endif
+
+/* How far to shift factor entries which are stuck at zero. */
+#ifndef CPAPR_KAPPA
+#define CPAPR_KAPPA 1e-2
+#endif
+
+/* Factor entries below this are considered stuck at zero. */
+#ifndef CPAPR_KAPPA_TOL
+#define CPAPR_KAPPA_TOL 1e-10
+#endif
+
+
+
+/******************************************************************************
+ * PRIVATE FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief Process one fiber (the nodes just above the leaves). The model row
+*        and the partial Khatri-Rao product of the upper levels are folded
+*        together once per fiber, so each non-zero costs only a dot product
+*        and (if computing Phi) an axpy.
+*
+* @param ct The CSF tensor.
+* @param tile_id The tile we are in.
+* @param fiber The fiber to process.
+* @param kr The Hadamard product of the rows at depths 1..nmodes-2, or NULL if
+*           the fiber is the root (i.e., a 2-mode tensor).
+* @param leafmat The factor at the leaves.
+* @param brow The (scaled) root row of the model.
+* @param[out] phirow If not NULL, Phi is accumulated here.
+* @param work Workspace of 2*nfactors values.
+* @param nfactors The rank of the factorization.
+*
+* @return The contribution to sum(x .* log(model)) if phirow is NULL.
+*/
+static double p_cpapr_fiber(
+    splatt_csf const * const ct,
+    idx_t const tile_id,
+    idx_t const fiber,
+    val_t const * const restrict kr,
+    val_t const * const restrict leafmat,
+    val_t const * const restrict brow,
+    val_t * const restrict phirow,
+    val_t * const restrict work,
+    idx_t const nfactors)
+{
+  idx_t const fdepth = ct->nmodes - 2;
+  idx_t const * const restrict fptr = ct->pt[tile_id].fptr[fdepth];
+  idx_t const * const restrict inds = ct->pt[tile_id].fids[fdepth+1];
+  val_t const * const restrict vals = ct->pt[tile_id].vals;
+
+  val_t * const restrict hada = work;
+  val_t * const restrict accum = work + nfactors;
+
+  /* fold the model row into the upper partial product */
+  for(idx_t r=0; r < nfactors; ++r) {
+    hada[r] = (kr != NULL) ? kr[r] * brow[r] : brow[r];
+    accum[r] = 0.;
+  }
+
+  double loglik = 0.;
+  for(idx_t jj=fptr[fiber]; jj < fptr[fiber+1]; ++jj) {
+    val_t const * const restrict lv = leafmat + (inds[jj] * nfactors);
+
+    val_t model = 0.;
+    for(idx_t r=0; r < nfactors; ++r) {
+      model += hada[r] * lv[r];
+    }
+    model = SS_MAX(model, CPAPR_EPS);
+
+    if(phirow != NULL) {
+      val_t const scale = vals[jj] / model;
+      for(idx_t r=0; r < nfactors; ++r) {
+        accum[r] += scale * lv[r];
+      }
+    } else {
+      loglik += vals[jj] * log(model);
+    }
+  }
+
+  if(phirow != NULL) {
+    for(idx_t r=0; r < nfactors; ++r) {
+      phirow[r] += (kr != NULL) ? kr[r] * accum[r] : accum[r];
+    }
+  }
+
+  return loglik;
+}
+
+
+/**
+* @brief Descend a CSF subtree, forming the partial Khatri-Rao products of
+*        each level on the way down (as the MTTKRP kernels do).
+*
+* @param ct The CSF tensor.
+* @param tile_id The tile we are in.
+* @param depth The depth of 'node' (at least 1).
+* @param node The node to descend from.
+* @param mats The factor matrices.
+* @param brow The (scaled) root row of the model.
+* @param[out] phirow If not NULL, Phi is accumulated here.
+* @param bufs Workspace of nmodes*nfactors values for the partial products.
+* @param work Workspace of 2*nfactors values.
+*
+* @return The contribution to sum(x .* log(model)) if phirow is NULL.
+*/
+static double p_cpapr_descend(
+    splatt_csf const * const ct,
+    idx_t const tile_id,
+    idx_t const depth,
+    idx_t const node,
+    matrix_t ** mats,
+    val_t const * const restrict brow,
+    val_t * const restrict phirow,
+    val_t * const restrict bufs,
+    val_t * const restrict work)
+{
+  idx_t const nfactors = mats[MAX_NMODES]->J;
+  idx_t const fdepth = ct->nmodes - 2;
+
+  idx_t const fid = ct->pt[tile_id].fids[depth][node];
+  val_t const * const restrict row =
+      mats[csf_depth_to_mode(ct, depth)]->vals + (fid * nfactors);
+  val_t const * const restrict parent = bufs + ((depth-1) * nfactors);
+  val_t * const restrict kr = bufs + (depth * nfactors);
+
+  for(idx_t r=0; r < nfactors; ++r) {
+    kr[r] = (depth == 1) ? row[r] : parent[r] * row[r];
+  }
+
+  if(depth == fdepth) {
+    val_t const * const leafmat = mats[csf_depth_to_mode(ct, fdepth+1)]->vals;
+    return p_cpapr_fiber(ct, tile_id, node, kr, leafmat, brow, phirow, work,
+        nfactors);
+  }
+
+  double loglik = 0.;
+  idx_t const * const restrict fptr = ct->pt[tile_id].fptr[depth];
+  for(idx_t c=fptr[node]; c < fptr[node+1]; ++c) {
+    loglik += p_cpapr_descend(ct, tile_id, depth+1, c, mats, brow, phirow,
+        bufs, work);
+  }
+  return loglik;
+}
+
+
+/**
+* @brief Evaluate one tile of a CSF tensor against the model. Each slice is
+*        accumulated into a thread-local row and flushed at the end.
+*
+* @param ct The CSF tensor, rooted at the mode being updated.
+* @param tile_id The tile to process.
+* @param mats The factor matrices.
+* @param B The model factor of the root mode (factor scaled by lambda).
+* @param[out] phi If not NULL, Phi is accumulated here.
+* @param partition A partitioning of the slices, or NULL for all slices.
+* @param pool Locks for updating rows of 'phi', or NULL if no other thread can
+*             touch these rows.
+* @param thds Thread structures.
+*
+* @return The contribution to sum(x .* log(model)) if phi is NULL.
+*/
+static double p_cpapr_tile(
+    splatt_csf const * const ct,
+    idx_t const tile_id,
+    matrix_t ** mats,
+    matrix_t const * const B,
+    matrix_t * const phi,
+    idx_t const * const partition,
+    mutex_pool * const pool,
+    thd_info * const thds)
+{
+  idx_t const nfactors = B->J;
+  int const tid = splatt_omp_get_thread_num();
+  val_t * const restrict bufs = (val_t *) thds[tid].scratch[0];
+  val_t * const restrict work = (val_t *) thds[tid].scratch[1];
+  val_t * const restrict prow = (val_t *) thds[tid].scratch[2];
+
+  idx_t const * const restrict sids = ct->pt[tile_id].fids[0];
+  idx_t const * const restrict sptr = ct->pt[tile_id].fptr[0];
+
+  idx_t const nslices = ct->pt[tile_id].nfibs[0];
+  idx_t const start = (partition != NULL) ? partition[tid]   : 0;
+  idx_t const stop  = (partition != NULL) ? partition[tid+1] : nslices;
+
+  double loglik = 0.;
+  for(idx_t s=start; s < stop; ++s) {
+    idx_t const fid = (sids == NULL) ? s : sids[s];
+    val_t const * const restrict brow = B->vals + (fid * nfactors);
+    val_t * const restrict phirow = (phi != NULL) ? prow : NULL;
+
+    if(phirow != NULL) {
+      for(idx_t r=0; r < nfactors; ++r) {
+        phirow[r] = 0.;
+      }
+    }
+
+    if(ct->nmodes == 2) {
+      loglik += p_cpapr_fiber(ct, tile_id, s, NULL,
+          mats[csf_depth_to_mode(ct, 1)]->vals, brow, phirow, work, nfactors);
+    } else {
+      for(idx_t f=sptr[s]; f < sptr[s+1]; ++f) {
+        loglik += p_cpapr_descend(ct, tile_id, 1, f, mats, brow, phirow, bufs,
+            work);
+      }
+    }
+
+    /* flush to output */
+    if(phirow != NULL) {
+      val_t * const restrict out = phi->vals + (fid * nfactors);
+      if(pool != NULL) {
+        mutex_set_lock(pool, fid);
+      }
+      for(idx_t r=0; r < nfactors; ++r) {
+        out[r] += phirow[r];
+      }
+      if(pool != NULL) {
+        mutex_unset_lock(pool, fid);
+      }
+    }
+  }
+
+  return loglik;
+}
+
+
+/**
+* @brief Evaluate a CSF tensor against the model, either accumulating
+*        Phi = (X_(m) ./ (B * KR^T)) * KR or sum(x .* log(model)). Work is
+*        distributed with the same tile and slice partitionings as MTTKRP.
+*
+* @param tensors The CSF tensors.
+* @param mode The mode at the root of the tensor we use.
+* @param mats The factor matrices.
+* @param B The model factor of 'mode' (factor scaled by lambda).
+* @param[out] phi If not NULL, Phi is written here.
+* @param ws MTTKRP workspace, for its partitioning.
+* @param pool Locks for updating rows of 'phi'.
+* @param thds Thread structures.
+*
+* @return sum(x .* log(model)) if phi is NULL, otherwise 0.
+*/
+static double p_cpapr_eval(
+    splatt_csf const * const tensors,
+    idx_t const mode,
+    matrix_t ** mats,
+    matrix_t const * const B,
+    matrix_t * const phi,
+    splatt_mttkrp_ws const * const ws,
+    mutex_pool * const pool,
+    thd_info * const thds)
+{
+  idx_t const csf_id = ws->mode_csf_map[mode];
+  splatt_csf const * const ct = tensors + csf_id;
+  idx_t const nmodes = ct->nmodes;
+  assert(csf_mode_to_depth(ct, mode) == 0);
+
+  if(phi != NULL) {
+    phi->I = ct->dims[mode];
+    memset(phi->vals, 0, phi->I * phi->J * sizeof(*(phi->vals)));
+  }
+
+  double loglik = 0.;
+
+  #pragma omp parallel reduction(+:loglik)
+  {
+    int const tid = splatt_omp_get_thread_num();
+    timer_start(&thds[tid].ttime);
+
+    if(ct->ntiles > 1) {
+      idx_t const * const tile_partition = ws->tile_partition[csf_id];
+
+      /* layers of tiles along the root mode touch disjoint rows */
+      if(ct->tile_dims[mode] > 1) {
+        #pragma omp for schedule(dynamic, 1) nowait
+        for(idx_t t=0; t < ct->tile_dims[mode]; ++t) {
+          idx_t tile_id =
+              get_next_tileid(TILE_BEGIN, ct->tile_dims, nmodes, mode, t);
+          while(tile_id != TILE_END) {
+            loglik += p_cpapr_tile(ct, tile_id, mats, B, phi, NULL, NULL,
+                thds);
+            tile_id =
+                get_next_tileid(tile_id, ct->tile_dims, nmodes, mode, t);
+          }
+        }
+      } else {
+        for(idx_t tile_id = tile_partition[tid];
+                  tile_id < tile_partition[tid+1]; ++tile_id) {
+          loglik += p_cpapr_tile(ct, tile_id, mats, B, phi, NULL, pool,
+              thds);
+        }
+      }
+    } else {
+      loglik += p_cpapr_tile(ct, 0, mats, B, phi, ws->tree_partition[csf_id],
+          NULL, thds);
+    }
+
+    timer_stop(&thds[tid].ttime);
+  } /* end omp parallel */
+
+  return loglik;
+}
+
+
+/**
+* @brief Scale the columns of a factor to sum to one, multiplying the column
+*        sums into lambda.
+*
+* @param A The factor to normalize.
+* @param[out] lambda The weights, which are scaled by the column sums.
+* @param colsum Workspace of A->J values.
+*/
+static void p_normalize_sum(
+    matrix_t * const A,
+    val_t * const lambda,
+    val_t * const colsum)
+{
+  idx_t const I = A->I;
+  idx_t const J = A->J;
+  val_t * const restrict vals = A->vals;
+
+  for(idx_t j=0; j < J; ++j) {
+    colsum[j] = 0.;
+  }
+  for(idx_t i=0; i < I; ++i) {
+    for(idx_t j=0; j < J; ++j) {
+      colsum[j] += vals[j + (i*J)];
+    }
+  }
+
+  #pragma omp parallel for schedule(static)
+  for(idx_t i=0; i < I; ++i) {
+    for(idx_t j=0; j < J; ++j) {
+      if(colsum[j] > 0.) {
+        vals[j + (i*J)] /= colsum[j];
+      }
+    }
+  }
+
+  for(idx_t j=0; j < J; ++j) {
+    lambda[j] *= colsum[j];
+  }
+}
+
+
+/**
+* @brief Compute the Poisson log-likelihood of the model,
+*        sum(x .* log(model)) - sum(model), up to the constant log(x!) terms.
+*        The factors must have columns which sum to one.
+*
+* @param tensors The CSF tensors.
+* @param mats The factor matrices. mats[MAX_NMODES] is used as workspace.
+* @param lambda The weights of the model.
+* @param ws MTTKRP workspace.
+* @param thds Thread structures.
+*
+* @return The log-likelihood.
+*/
+static double p_cpapr_loglik(
+    splatt_csf const * const tensors,
+    matrix_t ** mats,
+    val_t const * const lambda,
+    splatt_mttkrp_ws const * const ws,
+    thd_info * const thds)
+{
+  idx_t const nfactors = mats[0]->J;
+  matrix_t * const B = mats[MAX_NMODES];
+  B->I = mats[0]->I;
+
+  #pragma omp parallel for schedule(static)
+  for(idx_t i=0; i < B->I; ++i) {
+    for(idx_t r=0; r < nfactors; ++r) {
+      B->vals[r + (i*nfactors)] = mats[0]->vals[r + (i*nfactors)] * lambda[r];
+    }
+  }
+
+  double loglik = p_cpapr_eval(tensors, 0, mats, B, NULL, ws, NULL, thds);
+  for(idx_t r=0; r < nfactors; ++r) {
+    loglik -= lambda[r];
+  }
+  return loglik;
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+int cpapr_cpd(
+  splatt_csf const * const tensors,
+  idx_t const nfactors,
+  double const * const opts,
+  splatt_kruskal * factored)
+{
+  idx_t const nmodes = tensors->nmodes;
+  matrix_t * mats[MAX_NMODES+1];
+
+  /* each mode must be at the root of its own tensor */
+  if((splatt_csf_type) opts[SPLATT_OPTION_CSF_ALLOC] != SPLATT_CSF_ALLMODE) {
+    fprintf(stderr, "SPLATT: CP-APR requires SPLATT_CSF_ALLMODE.\n");
+    return SPLATT_ERROR_BADINPUT;
+  }
+
+  idx_t const maxdim = tensors->dims[argmax_elem(tensors->dims, nmodes)];
+  for(idx_t m=0; m < nmodes; ++m) {
+    /* multiplicative updates keep zeros at zero, so start strictly positive */
+    mats[m] = mat_rand(tensors->dims[m], nfactors);
+    for(idx_t x=0; x < mats[m]->I * nfactors; ++x) {
+      mats[m]->vals[x] = fabs(mats[m]->vals[x]) + CPAPR_EPS;
+    }
+  }
+  mats[MAX_NMODES] = mat_alloc(maxdim, nfactors);
+
+  val_t * lambda = splatt_malloc(nfactors * sizeof(*lambda));
+
+  factored->fit = cpapr_iterate(tensors, mats, lambda, nfactors, opts);
+
+  factored->rank = nfactors;
+  factored->nmodes = nmodes;
+  factored->lambda = lambda;
+  for(idx_t m=0; m < nmodes; ++m) {
+    factored->dims[m] = tensors->dims[m];
+    factored->factors[m] = mats[m]->vals;
+    splatt_free(mats[m]); /* just the matrix_t ptr, data is in factored */
+  }
+  mat_free(mats[MAX_NMODES]);
+
+  return SPLATT_SUCCESS;
+}
+
+
+double cpapr_iterate(
+  splatt_csf const * const tensors,
+  matrix_t ** mats,
+  val_t * const lambda,
+  idx_t const nfactors,
+  double const * const opts)
+{
+  idx_t const nmodes = tensors[0].nmodes;
+  idx_t const nthreads = (idx_t) opts[SPLATT_OPTION_NTHREADS];
+  val_t const tol = opts[SPLATT_OPTION_TOLERANCE];
+
+  splatt_omp_set_num_threads(nthreads);
+  thd_info * thds =  thd_init(nthreads, 3,
+    (nmodes * nfactors * sizeof(val_t)),
+    (2 * nfactors * sizeof(val_t)),
+    (nfactors * sizeof(val_t)));
+
+  mutex_pool * pool = mutex_alloc_sized(
+      (int) tensors->dims[argmax_elem(tensors->dims, nmodes)], (int) nthreads);
+
+  /* reuse the MTTKRP partitioning; Phi is never privatized */
+  double * wsopts = splatt_default_opts();
+  memcpy(wsopts, opts, SPLATT_OPTION_NOPTIONS * sizeof(*opts));
+  wsopts[SPLATT_OPTION_PRIVTHRESH] = 0.;
+  splatt_mttkrp_ws * ws = splatt_mttkrp_alloc_ws(tensors, nfactors, wsopts);
+  splatt_free_opts(wsopts);
+
+  /* Phi of each mode is kept to detect entries stuck at zero */
+  matrix_t * phis[MAX_NMODES];
+  for(idx_t m=0; m < nmodes; ++m) {
+    phis[m] = mat_alloc(mats[m]->I, nfactors);
+    memset(phis[m]->vals, 0, mats[m]->I * nfactors * sizeof(val_t));
+  }
+  matrix_t * const B = mats[MAX_NMODES];
+  val_t * colsum = splatt_malloc(nfactors * sizeof(*colsum));
+
+  /* start from column-stochastic factors */
+  for(idx_t f=0; f < nfactors; ++f) {
+    lambda[f] = 1.;
+  }
+  for(idx_t m=0; m < nmodes; ++m) {
+    p_normalize_sum(mats[m], lambda, colsum);
+  }
+
+  double loglik = 0.;
+  double oldll = 0.;
+
+  sp_timer_t itertime;
+  timer_start(&timers[TIMER_CPD]);
+
+  idx_t const niters = (idx_t) opts[SPLATT_OPTION_NITER];
+  for(idx_t it=0; it < niters; ++it) {
+    timer_fstart(&itertime);
+
+    bool converged = true;
+    val_t kkt = 0.;
+    idx_t inner_its = 0;
+
+    for(idx_t m=0; m < nmodes; ++m) {
+      idx_t const I = mats[m]->I;
+      val_t * const restrict av = mats[m]->vals;
+      val_t * const restrict pv = phis[m]->vals;
+      val_t * const restrict bv = B->vals;
+      B->I = I;
+
+      /* B = (A + S) * diag(lambda), where S shifts inadmissible zeros */
+      #pragma omp parallel for schedule(static)
+      for(idx_t i=0; i < I; ++i) {
+        for(idx_t r=0; r < nfactors; ++r) {
+          idx_t const x = r + (i*nfactors);
+          val_t a = av[x];
+          if(it > 0 && a < CPAPR_KAPPA_TOL && pv[x] > 1.) {
+            a += CPAPR_KAPPA;
+          }
+          bv[x] = a * lambda[r];
+        }
+      }
+
+      /* multiplicative updates */
+      for(idx_t inner=0; inner < CPAPR_INNER_ITS; ++inner) {
+        ++inner_its;
+
+        timer_start(&timers[TIMER_MTTKRP]);
+        p_cpapr_eval(tensors, m, mats, B, phis[m], ws, pool, thds);
+        timer_stop(&timers[TIMER_MTTKRP]);
+
+        /* KKT violation: min(B, 1 - Phi) */
+        val_t viol = 0.;
+        #pragma omp parallel for schedule(static) reduction(max:viol)
+        for(idx_t x=0; x < I * nfactors; ++x) {
+          val_t const v = fabs(SS_MIN(bv[x], 1. - pv[x]));
+          viol = SS_MAX(viol, v);
+        }
+        kkt = SS_MAX(kkt, viol);
+
+        if(viol < tol) {
+          break;
+        }
+        converged = false;
+
+        #pragma omp parallel for schedule(static)
+        for(idx_t x=0; x < I * nfactors; ++x) {
+          bv[x] *= pv[x];
+        }
+      }
+
+      /* A = B * diag(1 / lambda) */
+      par_memcpy(av, bv, I * nfactors * sizeof(val_t));
+      for(idx_t f=0; f < nfactors; ++f) {
+        lambda[f] = 1.;
+      }
+      p_normalize_sum(mats[m], lambda, colsum);
+    } /* foreach mode */
+
+    if(opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_NONE) {
+      loglik = p_cpapr_loglik(tensors, mats, lambda, ws, thds);
+    }
+    timer_stop(&itertime);
+
+    if(opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_NONE) {
+      printf("  its = %3"SPLATT_PF_IDX" (%0.3fs)  loglik = %0.5e  "
+             "delta = %+0.4e  kkt = %0.3e  inner = %"SPLATT_PF_IDX"\n",
+          it+1, itertime.seconds, loglik, loglik - oldll, kkt, inner_its);
+      oldll = loglik;
+    }
+
+    if(converged) {
+      break;
+    }
+  }
+  timer_stop(&timers[TIMER_CPD]);
+
+  loglik = p_cpapr_loglik(tensors, mats, lambda, ws, thds);
+
+  /* clean up */
+  splatt_free(colsum);
+  for(idx_t m=0; m < nmodes; ++m) {
+    mat_free(phis[m]);
+  }
+  splatt_mttkrp_free_ws(ws);
+  mutex_free(pool);
+  thd_free(thds, nthreads);
+
+  return loglik;
+}
@@ -0,0 +1,72 @@
+#ifndef SPLATT_CPAPR_H
+#define SPLATT_CPAPR_H
+
+#include "base.h"
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "matrix.h"
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+#define cpapr_cpd splatt_cpapr_cpd
+/**
+* @brief Compute a Poisson CPD of a count tensor from a random initialization.
+*        This is the CP-APR counterpart of splatt_cpd_als().
+*
+*        The factors are returned with columns that sum to one, with the
+*        scaling absorbed into lambda. factored->fit holds the final
+*        log-likelihood instead of a least-squares fit.
+*
+* @param tensors The CSF tensors to factor. Every mode must be the root of one
+*                of them, i.e., opts[SPLATT_OPTION_CSF_ALLOC] must be
+*                SPLATT_CSF_ALLMODE.
+* @param nfactors The rank of the decomposition.
+* @param opts SPLATT options array.
+* @param[out] factored The factored tensor in Kruskal format.
+*
+* @return SPLATT error code.
+*/
+int cpapr_cpd(
+  splatt_csf const * const tensors,
+  idx_t const nfactors,
+  double const * const opts,
+  splatt_kruskal * factored);
+
+
+#define cpapr_iterate splatt_cpapr_iterate
+/**
+* @brief Compute the CPD which maximizes the Poisson log-likelihood with the
+*        multiplicative updates of CP-APR (Chi & Kolda). Each factor is updated
+*        with up to CPAPR_INNER_ITS multiplicative steps B <- B .* Phi, where
+*
+*          Phi = (X_(m) ./ (B * KR^T)) * KR
+*
+*        is evaluated by walking the CSF tree rooted at that mode. The outer
+*        iterations stop once every factor satisfies the KKT conditions to
+*        within opts[SPLATT_OPTION_TOLERANCE], or after
+*        opts[SPLATT_OPTION_NITER] iterations.
+*
+* @param tensors The CSF tensors to factor (see cpapr_cpd()).
+* @param mats [OUT] The output factors. These must be initialized to
+*             non-negative values. mats[MAX_NMODES] is used as workspace and
+*             must have as many rows as the largest mode.
+* @param lambda [OUT] The output vector for scaling.
+* @param nfactors The rank of the factorization.
+* @param opts SPLATT options array.
+*
+* @return The final log-likelihood of the model.
+*/
+double cpapr_iterate(
+  splatt_csf const * const tensors,
+  matrix_t ** mats,
+  val_t * const lambda,
+  idx_t const nfactors,
+  double const * const opts);
+
+#endif
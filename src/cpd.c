@@ -4,25 +4,238 @@
  * INCLUDES
  *****************************************************************************/
 #include "base.h"
+#include "admm.h"
 #include "cpd.h"
+#include "io.h"
 #include "matrix.h"
 #include "mttkrp.h"
+#include "pperturb.h"
 #include "timer.h"
 #include "thd_info.h"
+#include "tucker.h"
 #include "util.h"
 
 #include <math.h>
 
 
+/* Extra columns in the sketch of the SVD initialization. */
+#ifndef CPD_SVD_OVERSAMPLE
+#define CPD_SVD_OVERSAMPLE 10
+#endif
+
+
 
 /******************************************************************************
- * API FUNCTIONS
+ * PRIVATE FUNCTIONS
  *****************************************************************************/
 
-int splatt_cpd_als(
+/**
+* @brief Initialize the factors with a randomized HOSVD. The unfolding of each
+*        mode is sketched by a Khatri-Rao product of random matrices:
+*
+*          Y = X_(m) (G_N krp ... krp G_1), skipping G_m,
+*
+*        which is exactly an MTTKRP with 'nfactors + CPD_SVD_OVERSAMPLE'
+*        columns. The random G have zero mean, so Y Y^T estimates
+*        X_(m) X_(m)^T and the leading left singular vectors of Y estimate
+*        those of the unfolding. Once a mode is done, its G is replaced by
+*        random combinations of its singular vectors. Altogether this costs
+*        one sweep of MTTKRP.
+*
+* @param tensors The CSF tensor(s) to factor.
+* @param nfactors The rank of the decomposition.
+* @param options SPLATT options array.
+* @param[out] mats The factors. The leading min(nfactors, I) columns of each
+*                  are overwritten and any others are left as they are.
+*/
+static void p_svd_init(
     splatt_csf const * const tensors,
-    splatt_idx_t const nfactors,
+    idx_t const nfactors,
     double const * const options,
+    matrix_t ** mats)
+{
+  idx_t const nmodes = tensors->nmodes;
+  idx_t const nthreads = (idx_t) options[SPLATT_OPTION_NTHREADS];
+  idx_t const ncols = nfactors + CPD_SVD_OVERSAMPLE;
+
+  matrix_t * sketch[MAX_NMODES+1];
+  idx_t maxdim = 0;
+  for(idx_t m=0; m < nmodes; ++m) {
+    sketch[m] = mat_rand(tensors->dims[m], ncols);
+    maxdim = SS_MAX(maxdim, tensors->dims[m]);
+  }
+  sketch[MAX_NMODES] = mat_alloc(maxdim, ncols);
+  matrix_t * const Y = sketch[MAX_NMODES];
+
+  thd_info * thds = cpd_alloc_thds(nmodes, ncols, nthreads);
+  splatt_mttkrp_ws * mttkrp_ws = splatt_mttkrp_alloc_ws(tensors, ncols,
+      options);
+  for(idx_t m=0; m < nmodes; ++m) {
+    mttkrp_invalidate_factor(mttkrp_ws, m);
+  }
+
+  for(idx_t m=0; m < nmodes; ++m) {
+    idx_t const dim = tensors->dims[m];
+    Y->I = dim;
+    mttkrp_csf(tensors, sketch, m, thds, mttkrp_ws, options);
+
+    idx_t const rank = SS_MIN(nfactors, dim);
+    matrix_t * U = mat_alloc(dim, rank);
+    tucker_leading_svecs(Y->vals, dim, ncols, U);
+
+    val_t * const restrict mv = mats[m]->vals;
+    val_t const * const restrict uv = U->vals;
+    for(idx_t i=0; i < dim; ++i) {
+      for(idx_t f=0; f < rank; ++f) {
+        mv[f + (i*nfactors)] = options[SPLATT_OPTION_NNCPD] ?
+            fabs(uv[f + (i*rank)]) : uv[f + (i*rank)];
+      }
+    }
+
+    /* later modes are sketched within the subspace just found, which filters
+     * out much of the noise (as in sequentially-truncated HOSVD) */
+    if(m < nmodes-1) {
+      matrix_t * omega = mat_rand(rank, ncols);
+      memset(sketch[m]->vals, 0, dim * ncols * sizeof(val_t));
+      mat_matmul(U, omega, sketch[m]);
+      mttkrp_invalidate_factor(mttkrp_ws, m);
+      mat_free(omega);
+    }
+    mat_free(U);
+  }
+
+  splatt_mttkrp_free_ws(mttkrp_ws);
+  thd_free(thds, nthreads);
+  for(idx_t m=0; m < nmodes; ++m) {
+    mat_free(sketch[m]);
+  }
+  mat_free(Y);
+}
+
+
+/**
+* @brief Seed a factor matrix from a previous factorization. Rows and columns
+*        which are present in 'init' are copied. New rows (from a tensor which
+*        has grown) and new columns (from an increased rank) are initialized
+*        randomly, scaled to match the magnitude of the existing entries so
+*        they do not dominate the first solve.
+*
+* @param init The previous factor, stored row-major.
+* @param init_dim The number of rows in 'init'.
+* @param init_rank The number of columns in 'init'.
+* @param[out] mat The factor to fill. Its dimensions must already be set.
+*/
+static void p_seed_factor(
+    val_t const * const restrict init,
+    idx_t const init_dim,
+    idx_t const init_rank,
+    matrix_t * const mat)
+{
+  idx_t const I = mat->I;
+  idx_t const J = mat->J;
+  val_t * const restrict vals = mat->vals;
+
+  /* root-mean-square of each existing column */
+  val_t * rms = splatt_malloc(J * sizeof(*rms));
+  val_t avg_rms = 0.;
+  for(idx_t j=0; j < init_rank; ++j) {
+    val_t sum = 0.;
+    for(idx_t i=0; i < init_dim; ++i) {
+      val_t const v = init[j + (i*init_rank)];
+      sum += v * v;
+    }
+    rms[j] = (init_dim > 0) ? sqrt(sum / (val_t) init_dim) : 1.;
+    avg_rms += rms[j];
+  }
+  avg_rms = (init_rank > 0) ? avg_rms / (val_t) init_rank : 1.;
+  if(avg_rms == 0.) {
+    avg_rms = 1.;
+  }
+  for(idx_t j=init_rank; j < J; ++j) {
+    rms[j] = avg_rms;
+  }
+
+  /* rand_val() is uniform in [-3, 3], which has an RMS of sqrt(3) */
+  for(idx_t j=0; j < J; ++j) {
+    rms[j] /= sqrt(3.);
+  }
+
+  for(idx_t i=0; i < I; ++i) {
+    for(idx_t j=0; j < J; ++j) {
+      if(i < init_dim && j < init_rank) {
+        vals[j + (i*J)] = init[j + (i*init_rank)];
+      } else {
+        vals[j + (i*J)] = rand_val() * rms[j];
+      }
+    }
+  }
+
+  splatt_free(rms);
+}
+
+
+/**
+* @brief Ensure that 'init' can be used to seed a rank-'nfactors' CPD of
+*        'tensors'.
+*
+* @param tensors The CSF tensor(s) to factor.
+* @param nfactors The rank of the decomposition.
+* @param init The initial factorization.
+*
+* @return SPLATT_SUCCESS if 'init' is usable, SPLATT_ERROR_BADINPUT otherwise.
+*/
+static int p_check_init(
+    splatt_csf const * const tensors,
+    idx_t const nfactors,
+    splatt_kruskal const * const init)
+{
+  idx_t const nmodes = tensors->nmodes;
+  if(init->nmodes != nmodes) {
+    fprintf(stderr, "SPLATT ERROR: initial factors have %"SPLATT_PF_IDX
+        " modes but tensor has %"SPLATT_PF_IDX".\n", init->nmodes, nmodes);
+    return SPLATT_ERROR_BADINPUT;
+  }
+  if(init->rank > nfactors) {
+    fprintf(stderr, "SPLATT ERROR: initial rank %"SPLATT_PF_IDX" exceeds "
+        "requested rank %"SPLATT_PF_IDX".\n", init->rank, nfactors);
+    return SPLATT_ERROR_BADINPUT;
+  }
+  for(idx_t m=0; m < nmodes; ++m) {
+    if(init->dims[m] > tensors->dims[m]) {
+      fprintf(stderr, "SPLATT ERROR: initial factor %"SPLATT_PF_IDX" has %"
+          SPLATT_PF_IDX" rows but tensor has only %"SPLATT_PF_IDX".\n",
+          m+1, init->dims[m], tensors->dims[m]);
+      return SPLATT_ERROR_BADINPUT;
+    }
+  }
+  return SPLATT_SUCCESS;
+}
+
+
+/**
+* @brief Allocate factors and run CPD-ALS, optionally seeded by a previous
+*        factorization. 'init' is assumed to have been validated.
+*
+* @param tensors The CSF tensor(s) to factor.
+* @param nfactors The rank of the decomposition.
+* @param options SPLATT options array.
+* @param init Initial factors, or NULL for a random initialization.
+* @param chkpt Checkpointing information, or NULL.
+* @param thds Thread structures from cpd_alloc_thds() to reuse, or NULL.
+* @param mttkrp_ws MTTKRP workspace to reuse, or NULL. Both 'thds' and
+*                  'mttkrp_ws' must be given to be used.
+* @param[out] factored The resulting factorization.
+*
+* @return SPLATT error code.
+*/
+static int p_cpd_als(
+    splatt_csf const * const tensors,
+    idx_t const nfactors,
+    double const * const options,
+    splatt_kruskal const * const init,
+    cpd_checkpoint * const chkpt,
+    thd_info * const thds,
+    splatt_mttkrp_ws * const mttkrp_ws,
     splatt_kruskal * factored)
 {
   matrix_t * mats[MAX_NMODES+1];
@@ -35,15 +248,47 @@ int splatt_cpd_als(
   /* allocate factor matrices */
   idx_t maxdim = tensors->dims[argmax_elem(tensors->dims, nmodes)];
   for(idx_t m=0; m < nmodes; ++m) {
-    mats[m] = (matrix_t *) mat_rand(tensors[0].dims[m], nfactors);
+    if(init == NULL) {
+      mats[m] = (matrix_t *) mat_rand(tensors[0].dims[m], nfactors);
+      /* a negative start wastes the first projection and can zero columns */
+      if(options[SPLATT_OPTION_NNCPD]) {
+        val_t * const restrict mv = mats[m]->vals;
+        for(idx_t x=0; x < mats[m]->I * nfactors; ++x) {
+          mv[x] = fabs(mv[x]);
+        }
+      }
+    } else {
+      mats[m] = mat_alloc(tensors[0].dims[m], nfactors);
+      p_seed_factor(init->factors[m], init->dims[m], init->rank, mats[m]);
+    }
   }
   mats[MAX_NMODES] = mat_alloc(maxdim, nfactors);
+  if(init == NULL && options[SPLATT_OPTION_INIT] == SPLATT_INIT_SVD) {
+    p_svd_init(tensors, nfactors, options, mats);
+  }
 
   val_t * lambda = (val_t *) splatt_malloc(nfactors * sizeof(val_t));
 
+  /* The first ALS solve (mode 1) is driven by the other modes, so absorb the
+   * initial scaling into the last mode to start from exactly 'init'. */
+  if(init != NULL && init->lambda != NULL) {
+    val_t * const restrict lastv = mats[nmodes-1]->vals;
+    idx_t const lastdim = mats[nmodes-1]->I;
+    for(idx_t i=0; i < lastdim; ++i) {
+      for(idx_t j=0; j < init->rank; ++j) {
+        lastv[j + (i*nfactors)] *= init->lambda[j];
+      }
+    }
+  }
+
   /* do the factorization! */
-  factored->fit = cpd_als_iterate(tensors, mats, lambda, nfactors, &rinfo,
-      options);
+  if(thds != NULL && mttkrp_ws != NULL) {
+    factored->fit = cpd_als_iterate_ws(tensors, mats, lambda, nfactors, &rinfo,
+        options, chkpt, thds, mttkrp_ws);
+  } else {
+    factored->fit = cpd_als_iterate(tensors, mats, lambda, nfactors, &rinfo,
+        options, chkpt);
+  }
 
   /* store output */
   factored->rank = nfactors;
@@ -57,24 +302,303 @@ int splatt_cpd_als(
   /* clean up */
   mat_free(mats[MAX_NMODES]);
   for(idx_t m=0; m < nmodes; ++m) {
-    free(mats[m]); /* just the matrix_t ptr, data is safely in factored */
+    splatt_free(mats[m]); /* just the matrix_t ptr, data is in factored */
   }
   return SPLATT_SUCCESS;
 }
 
 
+
+/**
+* @brief Fill a Kruskal tensor with the same random factors that
+*        p_cpd_als() would start from. Lambda is left NULL.
+*
+* @param tensors The CSF tensor(s) to factor.
+* @param nfactors The rank of the decomposition.
+* @param options SPLATT options array.
+* @param[out] init The random initialization.
+*/
+static void p_rand_kruskal(
+    splatt_csf const * const tensors,
+    idx_t const nfactors,
+    double const * const options,
+    splatt_kruskal * const init)
+{
+  idx_t const nmodes = tensors->nmodes;
+  init->rank = nfactors;
+  init->nmodes = nmodes;
+  init->lambda = NULL;
+  init->fit = 0.;
+  for(idx_t m=0; m < nmodes; ++m) {
+    idx_t const nvals = tensors->dims[m] * nfactors;
+    init->dims[m] = tensors->dims[m];
+    init->factors[m] = splatt_malloc(nvals * sizeof(**init->factors));
+    fill_rand(init->factors[m], nvals);
+    if(options[SPLATT_OPTION_NNCPD]) {
+      for(idx_t x=0; x < nvals; ++x) {
+        init->factors[m][x] = fabs(init->factors[m][x]);
+      }
+    }
+  }
+}
+
+
+
+/******************************************************************************
+ * API FUNCTIONS
+ *****************************************************************************/
+
+int splatt_cpd_als(
+    splatt_csf const * const tensors,
+    splatt_idx_t const nfactors,
+    double const * const options,
+    splatt_kruskal * factored)
+{
+  return p_cpd_als(tensors, nfactors, options, NULL, NULL, NULL, NULL,
+        factored);
+}
+
+
+int splatt_cpd_als_warm(
+    splatt_csf const * const tensors,
+    splatt_idx_t const nfactors,
+    double const * const options,
+    splatt_kruskal const * const init,
+    splatt_kruskal * factored)
+{
+  return cpd_als_chkpt(tensors, nfactors, options, init, NULL, factored);
+}
+
+
+int splatt_cpd_als_multistart(
+    splatt_csf const * const tensors,
+    splatt_idx_t const nfactors,
+    splatt_idx_t const nstarts,
+    double const * const options,
+    splatt_kruskal * factored)
+{
+  if(nstarts == 0) {
+    fprintf(stderr, "SPLATT ERROR: multi-start CPD needs at least one "
+        "start.\n");
+    return SPLATT_ERROR_BADINPUT;
+  }
+  if(nstarts == 1) {
+    return p_cpd_als(tensors, nfactors, options, NULL, NULL, NULL, NULL,
+        factored);
+  }
+
+  /* divide the threads among concurrent runs */
+  idx_t const nthreads = (idx_t) options[SPLATT_OPTION_NTHREADS];
+  idx_t const nconcurrent = SS_MAX(1, SS_MIN(nstarts, nthreads));
+  idx_t const run_threads = SS_MAX(1, nthreads / nconcurrent);
+
+  double * run_opts = splatt_malloc(SPLATT_OPTION_NOPTIONS * sizeof(*run_opts));
+  memcpy(run_opts, options, SPLATT_OPTION_NOPTIONS * sizeof(*run_opts));
+  run_opts[SPLATT_OPTION_NTHREADS] = run_threads;
+  run_opts[SPLATT_OPTION_VERBOSITY] = SPLATT_VERBOSITY_NONE;
+
+  /* rand() is not thread-safe, so draw every initialization up front. The
+   * first start is the SVD initialization, if requested. */
+  splatt_kruskal * inits = splatt_malloc(nstarts * sizeof(*inits));
+  splatt_kruskal * results = splatt_malloc(nstarts * sizeof(*results));
+  double * seconds = splatt_malloc(nstarts * sizeof(*seconds));
+  int * rets = splatt_malloc(nstarts * sizeof(*rets));
+  for(idx_t s=0; s < nstarts; ++s) {
+    p_rand_kruskal(tensors, nfactors, options, inits + s);
+  }
+  if(options[SPLATT_OPTION_INIT] == SPLATT_INIT_SVD) {
+    matrix_t views[MAX_NMODES];
+    matrix_t * first[MAX_NMODES];
+    for(idx_t m=0; m < tensors->nmodes; ++m) {
+      views[m].I = inits[0].dims[m];
+      views[m].J = nfactors;
+      views[m].vals = inits[0].factors[m];
+      views[m].rowmajor = 1;
+      first[m] = views + m;
+    }
+    p_svd_init(tensors, nfactors, options, first);
+  }
+
+  /* the global timers are not thread-safe, so only run_time is measured */
+  timer_pause_all();
+  int const old_levels = splatt_omp_get_max_active_levels();
+  splatt_omp_set_max_active_levels(SS_MAX(old_levels, 2));
+  #pragma omp parallel for schedule(dynamic, 1) num_threads(nconcurrent)
+  for(idx_t s=0; s < nstarts; ++s) {
+    sp_timer_t run_time;
+    timer_fstart(&run_time);
+    rets[s] = p_cpd_als(tensors, nfactors, run_opts, inits + s, NULL, NULL,
+        NULL, results + s);
+    timer_stop(&run_time);
+    seconds[s] = run_time.seconds;
+    splatt_free_kruskal(inits + s);
+  }
+  splatt_omp_set_max_active_levels(old_levels);
+  splatt_omp_set_num_threads(nthreads);
+  timer_resume_all();
+
+  /* keep the best fit */
+  idx_t best = nstarts;
+  for(idx_t s=0; s < nstarts; ++s) {
+    if(options[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_NONE) {
+      printf("  start = %3"SPLATT_PF_IDX" (%0.3fs)  fit = %0.5f\n", s+1,
+          seconds[s], results[s].fit);
+    }
+    if(rets[s] == SPLATT_SUCCESS &&
+        (best == nstarts || results[s].fit > results[best].fit)) {
+      best = s;
+    }
+  }
+
+  int ret = SPLATT_SUCCESS;
+  if(best < nstarts) {
+    *factored = results[best];
+    if(options[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_NONE) {
+      printf("  best start = %"SPLATT_PF_IDX" of %"SPLATT_PF_IDX
+          " (%"SPLATT_PF_IDX" concurrent x %"SPLATT_PF_IDX" threads)\n",
+          best+1, nstarts, nconcurrent, run_threads);
+    }
+  } else {
+    ret = rets[0];
+  }
+  for(idx_t s=0; s < nstarts; ++s) {
+    if(s != best && rets[s] == SPLATT_SUCCESS) {
+      splatt_free_kruskal(results + s);
+    }
+  }
+
+  splatt_free(inits);
+  splatt_free(results);
+  splatt_free(seconds);
+  splatt_free(rets);
+  splatt_free(run_opts);
+  return ret;
+}
+
+
+int splatt_cpd_als_sweep(
+    splatt_csf const * const tensors,
+    splatt_idx_t const * const ranks,
+    splatt_idx_t const nranks,
+    double const * const options,
+    splatt_kruskal * factored,
+    double * seconds)
+{
+  if(nranks == 0 || ranks[0] == 0) {
+    fprintf(stderr, "SPLATT ERROR: rank sweep needs at least one positive "
+        "rank.\n");
+    return SPLATT_ERROR_BADINPUT;
+  }
+  for(idx_t r=1; r < nranks; ++r) {
+    if(ranks[r] < ranks[r-1]) {
+      fprintf(stderr, "SPLATT ERROR: rank sweep must be non-decreasing "
+          "(%"SPLATT_PF_IDX" follows %"SPLATT_PF_IDX").\n", ranks[r],
+          ranks[r-1]);
+      return SPLATT_ERROR_BADINPUT;
+    }
+  }
+
+  /* size the thread structures and workspace for the largest rank */
+  idx_t const nthreads = (idx_t) options[SPLATT_OPTION_NTHREADS];
+  idx_t const maxrank = ranks[nranks-1];
+  splatt_omp_set_num_threads(nthreads);
+  thd_info * thds = cpd_alloc_thds(tensors->nmodes, maxrank, nthreads);
+  splatt_mttkrp_ws * mttkrp_ws = splatt_mttkrp_alloc_ws(tensors, maxrank,
+      options);
+
+  int ret = SPLATT_SUCCESS;
+  for(idx_t r=0; r < nranks; ++r) {
+    sp_timer_t rank_time;
+    timer_fstart(&rank_time);
+
+    /* seed from the previous rank; new columns are random */
+    splatt_kruskal const * const init = (r > 0) ? factored + (r-1) : NULL;
+    ret = p_cpd_als(tensors, ranks[r], options, init, NULL, thds, mttkrp_ws,
+        factored + r);
+
+    timer_stop(&rank_time);
+    if(seconds != NULL) {
+      seconds[r] = rank_time.seconds;
+    }
+    if(ret != SPLATT_SUCCESS) {
+      for(idx_t f=0; f < r; ++f) {
+        splatt_free_kruskal(factored + f);
+      }
+      break;
+    }
+  }
+
+  splatt_mttkrp_free_ws(mttkrp_ws);
+  thd_free(thds, nthreads);
+  return ret;
+}
+
+
+int splatt_kruskal_load(
+    char const * const stem,
+    splatt_idx_t const nmodes,
+    splatt_kruskal * kruskal)
+{
+  char * fname = NULL;
+  idx_t rank = 0;
+
+  kruskal->nmodes = 0;
+  kruskal->lambda = NULL;
+
+  if(stem) {
+    asprintf(&fname, "%s.lambda.mat", stem);
+  } else {
+    asprintf(&fname, "lambda.mat");
+  }
+  kruskal->lambda = vec_read(fname, &rank);
+  free(fname);
+  if(kruskal->lambda == NULL) {
+    return SPLATT_ERROR_BADINPUT;
+  }
+  kruskal->rank = rank;
+
+  for(idx_t m=0; m < nmodes; ++m) {
+    if(stem) {
+      asprintf(&fname, "%s.mode%"SPLATT_PF_IDX".mat", stem, m+1);
+    } else {
+      asprintf(&fname, "mode%"SPLATT_PF_IDX".mat", m+1);
+    }
+    matrix_t * mat = mat_read(fname);
+    if(mat != NULL && mat->J != rank) {
+      fprintf(stderr, "SPLATT ERROR: '%s' has %"SPLATT_PF_IDX" columns but "
+          "lambda has %"SPLATT_PF_IDX" entries.\n", fname, mat->J, rank);
+      mat_free(mat);
+      mat = NULL;
+    }
+    free(fname);
+    if(mat == NULL) {
+      splatt_free_kruskal(kruskal);
+      return SPLATT_ERROR_BADINPUT;
+    }
+
+    kruskal->dims[m] = mat->I;
+    kruskal->factors[m] = mat->vals;
+    kruskal->nmodes = m+1;
+    splatt_free(mat); /* just the matrix_t ptr, data is safely in kruskal */
+  }
+
+  kruskal->fit = 0.;
+  return SPLATT_SUCCESS;
+}
+
+
 void splatt_free_kruskal(
     splatt_kruskal * factored)
 {
-  free(factored->lambda);
+  splatt_free(factored->lambda);
   for(idx_t m=0; m < factored->nmodes; ++m) {
-    free(factored->factors[m]);
+    splatt_free(factored->factors[m]);
   }
 }
 
 
 /******************************************************************************
- * PRIVATE FUNCTIONS
+ * CPD HELPERS
  *****************************************************************************/
 
 /**
@@ -94,6 +618,85 @@ void nncpd_constraint(matrix_t *m)
   }
 }
 
+/**
+* @brief Update a factor with one pass of hierarchical ALS (HALS). Each column
+*        is the exact minimizer of the (non-negative, L1/L2 penalized)
+*        objective with all other columns fixed:
+*
+*          A(:,r) = prox((M(:,r) - A * G(:,r) + A(:,r) * G(r,r)) / G(r,r))
+*
+*        No factorization of G is needed, so the cost is O(I * R^2). The
+*        column updates of a row depend only on that row, so the rows are
+*        processed in parallel and the column loop is run inside.
+*
+* @param mode The mode we are updating.
+* @param nmodes The number of modes in the tensor.
+* @param aTa The A^T * A matrices. aTa[MAX_NMODES] is used as workspace.
+* @param m1 The MTTKRP result for this mode.
+* @param[out] A The factor to update. Its current value is the starting point.
+* @param opts SPLATT options array.
+*/
+static void p_hals_update(
+    idx_t const mode,
+    idx_t const nmodes,
+    matrix_t * * aTa,
+    matrix_t const * const m1,
+    matrix_t * const A,
+    double const * const opts)
+{
+  timer_start(&timers[TIMER_INV]);
+
+  idx_t const I = A->I;
+  idx_t const R = A->J;
+
+  mat_form_gram(aTa[MAX_NMODES], aTa, mode, nmodes);
+  val_t const * const restrict gram = aTa[MAX_NMODES]->vals;
+
+  val_t const l1 = opts[SPLATT_OPTION_L1];
+  val_t const l2 = opts[SPLATT_OPTION_REGULARIZE];
+  int const nonneg = opts[SPLATT_OPTION_NNCPD] != 0;
+
+  val_t * const restrict av = A->vals;
+  val_t const * const restrict mv = m1->vals;
+
+  #pragma omp parallel for schedule(static)
+  for(idx_t i=0; i < I; ++i) {
+    val_t * const restrict arow = av + (i*R);
+    val_t const * const restrict mrow = mv + (i*R);
+
+    for(idx_t r=0; r < R; ++r) {
+      val_t const diag = gram[r + (r*R)] + l2;
+      if(diag <= 0.) {
+        continue;
+      }
+
+      /* M(i,r) - A(i,:) * G(:,r), excluding A(i,r) itself */
+      val_t v = mrow[r];
+      for(idx_t k=0; k < R; ++k) {
+        if(k != r) {
+          v -= arow[k] * gram[k + (r*R)];
+        }
+      }
+
+      /* soft-threshold for L1, then project */
+      if(v > l1) {
+        v -= l1;
+      } else if(v < -l1) {
+        v += l1;
+      } else {
+        v = 0.;
+      }
+      if(nonneg && v < 0.) {
+        v = 0.;
+      }
+      arow[r] = v / diag;
+    }
+  }
+
+  timer_stop(&timers[TIMER_INV]);
+}
+
+
 /**
 * @brief Resets serial and MPI timers that were activated during some CPD
 *        pre-processing.
@@ -183,9 +786,10 @@ static val_t p_kruskal_norm(
 * @param m1 The result of doing MTTKRP along the last mode.
 *
 * @return The inner product of the two tensors, computed via:
-*         1^T hadamard(mats[nmodes-1], m1) \lambda.
+*         1^T hadamard(mats[nmodes-1], m1) \lambda. This must be called by
+*         every thread of the team, and each receives the result.
 */
-static val_t p_tt_kruskal_inner(
+static val_t p_tt_kruskal_inner_team(
   idx_t const nmodes,
   rank_info * const rinfo,
   thd_info * const thds,
@@ -200,58 +804,48 @@ static val_t p_tt_kruskal_inner(
   val_t const * const m0 = mats[lastm]->vals;
   val_t const * const mv = m1->vals;
 
-  val_t myinner = 0;
-  #pragma omp parallel reduction(+:myinner)
-  {
-    int const tid = splatt_omp_get_thread_num();
-    val_t * const restrict accumF = (val_t *) thds[tid].scratch[0];
+  int const tid = splatt_omp_get_thread_num();
+  val_t * const restrict accumF = (val_t *) thds[tid].scratch[0];
+  for(idx_t r=0; r < rank; ++r) {
+    accumF[r] = 0.;
+  }
 
+  #pragma omp for schedule(static)
+  for(idx_t i=0; i < dim; ++i) {
     for(idx_t r=0; r < rank; ++r) {
-      accumF[r] = 0.;
+      accumF[r] += m0[r+(i*rank)] * mv[r+(i*rank)];
     }
+  }
+  thd_reduce(thds, 0, rank, REDUCE_SUM);
 
-    #pragma omp for
-    for(idx_t i=0; i < dim; ++i) {
-      for(idx_t r=0; r < rank; ++r) {
-        accumF[r] += m0[r+(i*rank)] * mv[r+(i*rank)];
-      }
-    }
-    /* accumulate everything into 'myinner' */
+  val_t inner = 0.;
+  #pragma omp single copyprivate(inner)
+  {
+    val_t const * const restrict sums = (val_t *) thds[0].scratch[0];
+    val_t myinner = 0.;
     for(idx_t r=0; r < rank; ++r) {
-      myinner += accumF[r] * lambda[r];
+      myinner += sums[r] * lambda[r];
     }
-  }
-  val_t inner = 0.;
 
 #ifdef SPLATT_USE_MPI
-  timer_start(&timers[TIMER_MPI_FIT]);
-  MPI_Allreduce(&myinner, &inner, 1, SPLATT_MPI_VAL, MPI_SUM, rinfo->comm_3d);
-  timer_stop(&timers[TIMER_MPI_FIT]);
+    timer_start(&timers[TIMER_MPI_FIT]);
+    MPI_Allreduce(&myinner, &inner, 1, SPLATT_MPI_VAL, MPI_SUM,
+        rinfo->comm_3d);
+    timer_stop(&timers[TIMER_MPI_FIT]);
 #else
-  inner = myinner;
+    inner = myinner;
 #endif
+  }
 
   return inner;
 }
 
 
 /**
-* @brief Compute the fit of a Kruskal tensor, Z, to an input tensor, X. This
-*        is computed via 1 - [sqrt(<X,X> + <Z,Z> - 2<X,Z>) / sqrt(<X,X>)].
-*
-* @param nmodes The number of modes in the input tensors.
-* @param rinfo MPI rank information.
-* @param thds OpenMP thread data structures.
-* @param ttnormsq The norm (squared) of the original input tensor, <X,X>.
-* @param lambda The vector of column norms.
-* @param mats The Kruskal-tensor matrices.
-* @param m1 The result of doing MTTKRP along the last mode.
-* @param aTa An array of matrices (length MAX_NMODES)containing BtB, CtC, etc.
-*
-* @return The inner product of the two tensors, computed via:
-*         \lambda^T hadamard(mats[nmodes-1], m1) \lambda.
+* @brief The body of cpd_calc_fit(). This must be called by every thread of
+*        the team, and each receives the fit.
 */
-static val_t p_calc_fit(
+static val_t p_calc_fit_team(
   idx_t const nmodes,
   rank_info * const rinfo,
   thd_info * const thds,
@@ -261,48 +855,384 @@ static val_t p_calc_fit(
   matrix_t const * const m1,
   matrix_t ** aTa)
 {
+  #pragma omp master
   timer_start(&timers[TIMER_FIT]);
 
-  /* First get norm of new model: lambda^T * (hada aTa) * lambda. */
-  val_t const norm_mats = p_kruskal_norm(nmodes, lambda, aTa);
-
   /* Compute inner product of tensor with new model */
-  val_t const inner = p_tt_kruskal_inner(nmodes, rinfo, thds, lambda, mats,m1);
-
-  /*
-   * We actually want sqrt(<X,X> + <Y,Y> - 2<X,Y>), but if the fit is perfect
-   * just make it 0.
-   */
-  val_t residual = ttnormsq + norm_mats - (2 * inner);
-  if(residual > 0.) {
-    residual = sqrt(residual);
-  }
-  timer_stop(&timers[TIMER_FIT]);
-  return 1 - (residual / sqrt(ttnormsq));
+  val_t const inner = p_tt_kruskal_inner_team(nmodes, rinfo, thds, lambda,
+      mats, m1);
+
+  val_t fit = 0.;
+  #pragma omp single copyprivate(fit)
+  {
+    /* Get norm of new model: lambda^T * (hada aTa) * lambda. */
+    val_t const norm_mats = p_kruskal_norm(nmodes, lambda, aTa);
+
+    /*
+     * We actually want sqrt(<X,X> + <Y,Y> - 2<X,Y>), but if the fit is perfect
+     * just make it 0.
+     */
+    val_t residual = ttnormsq + norm_mats - (2 * inner);
+    if(residual > 0.) {
+      residual = sqrt(residual);
+    }
+    fit = 1 - (residual / sqrt(ttnormsq));
+    timer_stop(&timers[TIMER_FIT]);
+  }
+  return fit;
+}
+
+
+/**
+* @brief Attempt to accelerate ALS by extrapolating the factors along their
+*        change from the previous iteration:
+*          trial = prev + step * (mats - prev).
+*        The fit of the extrapolated model is computed with a single MTTKRP
+*        (along the last mode) and the trial is kept only if it improves the
+*        fit. The AO-ADMM duals are extrapolated with the factors, so an
+*        accepted trial leaves the constrained solver in a consistent state.
+*
+* @param tensors The CSF tensor(s) being factored.
+* @param mats The factors after the latest ALS sweep. Overwritten on success.
+* @param prev The factors after the previous ALS sweep.
+* @param trial Workspace for the extrapolated factors.
+* @param aTa The Gram matrices of 'mats'. Swapped with 'trial_aTa' on success.
+* @param trial_aTa Workspace for the Gram matrices of 'trial'.
+* @param duals The AO-ADMM duals after the latest sweep, or NULL if the
+*              factorization is not constrained. Overwritten on success.
+* @param prev_duals The duals after the previous sweep (or NULL).
+* @param trial_duals Workspace for the extrapolated duals (or NULL).
+* @param lambda The vector of column norms.
+* @param step The extrapolation step.
+* @param fit The fit of 'mats'.
+* @param ttnormsq The norm (squared) of the input tensor.
+* @param rinfo MPI rank information.
+* @param thds Thread data structures.
+* @param mttkrp_ws MTTKRP workspace.
+* @param opts SPLATT options array.
+* @param[out] accepted Set to 1 if the extrapolation was accepted.
+*
+* @return The fit after the line search.
+*/
+static double p_line_search(
+    splatt_csf const * const tensors,
+    matrix_t ** mats,
+    matrix_t ** prev,
+    matrix_t ** trial,
+    matrix_t ** aTa,
+    matrix_t ** trial_aTa,
+    matrix_t ** duals,
+    matrix_t ** prev_duals,
+    matrix_t ** trial_duals,
+    val_t const * const lambda,
+    val_t const step,
+    double const fit,
+    val_t const ttnormsq,
+    rank_info * const rinfo,
+    thd_info * const thds,
+    splatt_mttkrp_ws * const mttkrp_ws,
+    double const * const opts)
+{
+  idx_t const nmodes = tensors[0].nmodes;
+  idx_t const lastm = nmodes - 1;
+  idx_t const nthreads = (idx_t) opts[SPLATT_OPTION_NTHREADS];
+
+  /* extrapolate */
+  for(idx_t m=0; m < nmodes; ++m) {
+    idx_t const len = mats[m]->I * mats[m]->J;
+    val_t const * const restrict cur = mats[m]->vals;
+    val_t const * const restrict old = prev[m]->vals;
+    val_t * const restrict tv = trial[m]->vals;
+
+    #pragma omp parallel for schedule(static)
+    for(idx_t x=0; x < len; ++x) {
+      tv[x] = old[x] + step * (cur[x] - old[x]);
+    }
+
+    if(opts[SPLATT_OPTION_NNCPD]) {
+      nncpd_constraint(trial[m]);
+    }
+    mat_aTa(trial[m], trial_aTa[m], rinfo, thds, nthreads);
+
+    if(duals != NULL) {
+      val_t const * const restrict ucur = duals[m]->vals;
+      val_t const * const restrict uold = prev_duals[m]->vals;
+      val_t * const restrict uv = trial_duals[m]->vals;
+
+      #pragma omp parallel for schedule(static)
+      for(idx_t x=0; x < len; ++x) {
+        uv[x] = uold[x] + step * (ucur[x] - uold[x]);
+      }
+    }
+  }
+
+  /* evaluate the extrapolated model */
+  matrix_t * const m1 = trial[MAX_NMODES];
+  m1->I = trial[lastm]->I;
+  timer_start(&timers[TIMER_MTTKRP]);
+  mttkrp_csf(tensors, trial, lastm, thds, mttkrp_ws, opts);
+  timer_stop(&timers[TIMER_MTTKRP]);
+
+  double const trial_fit = cpd_calc_fit(nmodes, rinfo, thds, ttnormsq, lambda,
+      trial, m1, trial_aTa);
+  if(trial_fit <= fit) {
+    return fit;
+  }
+
+  /* accept */
+  for(idx_t m=0; m < nmodes; ++m) {
+    par_memcpy(mats[m]->vals, trial[m]->vals,
+        mats[m]->I * mats[m]->J * sizeof(val_t));
+    mttkrp_refresh_factor(mttkrp_ws, mats[m], m);
+    if(duals != NULL) {
+      par_memcpy(duals[m]->vals, trial_duals[m]->vals,
+          duals[m]->I * duals[m]->J * sizeof(val_t));
+    }
+
+    matrix_t * tmp = aTa[m];
+    aTa[m] = trial_aTa[m];
+    trial_aTa[m] = tmp;
+  }
+  return trial_fit;
 }
 
 
+
+/**
+* @brief Report the progress of one ALS iteration, if requested.
+*
+* @param it The (zero-indexed) iteration.
+* @param itertime The time taken by the iteration.
+* @param modetime The time taken by each mode.
+* @param nmodes The number of modes.
+* @param fit The fit after the iteration.
+* @param oldfit The fit before the iteration.
+* @param rinfo MPI rank information.
+* @param opts SPLATT options array.
+*/
+static void p_print_iter(
+    idx_t const it,
+    sp_timer_t const * const itertime,
+    sp_timer_t const * const modetime,
+    idx_t const nmodes,
+    double const fit,
+    double const oldfit,
+    rank_info const * const rinfo,
+    double const * const opts)
+{
+  if(rinfo->rank == 0 &&
+      opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_NONE) {
+    printf("  its = %3"SPLATT_PF_IDX" (%0.3fs)  fit = %0.5f  delta = %+0.4e\n",
+        it+1, itertime->seconds, fit, fit - oldfit);
+    if(opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_LOW) {
+      for(idx_t m=0; m < nmodes; ++m) {
+        printf("     mode = %1"SPLATT_PF_IDX" (%0.3fs)\n", m+1,
+            modetime[m].seconds);
+      }
+    }
+  }
+}
+
+
+/**
+* @brief Unconstrained ALS without line search or pairwise perturbation, which
+*        is the common case. One team of threads is created for the whole
+*        factorization instead of one per kernel, and the phases of each
+*        iteration are separated by barriers. For small and medium tensors the
+*        fork/join overhead is otherwise a visible fraction of the runtime.
+*
+* @param tensors The CSF tensor(s) to factor.
+* @param mats The factors, with MTTKRP output space in mats[MAX_NMODES].
+* @param aTa The Gram matrices of the factors, with workspace in
+*            aTa[MAX_NMODES].
+* @param lambda The column norms.
+* @param rinfo MPI rank information.
+* @param opts SPLATT options array.
+* @param chkpt Checkpointing information, or NULL.
+* @param thds Thread data structures.
+* @param mttkrp_ws MTTKRP workspace.
+* @param first_it The first iteration to perform.
+* @param start_fit The fit before 'first_it'.
+* @param ttnormsq The norm (squared) of the input tensor.
+*
+* @return The final fit.
+*/
+static double p_als_iterate_team(
+    splatt_csf const * const tensors,
+    matrix_t ** mats,
+    matrix_t ** aTa,
+    val_t * const lambda,
+    rank_info * const rinfo,
+    double const * const opts,
+    cpd_checkpoint * const chkpt,
+    thd_info * const thds,
+    splatt_mttkrp_ws * const mttkrp_ws,
+    idx_t const first_it,
+    double const start_fit,
+    val_t const ttnormsq)
+{
+  idx_t const nmodes = tensors[0].nmodes;
+  idx_t const niters = (idx_t) opts[SPLATT_OPTION_NITER];
+  val_t const reg = opts[SPLATT_OPTION_REGULARIZE];
+  matrix_t * const m1 = mats[MAX_NMODES];
+
+  double fit = start_fit;
+  double oldfit = start_fit;
+  int done = 0;
+  sp_timer_t itertime;
+  sp_timer_t modetime[MAX_NMODES];
+
+  #pragma omp parallel num_threads(mttkrp_ws->num_threads)
+  {
+    for(idx_t it=first_it; it < niters && !done; ++it) {
+      #pragma omp master
+      timer_fstart(&itertime);
+
+      splatt_mat_norm const which_norm = (it == 0) ? MAT_NORM_2 : MAT_NORM_MAX;
+      for(idx_t m=0; m < nmodes; ++m) {
+        #pragma omp master
+        {
+          timer_fstart(&modetime[m]);
+          timer_start(&timers[TIMER_MTTKRP]);
+        }
+        mttkrp_csf_team(tensors, mats, m, thds, mttkrp_ws, opts);
+        #pragma omp master
+        timer_stop(&timers[TIMER_MTTKRP]);
+
+        mat_fused_update_team(m, nmodes, aTa, m1, mats[m], lambda, which_norm,
+            reg, rinfo, thds);
+        mttkrp_refresh_factor_team(mttkrp_ws, mats[m], m);
+
+        #pragma omp master
+        timer_stop(&modetime[m]);
+      }
+
+      double const newfit = p_calc_fit_team(nmodes, rinfo, thds, ttnormsq,
+          lambda, mats, m1, aTa);
+
+      /* the barrier at the end publishes 'done' to the team */
+      #pragma omp single
+      {
+        fit = newfit;
+        timer_stop(&itertime);
+        p_print_iter(it, &itertime, modetime, nmodes, fit, oldfit, rinfo,
+            opts);
+
+        if(chkpt_due(chkpt, it+1)) {
+          chkpt_write(chkpt, nmodes, mats, lambda, it+1, fit);
+        }
+
+        if(fit == 1. ||
+            (it > 0 && fabs(fit - oldfit) < opts[SPLATT_OPTION_TOLERANCE])) {
+          done = 1;
+        }
+        oldfit = fit;
+      }
+    }
+  } /* end omp parallel */
+
+  return fit;
+}
+
+
+
 /******************************************************************************
  * PUBLIC FUNCTIONS
  *****************************************************************************/
+
+val_t cpd_calc_fit(
+  idx_t const nmodes,
+  rank_info * const rinfo,
+  thd_info * const thds,
+  val_t const ttnormsq,
+  val_t const * const restrict lambda,
+  matrix_t ** mats,
+  matrix_t const * const m1,
+  matrix_t ** aTa)
+{
+  val_t fit = 0.;
+  #pragma omp parallel
+  {
+    val_t const myfit = p_calc_fit_team(nmodes, rinfo, thds, ttnormsq, lambda,
+        mats, m1, aTa);
+    #pragma omp master
+    fit = myfit;
+  }
+  return fit;
+}
+
+
+int cpd_als_chkpt(
+    splatt_csf const * const tensors,
+    idx_t const nfactors,
+    double const * const opts,
+    splatt_kruskal const * const init,
+    cpd_checkpoint * const chkpt,
+    splatt_kruskal * factored)
+{
+  if(init != NULL) {
+    int const ret = p_check_init(tensors, nfactors, init);
+    if(ret != SPLATT_SUCCESS) {
+      return ret;
+    }
+  }
+  return p_cpd_als(tensors, nfactors, opts, init, chkpt, NULL, NULL,
+      factored);
+}
+
+
+thd_info * cpd_alloc_thds(
+  idx_t const nmodes,
+  idx_t const nfactors,
+  idx_t const nthreads)
+{
+  return thd_init(nthreads, 3,
+    (nmodes * nfactors * sizeof(val_t)),
+    0,
+    (nmodes * nfactors * sizeof(val_t)));
+}
+
+
 double cpd_als_iterate(
   splatt_csf const * const tensors,
   matrix_t ** mats,
   val_t * const lambda,
   idx_t const nfactors,
   rank_info * const rinfo,
-  double const * const opts)
+  double const * const opts,
+  cpd_checkpoint * const chkpt)
 {
-  idx_t const nmodes = tensors[0].nmodes;
   idx_t const nthreads = (idx_t) opts[SPLATT_OPTION_NTHREADS];
 
-  /* Setup thread structures. + 64 bytes is to avoid false sharing.
-   * TODO make this better */
+  /* Setup thread structures and mttkrp workspace */
+  splatt_omp_set_num_threads(nthreads);
+  thd_info * thds = cpd_alloc_thds(tensors[0].nmodes, nfactors, nthreads);
+  splatt_mttkrp_ws * mttkrp_ws = splatt_mttkrp_alloc_ws(tensors,nfactors,opts);
+
+  double const fit = cpd_als_iterate_ws(tensors, mats, lambda, nfactors, rinfo,
+      opts, chkpt, thds, mttkrp_ws);
+
+  splatt_mttkrp_free_ws(mttkrp_ws);
+  thd_free(thds, nthreads);
+
+  return fit;
+}
+
+
+double cpd_als_iterate_ws(
+  splatt_csf const * const tensors,
+  matrix_t ** mats,
+  val_t * const lambda,
+  idx_t const nfactors,
+  rank_info * const rinfo,
+  double const * const opts,
+  cpd_checkpoint * const chkpt,
+  thd_info * const thds,
+  splatt_mttkrp_ws * const mttkrp_ws)
+{
+  idx_t const nmodes = tensors[0].nmodes;
+  idx_t const nthreads = (idx_t) opts[SPLATT_OPTION_NTHREADS];
   splatt_omp_set_num_threads(nthreads);
-  thd_info * thds =  thd_init(nthreads, 3,
-    (nmodes * nfactors * sizeof(val_t)) + 64,
-    0,
-    (nmodes * nfactors * sizeof(val_t)) + 64);
 
   matrix_t * m1 = mats[MAX_NMODES];
 
@@ -313,27 +1243,119 @@ double cpd_als_iterate(
     aTa[m] = mat_alloc(nfactors, nfactors);
     memset(aTa[m]->vals, 0, nfactors * nfactors * sizeof(val_t));
     mat_aTa(mats[m], aTa[m], rinfo, thds, nthreads);
+
+    /* the workspace may be reused, so forget any old sparsity patterns */
+    mttkrp_refresh_factor(mttkrp_ws, mats[m], m);
   }
   /* used as buffer space */
   aTa[MAX_NMODES] = mat_alloc(nfactors, nfactors);
 
-  /* mttkrp workspace */
-  splatt_mttkrp_ws * mttkrp_ws = splatt_mttkrp_alloc_ws(tensors,nfactors,opts);
-
   /* Compute input tensor norm */
   double oldfit = 0;
   double fit = 0;
   val_t ttnormsq = csf_frobsq(tensors);
 
+  /* resume from a checkpoint? */
+  idx_t first_it = 0;
+  if(chkpt != NULL) {
+    first_it = chkpt->start_it;
+    oldfit = chkpt->start_fit;
+    fit = chkpt->start_fit;
+  }
+
+  /* line search workspace */
+  int const linesearch = opts[SPLATT_OPTION_LINESEARCH] != 0;
+  matrix_t * prev[MAX_NMODES];
+  matrix_t * trial[MAX_NMODES+1];
+  matrix_t * trial_aTa[MAX_NMODES+1];
+  double ls_pow = 3.;
+  idx_t ls_tries = 0;
+  idx_t ls_accepts = 0;
+  sp_timer_t ls_time;
+  timer_reset(&ls_time);
+  if(linesearch) {
+    for(idx_t m=0; m < nmodes; ++m) {
+      prev[m] = mat_alloc(mats[m]->I, nfactors);
+      trial[m] = mat_alloc(mats[m]->I, nfactors);
+      trial_aTa[m] = mat_alloc(nfactors, nfactors);
+    }
+    /* the MTTKRP output and Gram scratch space can be shared */
+    trial[MAX_NMODES] = mats[MAX_NMODES];
+    trial_aTa[MAX_NMODES] = aTa[MAX_NMODES];
+  }
+
+  /* pairwise perturbation replaces MTTKRP once the factors settle */
+  val_t const pp_tol = opts[SPLATT_OPTION_PPTOL];
+  pp_ws * pp = NULL;
+  int pp_active = 0;
+  int pp_next = 0;
+  idx_t pp_its = 0;
+  idx_t pp_builds = 0;
+  double pp_basefit = 0.;
+  if(pp_tol > 0.) {
+    pp = pp_alloc(tensors, nfactors);
+  }
+
+  /* constrained factorizations use AO-ADMM, whose dual variables persist,
+   * or a pass of HALS */
+  int const constrained = admm_is_constrained(opts);
+  int const hals = constrained &&
+      opts[SPLATT_OPTION_NNSOLVER] == SPLATT_NNSOLVER_HALS;
+  int const admm = constrained && !hals;
+  matrix_t * duals[MAX_NMODES];
+  matrix_t * admm_aux = NULL;
+  if(admm) {
+    idx_t maxdim = 0;
+    for(idx_t m=0; m < nmodes; ++m) {
+      duals[m] = mat_alloc(mats[m]->I, nfactors);
+      memset(duals[m]->vals, 0, mats[m]->I * nfactors * sizeof(val_t));
+      maxdim = SS_MAX(maxdim, mats[m]->I);
+    }
+    admm_aux = mat_alloc(maxdim, nfactors);
+  }
+
+  /* the line search extrapolates the duals along with the factors */
+  int const ls_duals = linesearch && admm;
+  matrix_t * prev_duals[MAX_NMODES];
+  matrix_t * trial_duals[MAX_NMODES];
+  if(ls_duals) {
+    for(idx_t m=0; m < nmodes; ++m) {
+      prev_duals[m] = mat_alloc(mats[m]->I, nfactors);
+      trial_duals[m] = mat_alloc(mats[m]->I, nfactors);
+    }
+  }
+
   /* setup timers */
   p_reset_cpd_timers(rinfo);
   sp_timer_t itertime;
   sp_timer_t modetime[MAX_NMODES];
   timer_start(&timers[TIMER_CPD]);
 
+  /* the common case runs in a single parallel region */
+  int const team = !linesearch && pp == NULL && !constrained;
+  if(team) {
+    fit = p_als_iterate_team(tensors, mats, aTa, lambda, rinfo, opts, chkpt,
+        thds, mttkrp_ws, first_it, fit, ttnormsq);
+  }
+
   idx_t const niters = (idx_t) opts[SPLATT_OPTION_NITER];
-  for(idx_t it=0; it < niters; ++it) {
+  for(idx_t it=first_it; !team && it < niters; ++it) {
     timer_fstart(&itertime);
+    if(pp != NULL) {
+      if(pp_next) {
+        timer_start(&timers[TIMER_MTTKRP]);
+        pp_build(pp, mats);
+        timer_stop(&timers[TIMER_MTTKRP]);
+        pp_active = 1;
+        pp_next = 0;
+        pp_basefit = fit;
+        ++pp_builds;
+      } else if(!pp_active) {
+        /* measure this iteration's change */
+        pp_snapshot(pp, mats);
+      }
+    }
+
     for(idx_t m=0; m < nmodes; ++m) {
       timer_fstart(&modetime[m]);
       mats[MAX_NMODES]->I = tensors[0].dims[m];
@@ -341,69 +1363,159 @@ double cpd_als_iterate(
 
       /* M1 = X * (C o B) */
       timer_start(&timers[TIMER_MTTKRP]);
-      mttkrp_csf(tensors, mats, m, thds, mttkrp_ws, opts);
+      if(pp_active && m < nmodes-1) {
+        pp_mttkrp(pp, mats, m, m1);
+      } else {
+        /* the last mode stays exact so that the fit is too */
+        mttkrp_csf(tensors, mats, m, thds, mttkrp_ws, opts);
+      }
       timer_stop(&timers[TIMER_MTTKRP]);
 
-#if 0
-      /* M2 = (CtC .* BtB .* ...)^-1 */
-      calc_gram_inv(m, nmodes, aTa);
-      /* A = M1 * M2 */
-      memset(mats[m]->vals, 0, mats[m]->I * nfactors * sizeof(val_t));
-      mat_matmul(m1, aTa[MAX_NMODES], mats[m]);
-#else
-      par_memcpy(mats[m]->vals, m1->vals, m1->I * nfactors * sizeof(val_t));
-      mat_solve_normals(m, nmodes, aTa, mats[m],
-          opts[SPLATT_OPTION_REGULARIZE]);
-#endif
-
-      /* apply non-negative constraints (if selected) */
-      if(opts[SPLATT_OPTION_NNCPD]) {
-        nncpd_constraint(mats[m]);
+      if(admm) {
+        /* non-negativity and/or L1 via AO-ADMM */
+        admm_aux->I = mats[m]->I;
+        admm_solve(m, nmodes, aTa, m1, mats[m], duals[m], admm_aux, opts);
+      } else if(hals) {
+        p_hals_update(m, nmodes, aTa, m1, mats[m], opts);
       }
 
-      /* normalize columns and extract lambda */
-      if(it == 0) {
-        mat_normalize(mats[m], lambda, MAT_NORM_2, rinfo, thds, nthreads);
+      splatt_mat_norm const which_norm = (it == 0) ? MAT_NORM_2 : MAT_NORM_MAX;
+      if(admm || hals) {
+        /* normalize columns and extract lambda */
+        mat_normalize(mats[m], lambda, which_norm, rinfo, thds, nthreads);
+        if(admm) {
+          /* keep the duals in the same scale as the factor */
+          admm_rescale_dual(duals[m], lambda);
+        }
+
+        /* update A^T*A */
+        mat_aTa(mats[m], aTa[m], rinfo, thds, nthreads);
       } else {
-        mat_normalize(mats[m], lambda, MAT_NORM_MAX, rinfo, thds,nthreads);
+        /* solve, normalize, and update A^T*A in one pass */
+        mat_fused_update(m, nmodes, aTa, m1, mats[m], lambda, which_norm,
+            opts[SPLATT_OPTION_REGULARIZE], rinfo, thds, nthreads);
       }
 
-      /* update A^T*A */
-      mat_aTa(mats[m], aTa[m], rinfo, thds, nthreads);
+      /* let MTTKRP skip zeros if the factor has become sparse */
+      mttkrp_refresh_factor(mttkrp_ws, mats[m], m);
+      if(pp_active) {
+        /* later modes correct for this change */
+        pp_delta(pp, mats[m], m);
+      }
       timer_stop(&modetime[m]);
     } /* foreach mode */
 
-    fit = p_calc_fit(nmodes, rinfo, thds, ttnormsq, lambda, mats, m1, aTa);
-    timer_stop(&itertime);
-
-    if(rinfo->rank == 0 &&
-        opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_NONE) {
-      printf("  its = %3"SPLATT_PF_IDX" (%0.3fs)  fit = %0.5f  delta = %+0.4e\n",
-          it+1, itertime.seconds, fit, fit - oldfit);
-      if(opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_LOW) {
-        for(idx_t m=0; m < nmodes; ++m) {
-          printf("     mode = %1"SPLATT_PF_IDX" (%0.3fs)\n", m+1,
-              modetime[m].seconds);
+    fit = cpd_calc_fit(nmodes, rinfo, thds, ttnormsq, lambda, mats, m1, aTa);
+
+    if(linesearch) {
+      timer_start(&ls_time);
+      /* we need two prior iterates to extrapolate */
+      if(it > first_it) {
+        double const prefit = fit;
+        val_t const step = pow((val_t) (it+1), 1. / ls_pow);
+        fit = p_line_search(tensors, mats, prev, trial, aTa, trial_aTa,
+            ls_duals ? duals : NULL, ls_duals ? prev_duals : NULL,
+            ls_duals ? trial_duals : NULL, lambda, step, fit, ttnormsq, rinfo,
+            thds, mttkrp_ws, opts);
+        ++ls_tries;
+        if(fit > prefit) {
+          ++ls_accepts;
+        } else {
+          /* take smaller steps from now on */
+          ls_pow += 1.;
         }
       }
+      for(idx_t m=0; m < nmodes; ++m) {
+        par_memcpy(prev[m]->vals, mats[m]->vals,
+            mats[m]->I * nfactors * sizeof(val_t));
+        if(ls_duals) {
+          par_memcpy(prev_duals[m]->vals, duals[m]->vals,
+              mats[m]->I * nfactors * sizeof(val_t));
+        }
+      }
+      timer_stop(&ls_time);
+    }
+
+    if(pp != NULL) {
+      /* the change since the snapshot, which for pairwise perturbation
+       * accumulates over every approximate iteration */
+      val_t change = 0.;
+      for(idx_t m=0; m < nmodes; ++m) {
+        change = SS_MAX(change, pp_delta(pp, mats[m], m));
+      }
+      if(pp_active) {
+        /* falling below the fit at the snapshot means the approximation has
+         * broken down */
+        ++pp_its;
+        pp_active = (change < pp_tol) && (fit > pp_basefit);
+      } else {
+        pp_next = (it > first_it) && (change < pp_tol);
+      }
     }
+    timer_stop(&itertime);
+    p_print_iter(it, &itertime, modetime, nmodes, fit, oldfit, rinfo, opts);
+
+    if(chkpt_due(chkpt, it+1)) {
+      chkpt_write(chkpt, nmodes, mats, lambda, it+1, fit);
+    }
+
     if(fit == 1. || 
         (it > 0 && fabs(fit - oldfit) < opts[SPLATT_OPTION_TOLERANCE])) {
-      break;
+      if(!pp_active) {
+        break;
+      }
+      /* pairwise perturbation stalls short of the exact solution, so confirm
+       * with an exact iteration */
+      pp_active = 0;
     }
     oldfit = fit;
   }
   timer_stop(&timers[TIMER_CPD]);
+  chkpt_wait(chkpt);
+
+  if(linesearch) {
+    if(rinfo->rank == 0 &&
+        opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_NONE) {
+      printf("  line search: %"SPLATT_PF_IDX"/%"SPLATT_PF_IDX" accepted "
+             "(%0.3fs of %0.3fs)\n", ls_accepts, ls_tries, ls_time.seconds,
+             timers[TIMER_CPD].seconds);
+    }
+    for(idx_t m=0; m < nmodes; ++m) {
+      mat_free(prev[m]);
+      mat_free(trial[m]);
+      mat_free(trial_aTa[m]);
+    }
+  }
+
+  if(pp != NULL) {
+    if(rinfo->rank == 0 &&
+        opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_NONE) {
+      printf("  pairwise perturbation: %"SPLATT_PF_IDX" approximate "
+             "iterations from %"SPLATT_PF_IDX" builds\n", pp_its, pp_builds);
+    }
+    pp_free(pp);
+  }
+
+  if(admm) {
+    for(idx_t m=0; m < nmodes; ++m) {
+      mat_free(duals[m]);
+    }
+    mat_free(admm_aux);
+  }
+  if(ls_duals) {
+    for(idx_t m=0; m < nmodes; ++m) {
+      mat_free(prev_duals[m]);
+      mat_free(trial_duals[m]);
+    }
+  }
 
   cpd_post_process(nfactors, nmodes, mats, lambda, thds, nthreads, rinfo);
 
   /* CLEAN UP */
-  splatt_mttkrp_free_ws(mttkrp_ws);
   for(idx_t m=0; m < nmodes; ++m) {
     mat_free(aTa[m]);
   }
   mat_free(aTa[MAX_NMODES]);
-  thd_free(thds, nthreads);
 
   return fit;
 }
@@ -429,7 +1541,7 @@ void cpd_post_process(
     }
   }
 
-  free(tmp);
+  splatt_free(tmp);
 }
 
 
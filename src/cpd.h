@@ -9,6 +9,7 @@
  *****************************************************************************/
 #include "ftensor.h"
 #include "matrix.h"
+#include "checkpoint.h"
 #include "splatt_mpi.h"
 
 
@@ -26,6 +27,9 @@
 * @param nfactors The rank of the factorization.
 * @param rinfo MPI rank information (not used, TODO remove).
 * @param opts SPLATT options array.
+* @param chkpt Checkpointing information. If non-NULL, iteration resumes from
+*              chkpt->start_it and checkpoints are written as requested. May
+*              be NULL.
 *
 * @return The final fitness of the factorization.
 */
@@ -35,7 +39,110 @@ double cpd_als_iterate(
   val_t * const lambda,
   idx_t const nfactors,
   rank_info * const rinfo,
-  double const * const opts);
+  double const * const opts,
+  cpd_checkpoint * const chkpt);
+
+
+#define cpd_als_iterate_ws splatt_cpd_als_iterate_ws
+/**
+* @brief Identical to cpd_als_iterate(), but uses caller-provided thread
+*        structures and MTTKRP workspace. These can be reused by several
+*        factorizations of the same tensor, so long as they were allocated for
+*        at least 'nfactors' columns (see cpd_alloc_thds() and
+*        splatt_mttkrp_alloc_ws()).
+*
+* @param tensors The CSF tensor(s) to factor.
+* @param mats [OUT] The output factors.
+* @param lambda [OUT] The output vector for scaling.
+* @param nfactors The rank of the factorization.
+* @param rinfo MPI rank information (not used, TODO remove).
+* @param opts SPLATT options array.
+* @param chkpt Checkpointing information, or NULL.
+* @param thds Thread structures.
+* @param mttkrp_ws MTTKRP workspace.
+*
+* @return The final fitness of the factorization.
+*/
+double cpd_als_iterate_ws(
+  splatt_csf const * const tensors,
+  matrix_t ** mats,
+  val_t * const lambda,
+  idx_t const nfactors,
+  rank_info * const rinfo,
+  double const * const opts,
+  cpd_checkpoint * const chkpt,
+  thd_info * const thds,
+  splatt_mttkrp_ws * const mttkrp_ws);
+
+
+#define cpd_alloc_thds splatt_cpd_alloc_thds
+/**
+* @brief Allocate the thread structures used by CPD-ALS. They must be freed
+*        with thd_free().
+*
+* @param nmodes The number of modes in the tensor.
+* @param nfactors The largest rank they will be used for.
+* @param nthreads The number of threads.
+*
+* @return The thread structures.
+*/
+thd_info * cpd_alloc_thds(
+  idx_t const nmodes,
+  idx_t const nfactors,
+  idx_t const nthreads);
+
+
+#define cpd_als_chkpt splatt_cpd_als_chkpt
+/**
+* @brief Allocate factors and compute the CPD, optionally seeded by 'init' and
+*        with checkpointing. This backs splatt_cpd_als() and
+*        splatt_cpd_als_warm(). To restart from a checkpoint, read it with
+*        chkpt_read() and pass the result as 'init'.
+*
+* @param tensors The CSF tensor(s) to factor.
+* @param nfactors The rank of the decomposition.
+* @param opts SPLATT options array.
+* @param init The initial factorization, or NULL for random initialization.
+* @param chkpt Checkpointing information, or NULL.
+* @param[out] factored The resulting factorization.
+*
+* @return SPLATT error code.
+*/
+int cpd_als_chkpt(
+    splatt_csf const * const tensors,
+    idx_t const nfactors,
+    double const * const opts,
+    splatt_kruskal const * const init,
+    cpd_checkpoint * const chkpt,
+    splatt_kruskal * factored);
+
+
+#define cpd_calc_fit splatt_cpd_calc_fit
+/**
+* @brief Compute the fit of a Kruskal tensor, Z, to an input tensor, X. This
+*        is computed via 1 - [sqrt(<X,X> + <Z,Z> - 2<X,Z>) / sqrt(<X,X>)].
+*
+* @param nmodes The number of modes in the input tensors.
+* @param rinfo MPI rank information.
+* @param thds OpenMP thread data structures.
+* @param ttnormsq The norm (squared) of the original input tensor, <X,X>.
+* @param lambda The vector of column norms.
+* @param mats The Kruskal-tensor matrices.
+* @param m1 The result of doing MTTKRP along the last mode.
+* @param aTa An array of matrices (length MAX_NMODES) containing BtB, CtC, etc.
+*
+* @return The inner product of the two tensors, computed via:
+*         \lambda^T hadamard(mats[nmodes-1], m1) \lambda.
+*/
+val_t cpd_calc_fit(
+  idx_t const nmodes,
+  rank_info * const rinfo,
+  thd_info * const thds,
+  val_t const ttnormsq,
+  val_t const * const restrict lambda,
+  matrix_t ** mats,
+  matrix_t const * const m1,
+  matrix_t ** aTa);
 
 
 #define cpd_post_process splatt_cpd_post_process
@@ -0,0 +1,477 @@
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "cprand.h"
+#include "cpd.h"
+#include "csf.h"
+#include "mttkrp.h"
+#include "mutex_pool.h"
+#include "thd_info.h"
+#include "timer.h"
+#include "util.h"
+
+#include <math.h>
+
+
+/******************************************************************************
+ * PRIVATE FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief Find the parent of a node in a CSF tree via binary search.
+*
+* @param fptr The fptr array of the parent level.
+* @param nparents The number of nodes in the parent level.
+* @param node The node whose parent we want.
+*
+* @return The parent p such that fptr[p] <= node < fptr[p+1].
+*/
+static inline idx_t p_find_parent(
+    idx_t const * const restrict fptr,
+    idx_t const nparents,
+    idx_t const node)
+{
+  idx_t lo = 0;
+  idx_t hi = nparents;
+  while(hi - lo > 1) {
+    idx_t const mid = lo + ((hi - lo) / 2);
+    if(fptr[mid] <= node) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+
+/**
+* @brief Return a uniformly random integer in [0, n).
+*
+* @param n The upper bound.
+*
+* @return The random integer.
+*/
+static inline idx_t p_rand_idx(
+    idx_t const n)
+{
+  uint64_t const r = ((uint64_t) rand() << 31) ^ (uint64_t) rand();
+  return (idx_t) (r % n);
+}
+
+
+/**
+* @brief Restore the rows of a sketched factor update which were not hit by any
+*        sample. The solve leaves those rows meaningless, so they take their
+*        previous value, scaled per column to match the solved rows: column
+*        'f' is scaled by the least-squares ratio between the solved sampled
+*        rows and their previous values. Empty slices are exactly zero and are
+*        left alone.
+*
+* @param A The freshly solved factor.
+* @param prev The factor before the update.
+* @param hits hits[i] is the number of sampled non-zeros in row 'i'.
+* @param rownnz rownnz[i] is the number of non-zeros in row 'i'.
+* @param lambda The current column weights, used for a column which no
+*               sampled row carries any information about.
+* @param thds Thread data. scratch[0] must hold 2*A->J values.
+*/
+static void p_restore_unsampled(
+    matrix_t * const A,
+    matrix_t const * const prev,
+    idx_t const * const restrict hits,
+    idx_t const * const restrict rownnz,
+    val_t const * const restrict lambda,
+    thd_info * const thds)
+{
+  idx_t const I = A->I;
+  idx_t const J = A->J;
+  val_t * const restrict mv = A->vals;
+  val_t const * const restrict pv = prev->vals;
+
+  #pragma omp parallel
+  {
+    int const tid = splatt_omp_get_thread_num();
+    val_t * const restrict acc = (val_t *) thds[tid].scratch[0];
+    for(idx_t f=0; f < 2 * J; ++f) {
+      acc[f] = 0;
+    }
+
+    /* <new, prev> and <prev, prev> over the sampled rows, per column */
+    #pragma omp for schedule(static)
+    for(idx_t i=0; i < I; ++i) {
+      if(hits[i] > 0) {
+        for(idx_t f=0; f < J; ++f) {
+          acc[f] += mv[f + (i*J)] * pv[f + (i*J)];
+          acc[f + J] += pv[f + (i*J)] * pv[f + (i*J)];
+        }
+      }
+    }
+
+    thd_reduce(thds, 0, 2 * J, REDUCE_SUM);
+
+    val_t const * const restrict sums = (val_t *) thds[0].scratch[0];
+
+    #pragma omp for schedule(static)
+    for(idx_t i=0; i < I; ++i) {
+      if(hits[i] == 0 && rownnz[i] > 0) {
+        for(idx_t f=0; f < J; ++f) {
+          val_t const ratio = (sums[f + J] > 0.) ?
+              sums[f] / sums[f + J] : lambda[f];
+          mv[f + (i*J)] = pv[f + (i*J)] * ratio;
+        }
+      }
+    }
+  } /* end omp parallel */
+}
+
+
+/**
+* @brief Compute a sketched MTTKRP using only a subset of the fibers of a
+*        tensor. Each fiber corresponds to one row of the Khatri-Rao product,
+*        which we form on the fly by walking up the CSF tree.
+*
+* @param csf The tensor, with the output mode stored at the leaves.
+* @param mats The factor matrices.
+* @param out The output matrix.
+* @param samples The fiber ids to use.
+* @param nsamples The number of samples.
+* @param[out] hits hits[i] counts the sampled non-zeros which contribute to
+*                  row 'i' of 'out'. Must be zeroed.
+* @param pool Locks to protect updates to rows of 'out'.
+* @param thds Thread data. scratch[1] must hold 'rank' values.
+*/
+static void p_sampled_mttkrp(
+    splatt_csf const * const csf,
+    matrix_t ** mats,
+    matrix_t * const out,
+    idx_t const * const samples,
+    idx_t const nsamples,
+    idx_t * const hits,
+    mutex_pool * const pool,
+    thd_info * const thds)
+{
+  idx_t const nmodes = csf->nmodes;
+  idx_t const fdepth = nmodes - 2;
+  idx_t const rank = out->J;
+  csf_sparsity const * const pt = csf->pt;
+
+  idx_t const * const restrict fptr = pt->fptr[fdepth];
+  idx_t const * const restrict inds = pt->fids[nmodes-1];
+  val_t const * const restrict vals = pt->vals;
+  val_t * const restrict ov = out->vals;
+
+  #pragma omp parallel
+  {
+    #pragma omp for schedule(static)
+    for(idx_t x=0; x < out->I * rank; ++x) {
+      ov[x] = 0.;
+    }
+
+    val_t * const restrict krrow =
+        (val_t *) thds[splatt_omp_get_thread_num()].scratch[1];
+
+    #pragma omp for schedule(dynamic, 16)
+    for(idx_t s=0; s < nsamples; ++s) {
+      idx_t const fib = samples[s];
+
+      /* form the Khatri-Rao row by walking to the root */
+      for(idx_t r=0; r < rank; ++r) {
+        krrow[r] = 1.;
+      }
+      idx_t node = fib;
+      for(idx_t d=fdepth+1; d-- > 0; ) {
+        idx_t const row = (pt->fids[d] == NULL) ? node : pt->fids[d][node];
+        val_t const * const restrict av =
+            mats[csf_depth_to_mode(csf, d)]->vals + (row * rank);
+        for(idx_t r=0; r < rank; ++r) {
+          krrow[r] *= av[r];
+        }
+        if(d > 0) {
+          node = p_find_parent(pt->fptr[d-1], pt->nfibs[d-1], node);
+        }
+      }
+
+      /* scatter into the output rows */
+      for(idx_t j=fptr[fib]; j < fptr[fib+1]; ++j) {
+        idx_t const row = inds[j];
+        val_t const v = vals[j];
+        val_t * const restrict orow = ov + (row * rank);
+        mutex_set_lock(pool, row);
+        for(idx_t r=0; r < rank; ++r) {
+          orow[r] += v * krrow[r];
+        }
+        ++hits[row];
+        mutex_unset_lock(pool, row);
+      }
+    }
+  } /* end omp parallel */
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+splatt_csf * cprand_csf_alloc(
+  sptensor_t * const tt,
+  double const * const opts)
+{
+  idx_t const nmodes = tt->nmodes;
+
+  /* fiber sampling assumes one tile */
+  double * untiled = splatt_default_opts();
+  memcpy(untiled, opts, SPLATT_OPTION_NOPTIONS * sizeof(*opts));
+  untiled[SPLATT_OPTION_TILE] = SPLATT_NOTILE;
+
+  splatt_csf * leaves = splatt_malloc(nmodes * sizeof(*leaves));
+  for(idx_t m=0; m < nmodes; ++m) {
+    /* place mode 'm' at the leaves, others in natural order */
+    idx_t d = 0;
+    for(idx_t m2=0; m2 < nmodes; ++m2) {
+      if(m2 != m) {
+        leaves[m].dim_perm[d++] = m2;
+      }
+    }
+    leaves[m].dim_perm[nmodes-1] = m;
+
+    csf_alloc_mode(tt, CSF_MODE_CUSTOM, m, leaves + m, untiled);
+  }
+
+  splatt_free_opts(untiled);
+  return leaves;
+}
+
+
+int cprand_cpd(
+  splatt_csf const * const leaves,
+  idx_t const nfactors,
+  double const * const opts,
+  splatt_kruskal * factored)
+{
+  idx_t const nmodes = leaves->nmodes;
+  matrix_t * mats[MAX_NMODES+1];
+
+  rank_info rinfo;
+  rinfo.rank = 0;
+
+  idx_t const maxdim = leaves->dims[argmax_elem(leaves->dims, nmodes)];
+  for(idx_t m=0; m < nmodes; ++m) {
+    mats[m] = mat_rand(leaves->dims[m], nfactors);
+  }
+  mats[MAX_NMODES] = mat_alloc(maxdim, nfactors);
+
+  val_t * lambda = splatt_malloc(nfactors * sizeof(*lambda));
+
+  factored->fit = cprand_iterate(leaves, mats, lambda, nfactors, &rinfo, opts);
+
+  factored->rank = nfactors;
+  factored->nmodes = nmodes;
+  factored->lambda = lambda;
+  for(idx_t m=0; m < nmodes; ++m) {
+    factored->dims[m] = leaves->dims[m];
+    factored->factors[m] = mats[m]->vals;
+    splatt_free(mats[m]); /* just the matrix_t ptr, data is in factored */
+  }
+  mat_free(mats[MAX_NMODES]);
+
+  return SPLATT_SUCCESS;
+}
+
+
+double cprand_iterate(
+  splatt_csf const * const leaves,
+  matrix_t ** mats,
+  val_t * const lambda,
+  idx_t const nfactors,
+  rank_info * const rinfo,
+  double const * const opts)
+{
+  idx_t const nmodes = leaves[0].nmodes;
+  idx_t const lastm = nmodes - 1;
+  idx_t const nthreads = (idx_t) opts[SPLATT_OPTION_NTHREADS];
+
+  splatt_omp_set_num_threads(nthreads);
+  thd_info * thds =  thd_init(nthreads, 3,
+    (nmodes * nfactors * sizeof(val_t)),
+    (nfactors * sizeof(val_t)),
+    (nmodes * nfactors * sizeof(val_t)));
+
+  mutex_pool * pool = mutex_alloc_sized(
+      (int) leaves->dims[argmax_elem(leaves->dims, nmodes)], (int) nthreads);
+
+  /* exact MTTKRPs use the regular kernels, with leaves[m] serving mode m */
+  double * allmode = splatt_default_opts();
+  memcpy(allmode, opts, SPLATT_OPTION_NOPTIONS * sizeof(*opts));
+  allmode[SPLATT_OPTION_CSF_ALLOC] = SPLATT_CSF_ALLMODE;
+  splatt_mttkrp_ws * mttkrp_ws =
+      splatt_mttkrp_alloc_ws(leaves, nfactors, allmode);
+  matrix_t * m1 = mats[MAX_NMODES];
+
+  matrix_t * aTa[MAX_NMODES+1];
+  for(idx_t m=0; m < nmodes; ++m) {
+    aTa[m] = mat_alloc(nfactors, nfactors);
+    memset(aTa[m]->vals, 0, nfactors * nfactors * sizeof(val_t));
+    mat_aTa(mats[m], aTa[m], rinfo, thds, nthreads);
+  }
+  aTa[MAX_NMODES] = mat_alloc(nfactors, nfactors);
+
+  /* sample size */
+  idx_t maxfibs = 0;
+  for(idx_t m=0; m < nmodes; ++m) {
+    maxfibs = SS_MAX(maxfibs, leaves[m].pt->nfibs[nmodes-2]);
+  }
+  idx_t nsamples = (idx_t) opts[SPLATT_OPTION_NSAMPLES];
+  if(nsamples == 0) {
+    /* default to 10% of the fibers of the largest mode, but never fewer than
+     * 50 per column -- tiny sketches do not recover the factors */
+    nsamples = SS_MAX(maxfibs / 10, 50 * nfactors);
+  }
+  /* there is no point in sampling more fibers than exist */
+  nsamples = SS_MIN(nsamples, maxfibs);
+  idx_t * samples = splatt_malloc(nsamples * sizeof(*samples));
+
+  /* Each row of the sketched MTTKRP is rescaled by the fraction of its
+   * non-zeros which were sampled (a per-row ratio estimator). Rows which are
+   * not hit by any sample have no information in the sketch, so they keep
+   * their previous value, rescaled to match the solved rows. */
+  idx_t const maxdim = leaves->dims[argmax_elem(leaves->dims, nmodes)];
+  idx_t * hits = splatt_malloc(maxdim * sizeof(*hits));
+  idx_t * rownnz[MAX_NMODES];
+  for(idx_t m=0; m < nmodes; ++m) {
+    rownnz[m] = splatt_malloc(leaves[m].dims[m] * sizeof(**rownnz));
+    memset(rownnz[m], 0, leaves[m].dims[m] * sizeof(**rownnz));
+    idx_t const * const inds = leaves[m].pt->fids[nmodes-1];
+    for(idx_t n=0; n < leaves[m].nnz; ++n) {
+      ++rownnz[m][inds[n]];
+    }
+  }
+  matrix_t * prev = mat_alloc(maxdim, nfactors);
+
+  /* the initial model has unit weights */
+  for(idx_t f=0; f < nfactors; ++f) {
+    lambda[f] = 1.;
+  }
+
+  idx_t fitfreq = (idx_t) opts[SPLATT_OPTION_FITFREQ];
+  if(fitfreq == 0) {
+    fitfreq = 1;
+  }
+
+  double oldfit = 0;
+  double fit = 0;
+  val_t const ttnormsq = csf_frobsq(leaves);
+
+  timer_reset(&timers[TIMER_ATA]);
+  sp_timer_t itertime;
+  timer_start(&timers[TIMER_CPD]);
+
+  idx_t const niters = (idx_t) opts[SPLATT_OPTION_NITER];
+  for(idx_t it=0; it < niters; ++it) {
+    timer_fstart(&itertime);
+
+    /* the fit is exact every 'fitfreq' iterations and at the end */
+    bool const exact = ((it+1) % fitfreq == 0) || (it+1 == niters);
+
+    for(idx_t m=0; m < nmodes; ++m) {
+      splatt_csf const * const csf = leaves + m;
+      idx_t const nfibs = csf->pt->nfibs[nmodes-2];
+      m1->I = mats[m]->I;
+
+      bool const sketch = !(exact && m == lastm) && nsamples < nfibs;
+
+      timer_start(&timers[TIMER_MTTKRP]);
+      if(sketch) {
+        for(idx_t s=0; s < nsamples; ++s) {
+          samples[s] = p_rand_idx(nfibs);
+        }
+        memset(hits, 0, mats[m]->I * sizeof(*hits));
+        p_sampled_mttkrp(csf, mats, m1, samples, nsamples, hits, pool, thds);
+        par_memcpy(prev->vals, mats[m]->vals,
+            mats[m]->I * nfactors * sizeof(val_t));
+      } else {
+        /* exact MTTKRP -- also needed for the fit */
+        mttkrp_csf(leaves, mats, m, thds, mttkrp_ws, allmode);
+      }
+      timer_stop(&timers[TIMER_MTTKRP]);
+
+      if(sketch) {
+        val_t * const restrict mv = m1->vals;
+        idx_t const * const restrict nnzs = rownnz[m];
+        #pragma omp parallel for schedule(static)
+        for(idx_t i=0; i < m1->I; ++i) {
+          if(hits[i] > 0) {
+            val_t const scale = (val_t) nnzs[i] / (val_t) hits[i];
+            for(idx_t f=0; f < nfactors; ++f) {
+              mv[f + (i*nfactors)] *= scale;
+            }
+          }
+        }
+      }
+
+      /* the Gram matrix is cheap, so it is not sketched */
+      par_memcpy(mats[m]->vals, m1->vals, m1->I * nfactors * sizeof(val_t));
+      mat_solve_normals(m, nmodes, aTa, mats[m],
+          opts[SPLATT_OPTION_REGULARIZE]);
+
+      if(sketch) {
+        p_restore_unsampled(mats[m], prev, hits, rownnz[m], lambda, thds);
+      }
+
+      if(it == 0) {
+        mat_normalize(mats[m], lambda, MAT_NORM_2, rinfo, thds, nthreads);
+      } else {
+        mat_normalize(mats[m], lambda, MAT_NORM_MAX, rinfo, thds, nthreads);
+      }
+
+      mat_aTa(mats[m], aTa[m], rinfo, thds, nthreads);
+    } /* foreach mode */
+
+    if(exact) {
+      fit = cpd_calc_fit(nmodes, rinfo, thds, ttnormsq, lambda, mats, m1, aTa);
+    }
+    timer_stop(&itertime);
+
+    if(opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_NONE) {
+      if(exact) {
+        printf("  its = %3"SPLATT_PF_IDX" (%0.3fs)  fit = %0.5f  "
+               "delta = %+0.4e\n", it+1, itertime.seconds, fit, fit - oldfit);
+      } else if(opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_LOW) {
+        printf("  its = %3"SPLATT_PF_IDX" (%0.3fs)\n", it+1,
+            itertime.seconds);
+      }
+    }
+
+    if(exact) {
+      if(fit == 1. ||
+          (it+1 > fitfreq &&
+           fabs(fit - oldfit) < opts[SPLATT_OPTION_TOLERANCE])) {
+        break;
+      }
+      oldfit = fit;
+    }
+  }
+  timer_stop(&timers[TIMER_CPD]);
+
+  cpd_post_process(nfactors, nmodes, mats, lambda, thds, nthreads, rinfo);
+
+  /* clean up */
+  splatt_free(samples);
+  splatt_free(hits);
+  for(idx_t m=0; m < nmodes; ++m) {
+    splatt_free(rownnz[m]);
+  }
+  mat_free(prev);
+  for(idx_t m=0; m < nmodes; ++m) {
+    mat_free(aTa[m]);
+  }
+  mat_free(aTa[MAX_NMODES]);
+  splatt_mttkrp_free_ws(mttkrp_ws);
+  splatt_free_opts(allmode);
+  mutex_free(pool);
+  thd_free(thds, nthreads);
+
+  return fit;
+}
@@ -0,0 +1,87 @@
+#ifndef SPLATT_CPRAND_H
+#define SPLATT_CPRAND_H
+
+#include "base.h"
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "matrix.h"
+#include "sptensor.h"
+#include "splatt_mpi.h"
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+#define cprand_csf_alloc splatt_cprand_csf_alloc
+/**
+* @brief Allocate the tensors required by cprand_iterate(). One (untiled) CSF
+*        tensor is built for each mode, with that mode stored at the leaves.
+*        The fibers of tensor 'm' are thus exactly the non-empty mode-m fibers
+*        of the tensor.
+*
+*        NOTE: This data must be freed with `csf_free()`, using
+*        opts[SPLATT_OPTION_CSF_ALLOC] = SPLATT_CSF_ALLMODE.
+*
+* @param tt The coordinate tensor to convert from.
+* @param opts SPLATT options array.
+*
+* @return An array of tt->nmodes CSF tensors.
+*/
+splatt_csf * cprand_csf_alloc(
+  sptensor_t * const tt,
+  double const * const opts);
+
+
+#define cprand_cpd splatt_cprand_cpd
+/**
+* @brief Compute a randomized CPD from a random initialization. This is the
+*        CPRAND counterpart of splatt_cpd_als().
+*
+* @param leaves The tensors from cprand_csf_alloc().
+* @param nfactors The rank of the decomposition.
+* @param opts SPLATT options array.
+* @param[out] factored The factored tensor in Kruskal format.
+*
+* @return SPLATT error code.
+*/
+int cprand_cpd(
+  splatt_csf const * const leaves,
+  idx_t const nfactors,
+  double const * const opts,
+  splatt_kruskal * factored);
+
+
+#define cprand_iterate splatt_cprand_iterate
+/**
+* @brief Compute the CPD with a randomized, sketched variant of ALS (CPRAND).
+*        Each factor update samples opts[SPLATT_OPTION_NSAMPLES] rows of the
+*        Khatri-Rao product which correspond to non-empty tensor fibers and
+*        solves the resulting sketched least-squares problem. The Gram matrix
+*        is formed exactly from the (cheap) A^T A matrices. The fit is only
+*        computed exactly every opts[SPLATT_OPTION_FITFREQ] iterations, and
+*        convergence is checked at those iterations.
+*
+* @param leaves The tensors from cprand_csf_alloc().
+* @param mats [OUT] The output factors. These must be initialized.
+*             mats[MAX_NMODES] is used as workspace and must have as many rows
+*             as the largest mode.
+* @param lambda [OUT] The output vector for scaling.
+* @param nfactors The rank of the factorization.
+* @param rinfo MPI rank information (not used).
+* @param opts SPLATT options array.
+*
+* @return The final (exact) fit of the factorization.
+*/
+double cprand_iterate(
+  splatt_csf const * const leaves,
+  matrix_t ** mats,
+  val_t * const lambda,
+  idx_t const nfactors,
+  rank_info * const rinfo,
+  double const * const opts);
+
+#endif
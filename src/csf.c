@@ -299,10 +299,12 @@ static void p_mk_outerptr(
       ct->pt[tile_id].nfibs[0] = nfibs;
       assert(nfibs <= ct->dims[csf_depth_to_mode(ct, 0)]);
 
-      pt->fptr[0] = splatt_malloc((nfibs+1) * sizeof(**(pt->fptr)));
+      pt->fptr[0] = splatt_malloc_tag((nfibs+1) * sizeof(**(pt->fptr)),
+          SPLATT_MEM_CSF);
       /* only store top-level fids if we are tiling or there are gaps */
       if((ct->ntiles > 1) || (tt->dims[csf_depth_to_mode(ct, 0)] != nfibs)) {
-        pt->fids[0] = splatt_malloc(nfibs * sizeof(**(pt->fids)));
+        pt->fids[0] = splatt_malloc_tag(nfibs * sizeof(**(pt->fids)),
+            SPLATT_MEM_CSF);
         pt->fids[0][0] = ttind[0];
       } else {
         pt->fids[0] = NULL;
@@ -418,9 +420,11 @@ static void p_mk_fptr(
       idx_t const nfibs = thread_nfibs[nthreads];
 
       pt->nfibs[mode] = nfibs;
-      pt->fptr[mode] = splatt_malloc((nfibs+1) * sizeof(**(pt->fptr)));
+      pt->fptr[mode] = splatt_malloc_tag((nfibs+1) * sizeof(**(pt->fptr)),
+          SPLATT_MEM_CSF);
       pt->fptr[mode][0] = 0;
-      pt->fids[mode] = splatt_malloc(nfibs * sizeof(**(pt->fids)));
+      pt->fids[mode] = splatt_malloc_tag(nfibs * sizeof(**(pt->fids)),
+          SPLATT_MEM_CSF);
     } /* implied barrier */
 
     idx_t * const restrict fp = pt->fptr[mode];
@@ -477,14 +481,16 @@ static void p_csf_alloc_untiled(
   for(idx_t m=0; m < nmodes; ++m) {
     ct->tile_dims[m] = 1;
   }
-  ct->pt = splatt_malloc(sizeof(*(ct->pt)));
+  ct->pt = splatt_malloc_tag(sizeof(*(ct->pt)), SPLATT_MEM_CSF);
 
   csf_sparsity * const pt = ct->pt;
 
   /* last row of fptr is just nonzero inds */
   pt->nfibs[nmodes-1] = ct->nnz;
-  pt->fids[nmodes-1] = splatt_malloc(ct->nnz * sizeof(**(pt->fids)));
-  pt->vals           = splatt_malloc(ct->nnz * sizeof(*(pt->vals)));
+  pt->fids[nmodes-1] = splatt_malloc_tag(ct->nnz * sizeof(**(pt->fids)),
+      SPLATT_MEM_CSF);
+  pt->vals           = splatt_malloc_tag(ct->nnz * sizeof(*(pt->vals)),
+      SPLATT_MEM_CSF);
   par_memcpy(pt->fids[nmodes-1], tt->ind[csf_depth_to_mode(ct, nmodes-1)],
       ct->nnz * sizeof(**(pt->fids)));
   par_memcpy(pt->vals, tt->vals, ct->nnz * sizeof(*(pt->vals)));
@@ -541,7 +547,7 @@ static void p_csf_alloc_densetile(
   idx_t * nnz_ptr = tt_densetile(tt, ct->tile_dims);
 
   ct->ntiles = ntiles;
-  ct->pt = splatt_malloc(ntiles * sizeof(*(ct->pt)));
+  ct->pt = splatt_malloc_tag(ntiles * sizeof(*(ct->pt)), SPLATT_MEM_CSF);
 
   for(idx_t t=0; t < ntiles; ++t) {
     idx_t const startnnz = nnz_ptr[t];
@@ -558,7 +564,8 @@ static void p_csf_alloc_densetile(
         pt->nfibs[m] = 0;
       }
       /* first fptr may be accessed anyway */
-      pt->fptr[0] = (idx_t *) splatt_malloc(2 * sizeof(**(pt->fptr)));
+      pt->fptr[0] = (idx_t *) splatt_malloc_tag(2 * sizeof(**(pt->fptr)),
+          SPLATT_MEM_CSF);
       pt->fptr[0][0] = 0;
       pt->fptr[0][1] = 0;
       pt->vals = NULL;
@@ -570,11 +577,12 @@ static void p_csf_alloc_densetile(
     /* last row of fptr is just nonzero inds */
     pt->nfibs[leaves] = ptnnz;
 
-    pt->fids[leaves] = splatt_malloc(ptnnz * sizeof(**(pt->fids)));
+    pt->fids[leaves] = splatt_malloc_tag(ptnnz * sizeof(**(pt->fids)),
+        SPLATT_MEM_CSF);
     par_memcpy(pt->fids[leaves], tt->ind[csf_depth_to_mode(ct, leaves)] + startnnz,
         ptnnz * sizeof(**(pt->fids)));
 
-    pt->vals = splatt_malloc(ptnnz * sizeof(*(pt->vals)));
+    pt->vals = splatt_malloc_tag(ptnnz * sizeof(*(pt->vals)), SPLATT_MEM_CSF);
     par_memcpy(pt->vals, tt->vals + startnnz, ptnnz * sizeof(*(pt->vals)));
 
     /* create fptr entries for the rest of the modes */
@@ -587,6 +595,156 @@ static void p_csf_alloc_densetile(
 }
 
 
+/**
+* @brief Move an array into a fresh allocation whose pages are first touched
+*        by the threads that will read them. Thread t copies elements
+*        [bounds[t], bounds[t+1]), and the last thread also copies any tail up
+*        to 'len'.
+*
+* @param old The array to move. It is freed.
+* @param width The size of each element, in bytes.
+* @param len The number of elements.
+* @param bounds The element partition, of length nthreads+1.
+* @param nthreads The number of threads.
+*
+* @return The new array.
+*/
+static void * p_place_array(
+  void * old,
+  size_t const width,
+  idx_t const len,
+  idx_t const * const bounds,
+  idx_t const nthreads)
+{
+  if(old == NULL) {
+    return NULL;
+  }
+
+  char * new = splatt_malloc_tag(len * width, SPLATT_MEM_CSF);
+  char const * const src = old;
+
+  #pragma omp parallel for schedule(static, 1) num_threads(nthreads)
+  for(idx_t t=0; t < nthreads; ++t) {
+    idx_t const start = bounds[t];
+    idx_t const end = (t == nthreads-1) ? len : bounds[t+1];
+    if(end > start) {
+      memcpy(new + (start * width), src + (start * width),
+          (end - start) * width);
+    }
+  }
+
+  splatt_free(old);
+  return new;
+}
+
+
+/**
+* @brief Place an untiled CSF tensor for NUMA locality. The root slices are
+*        split with the same partition that MTTKRP uses, and each thread first
+*        touches the subtrees it will own, so they land on its memory node.
+*
+* @param ct The CSF tensor to place.
+* @param nthreads The number of threads which will operate on the tensor.
+*/
+static void p_csf_place_untiled(
+  splatt_csf * const ct,
+  idx_t const nthreads)
+{
+  idx_t const nmodes = ct->nmodes;
+  csf_sparsity * const pt = ct->pt;
+
+  /* bounds[m][t] is the first node at level m in thread t's subtrees */
+  idx_t * bounds = splatt_malloc(nmodes * (nthreads+1) * sizeof(*bounds));
+  idx_t * parts = csf_partition_1d(ct, 0, nthreads);
+  memcpy(bounds, parts, (nthreads+1) * sizeof(*bounds));
+  splatt_free(parts);
+  for(idx_t m=1; m < nmodes; ++m) {
+    idx_t const * const prev = bounds + ((m-1) * (nthreads+1));
+    idx_t * const curr = bounds + (m * (nthreads+1));
+    for(idx_t t=0; t <= nthreads; ++t) {
+      curr[t] = pt->fptr[m-1][prev[t]];
+    }
+  }
+
+  for(idx_t m=0; m < nmodes; ++m) {
+    idx_t const * const mb = bounds + (m * (nthreads+1));
+    if(m < nmodes-1) {
+      pt->fptr[m] = p_place_array(pt->fptr[m], sizeof(**(pt->fptr)),
+          pt->nfibs[m]+1, mb, nthreads);
+    }
+    pt->fids[m] = p_place_array(pt->fids[m], sizeof(**(pt->fids)),
+        pt->nfibs[m], mb, nthreads);
+  }
+  pt->vals = p_place_array(pt->vals, sizeof(*(pt->vals)),
+      pt->nfibs[nmodes-1], bounds + ((nmodes-1) * (nthreads+1)), nthreads);
+
+  splatt_free(bounds);
+}
+
+
+/**
+* @brief Move an array into a fresh allocation, first touched by the calling
+*        thread.
+*
+* @param old The array to move. It is freed.
+* @param bytes The size of the array.
+*
+* @return The new array.
+*/
+static void * p_move_array(
+  void * old,
+  size_t const bytes)
+{
+  if(old == NULL) {
+    return NULL;
+  }
+  void * new = splatt_malloc_tag(bytes, SPLATT_MEM_CSF);
+  memcpy(new, old, bytes);
+  splatt_free(old);
+  return new;
+}
+
+
+/**
+* @brief Place a tiled CSF tensor for NUMA locality. Tiles are split with the
+*        same partition that MTTKRP uses, and each thread re-allocates and
+*        copies the tiles it owns.
+*
+* @param ct The CSF tensor to place.
+* @param nthreads The number of threads which will operate on the tensor.
+*/
+static void p_csf_place_tiled(
+  splatt_csf * const ct,
+  idx_t const nthreads)
+{
+  idx_t const nmodes = ct->nmodes;
+  idx_t * parts = csf_partition_tiles_1d(ct, nthreads);
+
+  #pragma omp parallel for schedule(static, 1) num_threads(nthreads)
+  for(idx_t t=0; t < nthreads; ++t) {
+    for(idx_t tile=parts[t]; tile < parts[t+1]; ++tile) {
+      csf_sparsity * const pt = ct->pt + tile;
+      if(pt->vals == NULL) {
+        continue;
+      }
+
+      for(idx_t m=0; m < nmodes; ++m) {
+        if(m < nmodes-1) {
+          pt->fptr[m] = p_move_array(pt->fptr[m],
+              (pt->nfibs[m]+1) * sizeof(**(pt->fptr)));
+        }
+        pt->fids[m] = p_move_array(pt->fids[m],
+            pt->nfibs[m] * sizeof(**(pt->fids)));
+      }
+      pt->vals = p_move_array(pt->vals,
+          pt->nfibs[nmodes-1] * sizeof(*(pt->vals)));
+    }
+  }
+
+  splatt_free(parts);
+}
+
+
 /**
 * @brief Construct dim_iperm, which is the inverse of dim_perm.
 *
@@ -641,6 +799,16 @@ static void p_mk_csf(
         ct->which_tile);
     break;
   }
+
+  /* re-home the tree on the memory nodes of the threads that will use it */
+  idx_t const nthreads = (idx_t) splatt_opts[SPLATT_OPTION_NTHREADS];
+  if(nthreads > 1) {
+    if(ct->ntiles > 1) {
+      p_csf_place_tiled(ct, nthreads);
+    } else if(ct->nnz > 0) {
+      p_csf_place_untiled(ct, nthreads);
+    }
+  }
 }
 
 /******************************************************************************
@@ -670,7 +838,7 @@ void csf_free(
     csf_free_mode(csf + i);
   }
 
-  free(csf);
+  splatt_free(csf);
 }
 
 
@@ -679,14 +847,14 @@ void csf_free_mode(
 {
   /* free each tile of sparsity pattern */
   for(idx_t t=0; t < csf->ntiles; ++t) {
-    free(csf->pt[t].vals);
-    free(csf->pt[t].fids[csf->nmodes-1]);
+    splatt_free(csf->pt[t].vals);
+    splatt_free(csf->pt[t].fids[csf->nmodes-1]);
     for(idx_t m=0; m < csf->nmodes-1; ++m) {
-      free(csf->pt[t].fptr[m]);
-      free(csf->pt[t].fids[m]);
+      splatt_free(csf->pt[t].fptr[m]);
+      splatt_free(csf->pt[t].fids[m]);
     }
   }
-  free(csf->pt);
+  splatt_free(csf->pt);
 }
 
 
@@ -799,7 +967,7 @@ splatt_csf * csf_alloc(
     last_mode = csf_depth_to_mode(&(ret[0]), tt->nmodes-1);
     p_mk_csf(ret + 1, tt, CSF_SORTED_MINUSONE, last_mode, tmp_opts);
 
-    free(tmp_opts);
+    splatt_free_opts(tmp_opts);
     break;
 
   case SPLATT_CSF_ALLMODE:
@@ -163,7 +163,7 @@ static void p_create_slabptr(
   }
 
   /* update ft with new data structures */
-  free(ft->sids);
+  splatt_free(ft->sids);
   ft->sids = sids;
   ft->sptr = sptr;
 
@@ -304,22 +304,22 @@ spmatrix_t * ften_spmat(
 void ften_free(
   ftensor_t * ft)
 {
-  free(ft->fptr);
-  free(ft->fids);
-  free(ft->inds);
-  free(ft->vals);
-  free(ft->sptr);
-  free(ft->indmap);
+  splatt_free(ft->fptr);
+  splatt_free(ft->fids);
+  splatt_free(ft->inds);
+  splatt_free(ft->vals);
+  splatt_free(ft->sptr);
+  splatt_free(ft->indmap);
 
   switch(ft->tiled) {
   case SPLATT_SYNCTILE:
-    free(ft->slabptr);
-    free(ft->sids);
+    splatt_free(ft->slabptr);
+    splatt_free(ft->sids);
     break;
 
   case SPLATT_COOPTILE:
-    free(ft->slabptr);
-    free(ft->sids);
+    splatt_free(ft->slabptr);
+    splatt_free(ft->sids);
     break;
   default:
     break;
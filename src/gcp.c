@@ -0,0 +1,614 @@
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "gcp.h"
+#include "mttkrp.h"
+#include "timer.h"
+#include "util.h"
+
+#include <math.h>
+
+
+/* Adam steps between loss estimates. */
+#ifndef GCP_EPOCH_ITS
+#define GCP_EPOCH_ITS 100
+#endif
+
+/* Failed epochs allowed before giving up. */
+#ifndef GCP_MAX_FAILS
+#define GCP_MAX_FAILS 1
+#endif
+
+/* Step size reduction after a failed epoch. */
+#define GCP_DECAY 0.1
+
+/* Adam parameters. */
+#define GCP_BETA1 0.9
+#define GCP_BETA2 0.999
+#define GCP_ADAM_EPS 1e-8
+
+/* Keeps the Gamma loss finite at m = 0. */
+#define GCP_EPS 1e-10
+
+/* Minimum samples per stratum and the size of the loss estimate's sample,
+ * relative to the gradient's. */
+#define GCP_MIN_SAMPLES 1000
+#define GCP_FSAMPLE_MULT 10
+
+
+
+/******************************************************************************
+ * LOSSES
+ *****************************************************************************/
+
+static val_t p_gaussian_func(
+    val_t const x,
+    val_t const m)
+{
+  return (x - m) * (x - m);
+}
+
+static val_t p_gaussian_deriv(
+    val_t const x,
+    val_t const m)
+{
+  return 2. * (m - x);
+}
+
+
+static val_t p_bernoulli_func(
+    val_t const x,
+    val_t const m)
+{
+  /* log(1 + e^m) without overflow */
+  return log1p(exp(-fabs(m))) + SS_MAX(m, 0.) - (x * m);
+}
+
+static val_t p_bernoulli_deriv(
+    val_t const x,
+    val_t const m)
+{
+  return (1. / (1. + exp(-m))) - x;
+}
+
+
+static val_t p_poisson_func(
+    val_t const x,
+    val_t const m)
+{
+  return exp(m) - (x * m);
+}
+
+static val_t p_poisson_deriv(
+    val_t const x,
+    val_t const m)
+{
+  return exp(m) - x;
+}
+
+
+static val_t p_gamma_func(
+    val_t const x,
+    val_t const m)
+{
+  val_t const mm = m + GCP_EPS;
+  return (x / mm) + log(mm);
+}
+
+static val_t p_gamma_deriv(
+    val_t const x,
+    val_t const m)
+{
+  val_t const mm = m + GCP_EPS;
+  return (1. / mm) - (x / (mm * mm));
+}
+
+
+static gcp_loss const gcp_losses[] = {
+  [SPLATT_LOSS_GAUSSIAN] =
+      { "gaussian", p_gaussian_func, p_gaussian_deriv, -INFINITY },
+  [SPLATT_LOSS_BERNOULLI] =
+      { "bernoulli", p_bernoulli_func, p_bernoulli_deriv, -INFINITY },
+  [SPLATT_LOSS_POISSON] =
+      { "poisson", p_poisson_func, p_poisson_deriv, -INFINITY },
+  [SPLATT_LOSS_GAMMA] =
+      { "gamma", p_gamma_func, p_gamma_deriv, 0. },
+};
+#define GCP_NLOSSES (sizeof(gcp_losses) / sizeof(gcp_losses[0]))
+
+
+
+/******************************************************************************
+ * PRIVATE FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief A stratified sample of tensor entries. The first 'nnz_samples' are
+*        nonzeros and the rest are drawn from all entries, which are treated
+*        as zeros (semi-stratified sampling). The nonzeros correct for being
+*        counted among the zeros as well, so no membership test is needed.
+*/
+typedef struct
+{
+  sptensor_t * coords; /** sampled coordinates; vals holds the gradient */
+  val_t * x;           /** tensor value of each sample */
+  val_t * model;       /** model value of each sample */
+  idx_t nnz_samples;
+  val_t nnz_weight;    /** nonzeros represented by each nonzero sample */
+  val_t zero_weight;   /** entries represented by each zero sample */
+} gcp_sample;
+
+
+static gcp_sample * p_sample_alloc(
+    sptensor_t const * const tt,
+    idx_t const nsamples)
+{
+  gcp_sample * sample = splatt_malloc(sizeof(*sample));
+  sample->coords = tt_alloc(2 * nsamples, tt->nmodes);
+  for(idx_t m=0; m < tt->nmodes; ++m) {
+    sample->coords->dims[m] = tt->dims[m];
+  }
+  sample->x = splatt_malloc(2 * nsamples * sizeof(*sample->x));
+  sample->model = splatt_malloc(2 * nsamples * sizeof(*sample->model));
+  sample->nnz_samples = nsamples;
+
+  double total = 1.;
+  for(idx_t m=0; m < tt->nmodes; ++m) {
+    total *= (double) tt->dims[m];
+  }
+  sample->nnz_weight = (val_t) tt->nnz / (val_t) nsamples;
+  sample->zero_weight = total / (val_t) nsamples;
+  return sample;
+}
+
+
+static void p_sample_free(
+    gcp_sample * sample)
+{
+  tt_free(sample->coords);
+  splatt_free(sample->x);
+  splatt_free(sample->model);
+  splatt_free(sample);
+}
+
+
+/**
+* @brief Draw new coordinates for a sample.
+*
+* @param tt The tensor to sample from.
+* @param sample The sample to fill.
+*/
+static void p_sample_draw(
+    sptensor_t const * const tt,
+    gcp_sample * const sample)
+{
+  idx_t const nmodes = tt->nmodes;
+  idx_t const ns = sample->nnz_samples;
+  sptensor_t * const coords = sample->coords;
+
+  /* rand() is not thread safe */
+  for(idx_t s=0; s < ns; ++s) {
+    idx_t const x = rand_idx() % tt->nnz;
+    for(idx_t m=0; m < nmodes; ++m) {
+      coords->ind[m][s] = tt->ind[m][x];
+    }
+    sample->x[s] = tt->vals[x];
+  }
+  for(idx_t s=ns; s < coords->nnz; ++s) {
+    for(idx_t m=0; m < nmodes; ++m) {
+      coords->ind[m][s] = rand_idx() % tt->dims[m];
+    }
+    sample->x[s] = 0.;
+  }
+}
+
+
+/**
+* @brief Evaluate the model at each sampled coordinate. Each value is the sum
+*        of the Hadamard product of one row from each factor.
+*
+* @param sample The sample to evaluate.
+* @param mats The factors.
+*/
+static void p_sample_model(
+    gcp_sample * const sample,
+    matrix_t ** mats)
+{
+  sptensor_t const * const coords = sample->coords;
+  idx_t const nmodes = coords->nmodes;
+  idx_t const nfactors = mats[0]->J;
+  val_t * const restrict model = sample->model;
+
+  #pragma omp parallel
+  {
+    val_t * const restrict accum = splatt_malloc(nfactors * sizeof(*accum));
+
+    #pragma omp for schedule(static)
+    for(idx_t s=0; s < coords->nnz; ++s) {
+      val_t const * const restrict first = mats[0]->vals +
+          (coords->ind[0][s] * nfactors);
+      for(idx_t f=0; f < nfactors; ++f) {
+        accum[f] = first[f];
+      }
+      for(idx_t m=1; m < nmodes; ++m) {
+        val_t const * const restrict row = mats[m]->vals +
+            (coords->ind[m][s] * nfactors);
+        for(idx_t f=0; f < nfactors; ++f) {
+          accum[f] *= row[f];
+        }
+      }
+
+      val_t sum = 0.;
+      for(idx_t f=0; f < nfactors; ++f) {
+        sum += accum[f];
+      }
+      model[s] = sum;
+    }
+
+    splatt_free(accum);
+  } /* end omp parallel */
+}
+
+
+/**
+* @brief Estimate the total loss over all tensor entries from a sample whose
+*        model values are current.
+*
+* @param sample The sample.
+* @param loss The loss function.
+*
+* @return The estimated loss.
+*/
+static double p_sample_loss(
+    gcp_sample const * const sample,
+    gcp_loss const * const loss)
+{
+  idx_t const ns = sample->nnz_samples;
+  idx_t const total = sample->coords->nnz;
+  val_t const * const restrict x = sample->x;
+  val_t const * const restrict model = sample->model;
+
+  double nnz_sum = 0.;
+  double zero_sum = 0.;
+  #pragma omp parallel for schedule(static) reduction(+:nnz_sum,zero_sum)
+  for(idx_t s=0; s < total; ++s) {
+    if(s < ns) {
+      nnz_sum += loss->func(x[s], model[s]) - loss->func(0., model[s]);
+    } else {
+      zero_sum += loss->func(0., model[s]);
+    }
+  }
+  return (sample->nnz_weight * nnz_sum) + (sample->zero_weight * zero_sum);
+}
+
+
+/**
+* @brief Compute the stochastic gradient of each factor. The gradient tensor
+*        Y is stored in the sample's coordinates, and the gradient of factor m
+*        is the MTTKRP of Y.
+*
+* @param sample The sample, with current model values.
+* @param loss The loss function.
+* @param mats The factors. mats[MAX_NMODES] is used as workspace.
+* @param[out] grads The gradient of each factor.
+*/
+static void p_gradient(
+    gcp_sample * const sample,
+    gcp_loss const * const loss,
+    matrix_t ** mats,
+    matrix_t ** grads)
+{
+  sptensor_t * const coords = sample->coords;
+  idx_t const ns = sample->nnz_samples;
+  val_t const * const restrict x = sample->x;
+  val_t const * const restrict model = sample->model;
+  val_t * const restrict yvals = coords->vals;
+
+  #pragma omp parallel for schedule(static)
+  for(idx_t s=0; s < coords->nnz; ++s) {
+    if(s < ns) {
+      yvals[s] = sample->nnz_weight *
+          (loss->deriv(x[s], model[s]) - loss->deriv(0., model[s]));
+    } else {
+      yvals[s] = sample->zero_weight * loss->deriv(0., model[s]);
+    }
+  }
+
+  timer_start(&timers[TIMER_MTTKRP]);
+  for(idx_t m=0; m < coords->nmodes; ++m) {
+    mats[MAX_NMODES]->I = coords->dims[m];
+    mttkrp_stream(coords, mats, m);
+    par_memcpy(grads[m]->vals, mats[MAX_NMODES]->vals,
+        grads[m]->I * grads[m]->J * sizeof(val_t));
+  }
+  timer_stop(&timers[TIMER_MTTKRP]);
+}
+
+
+/**
+* @brief Take one Adam step on a factor and project it onto the bounds of the
+*        loss.
+*
+* @param grad The gradient of the factor.
+* @param[out] mat The factor to update.
+* @param m1 The first moment estimate.
+* @param m2 The second moment estimate.
+* @param step The step size.
+* @param t The (1-based) number of steps since the moments were reset.
+* @param lower The lower bound of each entry.
+*/
+static void p_adam_step(
+    matrix_t const * const grad,
+    matrix_t * const mat,
+    matrix_t * const m1,
+    matrix_t * const m2,
+    val_t const step,
+    idx_t const t,
+    val_t const lower)
+{
+  val_t const c1 = 1. / (1. - pow(GCP_BETA1, (double) t));
+  val_t const c2 = 1. / (1. - pow(GCP_BETA2, (double) t));
+
+  val_t const * const restrict gv = grad->vals;
+  val_t * const restrict av = mat->vals;
+  val_t * const restrict m1v = m1->vals;
+  val_t * const restrict m2v = m2->vals;
+
+  #pragma omp parallel for schedule(static)
+  for(idx_t x=0; x < mat->I * mat->J; ++x) {
+    val_t const g = gv[x];
+    m1v[x] = (GCP_BETA1 * m1v[x]) + ((1. - GCP_BETA1) * g);
+    m2v[x] = (GCP_BETA2 * m2v[x]) + ((1. - GCP_BETA2) * g * g);
+    val_t const update = (m1v[x] * c1) / (sqrt(m2v[x] * c2) + GCP_ADAM_EPS);
+    av[x] = SS_MAX(av[x] - (step * update), lower);
+  }
+}
+
+
+/**
+* @brief Move the norms of the factor columns into lambda.
+*
+* @param nmodes The number of modes.
+* @param[out] mats The factors to normalize.
+* @param[out] lambda The product of the column norms.
+*/
+static void p_normalize(
+    idx_t const nmodes,
+    matrix_t ** mats,
+    val_t * const lambda)
+{
+  idx_t const nfactors = mats[0]->J;
+  for(idx_t f=0; f < nfactors; ++f) {
+    lambda[f] = 1.;
+  }
+
+  for(idx_t m=0; m < nmodes; ++m) {
+    val_t * const restrict vals = mats[m]->vals;
+    for(idx_t f=0; f < nfactors; ++f) {
+      val_t norm = 0.;
+      for(idx_t i=0; i < mats[m]->I; ++i) {
+        norm += vals[f + (i*nfactors)] * vals[f + (i*nfactors)];
+      }
+      norm = sqrt(norm);
+      lambda[f] *= norm;
+      if(norm > 0.) {
+        for(idx_t i=0; i < mats[m]->I; ++i) {
+          vals[f + (i*nfactors)] /= norm;
+        }
+      }
+    }
+  }
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+gcp_loss const * gcp_get_loss(
+  splatt_loss_type const which)
+{
+  if((idx_t) which >= GCP_NLOSSES) {
+    return NULL;
+  }
+  return gcp_losses + which;
+}
+
+
+bool gcp_parse_loss(
+  char const * const name,
+  splatt_loss_type * const which)
+{
+  for(idx_t l=0; l < GCP_NLOSSES; ++l) {
+    if(strcmp(name, gcp_losses[l].name) == 0) {
+      *which = (splatt_loss_type) l;
+      return true;
+    }
+  }
+  return false;
+}
+
+
+int gcp_cpd(
+  sptensor_t const * const tt,
+  idx_t const nfactors,
+  double const * const opts,
+  splatt_kruskal * factored)
+{
+  idx_t const nmodes = tt->nmodes;
+  gcp_loss const * const loss =
+      gcp_get_loss((splatt_loss_type) opts[SPLATT_OPTION_LOSS]);
+  if(loss == NULL) {
+    fprintf(stderr, "SPLATT: unknown GCP loss %d.\n",
+        (int) opts[SPLATT_OPTION_LOSS]);
+    return SPLATT_ERROR_BADINPUT;
+  }
+  if(tt->nnz == 0) {
+    fprintf(stderr, "SPLATT: GCP requires a tensor with nonzeros.\n");
+    return SPLATT_ERROR_BADINPUT;
+  }
+
+  /* Start from non-negative factors whose model has the mean of the data.
+   * Losses with a link function instead start near m = 0. */
+  val_t target = 0.1;
+  splatt_loss_type const which = (splatt_loss_type) opts[SPLATT_OPTION_LOSS];
+  if(which == SPLATT_LOSS_GAUSSIAN || which == SPLATT_LOSS_GAMMA) {
+    double total = 1.;
+    for(idx_t m=0; m < nmodes; ++m) {
+      total *= (double) tt->dims[m];
+    }
+    double sum = 0.;
+    for(idx_t x=0; x < tt->nnz; ++x) {
+      sum += tt->vals[x];
+    }
+    if(sum > 0.) {
+      target = sum / total;
+    }
+  }
+  /* uniform [0,1] entries give a mean model value of nfactors / 2^nmodes */
+  val_t const scale = pow(target * pow(2., (double) nmodes) / (val_t) nfactors,
+      1. / (double) nmodes);
+
+  matrix_t * mats[MAX_NMODES+1];
+  idx_t const maxdim = tt->dims[argmax_elem(tt->dims, nmodes)];
+  for(idx_t m=0; m < nmodes; ++m) {
+    mats[m] = mat_alloc(tt->dims[m], nfactors);
+    val_t * const restrict vals = mats[m]->vals;
+    for(idx_t x=0; x < tt->dims[m] * nfactors; ++x) {
+      vals[x] = scale * ((val_t) rand() / (val_t) RAND_MAX);
+    }
+  }
+  mats[MAX_NMODES] = mat_alloc(maxdim, nfactors);
+
+  factored->fit = gcp_iterate(tt, mats, loss, opts);
+
+  val_t * lambda = splatt_malloc(nfactors * sizeof(*lambda));
+  p_normalize(nmodes, mats, lambda);
+
+  factored->rank = nfactors;
+  factored->nmodes = nmodes;
+  factored->lambda = lambda;
+  for(idx_t m=0; m < nmodes; ++m) {
+    factored->dims[m] = tt->dims[m];
+    factored->factors[m] = mats[m]->vals;
+    splatt_free(mats[m]); /* just the matrix_t ptr, data is in factored */
+  }
+  mat_free(mats[MAX_NMODES]);
+
+  return SPLATT_SUCCESS;
+}
+
+
+double gcp_iterate(
+  sptensor_t const * const tt,
+  matrix_t ** mats,
+  gcp_loss const * const loss,
+  double const * const opts)
+{
+  idx_t const nmodes = tt->nmodes;
+  idx_t const nfactors = mats[0]->J;
+
+  idx_t nsamples = (idx_t) opts[SPLATT_OPTION_NSAMPLES];
+  if(nsamples == 0) {
+    nsamples = SS_MAX(GCP_MIN_SAMPLES, tt->nnz / 100);
+  }
+
+  /* the loss estimate uses one larger, fixed sample */
+  gcp_sample * gsample = p_sample_alloc(tt, nsamples);
+  gcp_sample * fsample = p_sample_alloc(tt, GCP_FSAMPLE_MULT * nsamples);
+  p_sample_draw(tt, fsample);
+
+  /* gradients, Adam moments, and the factors at the last good epoch */
+  matrix_t * grads[MAX_NMODES];
+  matrix_t * m1[MAX_NMODES];
+  matrix_t * m2[MAX_NMODES];
+  matrix_t * prev[MAX_NMODES];
+  for(idx_t m=0; m < nmodes; ++m) {
+    grads[m] = mat_alloc(tt->dims[m], nfactors);
+    m1[m] = mat_alloc(tt->dims[m], nfactors);
+    m2[m] = mat_alloc(tt->dims[m], nfactors);
+    memset(m1[m]->vals, 0, tt->dims[m] * nfactors * sizeof(val_t));
+    memset(m2[m]->vals, 0, tt->dims[m] * nfactors * sizeof(val_t));
+    prev[m] = mat_alloc(tt->dims[m], nfactors);
+    par_memcpy(prev[m]->vals, mats[m]->vals,
+        tt->dims[m] * nfactors * sizeof(val_t));
+  }
+
+  p_sample_model(fsample, mats);
+  double fest = p_sample_loss(fsample, loss);
+  if(opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_NONE) {
+    printf("  loss = %s  samples = %"SPLATT_PF_IDX"  initial = %0.5e\n",
+        loss->name, nsamples, fest);
+  }
+
+  val_t step = opts[SPLATT_OPTION_LEARNRATE];
+  idx_t t = 0;
+  idx_t nfails = 0;
+  sp_timer_t epochtime;
+  timer_start(&timers[TIMER_CPD]);
+
+  idx_t const nepochs = (idx_t) opts[SPLATT_OPTION_NITER];
+  for(idx_t e=0; e < nepochs; ++e) {
+    timer_fstart(&epochtime);
+    for(idx_t it=0; it < GCP_EPOCH_ITS; ++it) {
+      p_sample_draw(tt, gsample);
+      p_sample_model(gsample, mats);
+      p_gradient(gsample, loss, mats, grads);
+      ++t;
+      for(idx_t m=0; m < nmodes; ++m) {
+        p_adam_step(grads[m], mats[m], m1[m], m2[m], step, t, loss->lower);
+      }
+    }
+
+    p_sample_model(fsample, mats);
+    double const newf = p_sample_loss(fsample, loss);
+    timer_stop(&epochtime);
+
+    bool const failed = !(newf < fest);
+    double const delta = (fest - newf) / SS_MAX(fabs(fest), 1e-12);
+    if(opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_NONE) {
+      printf("  epoch = %3"SPLATT_PF_IDX" (%0.3fs)  loss = %0.5e  "
+             "delta = %+0.4e  step = %0.1e%s\n", e+1, epochtime.seconds, newf,
+             delta, step, failed ? "  (undone)" : "");
+    }
+
+    if(failed) {
+      /* undo the epoch and restart Adam with a smaller step */
+      for(idx_t m=0; m < nmodes; ++m) {
+        idx_t const nvals = tt->dims[m] * nfactors;
+        par_memcpy(mats[m]->vals, prev[m]->vals, nvals * sizeof(val_t));
+        memset(m1[m]->vals, 0, nvals * sizeof(val_t));
+        memset(m2[m]->vals, 0, nvals * sizeof(val_t));
+      }
+      t = 0;
+      step *= GCP_DECAY;
+      if(++nfails > GCP_MAX_FAILS) {
+        break;
+      }
+      continue;
+    }
+
+    for(idx_t m=0; m < nmodes; ++m) {
+      par_memcpy(prev[m]->vals, mats[m]->vals,
+          tt->dims[m] * nfactors * sizeof(val_t));
+    }
+    fest = newf;
+    if(delta < opts[SPLATT_OPTION_TOLERANCE]) {
+      break;
+    }
+  }
+  timer_stop(&timers[TIMER_CPD]);
+
+  for(idx_t m=0; m < nmodes; ++m) {
+    mat_free(grads[m]);
+    mat_free(m1[m]);
+    mat_free(m2[m]);
+    mat_free(prev[m]);
+  }
+  p_sample_free(gsample);
+  p_sample_free(fsample);
+
+  return fest;
+}
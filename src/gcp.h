@@ -0,0 +1,128 @@
+#ifndef SPLATT_GCP_H
+#define SPLATT_GCP_H
+
+#include "base.h"
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "matrix.h"
+#include "sptensor.h"
+
+
+/******************************************************************************
+ * STRUCTURES
+ *****************************************************************************/
+
+/**
+* @brief An elementwise loss f(x, m) for generalized CPD, where x is a tensor
+*        entry and m is the model's value at that entry. New losses only need
+*        to provide this struct.
+*/
+typedef struct
+{
+  /** @brief The name used on the command line. */
+  char const * name;
+
+  /** @brief The loss f(x, m). */
+  val_t (* func)(val_t const x, val_t const m);
+
+  /** @brief The derivative of f(x, m) with respect to m. */
+  val_t (* deriv)(val_t const x, val_t const m);
+
+  /** @brief A lower bound on factor entries which keeps the model in the
+   *         domain of the loss, or -INFINITY. */
+  val_t lower;
+} gcp_loss;
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+#define gcp_get_loss splatt_gcp_get_loss
+/**
+* @brief Look up one of the built-in losses.
+*
+* @param which The loss to return.
+*
+* @return The loss, or NULL if 'which' is not recognized.
+*/
+gcp_loss const * gcp_get_loss(
+  splatt_loss_type const which);
+
+
+#define gcp_parse_loss splatt_gcp_parse_loss
+/**
+* @brief Find a built-in loss by name, e.g., "bernoulli".
+*
+* @param name The name of the loss.
+* @param[out] which The loss type.
+*
+* @return True if the name was recognized.
+*/
+bool gcp_parse_loss(
+  char const * const name,
+  splatt_loss_type * const which);
+
+
+#define gcp_cpd splatt_gcp_cpd
+/**
+* @brief Compute a generalized CPD from a random initialization, with the loss
+*        chosen by opts[SPLATT_OPTION_LOSS]. This is the GCP counterpart of
+*        splatt_cpd_als().
+*
+*        The factors are returned with unit columns and the scaling absorbed
+*        into lambda. factored->fit holds the final estimated loss instead of a
+*        least-squares fit.
+*
+* @param tt The coordinate tensor to factor. Sampling needs the coordinates of
+*           each nonzero, so this does not use CSF.
+* @param nfactors The rank of the decomposition.
+* @param opts SPLATT options array.
+* @param[out] factored The factored tensor in Kruskal format.
+*
+* @return SPLATT error code.
+*/
+int gcp_cpd(
+  sptensor_t const * const tt,
+  idx_t const nfactors,
+  double const * const opts,
+  splatt_kruskal * factored);
+
+
+#define gcp_iterate splatt_gcp_iterate
+/**
+* @brief Compute the CPD which minimizes the sum of an elementwise loss over
+*        all tensor entries, zeros included, with stochastic gradients and Adam
+*        (Hong, Kolda, & Duersch).
+*
+*        Each step samples nonzeros and zeros separately (stratified), with
+*        opts[SPLATT_OPTION_NSAMPLES] samples from each. The gradient of the
+*        sampled loss is a sparse tensor Y at the sampled coordinates, and the
+*        gradient of each factor is the MTTKRP of Y with the other factors.
+*
+*        Steps are grouped into epochs of GCP_EPOCH_ITS. After each epoch the
+*        loss is estimated from a fixed sample. If it did not decrease, the
+*        epoch is undone and the step size (opts[SPLATT_OPTION_LEARNRATE]) is
+*        reduced. This stops after opts[SPLATT_OPTION_NITER] epochs, after
+*        GCP_MAX_FAILS failed epochs, or once the relative decrease is below
+*        opts[SPLATT_OPTION_TOLERANCE].
+*
+* @param tt The coordinate tensor to factor.
+* @param mats [IN/OUT] The factors, which must be initialized within the
+*             bounds of the loss. mats[MAX_NMODES] is used as workspace and
+*             must have as many rows as the largest mode.
+* @param loss The loss to minimize.
+* @param opts SPLATT options array.
+*
+* @return The final estimated loss.
+*/
+double gcp_iterate(
+  sptensor_t const * const tt,
+  matrix_t ** mats,
+  gcp_loss const * const loss,
+  double const * const opts);
+
+#endif
@@ -217,7 +217,7 @@ int splatt_load(
   *vals = tt->vals;
   *inds = tt->ind;
 
-  free(tt);
+  splatt_free(tt);
 
   return SPLATT_SUCCESS;
 }
@@ -775,6 +775,130 @@ void vec_write_file(
 }
 
 
+matrix_t * mat_read(
+  char const * const fname)
+{
+  FILE * fin;
+  if((fin = fopen(fname, "r")) == NULL) {
+    fprintf(stderr, "SPLATT ERROR: failed to open '%s'\n", fname);
+    return NULL;
+  }
+
+  matrix_t * mat = mat_read_file(fin);
+  if(mat == NULL) {
+    fprintf(stderr, "SPLATT ERROR: '%s' is not a valid matrix file.\n",
+        fname);
+  }
+
+  fclose(fin);
+  return mat;
+}
+
+
+matrix_t * mat_read_file(
+  FILE * fin)
+{
+  timer_start(&timers[TIMER_IO]);
+
+  char * ptr = NULL;
+  char * end = NULL;
+  char * line = NULL;
+  ssize_t read;
+  size_t len = 0;
+
+  /* first pass: count rows and get #columns from the first row */
+  idx_t nrows = 0;
+  idx_t ncols = 0;
+  while((read = getline(&line, &len, fin)) != -1) {
+    if(read > 1 && line[0] != '#') {
+      if(nrows == 0) {
+        ptr = line;
+        strtod(ptr, &end);
+        while(end != ptr) {
+          ++ncols;
+          ptr = end;
+          strtod(ptr, &end);
+        }
+      }
+      ++nrows;
+    }
+  }
+
+  if(nrows == 0 || ncols == 0) {
+    free(line);
+    timer_stop(&timers[TIMER_IO]);
+    return NULL;
+  }
+
+  matrix_t * mat = mat_alloc(nrows, ncols);
+
+  /* second pass: fill values */
+  rewind(fin);
+  idx_t i = 0;
+  while((read = getline(&line, &len, fin)) != -1) {
+    if(read > 1 && line[0] != '#') {
+      ptr = line;
+      for(idx_t j=0; j < ncols; ++j) {
+        mat->vals[j + (i*ncols)] = strtod(ptr, &end);
+        if(end == ptr) {
+          fprintf(stderr, "SPLATT ERROR: row %"SPLATT_PF_IDX" has fewer than "
+                          "%"SPLATT_PF_IDX" columns.\n", i+1, ncols);
+          mat_free(mat);
+          free(line);
+          timer_stop(&timers[TIMER_IO]);
+          return NULL;
+        }
+        ptr = end;
+      }
+      ++i;
+    }
+  }
+
+  free(line);
+  timer_stop(&timers[TIMER_IO]);
+  return mat;
+}
+
+
+val_t * vec_read(
+  char const * const fname,
+  idx_t * const len)
+{
+  FILE * fin;
+  if((fin = fopen(fname, "r")) == NULL) {
+    fprintf(stderr, "SPLATT ERROR: failed to open '%s'\n", fname);
+    return NULL;
+  }
+
+  val_t * vec = vec_read_file(fin, len);
+  if(vec == NULL) {
+    fprintf(stderr, "SPLATT ERROR: '%s' is not a valid vector file.\n",
+        fname);
+  }
+
+  fclose(fin);
+  return vec;
+}
+
+
+val_t * vec_read_file(
+  FILE * fin,
+  idx_t * const len)
+{
+  /* a vector is just a matrix with one column */
+  matrix_t * mat = mat_read_file(fin);
+  if(mat == NULL) {
+    *len = 0;
+    return NULL;
+  }
+
+  *len = mat->I;
+  val_t * vec = mat->vals;
+  splatt_free(mat); /* just the matrix_t ptr, data is returned */
+  return vec;
+}
+
+
 idx_t * part_read(
   char const * const ifname,
   idx_t const nvtxs,
@@ -792,7 +916,7 @@ idx_t * part_read(
   for(idx_t i=0; i < nvtxs; ++i) {
     if((ret = fscanf(pfile, "%"SPLATT_PF_IDX, &(arr[i]))) == 0) {
       fprintf(stderr, "SPLATT ERROR: not enough elements in '%s'\n", ifname);
-      free(arr);
+      splatt_free(arr);
       return NULL;
     }
     if(arr[i] > *nparts) {
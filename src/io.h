@@ -71,7 +71,8 @@ splatt_file_type get_file_type(
 typedef enum
 {
   SPLATT_BIN_COORD,
-  SPLATT_BIN_CSF
+  SPLATT_BIN_CSF,
+  SPLATT_BIN_CHKPT
 } splatt_magic_type;
 
 
@@ -235,6 +236,57 @@ void vec_write_file(
   idx_t const len,
   FILE * fout);
 
+#define mat_read splatt_mat_read
+/**
+* @brief Read a dense, row-major matrix written by mat_write(). Each line of
+*        the file is a row and values are separated by whitespace.
+*
+* @param fname The file to read from.
+*
+* @return The matrix, or NULL if the file could not be read. Must be freed with
+*         mat_free().
+*/
+matrix_t * mat_read(
+  char const * const fname);
+
+#define mat_read_file splatt_mat_read_file
+/**
+* @brief Read a dense, row-major matrix from an open file. See mat_read().
+*
+* @param fin The file to read from.
+*
+* @return The matrix, or NULL if the file is empty or malformed.
+*/
+matrix_t * mat_read_file(
+  FILE * fin);
+
+#define vec_read splatt_vec_read
+/**
+* @brief Read a vector written by vec_write(), one value per line.
+*
+* @param fname The file to read from.
+* @param[out] len The length of the vector.
+*
+* @return The vector, or NULL if the file could not be read. Must be freed with
+*         splatt_free().
+*/
+val_t * vec_read(
+  char const * const fname,
+  idx_t * const len);
+
+#define vec_read_file splatt_vec_read_file
+/**
+* @brief Read a vector from an open file. See vec_read().
+*
+* @param fin The file to read from.
+* @param[out] len The length of the vector.
+*
+* @return The vector, or NULL if the file is empty.
+*/
+val_t * vec_read_file(
+  FILE * fin,
+  idx_t * const len);
+
 
 /******************************************************************************
  * SPARSE MATRIX FUNCTIONS
@@ -12,6 +12,20 @@
 
 
 
+/******************************************************************************
+ * MACROS
+ *****************************************************************************/
+
+/* rows of a factor handled together by mat_fused_update(), in bytes */
+#ifndef FUSED_BLOCK_BYTES
+#define FUSED_BLOCK_BYTES (32 * 1024)
+#endif
+
+/* matrices at least this large are first touched by all threads */
+#ifndef MAT_FIRSTTOUCH_BYTES
+#define MAT_FIRSTTOUCH_BYTES (1024 * 1024)
+#endif
+
 
 /******************************************************************************
  * PRIVATE FUNCTIONS
@@ -24,6 +38,8 @@
 * @param aTa The individual Gram matrices.
 * @param mode Which mode we are computing for.
 * @param nmodes How many total modes.
+* @param extra Another Gram matrix to add to the product (upper triangle), or
+*              NULL.
 * @param reg Regularization parameter (to add to the diagonal).
 */
 static void p_form_gram(
@@ -31,6 +47,7 @@ static void p_form_gram(
     matrix_t * * aTa,
     idx_t const mode,
     idx_t const nmodes,
+    matrix_t const * const extra,
     val_t const reg)
 {
   /* nfactors */
@@ -70,6 +87,17 @@ static void p_form_gram(
       }
     } /* foreach mode */
 
+    /* coupled terms are added, not multiplied */
+    if(extra != NULL) {
+      val_t const * const restrict ev = extra->vals;
+      #pragma omp for schedule(static, 1)
+      for(splatt_blas_int i=0; i < N; ++i) {
+        for(splatt_blas_int j=i; j < N; ++j) {
+          neqs[j+(i*N)] += ev[j+(i*N)];
+        }
+      }
+    }
+
     #pragma omp barrier
 
     /* now copy lower triangular */
@@ -133,11 +161,13 @@ static void p_mat_2norm(
       lambda[j] = sqrt(lambda[j]);
     }
 
-    /* do the normalization */
+    /* do the normalization -- constrained solves may zero a column */
     #pragma omp for schedule(static)
     for(idx_t i=0; i < I; ++i) {
       for(idx_t j=0; j < J; ++j) {
-        vals[j+(i*J)] /= lambda[j];
+        if(lambda[j] > 0.) {
+          vals[j+(i*J)] /= lambda[j];
+        }
       }
     }
   } /* end omp for */
@@ -532,13 +562,26 @@ void mat_solve_normals(
 	matrix_t * * aTa,
   matrix_t * rhs,
   val_t const reg)
+{
+  mat_solve_normals_coupled(mode, nmodes, aTa, NULL, rhs, reg);
+}
+
+
+
+void mat_solve_normals_coupled(
+  idx_t const mode,
+  idx_t const nmodes,
+  matrix_t * * aTa,
+  matrix_t const * const extra,
+  matrix_t * rhs,
+  val_t const reg)
 {
   timer_start(&timers[TIMER_INV]);
 
   /* nfactors */
   splatt_blas_int N = aTa[0]->J;
 
-  p_form_gram(aTa[MAX_NMODES], aTa, mode, nmodes, reg);
+  p_form_gram(aTa[MAX_NMODES], aTa, mode, nmodes, extra, reg);
 
   splatt_blas_int info;
   char uplo = 'L';
@@ -566,7 +609,7 @@ void mat_solve_normals(
     }
   } else {
     /* restore gram matrix */
-    p_form_gram(aTa[MAX_NMODES], aTa, mode, nmodes, reg);
+    p_form_gram(aTa[MAX_NMODES], aTa, mode, nmodes, extra, reg);
 
     splatt_blas_int effective_rank;
     val_t * conditions = splatt_malloc(N * sizeof(*conditions));
@@ -607,6 +650,206 @@ void mat_solve_normals(
 
 
 
+void mat_fused_update(
+  idx_t const mode,
+  idx_t const nmodes,
+  matrix_t * * aTa,
+  matrix_t const * const rhs,
+  matrix_t * const A,
+  val_t * const restrict lambda,
+  splatt_mat_norm const which,
+  val_t const reg,
+  rank_info * const rinfo,
+  thd_info * const thds,
+  idx_t const nthreads)
+{
+  splatt_omp_set_num_threads(nthreads);
+  #pragma omp parallel
+  {
+    mat_fused_update_team(mode, nmodes, aTa, rhs, A, lambda, which, reg, rinfo,
+        thds);
+  }
+}
+
+
+
+void mat_fused_update_team(
+  idx_t const mode,
+  idx_t const nmodes,
+  matrix_t * * aTa,
+  matrix_t const * const rhs,
+  matrix_t * const A,
+  val_t * const restrict lambda,
+  splatt_mat_norm const which,
+  val_t const reg,
+  rank_info * const rinfo,
+  thd_info * const thds)
+{
+  #pragma omp master
+  timer_start(&timers[TIMER_INV]);
+
+  idx_t const I = rhs->I;
+  idx_t const R = rhs->J;
+  assert(A->J == R);
+  int const tid = splatt_omp_get_thread_num();
+  idx_t const nthreads = splatt_omp_get_num_threads();
+
+  /* each thread's column norms followed by its Gram matrix, from its arena */
+  size_t const mark = thd_arena_mark(thds + tid);
+  val_t ** parts = NULL;
+
+  /* factor the normal equations once -- they are only R x R, so one thread
+   * forms them rather than synchronizing the team for each mode */
+  splatt_blas_int info = 0;
+  #pragma omp single copyprivate(info, parts)
+  {
+    A->I = I;
+    p_form_gram(aTa[MAX_NMODES], aTa, mode, nmodes, NULL, reg);
+    char uplo = 'L';
+    splatt_blas_int N = (splatt_blas_int) R;
+    SPLATT_BLAS(potrf)(&uplo, &N, aTa[MAX_NMODES]->vals, &N, &info);
+    if(!info) {
+      parts = thd_arena_reserve(thds + splatt_omp_get_thread_num(),
+          nthreads * sizeof(*parts));
+    }
+  }
+  if(info) {
+    #pragma omp single
+    {
+      timer_stop(&timers[TIMER_INV]);
+
+      /* the unfused path knows how to recover with GELSS */
+      par_memcpy(A->vals, rhs->vals, I * R * sizeof(val_t));
+      mat_solve_normals(mode, nmodes, aTa, A, reg);
+      mat_normalize(A, lambda, which, rinfo, thds, nthreads);
+      mat_aTa(A, aTa[mode], rinfo, thds, nthreads);
+    }
+    return;
+  }
+
+  idx_t const block = SS_MAX(1, FUSED_BLOCK_BYTES / (R * sizeof(val_t)));
+  idx_t const nblocks = (I + block - 1) / block;
+
+  val_t * const restrict chol = aTa[MAX_NMODES]->vals;
+  val_t const * const restrict mv = rhs->vals;
+  val_t * const restrict av = A->vals;
+
+  {
+    val_t * const restrict mynorms = thd_arena_reserve(thds + tid,
+        (R + (R * R)) * sizeof(*mynorms));
+    val_t * const restrict mygram = mynorms + R;
+    memset(mynorms, 0, (R + (R * R)) * sizeof(*mynorms));
+    parts[tid] = mynorms;
+
+    #pragma omp for schedule(static)
+    for(idx_t b=0; b < nblocks; ++b) {
+      idx_t const start = b * block;
+      idx_t const nrows = SS_MIN(block, I - start);
+      val_t * const restrict ablock = av + (start * R);
+
+      /* solve -- each row is a right-hand side */
+      memcpy(ablock, mv + (start * R), nrows * R * sizeof(*ablock));
+      char bl_uplo = 'L';
+      splatt_blas_int bl_N = (splatt_blas_int) R;
+      splatt_blas_int nrhs = (splatt_blas_int) nrows;
+      splatt_blas_int bl_info;
+      SPLATT_BLAS(potrs)(&bl_uplo, &bl_N, &nrhs, chol, &bl_N, ablock, &bl_N,
+          &bl_info);
+
+      /* column norms while the block is still in cache */
+      for(idx_t i=0; i < nrows; ++i) {
+        val_t const * const restrict arow = ablock + (i * R);
+        if(which == MAT_NORM_2) {
+          for(idx_t j=0; j < R; ++j) {
+            mynorms[j] += arow[j] * arow[j];
+          }
+        } else {
+          for(idx_t j=0; j < R; ++j) {
+            mynorms[j] = SS_MAX(mynorms[j], arow[j]);
+          }
+        }
+      }
+
+      /* Gram contribution, same triangle as mat_aTa() */
+      char trans = 'N';
+      val_t alpha = 1.;
+      val_t beta = 1.;
+      SPLATT_BLAS(syrk)(&bl_uplo, &trans, &bl_N, &nrhs, &alpha, ablock, &bl_N,
+          &beta, mygram, &bl_N);
+    }
+
+    /* reduce into the first thread's partials */
+    #pragma omp for schedule(static)
+    for(idx_t x=0; x < R + (R * R); ++x) {
+      val_t v = parts[0][x];
+      for(idx_t t=1; t < nthreads; ++t) {
+        if(x < R && which == MAT_NORM_MAX) {
+          v = SS_MAX(v, parts[t][x]);
+        } else {
+          v += parts[t][x];
+        }
+      }
+      parts[0][x] = v;
+    }
+  }
+  val_t * const restrict partials = parts[0];
+
+  /* lambda and the column scaling, which overwrites the norms */
+  val_t * const restrict scale = partials;
+  #pragma omp single
+  {
+#ifdef SPLATT_USE_MPI
+    timer_start(&timers[TIMER_MPI_COMM]);
+    MPI_Allreduce(MPI_IN_PLACE, partials, R, SPLATT_MPI_VAL,
+        (which == MAT_NORM_2) ? MPI_SUM : MPI_MAX, rinfo->comm_3d);
+    MPI_Allreduce(MPI_IN_PLACE, partials + R, R * R, SPLATT_MPI_VAL, MPI_SUM,
+        rinfo->comm_3d);
+    timer_stop(&timers[TIMER_MPI_COMM]);
+#endif
+
+    for(idx_t j=0; j < R; ++j) {
+      if(which == MAT_NORM_2) {
+        lambda[j] = sqrt(partials[j]);
+      } else {
+        lambda[j] = SS_MAX(partials[j], 1.);
+      }
+      scale[j] = (lambda[j] > 0.) ? 1. / lambda[j] : 1.;
+    }
+
+    /* the Gram matrix of the normalized factor */
+    val_t const * const restrict pgram = partials + R;
+    val_t * const restrict gram = aTa[mode]->vals;
+    for(idx_t i=0; i < R; ++i) {
+      for(idx_t j=i; j < R; ++j) {
+        gram[j + (i*R)] = pgram[j + (i*R)] * scale[i] * scale[j];
+      }
+    }
+  }
+
+  #pragma omp for schedule(static)
+  for(idx_t i=0; i < I; ++i) {
+    for(idx_t j=0; j < R; ++j) {
+      av[j + (i*R)] *= scale[j];
+    }
+  }
+
+  thd_arena_release(thds + tid, mark);
+  #pragma omp master
+  timer_stop(&timers[TIMER_INV]);
+}
+
+
+
+void mat_form_gram(
+  matrix_t * const neq_matrix,
+  matrix_t * * aTa,
+  idx_t const mode,
+  idx_t const nmodes)
+{
+  p_form_gram(neq_matrix, aTa, mode, nmodes, NULL, 0.);
+}
+
+
 
 void calc_gram_inv(
   idx_t const mode,
@@ -644,8 +887,20 @@ matrix_t * mat_alloc(
   matrix_t * mat = (matrix_t *) splatt_malloc(sizeof(matrix_t));
   mat->I = nrows;
   mat->J = ncols;
-  mat->vals = (val_t *) splatt_malloc(nrows * ncols * sizeof(val_t));
+  mat->vals = (val_t *) splatt_malloc_tag(nrows * ncols * sizeof(val_t),
+      SPLATT_MEM_MATRIX);
   mat->rowmajor = 1;
+
+  /* Spread the pages of large matrices over the memory nodes with a static
+   * row partition, which is how the row-parallel kernels walk them. */
+  if(nrows * ncols * sizeof(val_t) >= MAT_FIRSTTOUCH_BYTES) {
+    val_t * const restrict vals = mat->vals;
+    #pragma omp parallel for schedule(static)
+    for(idx_t i=0; i < nrows; ++i) {
+      memset(vals + (i * ncols), 0, ncols * sizeof(val_t));
+    }
+  }
+
   return mat;
 }
 
@@ -664,8 +919,8 @@ matrix_t * mat_rand(
 void mat_free(
   matrix_t * mat)
 {
-  free(mat->vals);
-  free(mat);
+  splatt_free(mat->vals);
+  splatt_free(mat);
 }
 
 matrix_t * mat_mkrow(
@@ -730,9 +985,72 @@ spmatrix_t * spmat_alloc(
 void spmat_free(
   spmatrix_t * mat)
 {
-  free(mat->rowptr);
-  free(mat->colind);
-  free(mat->vals);
-  free(mat);
+  splatt_free(mat->rowptr);
+  splatt_free(mat->colind);
+  splatt_free(mat->vals);
+  splatt_free(mat);
+}
+
+
+void spmat_matmul(
+  spmatrix_t const * const A,
+  matrix_t const * const B,
+  matrix_t * const C)
+{
+  idx_t const J = B->J;
+  idx_t const * const restrict rowptr = A->rowptr;
+  idx_t const * const restrict colind = A->colind;
+  val_t const * const restrict avals = A->vals;
+  val_t const * const restrict bv = B->vals;
+  val_t * const restrict cv = C->vals;
+
+  /* rows are independent; the nonzeros per row can vary a lot */
+  #pragma omp parallel for schedule(dynamic, 16)
+  for(idx_t i=0; i < A->I; ++i) {
+    val_t * const restrict crow = cv + (i * J);
+    for(idx_t j=0; j < J; ++j) {
+      crow[j] = 0.;
+    }
+    for(idx_t x=rowptr[i]; x < rowptr[i+1]; ++x) {
+      val_t const v = avals[x];
+      val_t const * const restrict brow = bv + (colind[x] * J);
+      for(idx_t j=0; j < J; ++j) {
+        crow[j] += v * brow[j];
+      }
+    }
+  }
 }
 
+
+spmatrix_t * spmat_transpose(
+  spmatrix_t const * const A)
+{
+  spmatrix_t * At = spmat_alloc(A->J, A->I, A->nnz);
+  idx_t * const restrict rowptr = At->rowptr;
+
+  /* count the nonzeros of each column */
+  memset(rowptr, 0, (A->J + 1) * sizeof(*rowptr));
+  for(idx_t x=0; x < A->nnz; ++x) {
+    ++rowptr[A->colind[x] + 1];
+  }
+  for(idx_t j=0; j < A->J; ++j) {
+    rowptr[j+1] += rowptr[j];
+  }
+
+  /* scatter, using rowptr[j] as the next free slot of row j */
+  for(idx_t i=0; i < A->I; ++i) {
+    for(idx_t x=A->rowptr[i]; x < A->rowptr[i+1]; ++x) {
+      idx_t const dest = rowptr[A->colind[x]]++;
+      At->colind[dest] = i;
+      At->vals[dest] = A->vals[x];
+    }
+  }
+
+  /* shift the row pointers back */
+  for(idx_t j=A->J; j > 0; --j) {
+    rowptr[j] = rowptr[j-1];
+  }
+  rowptr[0] = 0;
+
+  return At;
+}
@@ -139,6 +139,47 @@ void mat_solve_normals(
   matrix_t * rhs,
   val_t const reg);
 
+
+#define mat_solve_normals_coupled splatt_mat_solve_normals_coupled
+/**
+* @brief Solve the normal equations of a factor which is shared with coupled
+*        matrices: (BtB * CtC * ... + extra) X = rhs, where * is the Hadamard
+*        product. This is mat_solve_normals() with an additive term.
+*
+* @param mode Which mode we are operating on (it is not used in the product).
+* @param nmodes The number of modes in the tensor.
+* @param aTa An array of matrices (length MAX_NMODES) containing BtB, CtC, etc.
+*            aTa[MAX_NMODES] is used as workspace.
+* @param extra The sum of the Gram matrices of the coupled factors, stored like
+*              aTa (upper triangle). NULL adds nothing.
+* @param rhs [IN/OUT] The right-hand side, overwritten with the solution.
+* @param reg Regularization parameter (added to the diagonal).
+*/
+void mat_solve_normals_coupled(
+  idx_t const mode,
+  idx_t const nmodes,
+  matrix_t * * aTa,
+  matrix_t const * const extra,
+  matrix_t * rhs,
+  val_t const reg);
+
+
+#define mat_form_gram splatt_mat_form_gram
+/**
+* @brief Form the Gram matrix of the CPD, (BtB * CtC * ...), where * is the
+*        Hadamard product. The full (symmetric) matrix is stored.
+*
+* @param[out] neq_matrix The matrix to fill.
+* @param aTa An array of matrices (length MAX_NMODES) containing BtB, CtC, etc.
+* @param mode Which mode we are operating on (it is not used in the product).
+* @param nmodes The number of modes in the tensor.
+*/
+void mat_form_gram(
+  matrix_t * const neq_matrix,
+  matrix_t * * aTa,
+  idx_t const mode,
+  idx_t const nmodes);
+
 #define mat_normalize splatt_mat_normalize
 /**
 * @brief Normalize the columns of A and return the norms in lambda.
@@ -159,6 +200,65 @@ void mat_normalize(
   idx_t const nthreads);
 
 
+#define mat_fused_update splatt_mat_fused_update
+/**
+* @brief Compute the unconstrained ALS update of a factor, normalize it, and
+*        update its Gram matrix. This is equivalent to copying 'rhs' into 'A'
+*        and calling mat_solve_normals(), mat_normalize(), and mat_aTa(), but
+*        makes one pass over blocks of rows which stay in cache: each block is
+*        solved and its column norms and Gram contribution are accumulated
+*        before moving on. A second, light pass applies the column scaling.
+*
+*        If the normal equations are not SPD we fall back to the unfused
+*        sequence.
+*
+* @param mode The mode we are updating.
+* @param nmodes The number of modes in the tensor.
+* @param aTa The A^T * A matrices. aTa[mode] is updated and aTa[MAX_NMODES] is
+*            used as workspace.
+* @param rhs The MTTKRP result for this mode.
+* @param[out] A The updated factor.
+* @param[out] lambda The column norms of the update.
+* @param which Which norm to use.
+* @param reg Regularization parameter (added to the diagonal).
+* @param rinfo MPI rank information.
+* @param thds Data structure for thread scratch space.
+* @param nthreads The number of threads to use.
+*/
+void mat_fused_update(
+  idx_t const mode,
+  idx_t const nmodes,
+  matrix_t * * aTa,
+  matrix_t const * const rhs,
+  matrix_t * const A,
+  val_t * const restrict lambda,
+  splatt_mat_norm const which,
+  val_t const reg,
+  rank_info * const rinfo,
+  thd_info * const thds,
+  idx_t const nthreads);
+
+
+#define mat_fused_update_team splatt_mat_fused_update_team
+/**
+* @brief The body of mat_fused_update(), for callers which are already inside
+*        a parallel region. It must be called by every thread of the team, and
+*        the team's size takes the place of 'nthreads'. Results are visible to
+*        every thread on return.
+*/
+void mat_fused_update_team(
+  idx_t const mode,
+  idx_t const nmodes,
+  matrix_t * * aTa,
+  matrix_t const * const rhs,
+  matrix_t * const A,
+  val_t * const restrict lambda,
+  splatt_mat_norm const which,
+  val_t const reg,
+  rank_info * const rinfo,
+  thd_info * const thds);
+
+
 #define mat_rand splatt_mat_rand
 /**
 * @brief Return a randomly initialized matrix (from util's rand_val()).
@@ -227,6 +327,33 @@ void spmat_free(
   spmatrix_t * mat);
 
 
+#define spmat_matmul splatt_spmat_matmul
+/**
+* @brief Sparse-dense matrix multiplication, C = AB. Rows of C are computed in
+*        parallel.
+*
+* @param A The sparse (CSR) matrix.
+* @param B The dense, row-major matrix, with A->J rows.
+* @param[out] C The dense, row-major result, with A->I rows. C is overwritten.
+*/
+void spmat_matmul(
+  spmatrix_t const * const A,
+  matrix_t const * const B,
+  matrix_t * const C);
+
+
+#define spmat_transpose splatt_spmat_transpose
+/**
+* @brief Transpose a sparse matrix. Column indices of the result are sorted.
+*
+* @param A The matrix to transpose.
+*
+* @return A^T, which must be freed with spmat_free().
+*/
+spmatrix_t * spmat_transpose(
+  spmatrix_t const * const A);
+
+
 #define mat_mkrow splatt_mat_mkrow
 /**
 * @brief Copies a column-major matrix and returns a row-major version.
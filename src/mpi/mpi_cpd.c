@@ -631,17 +631,18 @@ double mpi_cpd_als_iterate(
   val_t * const lambda,
   idx_t const nfactors,
   rank_info * const rinfo,
-  double const * const opts)
+  double const * const opts,
+  cpd_checkpoint * const chkpt)
 {
   idx_t const nmodes = tensors[0].nmodes;
   idx_t const nthreads = (idx_t) opts[SPLATT_OPTION_NTHREADS];
 
-  /* Setup thread structures. + 64 bytes is to avoid false sharing. */
+  /* Setup thread structures. */
   splatt_omp_set_num_threads(nthreads);
   thd_info * thds =  thd_init(nthreads, 3,
-    (nfactors * nfactors * sizeof(val_t)) + 64,
-    (TILE_SIZES[0] * nfactors * sizeof(val_t)) + 64,
-    (nmodes * nfactors * sizeof(val_t)) + 64);
+    (nfactors * nfactors * sizeof(val_t)),
+    (TILE_SIZES[0] * nfactors * sizeof(val_t)),
+    (nmodes * nfactors * sizeof(val_t)));
 
   matrix_t * m1 = mats[MAX_NMODES];
 
@@ -692,6 +693,14 @@ double mpi_cpd_als_iterate(
   val_t ttnormsq = 0;
   MPI_Allreduce(&mynorm, &ttnormsq, 1, SPLATT_MPI_VAL, MPI_SUM, rinfo->comm_3d);
 
+  /* resume from a checkpoint? */
+  idx_t first_it = 0;
+  if(chkpt != NULL) {
+    first_it = chkpt->start_it;
+    oldfit = chkpt->start_fit;
+    fit = chkpt->start_fit;
+  }
+
   /* setup timers */
   p_reset_cpd_timers(rinfo);
   sp_timer_t itertime;
@@ -699,7 +708,7 @@ double mpi_cpd_als_iterate(
   timer_start(&timers[TIMER_CPD]);
 
   idx_t const niters = (idx_t) opts[SPLATT_OPTION_NITER];
-  for(idx_t it=0; it < niters; ++it) {
+  for(idx_t it=first_it; it < niters; ++it) {
     timer_fstart(&itertime);
     for(idx_t m=0; m < nmodes; ++m) {
       timer_fstart(&modetime[m]);
@@ -761,12 +770,24 @@ double mpi_cpd_als_iterate(
         }
       }
     }
+
+    /* Every rank writes its own rows. Time-based checkpoints are decided by
+     * the root so that all shards describe the same iteration. */
+    if(chkpt != NULL) {
+      int due = chkpt_due(chkpt, it+1);
+      MPI_Bcast(&due, 1, MPI_INT, 0, rinfo->comm_3d);
+      if(due) {
+        chkpt_write(chkpt, nmodes, globmats, lambda, it+1, fit);
+      }
+    }
+
     if(it > 0 && fabs(fit - oldfit) < opts[SPLATT_OPTION_TOLERANCE]) {
       break;
     }
     oldfit = fit;
   }
   timer_stop(&timers[TIMER_CPD]);
+  chkpt_wait(chkpt);
 
   if(rinfo->rank == 0 &&
       opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_NONE) {
@@ -782,7 +803,7 @@ double mpi_cpd_als_iterate(
       lambda[f] *= tmp[f];
     }
   }
-  free(tmp);
+  splatt_free(tmp);
 
   /* CLEAN UP */
   splatt_mttkrp_free_ws(mttkrp_ws);
@@ -795,8 +816,8 @@ double mpi_cpd_als_iterate(
   if(rinfo->decomp != SPLATT_DECOMP_COARSE) {
     mat_free(m1ptr);
   }
-  free(local2nbr_buf);
-  free(nbr2globs_buf);
+  splatt_free(local2nbr_buf);
+  splatt_free(nbr2globs_buf);
 
   mpi_time_stats(rinfo);
 
@@ -59,7 +59,7 @@ int splatt_mpi_coord_load(
     (*inds)[m] = tt->ind[m];
   }
 
-  free(tt);
+  splatt_free(tt);
 
   return SPLATT_SUCCESS;
 }
@@ -494,7 +494,7 @@ static sptensor_t * p_rearrange_fine(
 
   sptensor_t * tt = mpi_rearrange_by_part(ttbuf, parts, rinfo->comm_3d);
 
-  free(parts);
+  splatt_free(parts);
   return tt;
 }
 
@@ -570,7 +570,7 @@ static void p_get_best_mpi_dim(
     rinfo->dims_3d[furthest] *= primes[p];
   }
 
-  free(primes);
+  splatt_free(primes);
 }
 
 
@@ -1014,8 +1014,8 @@ void mpi_write_mats(
 
   if(rinfo->rank == 0) {
     mat_free(matbuf);
-    free(vbuf);
-    free(loc_iperm);
+    splatt_free(vbuf);
+    splatt_free(loc_iperm);
   }
 }
 
@@ -358,8 +358,8 @@ static void p_distribute_u3_rows(
     }
   }
 
-  free(bufclaims);
-  free(myclaims);
+  splatt_free(bufclaims);
+  splatt_free(myclaims);
   free(claimed);
 
   MPI_Barrier(comm);
@@ -539,12 +539,12 @@ static void p_greedy_mat_distribution(
     rinfo->mat_end[m] = SS_MIN(rinfo->mat_start[m] + nrows, layerdim);
 
     free(inds);
-    free(pvols);
+    splatt_free(pvols);
     MPI_Barrier(rinfo->layer_comm[m]);
   } /* foreach mode */
 
-  free(pcount);
-  free(mine);
+  splatt_free(pcount);
+  splatt_free(mine);
 }
 
 
@@ -131,7 +131,7 @@ static void p_fill_ineed_inds(
                 comm);
 
   /* we don't need nbr2local_inds anymore */
-  free(rinfo->nbr2local_inds[m]);
+  splatt_free(rinfo->nbr2local_inds[m]);
   rinfo->nbr2local_inds[m] = NULL;
 
   /* sanity check on nbr2globs_inds */
@@ -292,9 +292,9 @@ void rank_free(
   rank_info rinfo,
   idx_t const nmodes)
 {
-  free(rinfo.stats);
-  free(rinfo.send_reqs);
-  free(rinfo.recv_reqs);
+  splatt_free(rinfo.stats);
+  splatt_free(rinfo.send_reqs);
+  splatt_free(rinfo.recv_reqs);
 
   switch(rinfo.decomp) {
   case SPLATT_DECOMP_COARSE:
@@ -304,17 +304,17 @@ void rank_free(
     for(idx_t m=0; m < nmodes; ++m) {
       MPI_Comm_free(&rinfo.layer_comm[m]);
       free(rinfo.mat_ptrs[m]);
-      free(rinfo.layer_ptrs[m]);
+      splatt_free(rinfo.layer_ptrs[m]);
 
       /* send/recv structures */
-      free(rinfo.nbr2globs_inds[m]);
-      free(rinfo.local2nbr_inds[m]);
-      free(rinfo.nbr2local_inds[m]);
+      splatt_free(rinfo.nbr2globs_inds[m]);
+      splatt_free(rinfo.local2nbr_inds[m]);
+      splatt_free(rinfo.nbr2local_inds[m]);
       free(rinfo.local2nbr_ptr[m]);
-      free(rinfo.nbr2globs_ptr[m]);
-      free(rinfo.local2nbr_disp[m]);
-      free(rinfo.nbr2globs_disp[m]);
-      free(rinfo.indmap[m]);
+      splatt_free(rinfo.nbr2globs_ptr[m]);
+      splatt_free(rinfo.local2nbr_disp[m]);
+      splatt_free(rinfo.nbr2globs_disp[m]);
+      splatt_free(rinfo.indmap[m]);
     }
     break;
   case SPLATT_DECOMP_FINE:
@@ -11,8 +11,9 @@
 #include "mutex_pool.h"
 
 
-/* XXX: this is a memory leak until cpd_ws is added/freed. */
-static mutex_pool * pool = NULL;
+/* XXX: this is a memory leak until cpd_ws is added/freed. Only
+ * mttkrp_stream() uses it; CSF kernels use the pool in their workspace. */
+static mutex_pool * stream_pool = NULL;
 
 
 
@@ -28,6 +29,7 @@ static mutex_pool * pool = NULL;
 *                  to threads. Use the thread ID to decide which slices to
 *                  process. This may be NULL, in that case simply process all
 *                  slices.
+* @param ws MTTKRP workspace, which holds the sparsity of the factors.
 */
 typedef void (* csf_mttkrp_func)(
     splatt_csf const * const ct,
@@ -35,7 +37,8 @@ typedef void (* csf_mttkrp_func)(
     matrix_t ** mats,
     idx_t const mode,
     thd_info * const thds,
-    idx_t const * const partition);
+    idx_t const * const partition,
+    splatt_mttkrp_ws const * const ws);
 
 
 
@@ -91,6 +94,7 @@ static void p_reduce_privatized(
 /**
 * @brief Map MTTKRP functions onto a (possibly tiled) CSF tensor. This function
 *        will handle any scheduling required with a partially tiled tensor.
+*        It must be called by every thread of the team.
 *
 * @param tensors An array of CSF representations. tensors[csf_id] is processed.
 * @param csf_id Which tensor are we processing?
@@ -118,10 +122,8 @@ static void p_schedule_tiles(
   idx_t const nrows = mats[mode]->I;
   idx_t const ncols = mats[mode]->J;
 
-  /* Store old pointer */
   val_t * const restrict global_output = mats[MAX_NMODES]->vals;
 
-  #pragma omp parallel
   {
     int const tid = splatt_omp_get_thread_num();
     timer_start(&thds[tid].ttime);
@@ -137,8 +139,8 @@ static void p_schedule_tiles(
       mats_priv[m] = mats[m];
     }
     /* each thread gets separate structure, but do a shallow copy */
-    mats_priv[MAX_NMODES] = splatt_malloc(sizeof(**mats_priv));
-    *(mats_priv[MAX_NMODES]) = *(mats[MAX_NMODES]);
+    matrix_t out_priv = *(mats[MAX_NMODES]);
+    mats_priv[MAX_NMODES] = &out_priv;
 
     /* Give each thread its own private buffer and overwrite atomic
      * function. */
@@ -172,7 +174,8 @@ static void p_schedule_tiles(
           tile_id =
               get_next_tileid(TILE_BEGIN, csf->tile_dims, nmodes, mode, t);
           while(tile_id != TILE_END) {
-            nosync_func(csf, tile_id, mats_priv, mode, thds, tree_partition);
+            nosync_func(csf, tile_id, mats_priv, mode, thds, tree_partition,
+                ws);
             tile_id =
               get_next_tileid(tile_id, csf->tile_dims, nmodes, mode, t);
           }
@@ -182,7 +185,8 @@ static void p_schedule_tiles(
       } else {
         for(idx_t tile_id = tile_partition[tid];
                   tile_id < tile_partition[tid+1]; ++tile_id) {
-          atomic_func(csf, tile_id, mats_priv, mode, thds, tree_partition);
+          atomic_func(csf, tile_id, mats_priv, mode, thds, tree_partition,
+                ws);
         }
       }
 
@@ -191,7 +195,7 @@ static void p_schedule_tiles(
      */
     } else {
       assert(tree_partition != NULL);
-      atomic_func(csf, 0, mats_priv, mode, thds, tree_partition);
+      atomic_func(csf, 0, mats_priv, mode, thds, tree_partition, ws);
     }
     timer_stop(&thds[tid].ttime);
 
@@ -200,12 +204,10 @@ static void p_schedule_tiles(
     if(ws->is_privatized[mode]) {
       p_reduce_privatized(ws, global_output, nrows, ncols);
     }
+  }
 
-    splatt_free(mats_priv[MAX_NMODES]);
-  } /* end omp parallel */
-
-  /* restore pointer */
-  mats[MAX_NMODES]->vals = global_output;
+  /* the output is not complete until every thread is done */
+  #pragma omp barrier
 }
 
 
@@ -263,6 +265,7 @@ static inline void p_assign_hada(
 
 
 static inline void p_csf_process_fiber_locked(
+  mutex_pool * const pool,
   val_t * const leafmat,
   val_t const * const restrict accumbuf,
   idx_t const nfactors,
@@ -387,15 +390,341 @@ static inline void p_propagate_up(
 }
 
 
+/**
+* @brief Fetch the non-zero pattern of a factor, if it is sparse and the
+*        pattern is still valid for the factor's values.
+*
+* @param ws MTTKRP workspace.
+* @param mats The factor matrices.
+* @param mode Which factor to check.
+* @param[out] rowptr The row pointer of the pattern.
+* @param[out] colind The column indices of the pattern.
+*
+* @return true if the factor should be treated as sparse.
+*/
+static inline bool p_sparse_pattern(
+    splatt_mttkrp_ws const * const ws,
+    matrix_t ** mats,
+    idx_t const mode,
+    idx_t const ** rowptr,
+    idx_t const ** colind)
+{
+  if(ws == NULL || !ws->is_sparse_factor[mode] ||
+      ws->factor_vals[mode] != mats[mode]->vals) {
+    return false;
+  }
+  *rowptr = ws->factor_rowptr[mode];
+  *colind = ws->factor_colind[mode];
+  return true;
+}
+
+
+/**
+* @brief Root MTTKRP for a 3-mode tensor when the factor at depth 1 is sparse.
+*        Only the non-zero columns of each fiber's row are accumulated, and
+*        fibers whose row is zero are skipped entirely.
+*
+* @param ct The CSF tensor.
+* @param tile_id The tile to process.
+* @param mats The factor matrices, with the output in mats[MAX_NMODES].
+* @param thds Thread structures.
+* @param partition The slice partitioning (may be NULL).
+* @param rowptr The row pointer of the depth-1 factor pattern.
+* @param colind The column indices of the depth-1 factor pattern.
+* @param pool Locks for the output rows, or NULL if they need none.
+*/
+static void p_csf_mttkrp_root3_sparse(
+  splatt_csf const * const ct,
+  idx_t const tile_id,
+  matrix_t ** mats,
+  thd_info * const thds,
+  idx_t const * const restrict partition,
+  idx_t const * const restrict rowptr,
+  idx_t const * const restrict colind,
+  mutex_pool * const pool)
+{
+  val_t const * const vals = ct->pt[tile_id].vals;
+
+  idx_t const * const restrict sptr = ct->pt[tile_id].fptr[0];
+  idx_t const * const restrict fptr = ct->pt[tile_id].fptr[1];
+
+  idx_t const * const restrict sids = ct->pt[tile_id].fids[0];
+  idx_t const * const restrict fids = ct->pt[tile_id].fids[1];
+  idx_t const * const restrict inds = ct->pt[tile_id].fids[2];
+
+  val_t const * const avals = mats[csf_depth_to_mode(ct, 1)]->vals;
+  val_t const * const bvals = mats[csf_depth_to_mode(ct, 2)]->vals;
+  val_t * const ovals = mats[MAX_NMODES]->vals;
+  idx_t const nfactors = mats[MAX_NMODES]->J;
+
+  int const tid = splatt_omp_get_thread_num();
+  val_t * const restrict accumF = (val_t *) thds[tid].scratch[0];
+
+  /* write to output */
+  val_t * const restrict writeF = (val_t *) thds[tid].scratch[2];
+  for(idx_t r=0; r < nfactors; ++r) {
+    writeF[r] = 0.;
+  }
+
+  idx_t const nslices = ct->pt[tile_id].nfibs[0];
+  idx_t const start = (partition != NULL) ? partition[tid]   : 0;
+  idx_t const stop  = (partition != NULL) ? partition[tid+1] : nslices;
+  for(idx_t s=start; s < stop; ++s) {
+    bool found = false;
+
+    /* foreach fiber in slice */
+    for(idx_t f=sptr[s]; f < sptr[s+1]; ++f) {
+      idx_t const * const restrict cols = colind + rowptr[fids[f]];
+      idx_t const ncols = rowptr[fids[f]+1] - rowptr[fids[f]];
+      if(ncols == 0) {
+        continue;
+      }
+      found = true;
+
+      for(idx_t c=0; c < ncols; ++c) {
+        accumF[c] = 0.;
+      }
+
+      /* foreach nnz in fiber */
+      for(idx_t jj=fptr[f]; jj < fptr[f+1]; ++jj) {
+        val_t const v = vals[jj];
+        val_t const * const restrict bv = bvals + (inds[jj] * nfactors);
+        for(idx_t c=0; c < ncols; ++c) {
+          accumF[c] += v * bv[cols[c]];
+        }
+      }
+
+      /* scale inner products by row of A and update to M */
+      val_t const * const restrict av = avals  + (fids[f] * nfactors);
+      for(idx_t c=0; c < ncols; ++c) {
+        writeF[cols[c]] += accumF[c] * av[cols[c]];
+      }
+    } /* foreach fiber */
+
+    if(!found) {
+      continue;
+    }
+
+    idx_t const fid = (sids == NULL) ? s : sids[s];
+    val_t * const restrict mv = ovals + (fid * nfactors);
+
+    /* flush to output */
+    if(pool != NULL) {
+      mutex_set_lock(pool, fid);
+    }
+    for(idx_t r=0; r < nfactors; ++r) {
+      mv[r] += writeF[r];
+      writeF[r] = 0.;
+    }
+    if(pool != NULL) {
+      mutex_unset_lock(pool, fid);
+    }
+  } /* foreach slice (tree) */
+}
+
+
+/**
+* @brief Internal MTTKRP for a 3-mode tensor when the root factor is sparse.
+*        Slices whose root row is zero are skipped entirely.
+*
+* @param ct The CSF tensor.
+* @param tile_id The tile to process.
+* @param mats The factor matrices, with the output in mats[MAX_NMODES].
+* @param thds Thread structures.
+* @param partition The slice partitioning (may be NULL).
+* @param rowptr The row pointer of the root factor pattern.
+* @param colind The column indices of the root factor pattern.
+* @param pool Locks for the output rows, or NULL if they need none.
+*/
+static void p_csf_mttkrp_intl3_sparse(
+  splatt_csf const * const ct,
+  idx_t const tile_id,
+  matrix_t ** mats,
+  thd_info * const thds,
+  idx_t const * const restrict partition,
+  idx_t const * const restrict rowptr,
+  idx_t const * const restrict colind,
+  mutex_pool * const pool)
+{
+  val_t const * const vals = ct->pt[tile_id].vals;
+
+  idx_t const * const restrict sptr = ct->pt[tile_id].fptr[0];
+  idx_t const * const restrict fptr = ct->pt[tile_id].fptr[1];
+
+  idx_t const * const restrict sids = ct->pt[tile_id].fids[0];
+  idx_t const * const restrict fids = ct->pt[tile_id].fids[1];
+  idx_t const * const restrict inds = ct->pt[tile_id].fids[2];
+
+  val_t const * const avals = mats[csf_depth_to_mode(ct, 0)]->vals;
+  val_t const * const bvals = mats[csf_depth_to_mode(ct, 2)]->vals;
+  val_t * const ovals = mats[MAX_NMODES]->vals;
+  idx_t const nfactors = mats[MAX_NMODES]->J;
+
+  int const tid = splatt_omp_get_thread_num();
+  val_t * const restrict accumF = (val_t *) thds[tid].scratch[0];
+
+  idx_t const nslices = ct->pt[tile_id].nfibs[0];
+  idx_t const start = (partition != NULL) ? partition[tid]   : 0;
+  idx_t const stop  = (partition != NULL) ? partition[tid+1] : nslices;
+  for(idx_t s=start; s < stop; ++s) {
+    idx_t const fid = (sids == NULL) ? s : sids[s];
+
+    idx_t const * const restrict cols = colind + rowptr[fid];
+    idx_t const ncols = rowptr[fid+1] - rowptr[fid];
+    if(ncols == 0) {
+      continue;
+    }
+
+    /* root row */
+    val_t const * const restrict rv = avals + (fid * nfactors);
+
+    /* foreach fiber in slice */
+    for(idx_t f=sptr[s]; f < sptr[s+1]; ++f) {
+      for(idx_t c=0; c < ncols; ++c) {
+        accumF[c] = 0.;
+      }
+
+      /* foreach nnz in fiber */
+      for(idx_t jj=fptr[f]; jj < fptr[f+1]; ++jj) {
+        val_t const v = vals[jj];
+        val_t const * const restrict bv = bvals + (inds[jj] * nfactors);
+        for(idx_t c=0; c < ncols; ++c) {
+          accumF[c] += v * bv[cols[c]];
+        }
+      }
+
+      /* write to fiber row */
+      val_t * const restrict ov = ovals  + (fids[f] * nfactors);
+      if(pool != NULL) {
+        mutex_set_lock(pool, fids[f]);
+      }
+      for(idx_t c=0; c < ncols; ++c) {
+        ov[cols[c]] += rv[cols[c]] * accumF[c];
+      }
+      if(pool != NULL) {
+        mutex_unset_lock(pool, fids[f]);
+      }
+    }
+  }
+}
+
+
+/**
+* @brief Leaf MTTKRP for a 3-mode tensor when the root or depth-1 factor is
+*        sparse. The Hadamard product of the two rows is formed only over the
+*        non-zero columns of the sparse factor, and only its non-zeros are
+*        scattered to the output.
+*
+* @param ct The CSF tensor.
+* @param tile_id The tile to process.
+* @param mats The factor matrices, with the output in mats[MAX_NMODES].
+* @param thds Thread structures.
+* @param partition The slice partitioning (may be NULL).
+* @param rowptr The row pointer of the sparse factor's pattern.
+* @param colind The column indices of the sparse factor's pattern.
+* @param sparse_depth Which depth (0 or 1) the sparse factor is at.
+* @param pool Locks for the output rows, or NULL if they need none.
+*/
+static void p_csf_mttkrp_leaf3_sparse(
+  splatt_csf const * const ct,
+  idx_t const tile_id,
+  matrix_t ** mats,
+  thd_info * const thds,
+  idx_t const * const restrict partition,
+  idx_t const * const restrict rowptr,
+  idx_t const * const restrict colind,
+  idx_t const sparse_depth,
+  mutex_pool * const pool)
+{
+  val_t const * const vals = ct->pt[tile_id].vals;
+
+  idx_t const * const restrict sptr = ct->pt[tile_id].fptr[0];
+  idx_t const * const restrict fptr = ct->pt[tile_id].fptr[1];
+
+  idx_t const * const restrict sids = ct->pt[tile_id].fids[0];
+  idx_t const * const restrict fids = ct->pt[tile_id].fids[1];
+  idx_t const * const restrict inds = ct->pt[tile_id].fids[2];
+
+  val_t const * const avals = mats[csf_depth_to_mode(ct, 0)]->vals;
+  val_t const * const bvals = mats[csf_depth_to_mode(ct, 1)]->vals;
+  val_t * const ovals = mats[MAX_NMODES]->vals;
+  idx_t const nfactors = mats[MAX_NMODES]->J;
+
+  int const tid = splatt_omp_get_thread_num();
+  val_t * const restrict accumF = (val_t *) thds[tid].scratch[0];
+  idx_t * const restrict nzcols = (idx_t *) thds[tid].scratch[2];
+
+  idx_t const nslices = ct->pt[tile_id].nfibs[0];
+  idx_t const start = (partition != NULL) ? partition[tid]   : 0;
+  idx_t const stop  = (partition != NULL) ? partition[tid+1] : nslices;
+  for(idx_t s=start; s < stop; ++s) {
+    idx_t const fid = (sids == NULL) ? s : sids[s];
+    if(sparse_depth == 0 && rowptr[fid] == rowptr[fid+1]) {
+      continue;
+    }
+
+    /* root row */
+    val_t const * const restrict rv = avals + (fid * nfactors);
+
+    /* foreach fiber in slice */
+    for(idx_t f=sptr[s]; f < sptr[s+1]; ++f) {
+      idx_t const row = (sparse_depth == 0) ? fid : fids[f];
+      idx_t const * const restrict cols = colind + rowptr[row];
+      idx_t const ncols = rowptr[row+1] - rowptr[row];
+
+      /* fill fiber with the non-zeros of hada */
+      val_t const * const restrict av = bvals  + (fids[f] * nfactors);
+      idx_t nnz = 0;
+      for(idx_t c=0; c < ncols; ++c) {
+        val_t const h = rv[cols[c]] * av[cols[c]];
+        if(h != 0.) {
+          accumF[nnz] = h;
+          nzcols[nnz] = cols[c];
+          ++nnz;
+        }
+      }
+      if(nnz == 0) {
+        continue;
+      }
+
+      /* foreach nnz in fiber, scale with hada and write to ovals */
+      for(idx_t jj=fptr[f]; jj < fptr[f+1]; ++jj) {
+        val_t const v = vals[jj];
+        val_t * const restrict ov = ovals + (inds[jj] * nfactors);
+        if(pool != NULL) {
+          mutex_set_lock(pool, inds[jj]);
+        }
+        for(idx_t c=0; c < nnz; ++c) {
+          ov[nzcols[c]] += v * accumF[c];
+        }
+        if(pool != NULL) {
+          mutex_unset_lock(pool, inds[jj]);
+        }
+      }
+    }
+  }
+}
+
+
 static void p_csf_mttkrp_root3_nolock(
   splatt_csf const * const ct,
   idx_t const tile_id,
   matrix_t ** mats,
   idx_t const mode,
   thd_info * const thds,
-  idx_t const * const restrict partition)
+  idx_t const * const restrict partition,
+  splatt_mttkrp_ws const * const ws)
 {
   assert(ct->nmodes == 3);
+
+  idx_t const * rowptr;
+  idx_t const * colind;
+  if(p_sparse_pattern(ws, mats, csf_depth_to_mode(ct, 1), &rowptr, &colind)) {
+    p_csf_mttkrp_root3_sparse(ct, tile_id, mats, thds, partition, rowptr,
+        colind, NULL);
+    return;
+  }
+
   val_t const * const vals = ct->pt[tile_id].vals;
 
   idx_t const * const restrict sptr = ct->pt[tile_id].fptr[0];
@@ -470,9 +799,20 @@ static void p_csf_mttkrp_root3_locked(
   matrix_t ** mats,
   idx_t const mode,
   thd_info * const thds,
-  idx_t const * const restrict partition)
+  idx_t const * const restrict partition,
+  splatt_mttkrp_ws const * const ws)
 {
+  mutex_pool * const pool = ws->pool;
   assert(ct->nmodes == 3);
+
+  idx_t const * rowptr;
+  idx_t const * colind;
+  if(p_sparse_pattern(ws, mats, csf_depth_to_mode(ct, 1), &rowptr, &colind)) {
+    p_csf_mttkrp_root3_sparse(ct, tile_id, mats, thds, partition, rowptr,
+        colind, pool);
+    return;
+  }
+
   val_t const * const vals = ct->pt[tile_id].vals;
 
   idx_t const * const restrict sptr = ct->pt[tile_id].fptr[0];
@@ -547,9 +887,20 @@ static void p_csf_mttkrp_intl3_locked(
   matrix_t ** mats,
   idx_t const mode,
   thd_info * const thds,
-  idx_t const * const restrict partition)
+  idx_t const * const restrict partition,
+  splatt_mttkrp_ws const * const ws)
 {
+  mutex_pool * const pool = ws->pool;
   assert(ct->nmodes == 3);
+
+  idx_t const * rowptr;
+  idx_t const * colind;
+  if(p_sparse_pattern(ws, mats, csf_depth_to_mode(ct, 0), &rowptr, &colind)) {
+    p_csf_mttkrp_intl3_sparse(ct, tile_id, mats, thds, partition, rowptr,
+        colind, pool);
+    return;
+  }
+
   val_t const * const vals = ct->pt[tile_id].vals;
 
   idx_t const * const restrict sptr = ct->pt[tile_id].fptr[0];
@@ -613,9 +964,25 @@ static void p_csf_mttkrp_leaf3_locked(
   matrix_t ** mats,
   idx_t const mode,
   thd_info * const thds,
-  idx_t const * const restrict partition)
+  idx_t const * const restrict partition,
+  splatt_mttkrp_ws const * const ws)
 {
+  mutex_pool * const pool = ws->pool;
   assert(ct->nmodes == 3);
+
+  idx_t const * rowptr;
+  idx_t const * colind;
+  if(p_sparse_pattern(ws, mats, csf_depth_to_mode(ct, 0), &rowptr, &colind)) {
+    p_csf_mttkrp_leaf3_sparse(ct, tile_id, mats, thds, partition, rowptr,
+        colind, 0, pool);
+    return;
+  }
+  if(p_sparse_pattern(ws, mats, csf_depth_to_mode(ct, 1), &rowptr, &colind)) {
+    p_csf_mttkrp_leaf3_sparse(ct, tile_id, mats, thds, partition, rowptr,
+        colind, 1, pool);
+    return;
+  }
+
   val_t const * const vals = ct->pt[tile_id].vals;
 
   idx_t const * const restrict sptr = ct->pt[tile_id].fptr[0];
@@ -671,8 +1038,10 @@ static void p_csf_mttkrp_root_nolock(
   matrix_t ** mats,
   idx_t const mode,
   thd_info * const thds,
-  idx_t const * const restrict partition)
+  idx_t const * const restrict partition,
+  splatt_mttkrp_ws const * const ws)
 {
+  mutex_pool * const pool = ws->pool;
   /* extract tensor structures */
   idx_t const nmodes = ct->nmodes;
   val_t const * const vals = ct->pt[tile_id].vals;
@@ -683,7 +1052,7 @@ static void p_csf_mttkrp_root_nolock(
   }
 
   if(nmodes == 3) {
-    p_csf_mttkrp_root3_nolock(ct, tile_id, mats, mode, thds, partition);
+    p_csf_mttkrp_root3_nolock(ct, tile_id, mats, mode, thds, partition, ws);
     return;
   }
 
@@ -739,8 +1108,10 @@ static void p_csf_mttkrp_root_locked(
   matrix_t ** mats,
   idx_t const mode,
   thd_info * const thds,
-  idx_t const * const restrict partition)
+  idx_t const * const restrict partition,
+  splatt_mttkrp_ws const * const ws)
 {
+  mutex_pool * const pool = ws->pool;
   /* extract tensor structures */
   idx_t const nmodes = ct->nmodes;
   val_t const * const vals = ct->pt[tile_id].vals;
@@ -751,7 +1122,7 @@ static void p_csf_mttkrp_root_locked(
   }
 
   if(nmodes == 3) {
-    p_csf_mttkrp_root3_locked(ct, tile_id, mats, mode, thds, partition);
+    p_csf_mttkrp_root3_locked(ct, tile_id, mats, mode, thds, partition, ws);
     return;
   }
 
@@ -805,9 +1176,24 @@ static void p_csf_mttkrp_leaf3_nolock(
   matrix_t ** mats,
   idx_t const mode,
   thd_info * const thds,
-  idx_t const * const partition)
+  idx_t const * const partition,
+  splatt_mttkrp_ws const * const ws)
 {
   assert(ct->nmodes == 3);
+
+  idx_t const * rowptr;
+  idx_t const * colind;
+  if(p_sparse_pattern(ws, mats, csf_depth_to_mode(ct, 0), &rowptr, &colind)) {
+    p_csf_mttkrp_leaf3_sparse(ct, tile_id, mats, thds, partition, rowptr,
+        colind, 0, NULL);
+    return;
+  }
+  if(p_sparse_pattern(ws, mats, csf_depth_to_mode(ct, 1), &rowptr, &colind)) {
+    p_csf_mttkrp_leaf3_sparse(ct, tile_id, mats, thds, partition, rowptr,
+        colind, 1, NULL);
+    return;
+  }
+
   val_t const * const vals = ct->pt[tile_id].vals;
 
   idx_t const * const restrict sptr = ct->pt[tile_id].fptr[0];
@@ -863,7 +1249,8 @@ static void p_csf_mttkrp_leaf_nolock(
   matrix_t ** mats,
   idx_t const mode,
   thd_info * const thds,
-  idx_t const * const partition)
+  idx_t const * const partition,
+  splatt_mttkrp_ws const * const ws)
 {
   val_t const * const vals = ct->pt[tile_id].vals;
   idx_t const nmodes = ct->nmodes;
@@ -872,7 +1259,7 @@ static void p_csf_mttkrp_leaf_nolock(
     return;
   }
   if(nmodes == 3) {
-    p_csf_mttkrp_leaf3_nolock(ct, tile_id, mats, mode, thds, partition);
+    p_csf_mttkrp_leaf3_nolock(ct, tile_id, mats, mode, thds, partition, ws);
     return;
   }
 
@@ -949,7 +1336,8 @@ static void p_csf_mttkrp_leaf_locked(
   matrix_t ** mats,
   idx_t const mode,
   thd_info * const thds,
-  idx_t const * const restrict partition)
+  idx_t const * const restrict partition,
+  splatt_mttkrp_ws const * const ws)
 {
   /* extract tensor structures */
   val_t const * const vals = ct->pt[tile_id].vals;
@@ -959,7 +1347,7 @@ static void p_csf_mttkrp_leaf_locked(
     return;
   }
   if(nmodes == 3) {
-    p_csf_mttkrp_leaf3_locked(ct, tile_id, mats, mode, thds, partition);
+    p_csf_mttkrp_leaf3_locked(ct, tile_id, mats, mode, thds, partition, ws);
     return;
   }
 
@@ -1016,8 +1404,8 @@ static void p_csf_mttkrp_leaf_locked(
       /* process all nonzeros [start, end) */
       idx_t const start = fp[depth][idxstack[depth]];
       idx_t const end   = fp[depth][idxstack[depth]+1];
-      p_csf_process_fiber_locked(mats[MAX_NMODES]->vals, buf[depth],
-          nfactors, start, end, fids[depth+1], vals);
+      p_csf_process_fiber_locked(ws->pool, mats[MAX_NMODES]->vals,
+          buf[depth], nfactors, start, end, fids[depth+1], vals);
 
       /* now move back up to the next unprocessed child */
       do {
@@ -1035,9 +1423,19 @@ static void p_csf_mttkrp_intl3_nolock(
   matrix_t ** mats,
   idx_t const mode,
   thd_info * const thds,
-  idx_t const * const partition)
+  idx_t const * const partition,
+  splatt_mttkrp_ws const * const ws)
 {
   assert(ct->nmodes == 3);
+
+  idx_t const * rowptr;
+  idx_t const * colind;
+  if(p_sparse_pattern(ws, mats, csf_depth_to_mode(ct, 0), &rowptr, &colind)) {
+    p_csf_mttkrp_intl3_sparse(ct, tile_id, mats, thds, partition, rowptr,
+        colind, NULL);
+    return;
+  }
+
   val_t const * const vals = ct->pt[tile_id].vals;
 
   idx_t const * const restrict sptr = ct->pt[tile_id].fptr[0];
@@ -1099,7 +1497,8 @@ static void p_csf_mttkrp_intl_nolock(
   matrix_t ** mats,
   idx_t const mode,
   thd_info * const thds,
-  idx_t const * const partition)
+  idx_t const * const partition,
+  splatt_mttkrp_ws const * const ws)
 {
   /* extract tensor structures */
   idx_t const nmodes = ct->nmodes;
@@ -1109,7 +1508,7 @@ static void p_csf_mttkrp_intl_nolock(
     return;
   }
   if(nmodes == 3) {
-    p_csf_mttkrp_intl3_nolock(ct, tile_id, mats, mode, thds, partition);
+    p_csf_mttkrp_intl3_nolock(ct, tile_id, mats, mode, thds, partition, ws);
     return;
   }
 
@@ -1191,8 +1590,10 @@ static void p_csf_mttkrp_intl_locked(
   matrix_t ** mats,
   idx_t const mode,
   thd_info * const thds,
-  idx_t const * const partition)
+  idx_t const * const partition,
+  splatt_mttkrp_ws const * const ws)
 {
+  mutex_pool * const pool = ws->pool;
   /* extract tensor structures */
   idx_t const nmodes = ct->nmodes;
   val_t const * const vals = ct->pt[tile_id].vals;
@@ -1201,7 +1602,7 @@ static void p_csf_mttkrp_intl_locked(
     return;
   }
   if(nmodes == 3) {
-    p_csf_mttkrp_intl3_locked(ct, tile_id, mats, mode, thds, partition);
+    p_csf_mttkrp_intl3_locked(ct, tile_id, mats, mode, thds, partition, ws);
     return;
   }
 
@@ -1295,19 +1696,40 @@ void mttkrp_csf(
   /* ensure we use as many threads as our partitioning supports */
   splatt_omp_set_num_threads(ws->num_threads);
 
-  if(pool == NULL) {
-    pool = mutex_alloc();
+  #pragma omp parallel
+  {
+    mttkrp_csf_team(tensors, mats, mode, thds, ws, opts);
   }
+}
 
-  /* clear output matrix */
+
+void mttkrp_csf_team(
+  splatt_csf const * const tensors,
+  matrix_t ** mats,
+  idx_t const mode,
+  thd_info * const thds,
+  splatt_mttkrp_ws * const ws,
+  double const * const opts)
+{
   matrix_t * const M = mats[MAX_NMODES];
-  M->I = tensors[0].dims[mode];
-  memset(M->vals, 0, M->I * M->J * sizeof(val_t));
+  idx_t const nrows = tensors[0].dims[mode];
+  #pragma omp single nowait
+  {
+    M->I = nrows;
+  }
+
+  /* clear output matrix -- the barrier also publishes the above */
+  idx_t const ncols = M->J;
+  val_t * const restrict mv = M->vals;
+  #pragma omp for schedule(static)
+  for(idx_t i=0; i < nrows; ++i) {
+    memset(mv + (i * ncols), 0, ncols * sizeof(*mv));
+  }
 
   idx_t const nmodes = tensors[0].nmodes;
 
   /* reset thread times */
-  thd_reset(thds, splatt_omp_get_max_threads());
+  timer_reset(&thds[splatt_omp_get_thread_num()].ttime);
 
   /* choose which MTTKRP function to use */
   idx_t const which_csf = ws->mode_csf_map[mode];
@@ -1331,13 +1753,122 @@ void mttkrp_csf(
 
   /* print thread times, if requested */
   if((int)opts[SPLATT_OPTION_VERBOSITY] == SPLATT_VERBOSITY_MAX) {
-    printf("MTTKRP mode %"SPLATT_PF_IDX": ", mode+1);
-    thd_time_stats(thds, splatt_omp_get_max_threads());
-    if(ws->is_privatized[mode]) {
-      printf("  reduction-time: %0.3fs\n", ws->reduction_time);
+    #pragma omp master
+    {
+      printf("MTTKRP mode %"SPLATT_PF_IDX": ", mode+1);
+      thd_time_stats(thds, splatt_omp_get_num_threads());
+      if(ws->is_privatized[mode]) {
+        printf("  reduction-time: %0.3fs\n", ws->reduction_time);
+      }
+    }
+    #pragma omp barrier
+  }
+  timer_reset(&thds[splatt_omp_get_thread_num()].ttime);
+}
+
+
+void mttkrp_invalidate_factor(
+  splatt_mttkrp_ws * const ws,
+  idx_t const mode)
+{
+  ws->is_sparse_factor[mode] = false;
+  ws->factor_vals[mode] = NULL;
+}
+
+
+void mttkrp_refresh_factor(
+  splatt_mttkrp_ws * const ws,
+  matrix_t const * const mat,
+  idx_t const mode)
+{
+  if(ws->sparse_thresh <= 0.) {
+    mttkrp_invalidate_factor(ws, mode);
+    return;
+  }
+
+  #pragma omp parallel
+  {
+    mttkrp_refresh_factor_team(ws, mat, mode);
+  }
+}
+
+
+void mttkrp_refresh_factor_team(
+  splatt_mttkrp_ws * const ws,
+  matrix_t const * const mat,
+  idx_t const mode)
+{
+  if(ws->sparse_thresh <= 0.) {
+    #pragma omp single
+    mttkrp_invalidate_factor(ws, mode);
+    return;
+  }
+
+  idx_t const I = mat->I;
+  idx_t const J = mat->J;
+  val_t const * const restrict vals = mat->vals;
+
+  #pragma omp single
+  {
+    ws->is_sparse_factor[mode] = false;
+    ws->factor_vals[mode] = NULL;
+    if(ws->factor_rowptr_cap[mode] < I+1) {
+      splatt_free(ws->factor_rowptr[mode]);
+      ws->factor_rowptr[mode] = splatt_malloc((I+1) * sizeof(idx_t));
+      ws->factor_rowptr_cap[mode] = I+1;
+    }
+    ws->factor_rowptr[mode][0] = 0;
+  }
+  idx_t * const restrict rowptr = ws->factor_rowptr[mode];
+
+  /* count non-zeros in each row */
+  #pragma omp for schedule(static)
+  for(idx_t i=0; i < I; ++i) {
+    idx_t nnz = 0;
+    for(idx_t j=0; j < J; ++j) {
+      if(vals[j + (i*J)] != 0.) {
+        ++nnz;
+      }
     }
+    rowptr[i+1] = nnz;
+  }
+
+  /* not worth skipping columns */
+  idx_t const max_nnz = (idx_t) (ws->sparse_thresh * (double) (I * J));
+  #pragma omp single
+  {
+    for(idx_t i=0; i < I; ++i) {
+      rowptr[i+1] += rowptr[i];
+    }
+
+    /* the pattern never exceeds max_nnz for this shape, but a reused
+     * workspace may see wider factors than it has room for */
+    if(rowptr[I] <= max_nnz && ws->factor_colind_cap[mode] < max_nnz+1) {
+      splatt_free(ws->factor_colind[mode]);
+      ws->factor_colind[mode] = splatt_malloc((max_nnz+1) * sizeof(idx_t));
+      ws->factor_colind_cap[mode] = max_nnz+1;
+    }
+  }
+  if(rowptr[I] > max_nnz) {
+    return;
+  }
+  idx_t * const restrict colind = ws->factor_colind[mode];
+
+  #pragma omp for schedule(static)
+  for(idx_t i=0; i < I; ++i) {
+    idx_t ptr = rowptr[i];
+    for(idx_t j=0; j < J; ++j) {
+      if(vals[j + (i*J)] != 0.) {
+        colind[ptr++] = j;
+      }
+    }
+  }
+
+  #pragma omp single
+  {
+    ws->is_sparse_factor[mode] = true;
+    ws->factor_vals[mode] = vals;
   }
-  thd_reset(thds, splatt_omp_get_max_threads());
 }
 
 
@@ -1699,8 +2230,12 @@ void mttkrp_stream(
   matrix_t ** mats,
   idx_t const mode)
 {
-  if(pool == NULL) {
-    pool = mutex_alloc();
+  /* concurrent factorizations (e.g., multi-start CPD) may race here */
+  #pragma omp critical (splatt_mttkrp_pool)
+  {
+    if(stream_pool == NULL) {
+      stream_pool = mutex_alloc();
+    }
   }
 
   matrix_t * const M = mats[MAX_NMODES];
@@ -1745,11 +2280,11 @@ void mttkrp_stream(
       /* write to output */
       idx_t const out_ind = tt->ind[mode][n];
       val_t * const restrict outrow = outmat + (tt->ind[mode][n] * nfactors);
-      mutex_set_lock(pool, out_ind);
+      mutex_set_lock(stream_pool, out_ind);
       for(idx_t f=0; f < nfactors; ++f) {
         outrow[f] += accum[f];
       }
-      mutex_unset_lock(pool, out_ind);
+      mutex_unset_lock(stream_pool, out_ind);
     }
 
     splatt_free(accum);
@@ -1785,13 +2320,13 @@ int splatt_mttkrp(
   mats[MAX_NMODES]->rowmajor = 1;
   mats[MAX_NMODES]->vals = matout;
 
-  /* Setup thread structures. + 64 bytes is to avoid false sharing. */
+  /* Setup thread structures. */
   idx_t const nthreads = (idx_t) options[SPLATT_OPTION_NTHREADS];
   splatt_omp_set_num_threads(nthreads);
   thd_info * thds =  thd_init(nthreads, 3,
-    (nmodes * ncolumns * sizeof(val_t)) + 64,
+    (nmodes * ncolumns * sizeof(val_t)),
     0,
-    (nmodes * ncolumns * sizeof(val_t)) + 64);
+    (nmodes * ncolumns * sizeof(val_t)));
 
   splatt_mttkrp_ws * ws = splatt_mttkrp_alloc_ws(tensors, ncolumns, options);
 
@@ -1803,9 +2338,9 @@ int splatt_mttkrp(
   /* cleanup */
   thd_free(thds, nthreads);
   for(idx_t m=0; m < nmodes; ++m) {
-    free(mats[m]);
+    splatt_free(mats[m]);
   }
-  free(mats[MAX_NMODES]);
+  splatt_free(mats[MAX_NMODES]);
 
   return SPLATT_SUCCESS;
 }
@@ -1893,8 +2428,8 @@ splatt_mttkrp_ws * splatt_mttkrp_alloc_ws(
     }
   }
   for(idx_t t=0; t < num_threads; ++t) {
-    ws->privatize_buffer[t] = splatt_malloc(largest_priv_dim * ncolumns *
-        sizeof(**(ws->privatize_buffer)));
+    ws->privatize_buffer[t] = splatt_malloc_tag(largest_priv_dim * ncolumns *
+        sizeof(**(ws->privatize_buffer)), SPLATT_MEM_MTTKRP);
   }
   if(largest_priv_dim > 0 &&
         (int)opts[SPLATT_OPTION_VERBOSITY] == SPLATT_VERBOSITY_MAX) {
@@ -1908,6 +2443,29 @@ splatt_mttkrp_ws * splatt_mttkrp_alloc_ws(
     free(bstr);
   }
 
+  /* locks for the rows of every mode which is not privatized */
+  idx_t maxdim = 0;
+  for(idx_t m=0; m < tensors->nmodes; ++m) {
+    maxdim = SS_MAX(maxdim, tensors->dims[m]);
+  }
+  ws->pool = mutex_alloc_sized((int) maxdim, (int) num_threads);
+
+  /* Factors start dense, see mttkrp_refresh_factor(). Only constrained
+   * factorizations produce exact zeros and only the 3-mode kernels can skip
+   * them, so other workspaces never scan their factors. */
+  bool const constrained = opts[SPLATT_OPTION_NNCPD] ||
+      opts[SPLATT_OPTION_L1] > 0.;
+  ws->sparse_thresh = (constrained && tensors->nmodes == 3) ?
+      opts[SPLATT_OPTION_SPFACTOR] : 0.;
+  for(idx_t m=0; m < MAX_NMODES; ++m) {
+    ws->is_sparse_factor[m] = false;
+    ws->factor_rowptr[m] = NULL;
+    ws->factor_colind[m] = NULL;
+    ws->factor_rowptr_cap[m] = 0;
+    ws->factor_colind_cap[m] = 0;
+    ws->factor_vals[m] = NULL;
+  }
+
   return ws;
 }
 
@@ -1919,11 +2477,17 @@ void splatt_mttkrp_free_ws(
     splatt_free(ws->privatize_buffer[t]);
   }
   splatt_free(ws->privatize_buffer);
+  mutex_free(ws->pool);
 
   for(idx_t c=0; c < ws->num_csf; ++c) {
     splatt_free(ws->tile_partition[c]);
     splatt_free(ws->tree_partition[c]);
   }
+
+  for(idx_t m=0; m < MAX_NMODES; ++m) {
+    splatt_free(ws->factor_rowptr[m]);
+    splatt_free(ws->factor_colind[m]);
+  }
   splatt_free(ws);
 }
 
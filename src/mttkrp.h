@@ -41,6 +41,86 @@ void mttkrp_csf(
   double const * const opts);
 
 
+#define mttkrp_csf_team splatt_mttkrp_csf_team
+/**
+* @brief The body of mttkrp_csf(), for callers which are already inside a
+*        parallel region. It must be called by every thread of a team of
+*        ws->num_threads threads, and the output is complete for every thread
+*        on return.
+*
+* @param tensors The CSF tensor(s) to factor.
+* @param mats The output and input matrices.
+* @param mode Which mode we are computing for.
+* @param thds Thread structures.
+* @param ws MTTKRP workspace.
+* @param opts SPLATT options.
+*/
+void mttkrp_csf_team(
+  splatt_csf const * const tensors,
+  matrix_t ** mats,
+  idx_t const mode,
+  thd_info * const thds,
+  splatt_mttkrp_ws * const ws,
+  double const * const opts);
+
+
+#define mttkrp_refresh_factor splatt_mttkrp_refresh_factor
+/**
+* @brief Update the non-zero pattern of a factor matrix after it has changed.
+*        If the density of the factor is below ws->sparse_thresh, its pattern
+*        is stored in the workspace and the 3-mode CSF kernels will skip its
+*        zero columns. Otherwise, the factor is treated as dense.
+*
+*        The pattern is trusted until the next call to this function or to
+*        mttkrp_invalidate_factor() for the same mode. Callers which modify a
+*        factor by any other path must call one of them before the next
+*        MTTKRP. The pattern is also ignored if MTTKRP is given a factor whose
+*        values are not the ones it was built from.
+*
+*        Factors are not scanned at all unless the workspace was allocated
+*        for a constrained (non-negative or L1) factorization of a 3-mode
+*        tensor, as other factors are not expected to have exact zeros.
+*
+* @param ws MTTKRP workspace.
+* @param mat The factor matrix.
+* @param mode Which mode 'mat' is the factor of.
+*/
+void mttkrp_refresh_factor(
+  splatt_mttkrp_ws * const ws,
+  matrix_t const * const mat,
+  idx_t const mode);
+
+
+#define mttkrp_invalidate_factor splatt_mttkrp_invalidate_factor
+/**
+* @brief Forget the non-zero pattern of a factor, which MTTKRP will then treat
+*        as dense until the next mttkrp_refresh_factor(). This is cheaper than
+*        a refresh for factors which are known to be dense.
+*
+* @param ws MTTKRP workspace.
+* @param mode Which factor to forget.
+*/
+void mttkrp_invalidate_factor(
+  splatt_mttkrp_ws * const ws,
+  idx_t const mode);
+
+
+#define mttkrp_refresh_factor_team splatt_mttkrp_refresh_factor_team
+/**
+* @brief The body of mttkrp_refresh_factor(), for callers which are already
+*        inside a parallel region. It must be called by every thread of the
+*        team.
+*
+* @param ws MTTKRP workspace.
+* @param mat The factor matrix.
+* @param mode Which mode 'mat' is the factor of.
+*/
+void mttkrp_refresh_factor_team(
+  splatt_mttkrp_ws * const ws,
+  matrix_t const * const mat,
+  idx_t const mode);
+
+
 /******************************************************************************
  * DEPRECATED FUNCTIONS
  *****************************************************************************/
@@ -2,6 +2,85 @@
 
 #include "base.h"
 #include "mutex_pool.h"
+#include "thd_info.h"
+
+
+#ifdef SPLATT_LOCK_STATS
+
+/* threads and locks which are listed individually by mutex_report_stats() */
+#ifndef SPLATT_LOCK_STATS_THREADS
+#define SPLATT_LOCK_STATS_THREADS 256
+#endif
+#ifndef SPLATT_LOCK_STATS_HOTTEST
+#define SPLATT_LOCK_STATS_HOTTEST 5
+#endif
+
+/* counters gathered from freed pools */
+static mutex_stats p_thread_totals[SPLATT_LOCK_STATS_THREADS];
+static int p_max_thread = 0;
+
+static struct
+{
+  mutex_stats stats;
+  int lock;
+  int num_locks;
+} p_hottest[SPLATT_LOCK_STATS_HOTTEST];
+
+
+/**
+* @brief Add the counters in 'src' to 'dest'.
+*/
+static void p_add_stats(
+    mutex_stats * const dest,
+    mutex_stats const * const src)
+{
+  dest->acquires += src->acquires;
+  dest->failed_tries += src->failed_tries;
+  dest->wait_cycles += src->wait_cycles;
+}
+
+
+/**
+* @brief Add the counters of a pool to the global totals. Must be called from
+*        within the 'splatt_mutex_stats' critical section.
+*
+* @param pool The pool to gather from.
+*/
+static void p_gather_stats(
+    mutex_pool const * const pool)
+{
+  for(int t=0; t < pool->num_thread_stats; ++t) {
+    mutex_stats const * const ts = &(pool->thread_stats[t].stats);
+    if(ts->acquires == 0) {
+      continue;
+    }
+    int const slot = t % SPLATT_LOCK_STATS_THREADS;
+    p_add_stats(p_thread_totals + slot, ts);
+    p_max_thread = SS_MAX(p_max_thread, slot + 1);
+  }
+
+  /* keep the locks which were waited on longest, in descending order */
+  for(int l=0; l < pool->num_locks; ++l) {
+    mutex_stats const * const ls = pool->lock_stats + l;
+    if(ls->wait_cycles == 0) {
+      continue;
+    }
+    int slot = SPLATT_LOCK_STATS_HOTTEST;
+    while(slot > 0 && ls->wait_cycles > p_hottest[slot-1].stats.wait_cycles) {
+      if(slot < SPLATT_LOCK_STATS_HOTTEST) {
+        p_hottest[slot] = p_hottest[slot-1];
+      }
+      --slot;
+    }
+    if(slot < SPLATT_LOCK_STATS_HOTTEST) {
+      p_hottest[slot].stats = *ls;
+      p_hottest[slot].lock = l;
+      p_hottest[slot].num_locks = pool->num_locks;
+    }
+  }
+}
+
+#endif
 
 
 
@@ -13,18 +92,28 @@ mutex_pool * mutex_alloc_custom(
 
   pool->num_locks = num_locks;
   pool->pad_size = pad_size;
-  
+
 #ifdef _OPENMP
   pool->locks = splatt_malloc(num_locks * pad_size * sizeof(*pool->locks));
   for(int l=0; l < num_locks; ++l) {
     int const lock = mutex_translate_id(l, num_locks, pad_size);
-    omp_init_lock(pool->locks + lock);
+    pool->locks[lock] = 0;
   }
 
 #else
   pool->locks = NULL;
 #endif
 
+#ifdef SPLATT_LOCK_STATS
+  pool->lock_stats = splatt_malloc(num_locks * sizeof(*pool->lock_stats));
+  memset(pool->lock_stats, 0, num_locks * sizeof(*pool->lock_stats));
+  pool->num_thread_stats = splatt_omp_get_max_threads();
+  pool->thread_stats = splatt_malloc(pool->num_thread_stats *
+      sizeof(*pool->thread_stats));
+  memset(pool->thread_stats, 0, pool->num_thread_stats *
+      sizeof(*pool->thread_stats));
+#endif
+
   return pool;
 }
 
@@ -35,17 +124,65 @@ mutex_pool * mutex_alloc()
 }
 
 
+mutex_pool * mutex_alloc_sized(
+    int const nrows,
+    int const nthreads)
+{
+  int num_locks = SS_MAX(SPLATT_DEFAULT_NLOCKS,
+      nthreads * SPLATT_LOCKS_PER_THREAD);
+  num_locks = SS_MIN(num_locks, SS_MAX(nrows, 1));
+  return mutex_alloc_custom(num_locks, SPLATT_DEFAULT_LOCK_PAD);
+}
+
+
+void mutex_report_stats(void)
+{
+#ifdef SPLATT_LOCK_STATS
+  mutex_stats total = {0, 0, 0};
+  for(int t=0; t < p_max_thread; ++t) {
+    p_add_stats(&total, p_thread_totals + t);
+  }
+  if(total.acquires == 0) {
+    return;
+  }
+
+  printf("\n");
+  printf("Lock contention ------------------------------------------------\n");
+  printf("  ACQUIRES=%llu FAILED-TRIES=%llu WAIT=%llu cycles "
+         "(%0.1f per acquire)\n",
+      total.acquires, total.failed_tries, total.wait_cycles,
+      (double) total.wait_cycles / (double) total.acquires);
+  for(int t=0; t < p_max_thread; ++t) {
+    mutex_stats const * const ts = p_thread_totals + t;
+    printf("  thread %-4d acquires: %-12llu failed: %-12llu wait: %llu\n",
+        t, ts->acquires, ts->failed_tries, ts->wait_cycles);
+  }
+  for(int h=0; h < SPLATT_LOCK_STATS_HOTTEST; ++h) {
+    mutex_stats const * const hs = &(p_hottest[h].stats);
+    if(hs->wait_cycles == 0) {
+      break;
+    }
+    printf("  lock %d/%d acquires: %-12llu failed: %-12llu wait: %llu\n",
+        p_hottest[h].lock, p_hottest[h].num_locks, hs->acquires,
+        hs->failed_tries, hs->wait_cycles);
+  }
+#endif
+}
+
+
 void mutex_free(
     mutex_pool * pool)
 {
-#ifdef _OPENMP
-  for(int l=0; l < pool->num_locks; ++l) {
-    int const lock = mutex_translate_id(l, pool->num_locks, pool->pad_size);
-    omp_destroy_lock(pool->locks + lock);
+#ifdef SPLATT_LOCK_STATS
+  #pragma omp critical (splatt_mutex_stats)
+  {
+    p_gather_stats(pool);
   }
+  splatt_free(pool->lock_stats);
+  splatt_free(pool->thread_stats);
 #endif
 
-  splatt_free(pool->locks);
+  splatt_free((void *) pool->locks);
   splatt_free(pool);
 }
 
@@ -9,6 +9,7 @@
 
 #ifdef _OPENMP
 #include <omp.h>
+#include <sched.h>
 #endif
 
 
@@ -18,20 +19,54 @@
 
 
 /**
-* @brief A pool of mutexes for synchronization.
+* @brief Contention counters, kept for each lock and for each thread when
+*        SPLATT_LOCK_STATS is defined.
 */
 typedef struct
+{
+  /** @brief How many times the lock was taken. */
+  unsigned long long acquires;
+  /** @brief How many atomic attempts found the lock already held. */
+  unsigned long long failed_tries;
+  /** @brief Cycles spent between the first failed attempt and the acquire. */
+  unsigned long long wait_cycles;
+} mutex_stats;
+
+
+/**
+* @brief Per-thread contention counters, padded to a cache line.
+*/
+typedef struct
+{
+  mutex_stats stats;
+  char pad[64 - sizeof(mutex_stats)];
+} mutex_thread_stats;
+
+
+/**
+* @brief A pool of mutexes for synchronization. Each mutex is a
+*        test-and-test-and-set spinlock on its own padded word; updates which
+*        are protected by the pool are only a few flops long, which is far
+*        less than the cost of an omp_lock_t.
+*/
+typedef struct splatt_mutex_pool
 {
   bool initialized;
   int num_locks;
   int pad_size;
 
-#ifdef _OPENMP
-  omp_lock_t * locks;
-#else
+  /** @brief The lock words, pad_size ints apart. NULL without OpenMP. */
   volatile int * locks;
+
+#ifdef SPLATT_LOCK_STATS
+  /** @brief Counters for each lock, which are updated while it is held. */
+  mutex_stats * lock_stats;
+  /** @brief Counters for each thread, indexed by OpenMP thread ID modulo
+   *         num_thread_stats. */
+  int num_thread_stats;
+  mutex_thread_stats * thread_stats;
 #endif
-} mutex_pool; 
+} mutex_pool;
 
 
 #ifndef SPLATT_DEFAULT_NLOCKS
@@ -44,10 +79,48 @@ typedef struct
 #endif
 
 
+/* locks per thread in pools sized by mutex_alloc_sized() */
+#ifndef SPLATT_LOCKS_PER_THREAD
+#define SPLATT_LOCKS_PER_THREAD 256
+#endif
+
+
+/* offset between consecutive blocks of num_locks IDs, see
+ * mutex_translate_id() */
+#ifndef SPLATT_LOCK_SKEW
+#define SPLATT_LOCK_SKEW 97
+#endif
+
+
+/* the longest backoff (in pause instructions) before a waiter yields */
+#ifndef SPLATT_LOCK_MAX_BACKOFF
+#define SPLATT_LOCK_MAX_BACKOFF 1024
+#endif
+
+
 /******************************************************************************
  * PUBLIC FUNCTIONS
  *****************************************************************************/
 
+#ifdef SPLATT_LOCK_STATS
+/**
+* @brief Read a cheap, monotonic cycle counter for timing lock waits.
+*
+* @return The current count.
+*/
+static inline unsigned long long mutex_ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __builtin_ia32_rdtsc();
+#elif defined(_OPENMP)
+  return (unsigned long long) (omp_get_wtime() * 1e9);
+#else
+  return 0;
+#endif
+}
+#endif
+
+
 #define mutex_alloc splatt_mutex_alloc
 /**
 * @brief Allocate a pool of mutexes following SPLATT default values. Defaults
@@ -72,9 +145,38 @@ mutex_pool * mutex_alloc_custom(
     int const pad_size);
 
 
+#define mutex_alloc_sized splatt_mutex_alloc_sized
+/**
+* @brief Allocate a pool of mutexes for protecting 'nrows' rows which are
+*        updated by 'nthreads' threads. The pool grows with the thread count,
+*        and if it is at least as large as 'nrows' then every row gets a lock
+*        of its own. This is the common case for short modes, whose few rows
+*        are the most heavily contended.
+*
+* @param nrows The number of rows (IDs) to protect.
+* @param nthreads The number of threads which will use the pool.
+*
+* @return The allocated mutex pool.
+*/
+mutex_pool * mutex_alloc_sized(
+    int const nrows,
+    int const nthreads);
+
+
+#define mutex_report_stats splatt_mutex_report_stats
+/**
+* @brief Print the lock contention counters of every pool freed so far: the
+*        totals, each thread's share, and the locks which were waited on
+*        longest. This does nothing unless SPLATT_LOCK_STATS is defined.
+*/
+void mutex_report_stats(void);
+
+
 #define mutex_free splatt_mutex_free
 /**
-* @brief Free the memory allocated for a mutex pool.
+* @brief Free the memory allocated for a mutex pool. With SPLATT_LOCK_STATS
+*        defined, its counters are first added to those reported by
+*        mutex_report_stats().
 *
 * @param pool The pool to free.
 */
@@ -84,20 +186,28 @@ void mutex_free(
 
 #define mutex_translate_id splatt_mutex_translate_id
 /**
-* @brief Convert an arbitrary integer ID to a lock ID in a mutex pool.
+* @brief Convert an arbitrary integer ID to a lock ID in a mutex pool. IDs
+*        below 'num_locks' map to distinct locks. Each later block of
+*        'num_locks' IDs is rotated by SPLATT_LOCK_SKEW more than the last, so
+*        that IDs which are a multiple of the pool size apart (e.g., strided
+*        hot rows) do not all collide on one lock as they would with a plain
+*        modulus.
 *
 * @param id An arbitrary integer ID (e.g., matrix row).
 * @param num_locks The size of the mutex pool.
 * @param pad_size The padding between each lock.
 *
-* @return 
+* @return The offset of the lock in the pool.
 */
 static inline int mutex_translate_id(
     int const id,
     int const num_locks,
     int const pad_size)
 {
-  return (id % num_locks) * pad_size;
+  unsigned int const uid = (unsigned int) id;
+  unsigned int const nlocks = (unsigned int) num_locks;
+  unsigned int const block = uid / nlocks;
+  return (int) ((uid + (block * SPLATT_LOCK_SKEW)) % nlocks) * pad_size;
 }
 
 
@@ -108,6 +218,11 @@ static inline int mutex_translate_id(
 *        protect (e.g., a matrix row). The ID is then translated into an actual
 *        lock based on the pool size and padding.
 *
+*        Waiters spin on a plain load and only retry the atomic exchange once
+*        the lock looks free, with exponential backoff between loads. Waiters
+*        yield the processor once the backoff saturates, which bounds the cost
+*        of a lock holder being descheduled.
+*
 * @param pool The pool to use.
 * @param id The ID of the lock.
 */
@@ -117,7 +232,52 @@ static inline void mutex_set_lock(
 {
 #ifdef _OPENMP
   int const lock_id = mutex_translate_id(id, pool->num_locks, pool->pad_size);
-  omp_set_lock(pool->locks + lock_id);
+  volatile int * const lock = pool->locks + lock_id;
+
+#ifdef SPLATT_LOCK_STATS
+  unsigned long long failed_tries = 0;
+  unsigned long long wait_start = 0;
+#endif
+
+  int backoff = 1;
+  while(__atomic_exchange_n(lock, 1, __ATOMIC_ACQUIRE)) {
+#ifdef SPLATT_LOCK_STATS
+    if(failed_tries++ == 0) {
+      wait_start = mutex_ticks();
+    }
+#endif
+    do {
+      if(backoff < SPLATT_LOCK_MAX_BACKOFF) {
+        for(int b=0; b < backoff; ++b) {
+#if defined(__x86_64__) || defined(__i386__)
+          __builtin_ia32_pause();
+#else
+          __asm__ __volatile__("" ::: "memory");
+#endif
+        }
+        backoff *= 2;
+      } else {
+        sched_yield();
+      }
+    } while(__atomic_load_n(lock, __ATOMIC_RELAXED));
+  }
+
+#ifdef SPLATT_LOCK_STATS
+  unsigned long long const waited =
+      (failed_tries > 0) ? mutex_ticks() - wait_start : 0;
+
+  /* we hold the lock, so its counters are ours to update */
+  mutex_stats * const ls = pool->lock_stats + (lock_id / pool->pad_size);
+  ++ls->acquires;
+  ls->failed_tries += failed_tries;
+  ls->wait_cycles += waited;
+
+  mutex_stats * const ts = &(pool->thread_stats[
+      omp_get_thread_num() % pool->num_thread_stats].stats);
+  ++ts->acquires;
+  ts->failed_tries += failed_tries;
+  ts->wait_cycles += waited;
+#endif
 #endif
 }
 
@@ -136,7 +296,7 @@ static inline void mutex_unset_lock(
 {
 #ifdef _OPENMP
   int const lock_id = mutex_translate_id(id, pool->num_locks, pool->pad_size);
-  omp_unset_lock(pool->locks + lock_id);
+  __atomic_store_n(pool->locks + lock_id, 0, __ATOMIC_RELEASE);
 #endif
 }
 
@@ -20,11 +20,29 @@ double * splatt_default_opts(void)
   opts[SPLATT_OPTION_NITER]      = DEFAULT_ITS;
   opts[SPLATT_OPTION_VERBOSITY]  = SPLATT_VERBOSITY_LOW;
   opts[SPLATT_OPTION_NNCPD] = 0;
+  opts[SPLATT_OPTION_LINESEARCH] = 0;
+  opts[SPLATT_OPTION_L1] = 0.;
+  opts[SPLATT_OPTION_NNSOLVER] = SPLATT_NNSOLVER_ADMM;
+  opts[SPLATT_OPTION_LEARNRATE] = 1e-3;
+  opts[SPLATT_OPTION_PPTOL] = 0.;
+  opts[SPLATT_OPTION_INIT] = SPLATT_INIT_RAND;
+
+  /* streaming CPD */
+  opts[SPLATT_OPTION_FORGET] = 1.;
+  opts[SPLATT_OPTION_WINDOW] = 0;
+
+  /* generalized CPD */
+  opts[SPLATT_OPTION_LOSS] = SPLATT_LOSS_GAUSSIAN;
 
   opts[SPLATT_OPTION_CSF_ALLOC] = SPLATT_CSF_TWOMODE;
   opts[SPLATT_OPTION_TILE]      = SPLATT_NOTILE;
 
   opts[SPLATT_OPTION_PRIVTHRESH] = 0.02;
+  opts[SPLATT_OPTION_SPFACTOR] = 0.2;
+
+  /* randomized CPD */
+  opts[SPLATT_OPTION_NSAMPLES] = 0;
+  opts[SPLATT_OPTION_FITFREQ] = 5;
 
   /* Tile one level by default. */
   opts[SPLATT_OPTION_TILELEVEL] = 1;
@@ -50,6 +68,6 @@ double * splatt_default_opts(void)
 void splatt_free_opts(
   double * opts)
 {
-  free(opts);
+  splatt_free(opts);
 }
 
@@ -0,0 +1,430 @@
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "pperturb.h"
+#include "csf.h"
+#include "sptensor.h"
+#include "util.h"
+
+#include <math.h>
+
+
+
+/******************************************************************************
+ * PRIVATE FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief Stable counting sort of 'n' items by key.
+*
+* @param keys The key of each item, indexed by item id.
+* @param dim The keys are in [0, dim).
+* @param in The item ids to sort, or NULL for 0..n-1.
+* @param n The number of items.
+* @param[out] out The sorted item ids.
+* @param[out] ptr Items with key k are out[ptr[k]:ptr[k+1]]. Length dim+1.
+*/
+static void p_counting_sort(
+    idx_t const * const keys,
+    idx_t const dim,
+    idx_t const * const in,
+    idx_t const n,
+    idx_t * const out,
+    idx_t * const ptr)
+{
+  memset(ptr, 0, (dim+1) * sizeof(*ptr));
+  for(idx_t x=0; x < n; ++x) {
+    idx_t const id = (in == NULL) ? x : in[x];
+    ++ptr[1 + keys[id]];
+  }
+  for(idx_t k=0; k < dim; ++k) {
+    ptr[k+1] += ptr[k];
+  }
+
+  idx_t * pos = splatt_malloc(dim * sizeof(*pos));
+  memcpy(pos, ptr, dim * sizeof(*pos));
+  for(idx_t x=0; x < n; ++x) {
+    idx_t const id = (in == NULL) ? x : in[x];
+    out[pos[keys[id]]++] = id;
+  }
+  splatt_free(pos);
+}
+
+
+/**
+* @brief Copy the coordinates and values of a CSF tensor's nonzeros.
+*
+* @param tensor The CSF tensor.
+*
+* @return A coordinate tensor with the same nonzeros.
+*/
+static sptensor_t * p_copy_coords(
+    splatt_csf const * const tensor)
+{
+  sptensor_t * tt = tt_alloc(tensor->nnz, tensor->nmodes);
+  memcpy(tt->dims, tensor->dims, tensor->nmodes * sizeof(*tt->dims));
+
+  idx_t const nmodes = tensor->nmodes;
+  idx_t offset = 0;
+
+  for(idx_t t=0; t < tensor->ntiles; ++t) {
+    csf_sparsity const * const pt = tensor->pt + t;
+    if(pt->vals == NULL) {
+      continue;
+    }
+    idx_t const nnz = pt->nfibs[nmodes-1];
+    memcpy(tt->vals + offset, pt->vals, nnz * sizeof(*tt->vals));
+
+    for(idx_t d=0; d < nmodes; ++d) {
+      idx_t * const ind = tt->ind[csf_depth_to_mode(tensor, d)] + offset;
+
+      /* follow fptr down to the range of nonzeros below each node */
+      for(idx_t f=0; f < pt->nfibs[d]; ++f) {
+        idx_t lo = f;
+        idx_t hi = f+1;
+        for(idx_t e=d; e < nmodes-1; ++e) {
+          lo = pt->fptr[e][lo];
+          hi = pt->fptr[e][hi];
+        }
+        idx_t const fid = (pt->fids[d] == NULL) ? f : pt->fids[d][f];
+        for(idx_t x=lo; x < hi; ++x) {
+          ind[x] = fid;
+        }
+      }
+    }
+    offset += nnz;
+  }
+  return tt;
+}
+
+
+/**
+* @brief Find the distinct index pairs of modes (i,j) and group the nonzeros
+*        by them.
+*
+* @param tt The nonzeros.
+* @param nfactors The rank of the factorization.
+* @param i The first mode.
+* @param j The second mode, j > i.
+* @param[out] pair The pair structure to fill.
+*/
+static void p_pair_pattern(
+    sptensor_t const * const tt,
+    idx_t const nfactors,
+    idx_t const i,
+    idx_t const j,
+    pp_pair * const pair)
+{
+  idx_t const nnz = tt->nnz;
+  idx_t const * const indi = tt->ind[i];
+  idx_t const * const indj = tt->ind[j];
+
+  pair->modes[0] = i;
+  pair->modes[1] = j;
+
+  /* sort nonzeros by (i,j) with two stable passes */
+  idx_t * tmp = splatt_malloc(nnz * sizeof(*tmp));
+  idx_t * perm = splatt_malloc(nnz * sizeof(*perm));
+  idx_t * ptr = splatt_malloc((SS_MAX(tt->dims[i], tt->dims[j])+1) *
+      sizeof(*ptr));
+  p_counting_sort(indj, tt->dims[j], NULL, nnz, tmp, ptr);
+  p_counting_sort(indi, tt->dims[i], tmp, nnz, perm, ptr);
+  splatt_free(tmp);
+
+  /* copy the nonzeros in pair order */
+  pair->nzvals = splatt_malloc(nnz * sizeof(*pair->nzvals));
+  for(idx_t m=0; m < MAX_NMODES; ++m) {
+    pair->nzind[m] = NULL;
+  }
+  for(idx_t m=0; m < tt->nmodes; ++m) {
+    if(m != i && m != j) {
+      pair->nzind[m] = splatt_malloc(nnz * sizeof(**pair->nzind));
+    }
+  }
+  #pragma omp parallel for schedule(static)
+  for(idx_t x=0; x < nnz; ++x) {
+    pair->nzvals[x] = tt->vals[perm[x]];
+    for(idx_t m=0; m < tt->nmodes; ++m) {
+      if(pair->nzind[m] != NULL) {
+        pair->nzind[m][x] = tt->ind[m][perm[x]];
+      }
+    }
+  }
+
+  idx_t npairs = 0;
+  for(idx_t x=0; x < nnz; ++x) {
+    if(x == 0 || indi[perm[x]] != indi[perm[x-1]] ||
+        indj[perm[x]] != indj[perm[x-1]]) {
+      ++npairs;
+    }
+  }
+  pair->npairs = npairs;
+  pair->nzptr = splatt_malloc((npairs+1) * sizeof(*pair->nzptr));
+  pair->ind[0] = splatt_malloc(npairs * sizeof(**pair->ind));
+  pair->ind[1] = splatt_malloc(npairs * sizeof(**pair->ind));
+
+  idx_t p = 0;
+  for(idx_t x=0; x < nnz; ++x) {
+    if(x == 0 || indi[perm[x]] != indi[perm[x-1]] ||
+        indj[perm[x]] != indj[perm[x-1]]) {
+      pair->nzptr[p] = x;
+      pair->ind[0][p] = indi[perm[x]];
+      pair->ind[1][p] = indj[perm[x]];
+      ++p;
+    }
+  }
+  pair->nzptr[npairs] = nnz;
+
+  /* group pairs by each of their two indices */
+  pair->order = splatt_malloc(npairs * sizeof(*pair->order));
+  pair->rowptr[1] = splatt_malloc((tt->dims[j]+1) * sizeof(**pair->rowptr));
+  p_counting_sort(pair->ind[1], tt->dims[j], NULL, npairs, pair->order,
+      pair->rowptr[1]);
+
+  /* already sorted by ind[0], so only the pointer is needed */
+  pair->rowptr[0] = splatt_malloc((tt->dims[i]+1) * sizeof(**pair->rowptr));
+  memset(pair->rowptr[0], 0, (tt->dims[i]+1) * sizeof(**pair->rowptr));
+  for(idx_t q=0; q < npairs; ++q) {
+    ++pair->rowptr[0][1 + pair->ind[0][q]];
+  }
+  for(idx_t r=0; r < tt->dims[i]; ++r) {
+    pair->rowptr[0][r+1] += pair->rowptr[0][r];
+  }
+
+  pair->vals = splatt_malloc(npairs * nfactors * sizeof(*pair->vals));
+  splatt_free(perm);
+  splatt_free(ptr);
+}
+
+
+/**
+* @brief Return the operator of modes a and b, in either order.
+*/
+static inline pp_pair const * p_get_pair(
+    pp_ws const * const ws,
+    idx_t const a,
+    idx_t const b)
+{
+  idx_t const i = SS_MIN(a, b);
+  idx_t const j = SS_MAX(a, b);
+  /* pairs are enumerated (0,1), (0,2), ..., (1,2), ... */
+  idx_t const id = (i * ws->nmodes) - ((i * (i+1)) / 2) + (j - i - 1);
+  return ws->pairs + id;
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+pp_ws * pp_alloc(
+    splatt_csf const * const tensor,
+    idx_t const nfactors)
+{
+  idx_t const nmodes = tensor->nmodes;
+  if(nmodes < 3) {
+    return NULL;
+  }
+
+  pp_ws * ws = splatt_malloc(sizeof(*ws));
+  ws->nmodes = nmodes;
+  ws->nfactors = nfactors;
+  for(idx_t m=0; m < nmodes; ++m) {
+    ws->dims[m] = tensor->dims[m];
+    ws->snap[m] = mat_alloc(tensor->dims[m], nfactors);
+    ws->delta[m] = mat_alloc(tensor->dims[m], nfactors);
+  }
+  sptensor_t * tt = p_copy_coords(tensor);
+
+  ws->npairs = (nmodes * (nmodes-1)) / 2;
+  ws->pairs = splatt_malloc(ws->npairs * sizeof(*ws->pairs));
+  idx_t p = 0;
+  for(idx_t i=0; i < nmodes; ++i) {
+    for(idx_t j=i+1; j < nmodes; ++j) {
+      p_pair_pattern(tt, nfactors, i, j, ws->pairs + p++);
+    }
+  }
+  tt_free(tt);
+
+  return ws;
+}
+
+
+void pp_free(
+    pp_ws * ws)
+{
+  if(ws == NULL) {
+    return;
+  }
+  for(idx_t p=0; p < ws->npairs; ++p) {
+    pp_pair * const pair = ws->pairs + p;
+    splatt_free(pair->ind[0]);
+    splatt_free(pair->ind[1]);
+    splatt_free(pair->nzptr);
+    splatt_free(pair->nzvals);
+    for(idx_t m=0; m < ws->nmodes; ++m) {
+      splatt_free(pair->nzind[m]);
+    }
+    splatt_free(pair->rowptr[0]);
+    splatt_free(pair->rowptr[1]);
+    splatt_free(pair->order);
+    splatt_free(pair->vals);
+  }
+  splatt_free(ws->pairs);
+  for(idx_t m=0; m < ws->nmodes; ++m) {
+    mat_free(ws->snap[m]);
+    mat_free(ws->delta[m]);
+  }
+  splatt_free(ws);
+}
+
+
+void pp_snapshot(
+    pp_ws * const ws,
+    matrix_t ** mats)
+{
+  for(idx_t m=0; m < ws->nmodes; ++m) {
+    idx_t const len = ws->dims[m] * ws->nfactors;
+    par_memcpy(ws->snap[m]->vals, mats[m]->vals, len * sizeof(val_t));
+    memset(ws->delta[m]->vals, 0, len * sizeof(val_t));
+  }
+}
+
+
+void pp_build(
+    pp_ws * const ws,
+    matrix_t ** mats)
+{
+  pp_snapshot(ws, mats);
+
+  idx_t const nmodes = ws->nmodes;
+  idx_t const nfactors = ws->nfactors;
+
+  #pragma omp parallel
+  {
+    val_t * const restrict accum = splatt_malloc(nfactors * sizeof(*accum));
+
+    for(idx_t p=0; p < ws->npairs; ++p) {
+      pp_pair * const pair = ws->pairs + p;
+
+      /* the modes contracted by this operator */
+      idx_t nother = 0;
+      idx_t other[MAX_NMODES];
+      for(idx_t m=0; m < nmodes; ++m) {
+        if(pair->nzind[m] != NULL) {
+          other[nother++] = m;
+        }
+      }
+      idx_t const last = other[nother-1];
+      val_t const * const restrict lastmat = ws->snap[last]->vals;
+
+      #pragma omp for schedule(dynamic, 64) nowait
+      for(idx_t q=0; q < pair->npairs; ++q) {
+        val_t * const restrict out = pair->vals + (q * nfactors);
+        for(idx_t f=0; f < nfactors; ++f) {
+          out[f] = 0.;
+        }
+
+        for(idx_t x=pair->nzptr[q]; x < pair->nzptr[q+1]; ++x) {
+          val_t const v = pair->nzvals[x];
+          val_t const * const restrict lastrow = lastmat +
+              (pair->nzind[last][x] * nfactors);
+
+          /* three-mode tensors contract only one mode */
+          if(nother == 1) {
+            for(idx_t f=0; f < nfactors; ++f) {
+              out[f] += v * lastrow[f];
+            }
+            continue;
+          }
+
+          for(idx_t f=0; f < nfactors; ++f) {
+            accum[f] = v;
+          }
+          for(idx_t o=0; o < nother-1; ++o) {
+            val_t const * const restrict row = ws->snap[other[o]]->vals +
+                (pair->nzind[other[o]][x] * nfactors);
+            for(idx_t f=0; f < nfactors; ++f) {
+              accum[f] *= row[f];
+            }
+          }
+          for(idx_t f=0; f < nfactors; ++f) {
+            out[f] += accum[f] * lastrow[f];
+          }
+        }
+      }
+    }
+
+    splatt_free(accum);
+  } /* end omp parallel */
+}
+
+
+val_t pp_delta(
+    pp_ws * const ws,
+    matrix_t const * const mat,
+    idx_t const mode)
+{
+  idx_t const len = ws->dims[mode] * ws->nfactors;
+  val_t const * const restrict cur = mat->vals;
+  val_t const * const restrict old = ws->snap[mode]->vals;
+  val_t * const restrict dv = ws->delta[mode]->vals;
+
+  double diff = 0.;
+  double norm = 0.;
+  #pragma omp parallel for schedule(static) reduction(+:diff,norm)
+  for(idx_t x=0; x < len; ++x) {
+    dv[x] = cur[x] - old[x];
+    diff += dv[x] * dv[x];
+    norm += cur[x] * cur[x];
+  }
+
+  return (norm > 0.) ? sqrt(diff / norm) : 0.;
+}
+
+
+void pp_mttkrp(
+    pp_ws const * const ws,
+    matrix_t ** mats,
+    idx_t const mode,
+    matrix_t * const out)
+{
+  idx_t const nmodes = ws->nmodes;
+  idx_t const nfactors = ws->nfactors;
+
+  /* one mode contributes its full factor, which adds the exact MTTKRP at the
+   * snapshot; the others contribute only their change */
+  idx_t const full = (mode == 0) ? 1 : 0;
+
+  #pragma omp parallel for schedule(dynamic, 64)
+  for(idx_t i=0; i < ws->dims[mode]; ++i) {
+    val_t * const restrict orow = out->vals + (i * nfactors);
+    for(idx_t f=0; f < nfactors; ++f) {
+      orow[f] = 0.;
+    }
+
+    for(idx_t m=0; m < nmodes; ++m) {
+      if(m == mode) {
+        continue;
+      }
+      pp_pair const * const pair = p_get_pair(ws, m, mode);
+      /* which side of the pair we are accumulating into */
+      idx_t const side = (pair->modes[0] == mode) ? 0 : 1;
+      idx_t const * const other = pair->ind[!side];
+      val_t const * const restrict fvals = (m == full) ?
+          mats[m]->vals : ws->delta[m]->vals;
+
+      for(idx_t x=pair->rowptr[side][i]; x < pair->rowptr[side][i+1]; ++x) {
+        idx_t const q = (side == 0) ? x : pair->order[x];
+        val_t const * const restrict op = pair->vals + (q * nfactors);
+        val_t const * const restrict frow = fvals + (other[q] * nfactors);
+        for(idx_t f=0; f < nfactors; ++f) {
+          orow[f] += op[f] * frow[f];
+        }
+      }
+    }
+  }
+}
+
@@ -0,0 +1,172 @@
+#ifndef SPLATT_PPERTURB_H
+#define SPLATT_PPERTURB_H
+
+#include "base.h"
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "matrix.h"
+
+
+/******************************************************************************
+ * STRUCTURES
+ *****************************************************************************/
+
+/**
+* @brief The pairwise operator of modes (i,j), i < j: the tensor contracted
+*        with every factor except A_i and A_j. It is stored sparsely, with one
+*        row of 'nfactors' values for each distinct (i,j) index pair found
+*        among the nonzeros.
+*/
+typedef struct
+{
+  /** @brief The two modes, modes[0] < modes[1]. */
+  idx_t modes[2];
+
+  /** @brief The number of distinct index pairs. */
+  idx_t npairs;
+
+  /** @brief The index of each pair in modes[0] and modes[1]. Pairs are sorted
+   *         by ind[0] and then ind[1]. */
+  idx_t * ind[2];
+
+  /** @brief A copy of the nonzeros, grouped by pair. The nonzeros of pair p
+   *         are [nzptr[p], nzptr[p+1]). nzind[m] is NULL for the two modes
+   *         of the pair. */
+  idx_t * nzptr;
+  idx_t * nzind[MAX_NMODES];
+  val_t * nzvals;
+
+  /** @brief Pairs with index i in modes[0] are [rowptr[0][i], rowptr[0][i+1]).
+   *         Pairs with index i in modes[1] are the ids stored in
+   *         order[rowptr[1][i]:rowptr[1][i+1]]. */
+  idx_t * rowptr[2];
+  idx_t * order;
+
+  /** @brief The operator, npairs x nfactors and row-major. */
+  val_t * vals;
+} pp_pair;
+
+
+/**
+* @brief Workspace for pairwise perturbation (Ma & Solomonik). Once the factors
+*        are changing slowly, the pairwise operators are built once from a
+*        snapshot of the factors and MTTKRP is approximated to first order in
+*        the change since the snapshot:
+*
+*          M_n ~ sum_{i != n} op(i,n) x_i dA_i + op(i0,n) x_i0 A_i0,
+*
+*        for any fixed i0 != n. Each approximation costs only the number of
+*        index pairs, rather than nonzeros.
+*/
+typedef struct
+{
+  idx_t nmodes;
+  idx_t nfactors;
+  idx_t dims[MAX_NMODES];
+
+  /** @brief One operator for each pair of modes. */
+  idx_t npairs;
+  pp_pair * pairs;
+
+  /** @brief The factors the operators were built from, and the current
+   *         factors minus them. */
+  matrix_t * snap[MAX_NMODES];
+  matrix_t * delta[MAX_NMODES];
+} pp_ws;
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+#define pp_alloc splatt_pp_alloc
+/**
+* @brief Allocate pairwise perturbation workspace and find the sparsity pattern
+*        of every pairwise operator. Each of the nmodes*(nmodes-1)/2 operators
+*        keeps its own copy of the nonzeros, ordered by that pair of modes, so
+*        that they can be built with unit-stride access.
+*
+* @param tensor A CSF representation of the tensor.
+* @param nfactors The rank of the factorization.
+*
+* @return The workspace, or NULL if the tensor has fewer than three modes.
+*/
+pp_ws * pp_alloc(
+    splatt_csf const * const tensor,
+    idx_t const nfactors);
+
+
+#define pp_free splatt_pp_free
+/**
+* @brief Free workspace from pp_alloc().
+*
+* @param ws The workspace to free.
+*/
+void pp_free(
+    pp_ws * ws);
+
+
+#define pp_snapshot splatt_pp_snapshot
+/**
+* @brief Record the current factors. Later calls to pp_delta() measure the
+*        change from this point.
+*
+* @param ws The workspace.
+* @param mats The factor matrices.
+*/
+void pp_snapshot(
+    pp_ws * const ws,
+    matrix_t ** mats);
+
+
+#define pp_build splatt_pp_build
+/**
+* @brief Snapshot the factors and compute every pairwise operator from them.
+*        Each operator costs about as much as one coordinate MTTKRP.
+*
+* @param ws The workspace.
+* @param mats The factor matrices.
+*/
+void pp_build(
+    pp_ws * const ws,
+    matrix_t ** mats);
+
+
+#define pp_delta splatt_pp_delta
+/**
+* @brief Update the change in one factor since the last snapshot.
+*
+* @param ws The workspace.
+* @param mat The current factor.
+* @param mode The mode of the factor.
+*
+* @return The relative change, ||mat - snapshot||_F / ||mat||_F.
+*/
+val_t pp_delta(
+    pp_ws * const ws,
+    matrix_t const * const mat,
+    idx_t const mode);
+
+
+#define pp_mttkrp splatt_pp_mttkrp
+/**
+* @brief Approximate the MTTKRP of 'mode' from the pairwise operators. The
+*        result is exact if no factor has changed since pp_build(), and the
+*        error is second order in the changes otherwise. pp_delta() must be
+*        current for every other mode.
+*
+* @param ws The workspace.
+* @param mats The factor matrices.
+* @param mode The mode to compute.
+* @param[out] out The output matrix, which must have ws->dims[mode] rows.
+*/
+void pp_mttkrp(
+    pp_ws const * const ws,
+    matrix_t ** mats,
+    idx_t const mode,
+    matrix_t * const out);
+
+#endif
@@ -955,7 +955,7 @@ void tt_sort_range(
 
 
   if(dim_perm == NULL) {
-    free(cmplt);
+    splatt_free(cmplt);
   }
   timer_stop(&timers[TIMER_SORT]);
 }
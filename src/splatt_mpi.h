@@ -115,6 +115,7 @@ typedef struct
  *****************************************************************************/
 #include "sptensor.h"
 #include "reorder.h"
+#include "checkpoint.h"
 
 
 
@@ -130,7 +131,8 @@ double mpi_cpd_als_iterate(
   val_t * const lambda,
   idx_t const nfactors,
   rank_info * const rinfo,
-  double const * const opts);
+  double const * const opts,
+  cpd_checkpoint * const chkpt);
 
 
 #define mpi_update_rows splatt_mpi_update_rows
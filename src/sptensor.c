@@ -245,7 +245,7 @@ sptensor_t * tt_alloc(
   tt->tiled = SPLATT_NOTILE;
 
   tt->nnz = nnz;
-  tt->vals = splatt_malloc(nnz * sizeof(*tt->vals));
+  tt->vals = splatt_malloc_tag(nnz * sizeof(*tt->vals), SPLATT_MEM_COORD);
 
   tt->nmodes = nmodes;
   tt->type = (nmodes == 3) ? SPLATT_3MODE : SPLATT_NMODE;
@@ -253,7 +253,7 @@ sptensor_t * tt_alloc(
   tt->dims = splatt_malloc(nmodes * sizeof(*tt->dims));
   tt->ind  = splatt_malloc(nmodes * sizeof(*tt->ind));
   for(idx_t m=0; m < nmodes; ++m) {
-    tt->ind[m] = splatt_malloc(nnz * sizeof(**tt->ind));
+    tt->ind[m] = splatt_malloc_tag(nnz * sizeof(**tt->ind), SPLATT_MEM_COORD);
     tt->indmap[m] = NULL;
   }
 
@@ -9,8 +9,13 @@
 #include "csf.h"
 #include "io.h"
 #include "reorder.h"
+#include "thd_info.h"
 #include "util.h"
 
+#ifdef __linux__
+#include <sched.h>
+#endif
+
 
 /******************************************************************************
  * PRIVATE FUNCTIONS
@@ -159,10 +164,10 @@ static void p_stats_hparts(
 
 
   for(idx_t m=0; m < ft.nmodes; ++m) {
-    free(unique[m]);
+    splatt_free(unique[m]);
   }
-  free(parts);
-  free(plookup);
+  splatt_free(parts);
+  splatt_free(plookup);
   free(pptr);
   ften_free(&ft);
 }
@@ -223,6 +228,53 @@ void stats_csf(
 }
 
 
+/**
+* @brief Print how threads are bound to processors: the OpenMP binding policy
+*        and the CPU that each thread is running on.
+*
+* @param nthreads The number of threads to report.
+*/
+static void p_stats_binding(
+  idx_t const nthreads)
+{
+#ifdef _OPENMP
+  char const * bind = "UNKNOWN";
+  switch(omp_get_proc_bind()) {
+  case omp_proc_bind_false:
+    bind = "NONE";
+    break;
+  case omp_proc_bind_true:
+    bind = "TRUE";
+    break;
+  case omp_proc_bind_master:
+    bind = "MASTER";
+    break;
+  case omp_proc_bind_close:
+    bind = "CLOSE";
+    break;
+  case omp_proc_bind_spread:
+    bind = "SPREAD";
+    break;
+  }
+  printf("BIND=%s PLACES=%d", bind, omp_get_num_places());
+
+#ifdef __linux__
+  int * cpus = splatt_malloc(nthreads * sizeof(*cpus));
+  #pragma omp parallel num_threads(nthreads)
+  {
+    cpus[splatt_omp_get_thread_num()] = sched_getcpu();
+  }
+  printf(" CPUS=");
+  for(idx_t t=0; t < nthreads; ++t) {
+    printf("%s%d", (t > 0) ? "," : "", cpus[t]);
+  }
+  splatt_free(cpus);
+#endif
+  printf("\n");
+#endif
+}
+
+
 void cpd_stats(
   splatt_csf const * const csf,
   idx_t const nfactors,
@@ -247,6 +299,19 @@ void cpd_stats(
   printf("SEED=%d ", (int) opts[SPLATT_OPTION_RANDSEED]);
 
   printf("THREADS=%"SPLATT_PF_IDX" ", (idx_t) opts[SPLATT_OPTION_NTHREADS]);
+  if(opts[SPLATT_OPTION_LINESEARCH]) {
+    printf("LINESEARCH=YES ");
+  }
+  if(opts[SPLATT_OPTION_NNCPD]) {
+    if(opts[SPLATT_OPTION_NNSOLVER] == SPLATT_NNSOLVER_HALS) {
+      printf("NNCPD=HALS ");
+    } else {
+      printf("NNCPD=ADMM ");
+    }
+  }
+  if(opts[SPLATT_OPTION_L1] > 0.) {
+    printf("L1=%0.1e ", opts[SPLATT_OPTION_L1]);
+  }
   printf("\n");
 
   /* CSF allocation */
@@ -285,6 +350,8 @@ void cpd_stats(
   }
   printf("\n");
 
+  p_stats_binding((idx_t) opts[SPLATT_OPTION_NTHREADS]);
+
   char * fstorage = bytes_str(fbytes);
   char * mstorage = bytes_str(mbytes);
   printf("CSF-STORAGE=%s FACTOR-STORAGE=%s", fstorage, mstorage);
@@ -0,0 +1,641 @@
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "stream.h"
+#include "cpd.h"
+#include "csf.h"
+#include "mttkrp.h"
+#include "splatt_lapack.h"
+#include "util.h"
+
+#include <math.h>
+
+
+
+/******************************************************************************
+ * PRIVATE FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief Compute the full (symmetric) Gram matrix A^T A.
+*
+* @param A The matrix, stored row-major.
+* @param[out] gram The R x R result.
+*/
+static void p_full_gram(
+    matrix_t const * const A,
+    matrix_t * const gram)
+{
+  idx_t const R = A->J;
+
+  char uplo = 'L';
+  char trans = 'N'; /* actually A^T * A due to row-major ordering */
+  splatt_blas_int N = (splatt_blas_int) R;
+  splatt_blas_int K = (splatt_blas_int) A->I;
+  val_t alpha = 1.;
+  val_t beta = 0.;
+  if(K > 0) {
+    SPLATT_BLAS(syrk)(&uplo, &trans, &N, &K, &alpha, A->vals, &N, &beta,
+        gram->vals, &N);
+  } else {
+    memset(gram->vals, 0, R * R * sizeof(*gram->vals));
+  }
+
+  /* syrk only filled one triangle */
+  val_t * const restrict gv = gram->vals;
+  for(idx_t i=0; i < R; ++i) {
+    for(idx_t j=0; j < i; ++j) {
+      gv[j + (i*R)] = gv[i + (j*R)];
+    }
+  }
+}
+
+
+/**
+* @brief Compute the Hadamard product of the Gram matrices of every mode except
+*        'skip1' and 'skip2', optionally also with 'extra'.
+*
+* @param stream The streaming state.
+* @param skip1 The first mode to skip.
+* @param skip2 The second mode to skip (may equal 'skip1').
+* @param extra Another R x R matrix to include, or NULL.
+* @param[out] out The R x R result.
+*/
+static void p_hada_grams(
+    stream_cpd const * const stream,
+    idx_t const skip1,
+    idx_t const skip2,
+    matrix_t const * const extra,
+    matrix_t * const out)
+{
+  idx_t const R = stream->rank;
+  val_t * const restrict ov = out->vals;
+  for(idx_t x=0; x < R * R; ++x) {
+    ov[x] = (extra != NULL) ? extra->vals[x] : 1.;
+  }
+  for(idx_t m=0; m < stream->nmodes; ++m) {
+    if(m == skip1 || m == skip2) {
+      continue;
+    }
+    val_t const * const restrict gv = stream->gram[m]->vals;
+    for(idx_t x=0; x < R * R; ++x) {
+      ov[x] *= gv[x];
+    }
+  }
+}
+
+
+/**
+* @brief Overwrite B with B * (Q + reg * I)^-1. Each row of B is a right-hand
+*        side. If Q is numerically singular we add a small ridge until it can
+*        be factored.
+*
+* @param Q The symmetric R x R coefficient matrix.
+* @param reg Regularization added to the diagonal.
+* @param[out] B The right-hand sides, overwritten with the solution.
+*/
+static void p_solve_rows(
+    matrix_t const * const Q,
+    val_t const reg,
+    matrix_t * const B)
+{
+  idx_t const R = Q->I;
+  if(B->I == 0) {
+    return;
+  }
+
+  val_t trace = 0.;
+  for(idx_t r=0; r < R; ++r) {
+    trace += Q->vals[r + (r*R)];
+  }
+  val_t ridge = reg;
+
+  val_t * const chol = splatt_malloc(R * R * sizeof(*chol));
+  char uplo = 'L';
+  splatt_blas_int N = (splatt_blas_int) R;
+  splatt_blas_int nrhs = (splatt_blas_int) B->I;
+  splatt_blas_int info = 1;
+  for(int tries=0; tries < 8 && info != 0; ++tries) {
+    memcpy(chol, Q->vals, R * R * sizeof(*chol));
+    for(idx_t r=0; r < R; ++r) {
+      chol[r + (r*R)] += ridge;
+    }
+    SPLATT_BLAS(potrf)(&uplo, &N, chol, &N, &info);
+    ridge = (ridge > 0.) ? ridge * 10. : 1e-12 * SS_MAX(trace / R, 1e-12);
+  }
+
+  if(info == 0) {
+    SPLATT_BLAS(potrs)(&uplo, &N, &nrhs, chol, &N, B->vals, &N, &info);
+  } else {
+    fprintf(stderr, "SPLATT: streaming statistics are not SPD.\n");
+  }
+  splatt_free(chol);
+}
+
+
+/**
+* @brief Compute an MTTKRP of a batch and copy the result into 'out'.
+*
+* @param csf The batch.
+* @param mats The factors, with mats[MAX_NMODES] as the output buffer.
+* @param mode The mode of the MTTKRP.
+* @param stream The streaming state (for its thread structures and options).
+* @param ws The MTTKRP workspace of the batch.
+* @param[out] out The result, which must have the rows of 'mode'.
+*/
+static void p_batch_mttkrp(
+    splatt_csf const * const csf,
+    matrix_t ** mats,
+    idx_t const mode,
+    stream_cpd const * const stream,
+    splatt_mttkrp_ws * const ws,
+    matrix_t * const out)
+{
+  mttkrp_csf(csf, mats, mode, stream->thds, ws, stream->opts);
+  memcpy(out->vals, mats[MAX_NMODES]->vals,
+      out->I * out->J * sizeof(*out->vals));
+}
+
+
+/**
+* @brief Grow a matrix to 'nrows' rows, with zeros in the new rows.
+*
+* @param mat The matrix to grow.
+* @param nrows The new number of rows.
+*/
+static void p_grow_rows(
+    matrix_t * const mat,
+    idx_t const nrows)
+{
+  if(nrows <= mat->I) {
+    return;
+  }
+  idx_t const J = mat->J;
+  val_t * vals = splatt_malloc(nrows * J * sizeof(*vals));
+  memcpy(vals, mat->vals, mat->I * J * sizeof(*vals));
+  memset(vals + (mat->I * J), 0, (nrows - mat->I) * J * sizeof(*vals));
+  splatt_free(mat->vals);
+  mat->vals = vals;
+  mat->I = nrows;
+}
+
+
+/**
+* @brief Ensure a matrix has room for 'nrows' rows without changing its
+*        dimensions. Capacity doubles so appending rows is amortized O(1).
+*
+* @param mat The matrix.
+* @param capacity [IN/OUT] The number of rows allocated.
+* @param nrows The number of rows needed.
+*/
+static void p_reserve_rows(
+    matrix_t * const mat,
+    idx_t * const capacity,
+    idx_t const nrows)
+{
+  if(nrows <= *capacity) {
+    return;
+  }
+  idx_t const newcap = SS_MAX(nrows, 2 * (*capacity));
+  val_t * vals = splatt_malloc(newcap * mat->J * sizeof(*vals));
+  memcpy(vals, mat->vals, mat->I * mat->J * sizeof(*vals));
+  splatt_free(mat->vals);
+  mat->vals = vals;
+  *capacity = newcap;
+}
+
+
+/**
+* @brief Combine history with a new batch: out = forget * acc + fresh - drop,
+*        where 'drop' is the weighted contribution leaving the window. Rows
+*        beyond the end of 'acc' or 'drop' (from grown modes) are treated as
+*        zero.
+*
+* @param acc The accumulated statistic.
+* @param fresh The new batch's contribution.
+* @param dropped The contribution leaving the window, or NULL.
+* @param forget The forgetting factor.
+* @param dropw The weight of 'dropped'.
+* @param[out] out The combined statistic, the same shape as 'fresh'.
+*/
+static void p_combine(
+    matrix_t const * const acc,
+    matrix_t const * const fresh,
+    matrix_t const * const dropped,
+    double const forget,
+    double const dropw,
+    matrix_t * const out)
+{
+  idx_t const J = fresh->J;
+  idx_t const accvals = acc->I * J;
+  idx_t const dropvals = (dropped != NULL) ? dropped->I * J : 0;
+  val_t * const restrict ov = out->vals;
+
+  #pragma omp parallel for schedule(static)
+  for(idx_t x=0; x < fresh->I * J; ++x) {
+    val_t v = fresh->vals[x];
+    if(x < accvals) {
+      v += forget * acc->vals[x];
+    }
+    if(x < dropvals) {
+      v -= dropw * dropped->vals[x];
+    }
+    ov[x] = v;
+  }
+}
+
+
+/**
+* @brief Store a batch's contribution in the window's history slot.
+*
+* @param stream The streaming state.
+* @param mode The mode of the contribution.
+* @param P The MTTKRP contribution.
+* @param Q The Gram contribution.
+*/
+static void p_remember(
+    stream_cpd * const stream,
+    idx_t const mode,
+    matrix_t const * const P,
+    matrix_t const * const Q)
+{
+  if(stream->window == 0) {
+    return;
+  }
+  idx_t const slot = ((stream->nbatches % stream->window) * stream->nmodes) +
+      mode;
+  if(stream->histP[slot] != NULL) {
+    mat_free(stream->histP[slot]);
+    mat_free(stream->histQ[slot]);
+  }
+  stream->histP[slot] = mat_alloc(P->I, P->J);
+  stream->histQ[slot] = mat_alloc(Q->I, Q->J);
+  memcpy(stream->histP[slot]->vals, P->vals, P->I * P->J * sizeof(val_t));
+  memcpy(stream->histQ[slot]->vals, Q->vals, Q->I * Q->J * sizeof(val_t));
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+stream_cpd * stream_alloc(
+  sptensor_t * const first,
+  idx_t const nfactors,
+  idx_t const time_mode,
+  double const * const opts)
+{
+  idx_t const nmodes = first->nmodes;
+  if(time_mode >= nmodes || nfactors == 0) {
+    fprintf(stderr, "SPLATT ERROR: streaming CPD needs a positive rank and a "
+        "time mode below %"SPLATT_PF_IDX".\n", nmodes);
+    return NULL;
+  }
+  if(first->nnz == 0) {
+    fprintf(stderr, "SPLATT ERROR: the first batch of a stream is empty.\n");
+    return NULL;
+  }
+  double const forget = opts[SPLATT_OPTION_FORGET];
+  if(forget <= 0. || forget > 1.) {
+    fprintf(stderr, "SPLATT ERROR: forgetting factor must be in (0, 1].\n");
+    return NULL;
+  }
+
+  stream_cpd * stream = splatt_malloc(sizeof(*stream));
+  stream->nmodes = nmodes;
+  stream->rank = nfactors;
+  stream->time_mode = time_mode;
+  stream->forget = forget;
+  stream->window = (idx_t) opts[SPLATT_OPTION_WINDOW];
+  stream->nbatches = 0;
+  stream->opts = splatt_malloc(SPLATT_OPTION_NOPTIONS * sizeof(*stream->opts));
+  memcpy(stream->opts, opts, SPLATT_OPTION_NOPTIONS * sizeof(*opts));
+
+  idx_t const nthreads = (idx_t) opts[SPLATT_OPTION_NTHREADS];
+  splatt_omp_set_num_threads(nthreads);
+  stream->thds = cpd_alloc_thds(nmodes, nfactors, nthreads);
+
+  stream->histP = NULL;
+  stream->histQ = NULL;
+  if(stream->window > 0) {
+    idx_t const nhist = stream->window * nmodes;
+    stream->histP = splatt_malloc(nhist * sizeof(*stream->histP));
+    stream->histQ = splatt_malloc(nhist * sizeof(*stream->histQ));
+    for(idx_t h=0; h < nhist; ++h) {
+      stream->histP[h] = NULL;
+      stream->histQ[h] = NULL;
+    }
+  }
+
+  /* factor the first batch from scratch */
+  double * seed_opts = splatt_malloc(SPLATT_OPTION_NOPTIONS *
+      sizeof(*seed_opts));
+  memcpy(seed_opts, opts, SPLATT_OPTION_NOPTIONS * sizeof(*opts));
+  seed_opts[SPLATT_OPTION_VERBOSITY] = SPLATT_VERBOSITY_NONE;
+  splatt_csf * csf = csf_alloc(first, seed_opts);
+  splatt_kruskal seed;
+  int const ret = splatt_cpd_als(csf, nfactors, seed_opts, &seed);
+  splatt_free(seed_opts);
+  if(ret != SPLATT_SUCCESS) {
+    fprintf(stderr, "SPLATT ERROR: failed to factor the first batch.\n");
+    csf_free(csf, opts);
+    thd_free(stream->thds, nthreads);
+    splatt_free(stream->histP);
+    splatt_free(stream->histQ);
+    splatt_free(stream->opts);
+    splatt_free(stream);
+    return NULL;
+  }
+
+  idx_t maxdim = 0;
+  for(idx_t m=0; m < nmodes; ++m) {
+    stream->dims[m] = seed.dims[m];
+    maxdim = SS_MAX(maxdim, seed.dims[m]);
+
+    matrix_t * mat = splatt_malloc(sizeof(*mat));
+    mat->I = seed.dims[m];
+    mat->J = nfactors;
+    mat->vals = seed.factors[m];
+    mat->rowmajor = 1;
+    stream->factors[m] = mat;
+
+    stream->gram[m] = mat_alloc(nfactors, nfactors);
+    stream->P[m] = NULL;
+    stream->Q[m] = NULL;
+  }
+
+  /* the weights live in the time factor */
+  matrix_t * const C = stream->factors[time_mode];
+  for(idx_t i=0; i < C->I; ++i) {
+    for(idx_t f=0; f < nfactors; ++f) {
+      C->vals[f + (i*nfactors)] *= seed.lambda[f];
+    }
+  }
+  stream->fit = seed.fit;
+  stream->time_capacity = C->I;
+  splatt_free(seed.lambda);
+
+  for(idx_t m=0; m < nmodes; ++m) {
+    p_full_gram(stream->factors[m], stream->gram[m]);
+  }
+
+  /* the seed batch's statistics */
+  matrix_t * mats[MAX_NMODES+1];
+  for(idx_t m=0; m < nmodes; ++m) {
+    mats[m] = stream->factors[m];
+  }
+  mats[MAX_NMODES] = mat_alloc(maxdim, nfactors);
+  splatt_mttkrp_ws * ws = splatt_mttkrp_alloc_ws(csf, nfactors, opts);
+  for(idx_t m=0; m < nmodes; ++m) {
+    if(m == time_mode) {
+      continue;
+    }
+    stream->P[m] = mat_alloc(stream->dims[m], nfactors);
+    stream->Q[m] = mat_alloc(nfactors, nfactors);
+    p_batch_mttkrp(csf, mats, m, stream, ws, stream->P[m]);
+    p_hada_grams(stream, m, m, NULL, stream->Q[m]);
+    p_remember(stream, m, stream->P[m], stream->Q[m]);
+  }
+  stream->nbatches = 1;
+
+  splatt_mttkrp_free_ws(ws);
+  mat_free(mats[MAX_NMODES]);
+  csf_free(csf, opts);
+
+  return stream;
+}
+
+
+double stream_add(
+  stream_cpd * const stream,
+  sptensor_t * const batch,
+  idx_t * const niters)
+{
+  idx_t const nmodes = stream->nmodes;
+  idx_t const R = stream->rank;
+  idx_t const tmode = stream->time_mode;
+  double const * const opts = stream->opts;
+  val_t const reg = opts[SPLATT_OPTION_REGULARIZE];
+
+  /* new entities start at zero and are filled in by their statistics */
+  for(idx_t m=0; m < nmodes; ++m) {
+    if(m == tmode) {
+      continue;
+    }
+    if(batch->dims[m] > stream->dims[m]) {
+      stream->dims[m] = batch->dims[m];
+      p_grow_rows(stream->factors[m], stream->dims[m]);
+      p_grow_rows(stream->P[m], stream->dims[m]);
+    }
+    batch->dims[m] = stream->dims[m];
+  }
+  idx_t const nsteps = batch->dims[tmode];
+
+  /* an empty batch only ages the history */
+  splatt_csf * csf = NULL;
+  splatt_mttkrp_ws * ws = NULL;
+  double xnormsq = 0.;
+  if(batch->nnz > 0) {
+    csf = csf_alloc(batch, opts);
+    ws = splatt_mttkrp_alloc_ws(csf, R, opts);
+    xnormsq = csf_frobsq(csf);
+  }
+
+  /* the batch's time rows are solved for, the rest come from the stream */
+  matrix_t * C = mat_alloc(nsteps, R);
+  idx_t maxdim = nsteps;
+  matrix_t * mats[MAX_NMODES+1];
+  matrix_t * Pnew[MAX_NMODES];
+  matrix_t * Qnew[MAX_NMODES];
+  for(idx_t m=0; m < nmodes; ++m) {
+    mats[m] = (m == tmode) ? C : stream->factors[m];
+    maxdim = SS_MAX(maxdim, stream->dims[m]);
+    Pnew[m] = NULL;
+    Qnew[m] = NULL;
+    if(m != tmode) {
+      Pnew[m] = mat_alloc(stream->dims[m], R);
+      Qnew[m] = mat_alloc(R, R);
+      memset(Pnew[m]->vals, 0, stream->dims[m] * R * sizeof(val_t));
+      memset(Qnew[m]->vals, 0, R * R * sizeof(val_t));
+    }
+  }
+  memset(C->vals, 0, nsteps * R * sizeof(*C->vals));
+  mats[MAX_NMODES] = mat_alloc(maxdim, R);
+  matrix_t * H = mat_alloc(R, R);
+  matrix_t * CtC = mat_alloc(R, R);
+  matrix_t * Qtot = mat_alloc(R, R);
+
+  /* the contribution which falls out of the window with this batch */
+  idx_t const window = stream->window;
+  double const dropw = (window > 0 && stream->nbatches >= window) ?
+      pow(stream->forget, (double) window) : 0.;
+  idx_t const slot = (window > 0) ? (stream->nbatches % window) * nmodes : 0;
+
+  double fit = 1.;
+  double oldfit = 0.;
+  idx_t const maxits = (csf != NULL) ?
+      SS_MAX(1, (idx_t) opts[SPLATT_OPTION_NITER]) : 0;
+  idx_t it;
+  for(it=0; it < maxits; ++it) {
+    /* time rows: C = X_(t) (KRP) (Hadamard of Grams)^-1 */
+    p_hada_grams(stream, tmode, tmode, NULL, H);
+    mttkrp_csf(csf, mats, tmode, stream->thds, ws, opts);
+    memcpy(C->vals, mats[MAX_NMODES]->vals, nsteps * R * sizeof(*C->vals));
+    p_solve_rows(H, reg, C);
+    p_full_gram(C, CtC);
+
+    /* fit of the batch, from the same MTTKRP */
+    double inner = 0.;
+    val_t const * const restrict mv = mats[MAX_NMODES]->vals;
+    for(idx_t x=0; x < nsteps * R; ++x) {
+      inner += mv[x] * C->vals[x];
+    }
+    double mnormsq = 0.;
+    for(idx_t x=0; x < R * R; ++x) {
+      mnormsq += H->vals[x] * CtC->vals[x];
+    }
+    double const residual = SS_MAX(0., xnormsq - (2. * inner) + mnormsq);
+    fit = (xnormsq > 0.) ? 1. - sqrt(residual / xnormsq) : 1.;
+
+    /* other modes: A_m = (forget P_m + P_new) (forget Q_m + Q_new)^-1 */
+    for(idx_t m=0; m < nmodes; ++m) {
+      if(m == tmode) {
+        continue;
+      }
+      p_batch_mttkrp(csf, mats, m, stream, ws, Pnew[m]);
+      p_hada_grams(stream, m, tmode, CtC, Qnew[m]);
+
+      matrix_t const * const dropP = (dropw > 0.) ?
+          stream->histP[slot + m] : NULL;
+      matrix_t const * const dropQ = (dropw > 0.) ?
+          stream->histQ[slot + m] : NULL;
+      p_combine(stream->P[m], Pnew[m], dropP, stream->forget, dropw,
+          stream->factors[m]);
+      p_combine(stream->Q[m], Qnew[m], dropQ, stream->forget, dropw, Qtot);
+      p_solve_rows(Qtot, reg, stream->factors[m]);
+      p_full_gram(stream->factors[m], stream->gram[m]);
+    }
+
+    if(it > 0 && fabs(fit - oldfit) < opts[SPLATT_OPTION_TOLERANCE]) {
+      ++it;
+      break;
+    }
+    oldfit = fit;
+  }
+  if(niters != NULL) {
+    *niters = SS_MIN(it, maxits);
+  }
+
+  /* commit the statistics */
+  for(idx_t m=0; m < nmodes; ++m) {
+    if(m == tmode) {
+      continue;
+    }
+    matrix_t const * const dropP = (dropw > 0.) ? stream->histP[slot + m] : NULL;
+    matrix_t const * const dropQ = (dropw > 0.) ? stream->histQ[slot + m] : NULL;
+    matrix_t * const newP = mat_alloc(stream->dims[m], R);
+    p_combine(stream->P[m], Pnew[m], dropP, stream->forget, dropw, newP);
+    p_combine(stream->Q[m], Qnew[m], dropQ, stream->forget, dropw, Qtot);
+    mat_free(stream->P[m]);
+    stream->P[m] = newP;
+    memcpy(stream->Q[m]->vals, Qtot->vals, R * R * sizeof(val_t));
+    p_remember(stream, m, Pnew[m], Qnew[m]);
+  }
+  ++stream->nbatches;
+
+  /* append the new time rows */
+  matrix_t * const T = stream->factors[tmode];
+  p_reserve_rows(T, &(stream->time_capacity), stream->dims[tmode] + nsteps);
+  T->I = stream->dims[tmode] + nsteps;
+  memcpy(stream->factors[tmode]->vals + (stream->dims[tmode] * R), C->vals,
+      nsteps * R * sizeof(*C->vals));
+  stream->dims[tmode] += nsteps;
+  stream->fit = fit;
+
+  /* clean up */
+  for(idx_t m=0; m < nmodes; ++m) {
+    if(m != tmode) {
+      mat_free(Pnew[m]);
+      mat_free(Qnew[m]);
+    }
+  }
+  mat_free(mats[MAX_NMODES]);
+  mat_free(C);
+  mat_free(H);
+  mat_free(CtC);
+  mat_free(Qtot);
+  if(csf != NULL) {
+    splatt_mttkrp_free_ws(ws);
+    csf_free(csf, opts);
+  }
+
+  return fit;
+}
+
+
+void stream_to_kruskal(
+  stream_cpd const * const stream,
+  splatt_kruskal * const factored)
+{
+  idx_t const R = stream->rank;
+  factored->rank = R;
+  factored->nmodes = stream->nmodes;
+  factored->fit = stream->fit;
+  factored->lambda = splatt_malloc(R * sizeof(*factored->lambda));
+  for(idx_t f=0; f < R; ++f) {
+    factored->lambda[f] = 1.;
+  }
+
+  for(idx_t m=0; m < stream->nmodes; ++m) {
+    matrix_t const * const A = stream->factors[m];
+    idx_t const I = stream->dims[m];
+    factored->dims[m] = I;
+    factored->factors[m] = splatt_malloc(I * R * sizeof(val_t));
+    val_t * const restrict out = factored->factors[m];
+
+    /* move the column norms into lambda */
+    for(idx_t f=0; f < R; ++f) {
+      val_t norm = 0.;
+      for(idx_t i=0; i < I; ++i) {
+        norm += A->vals[f + (i*R)] * A->vals[f + (i*R)];
+      }
+      norm = sqrt(norm);
+      factored->lambda[f] *= norm;
+      val_t const scale = (norm > 0.) ? 1. / norm : 1.;
+      for(idx_t i=0; i < I; ++i) {
+        out[f + (i*R)] = A->vals[f + (i*R)] * scale;
+      }
+    }
+  }
+}
+
+
+void stream_free(
+  stream_cpd * stream)
+{
+  if(stream == NULL) {
+    return;
+  }
+  for(idx_t m=0; m < stream->nmodes; ++m) {
+    mat_free(stream->factors[m]);
+    mat_free(stream->gram[m]);
+    if(stream->P[m] != NULL) {
+      mat_free(stream->P[m]);
+      mat_free(stream->Q[m]);
+    }
+  }
+  if(stream->window > 0) {
+    for(idx_t h=0; h < stream->window * stream->nmodes; ++h) {
+      if(stream->histP[h] != NULL) {
+        mat_free(stream->histP[h]);
+        mat_free(stream->histQ[h]);
+      }
+    }
+    splatt_free(stream->histP);
+    splatt_free(stream->histQ);
+  }
+  thd_free(stream->thds, (idx_t) stream->opts[SPLATT_OPTION_NTHREADS]);
+  splatt_free(stream->opts);
+  splatt_free(stream);
+}
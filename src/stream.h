@@ -0,0 +1,146 @@
+#ifndef SPLATT_STREAM_H
+#define SPLATT_STREAM_H
+
+#include "base.h"
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "matrix.h"
+#include "sptensor.h"
+#include "thd_info.h"
+
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/**
+* @brief The state of a streaming (online) CPD along one "time" mode. New
+*        time slices arrive in batches. Only the time rows of a batch are
+*        solved for; the other factors are updated from sufficient statistics,
+*        which are the accumulated MTTKRP and Gram contributions of each
+*        batch:
+*
+*          A_m = P_m Q_m^-1,  P_m = sum_b w_b X_b(m) (KRP of the others),
+*                             Q_m = sum_b w_b (Hadamard of the others' Grams)
+*
+*        with w_b = forget^(age of batch b). If 'window' is non-zero, batches
+*        older than 'window' are subtracted back out, which requires the last
+*        'window' contributions to be stored.
+*/
+typedef struct
+{
+  idx_t nmodes;    /** The number of modes. */
+  idx_t rank;      /** The rank of the factorization. */
+  idx_t time_mode; /** Which mode grows with each batch. */
+  double forget;   /** Weight of the history after each batch, in (0, 1]. */
+  idx_t window;    /** Number of batches remembered, or 0 for all. */
+
+  /** The current dimensions. dims[time_mode] is the number of time steps. */
+  idx_t dims[MAX_NMODES];
+  /** The factors. The time factor holds a row for every time step. */
+  matrix_t * factors[MAX_NMODES];
+  /** A^T A of each non-time factor. */
+  matrix_t * gram[MAX_NMODES];
+  /** Accumulated MTTKRP statistics of each non-time mode. */
+  matrix_t * P[MAX_NMODES];
+  /** Accumulated Gram statistics of each non-time mode. */
+  matrix_t * Q[MAX_NMODES];
+
+  /** Rows allocated for the time factor, which grows by doubling. */
+  idx_t time_capacity;
+  /** The fit of the most recent batch. */
+  double fit;
+
+  /** The number of batches seen, including the seed batch. */
+  idx_t nbatches;
+  /** Per-batch P contributions, indexed [(batch % window) * nmodes + mode]. */
+  matrix_t ** histP;
+  /** Per-batch Q contributions, indexed like histP. */
+  matrix_t ** histQ;
+
+  /** Thread structures reused by every batch. */
+  thd_info * thds;
+  /** A copy of the SPLATT options. */
+  double * opts;
+} stream_cpd;
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+#define stream_alloc splatt_stream_alloc
+/**
+* @brief Start a streaming CPD by factoring an initial batch with CPD-ALS.
+*
+* @param first The initial batch. Its indices along 'time_mode' are local
+*              (starting from 0).
+* @param nfactors The rank of the factorization.
+* @param time_mode The mode which grows with each batch.
+* @param opts SPLATT options array. This uses SPLATT_OPTION_FORGET,
+*             SPLATT_OPTION_WINDOW, SPLATT_OPTION_NITER (per batch),
+*             SPLATT_OPTION_TOLERANCE, SPLATT_OPTION_REGULARIZE, and
+*             SPLATT_OPTION_NTHREADS.
+*
+* @return The streaming state, which must be freed with stream_free(), or
+*         NULL on bad input (including an empty first batch).
+*/
+stream_cpd * stream_alloc(
+  sptensor_t * const first,
+  idx_t const nfactors,
+  idx_t const time_mode,
+  double const * const opts);
+
+
+#define stream_add splatt_stream_add
+/**
+* @brief Add a batch of new time slices. Their rows are appended to the time
+*        factor. The other factors are refined from their sufficient
+*        statistics and the new batch only, so the cost depends on the batch
+*        and the factor sizes but not on the length of the history.
+*
+*        The non-time modes may grow. New rows start at zero and are filled in
+*        by the update. An empty batch appends zero rows and only ages the
+*        history.
+*
+* @param stream The streaming state.
+* @param batch The new slices, with local time indices. batch->dims of the
+*              non-time modes are set to the (possibly grown) stream
+*              dimensions.
+* @param[out] niters If not NULL, the number of inner iterations used.
+*
+* @return The fit of the model to the batch.
+*/
+double stream_add(
+  stream_cpd * const stream,
+  sptensor_t * const batch,
+  idx_t * const niters);
+
+
+#define stream_to_kruskal splatt_stream_to_kruskal
+/**
+* @brief Copy the current model into a Kruskal tensor with unit-norm columns.
+*
+* @param stream The streaming state.
+* @param[out] factored The model, which must be freed with
+*                      splatt_free_kruskal().
+*/
+void stream_to_kruskal(
+  stream_cpd const * const stream,
+  splatt_kruskal * const factored);
+
+
+#define stream_free splatt_stream_free
+/**
+* @brief Free a streaming CPD allocated with stream_alloc().
+*
+* @param stream The state to free.
+*/
+void stream_free(
+  stream_cpd * stream);
+
+#endif
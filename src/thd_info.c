@@ -6,116 +6,110 @@
 #include "thd_info.h"
 
 
+/******************************************************************************
+ * PRIVATE DEFINES
+ *****************************************************************************/
+
+/* scratch is padded and aligned to cache lines */
+#ifndef THD_LINE_BYTES
+#define THD_LINE_BYTES 64
+#endif
+
+/* blocks are aligned to pages so they are never shared between threads */
+#ifndef THD_PAGE_BYTES
+#define THD_PAGE_BYTES 4096
+#endif
+
+
 /******************************************************************************
  * PRIVATE FUNCTIONS
  *****************************************************************************/
 
 /**
-* @brief Perform a parallel SUM reduction.
-*
-* @param thds The thread structure we are using in the reduction.
-* @param scratchid Which scratch array to reduce.
-* @param nelems How many elements in the scratch array.
+* @brief Round 'bytes' up to a multiple of 'align', a power of two.
 */
-static inline void p_reduce_sum(
-  thd_info * const thds,
-  idx_t const scratchid,
-  idx_t const nelems)
+static inline size_t p_round_up(
+  size_t const bytes,
+  size_t const align)
 {
-  int const tid = splatt_omp_get_thread_num();
-  int const nthreads = splatt_omp_get_num_threads();
-
-  val_t * const myvals = (val_t *) thds[tid].scratch[scratchid];
-
-  int half = nthreads / 2;
-  while(half > 0) {
-    if(tid < half && tid + half < nthreads) {
-      val_t const * const target = (val_t *) thds[tid+half].scratch[scratchid];
-      for(idx_t i=0; i < nelems; ++i) {
-        myvals[i] += target[i];
-      }
-    }
-
-    #pragma omp barrier
+  return (bytes + align - 1) & ~(align - 1);
+}
 
-    /* check for odd number */
-    #pragma omp master
-    if(half > 1 && half % 2 == 1) {
-        val_t const * const last = (val_t *) thds[half-1].scratch[scratchid];
-        for(idx_t i=0; i < nelems; ++i) {
-          myvals[i] += last[i];
-        }
-    }
 
-    /* next iteration */
-    half /= 2;
+/**
+* @brief Allocate a page-aligned block whose size is rounded up to pages.
+*/
+static void * p_alloc_pages(
+  size_t const bytes)
+{
+  void * ptr = NULL;
+  int const ret = posix_memalign(&ptr, THD_PAGE_BYTES,
+      p_round_up(SS_MAX(bytes, 1), THD_PAGE_BYTES));
+  if(ret != 0) {
+    fprintf(stderr, "SPLATT: posix_memalign() of %zu bytes failed: %s.\n",
+        bytes, strerror(ret));
+    abort();
   }
+  return ptr;
+}
 
-  /* account for odd thread at end */
-  #pragma omp master
-  {
-    if(nthreads % 2 == 1) {
-      val_t const * const last = (val_t *) thds[nthreads-1].scratch[scratchid];
-      for(idx_t i=0; i < nelems; ++i) {
-        myvals[i] += last[i];
-      }
-    }
+
+/**
+* @brief Free the spill blocks of a thread's arena.
+*/
+static void p_free_spills(
+  thd_info * const thd)
+{
+  while(thd->spill != NULL) {
+    void * const next = *((void **) thd->spill);
+    free(thd->spill);
+    thd->spill = next;
   }
-  #pragma omp barrier
+  thd->spill_bytes = 0;
 }
 
 
 /**
-* @brief Perform a parallel MAX reduction.
+* @brief Perform a parallel SUM or MAX reduction into thds[0]. Each thread
+*        owns a contiguous, cache-line aligned chunk of the output and combines
+*        that chunk across every thread's buffer, so the reduction needs only
+*        the barrier at its end.
 *
 * @param thds The thread structure we are using in the reduction.
 * @param scratchid Which scratch array to reduce.
 * @param nelems How many elements in the scratch array.
+* @param which Which reduction operation to perform.
 */
-static inline void p_reduce_max(
+static inline void p_reduce_columns(
   thd_info * const thds,
   idx_t const scratchid,
-  idx_t const nelems)
+  idx_t const nelems,
+  splatt_reduce_type const which)
 {
   int const tid = splatt_omp_get_thread_num();
   int const nthreads = splatt_omp_get_num_threads();
 
-  val_t * const myvals = (val_t *) thds[tid].scratch[scratchid];
-
-  int half = nthreads / 2;
-  while(half > 0) {
-    if(tid < half && tid + half < nthreads) {
-      val_t const * const target = (val_t *) thds[tid+half].scratch[scratchid];
-      for(idx_t i=0; i < nelems; ++i) {
-        myvals[i] = SS_MAX(myvals[i], target[i]);
+  /* chunks are whole cache lines, so no two threads write to the same one */
+  idx_t const line = THD_LINE_BYTES / sizeof(val_t);
+  idx_t chunk = (nelems + nthreads - 1) / nthreads;
+  chunk = ((chunk + line - 1) / line) * line;
+  idx_t const start = SS_MIN(tid * chunk, nelems);
+  idx_t const end = SS_MIN(start + chunk, nelems);
+
+  val_t * const restrict out = (val_t *) thds[0].scratch[scratchid];
+  for(int t=1; t < nthreads; ++t) {
+    val_t const * const restrict in = (val_t *) thds[t].scratch[scratchid];
+    if(which == REDUCE_SUM) {
+      for(idx_t i=start; i < end; ++i) {
+        out[i] += in[i];
       }
-    }
-
-    #pragma omp barrier
-
-    /* check for odd number */
-    #pragma omp master
-    if(half > 1 && half % 2 == 1) {
-        val_t const * const last = (val_t *) thds[half-1].scratch[scratchid];
-        for(idx_t i=0; i < nelems; ++i) {
-          myvals[i] = SS_MAX(myvals[i], last[i]);
-        }
-    }
-
-    /* next iteration */
-    half /= 2;
-  }
-
-  /* account for odd thread at end */
-  #pragma omp master
-  {
-    if(nthreads % 2 == 1) {
-      val_t const * const last = (val_t *) thds[nthreads-1].scratch[scratchid];
-      for(idx_t i=0; i < nelems; ++i) {
-        myvals[i] = SS_MAX(myvals[i], last[i]);
+    } else {
+      for(idx_t i=start; i < end; ++i) {
+        out[i] = SS_MAX(out[i], in[i]);
       }
     }
   }
+
   #pragma omp barrier
 }
 
@@ -139,10 +133,8 @@ void thd_reduce(
 
   switch(which) {
   case REDUCE_SUM:
-    p_reduce_sum(thds, scratchid, nelems);
-    break;
   case REDUCE_MAX:
-    p_reduce_max(thds, scratchid, nelems);
+    p_reduce_columns(thds, scratchid, nelems, which);
     break;
   default:
     fprintf(stderr, "SPLATT: thd_reduce supports SUM and MAX only.\n");
@@ -151,6 +143,52 @@ void thd_reduce(
 }
 
 
+void * thd_arena_reserve(
+  thd_info * const thd,
+  size_t const bytes)
+{
+  size_t const padded = p_round_up(SS_MAX(bytes, 1), THD_LINE_BYTES);
+  if(thd->arena_used + padded <= thd->arena_bytes) {
+    void * const ptr = thd->arena + thd->arena_used;
+    thd->arena_used += padded;
+    return ptr;
+  }
+
+  /* Spill into a new block, linked through its first cache line. */
+  char * const block = p_alloc_pages(THD_LINE_BYTES + padded);
+  *((void **) block) = thd->spill;
+  thd->spill = block;
+  thd->spill_bytes += padded;
+  return block + THD_LINE_BYTES;
+}
+
+
+size_t thd_arena_mark(
+  thd_info const * const thd)
+{
+  return thd->arena_used;
+}
+
+
+void thd_arena_release(
+  thd_info * const thd,
+  size_t const mark)
+{
+  assert(mark <= thd->arena_used);
+  thd->arena_used = mark;
+
+  /* Spills are only outstanding until everything is released. Then we grow
+   * the arena so that the same reservations will fit next time. */
+  if(mark == 0 && thd->spill != NULL) {
+    size_t const bytes = thd->arena_bytes + thd->spill_bytes;
+    p_free_spills(thd);
+    free(thd->arena);
+    thd->arena = p_alloc_pages(bytes);
+    thd->arena_bytes = p_round_up(bytes, THD_PAGE_BYTES);
+  }
+}
+
+
 thd_info * thd_init(
   idx_t const nthreads,
   idx_t const nscratch,
@@ -158,23 +196,36 @@ thd_info * thd_init(
 {
   thd_info * thds = (thd_info *) splatt_malloc(nthreads * sizeof(thd_info));
 
-  for(idx_t t=0; t < nthreads; ++t) {
-    timer_reset(&thds[t].ttime);
-    thds[t].nscratch = nscratch;
-    thds[t].scratch = (void **) splatt_malloc(nscratch * sizeof(void*));
-  }
-
+  /* lay out the scratch arrays, one cache line apart at least */
+  size_t offsets[nscratch+1];
+  offsets[0] = 0;
   va_list args;
   va_start(args, nscratch);
   for(idx_t s=0; s < nscratch; ++s) {
     idx_t const bytes = va_arg(args, idx_t);
-    for(idx_t t=0; t < nthreads; ++t) {
-      thds[t].scratch[s] = (void *) splatt_malloc(bytes);
-      memset(thds[t].scratch[s], 0, bytes);
-    }
+    offsets[s+1] = offsets[s] + p_round_up(SS_MAX(bytes, 1), THD_LINE_BYTES);
   }
   va_end(args);
 
+  /* each thread allocates and zeroes its own block (first touch) */
+  #pragma omp parallel for schedule(static, 1) num_threads(nthreads)
+  for(idx_t t=0; t < nthreads; ++t) {
+    timer_reset(&thds[t].ttime);
+    thds[t].nscratch = nscratch;
+    thds[t].scratch = (void **) splatt_malloc(nscratch * sizeof(void*));
+    thds[t].block = p_alloc_pages(offsets[nscratch]);
+    memset(thds[t].block, 0, offsets[nscratch]);
+    for(idx_t s=0; s < nscratch; ++s) {
+      thds[t].scratch[s] = thds[t].block + offsets[s];
+    }
+
+    thds[t].arena = NULL;
+    thds[t].arena_bytes = 0;
+    thds[t].arena_used = 0;
+    thds[t].spill = NULL;
+    thds[t].spill_bytes = 0;
+  }
+
   return thds;
 }
 
@@ -221,11 +272,11 @@ void thd_free(
   idx_t const nthreads)
 {
   for(idx_t t=0; t < nthreads; ++t) {
-    for(idx_t s=0; s < thds[t].nscratch; ++s) {
-      free(thds[t].scratch[s]);
-    }
-    free(thds[t].scratch);
+    p_free_spills(thds + t);
+    free(thds[t].arena);
+    free(thds[t].block);
+    splatt_free(thds[t].scratch);
   }
-  free(thds);
+  splatt_free(thds);
 }
 
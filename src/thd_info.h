@@ -21,12 +21,28 @@
 
 /**
 * @brief A general structure for data structures that need to be thread-local.
+*        Each thread owns an arena: one page-aligned block holding its fixed
+*        scratch arrays, and a bump allocator for the transient scratch of
+*        kernels (see thd_arena_reserve()). Both are allocated and first
+*        touched by the owning thread, so they are local to its NUMA node.
 */
 typedef struct
 {
   idx_t nscratch;
   void ** scratch;
   sp_timer_t ttime;
+
+  /** @brief The memory behind 'scratch'. */
+  char * block;
+
+  /** @brief Transient scratch. 'arena_used' bytes of 'arena' are reserved.
+   *         Reservations which do not fit are 'spill' blocks, which are
+   *         folded into a larger arena once everything is released. */
+  char * arena;
+  size_t arena_bytes;
+  size_t arena_used;
+  void * spill;
+  size_t spill_bytes;
 } thd_info;
 
 
@@ -68,6 +84,17 @@ static inline int splatt_omp_get_num_threads()
   return omp_get_num_threads();
 }
 
+static inline int splatt_omp_get_max_active_levels()
+{
+  return omp_get_max_active_levels();
+}
+
+static inline void splatt_omp_set_max_active_levels(
+    int levels)
+{
+  omp_set_max_active_levels(levels);
+}
+
 #else
 static inline void splatt_omp_set_num_threads(
     int num_threads)
@@ -90,6 +117,17 @@ static inline int splatt_omp_get_num_threads()
 {
   return 1;
 }
+
+static inline int splatt_omp_get_max_active_levels()
+{
+  return 1;
+}
+
+static inline void splatt_omp_set_max_active_levels(
+    int levels)
+{
+  /* do nothing */
+}
 #endif
 
 
@@ -101,7 +139,9 @@ static inline int splatt_omp_get_num_threads()
 
 #define thd_reduce splatt_thd_reduce
 /**
-* @brief Perform a parallel reduction on thds->scratch[scratchid].
+* @brief Perform a parallel reduction on thds->scratch[scratchid]. Every
+*        thread of the team must call this; the result is left in
+*        thds[0].scratch[scratchid].
 *
 * @param thds The thread structure we are using in the reduction.
 * @param scratchid Which scratch array to reduce.
@@ -152,7 +192,10 @@ void thd_reset(
 
 #define thd_init splatt_thd_init
 /**
-* @brief Allocate and initialize a number thd_info structs.
+* @brief Allocate and initialize a number thd_info structs. The scratch arrays
+*        of each thread share one page-aligned block, allocated and zeroed by
+*        that thread. Every array is cache-line aligned and padded, so
+*        callers need not pad the sizes to avoid false sharing.
 *
 * @param nthreads The number of threads to allocate for.
 * @param nscratch The number of scratch arrays to use.
@@ -166,6 +209,52 @@ thd_info * thd_init(
   ...);
 
 
+#define thd_arena_reserve splatt_thd_arena_reserve
+/**
+* @brief Reserve transient scratch from a thread's arena. The memory is
+*        cache-line aligned and padded, so neighboring reservations never
+*        share a line. Once the arena has grown to a kernel's needs, this is
+*        just a pointer increment.
+*
+*        Reservations are released in LIFO order with thd_arena_release().
+*        Only the owning thread should reserve from its arena, and any thread
+*        may read the memory.
+*
+* @param thd The thread's structure (i.e., thds + tid).
+* @param bytes The number of bytes to reserve.
+*
+* @return The reserved memory. Its contents are undefined.
+*/
+void * thd_arena_reserve(
+  thd_info * const thd,
+  size_t const bytes);
+
+
+#define thd_arena_mark splatt_thd_arena_mark
+/**
+* @brief Record the state of a thread's arena, to later release everything
+*        reserved after this point.
+*
+* @param thd The thread's structure.
+*
+* @return A mark for thd_arena_release().
+*/
+size_t thd_arena_mark(
+  thd_info const * const thd);
+
+
+#define thd_arena_release splatt_thd_arena_release
+/**
+* @brief Release every reservation made after 'mark'.
+*
+* @param thd The thread's structure.
+* @param mark A mark from thd_arena_mark().
+*/
+void thd_arena_release(
+  thd_info * const thd,
+  size_t const mark);
+
+
 #define thd_free splatt_thd_free
 /**
 * @brief Free the memory allocated by thd_init.
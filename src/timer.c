@@ -4,6 +4,7 @@
  * INCLUDES
  *****************************************************************************/
 #include "timer.h"
+#include "mutex_pool.h"
 #include <stdio.h>
 
 
@@ -13,8 +14,11 @@
 static char const * const timer_names[] = {
   [TIMER_ALL]       = "TOTAL",
   [TIMER_CPD]       = "CPD",
+  [TIMER_TUCKER]    = "TUCKER",
   [TIMER_IO]        = "IO",
   [TIMER_MTTKRP]    = "MTTKRP",
+  [TIMER_TTMC]      = "TTMc",
+  [TIMER_SVD]       = "SVD",
   [TIMER_INV]       = "INVERSE",
   [TIMER_SPLATT]    = "SPLATT",
   [TIMER_GIGA]      = "GIGA",
@@ -48,6 +52,13 @@ static char const * const timer_names[] = {
 };
 
 
+/******************************************************************************
+ * GLOBALS
+ *****************************************************************************/
+int timer_lvl;
+sp_timer_t timers[TIMER_NTIMERS];
+
+
 /******************************************************************************
  * PUBLIC FUNCTIONS
  *****************************************************************************/
@@ -55,6 +66,7 @@ void init_timers(void)
 {
   timer_lvl = TIMER_LVL1;
   for(int t=0; t < TIMER_NTIMERS; ++t) {
+    timers[t].paused = false;
     timer_reset(&timers[t]);
   }
 }
@@ -68,6 +80,11 @@ void report_times(void)
       printf("  %-20s%0.3fs\n", timer_names[t], timers[t].seconds);
     }
   }
+
+  /* lock contention is only counted when built with SPLATT_LOCK_STATS */
+  if(timer_lvl == TIMER_NTIMERS) {
+    mutex_report_stats();
+  }
 }
 
 void timer_inc_verbose(void)
@@ -87,3 +104,16 @@ void timer_inc_verbose(void)
   }
 }
 
+void timer_pause_all(void)
+{
+  for(int t=0; t < TIMER_NTIMERS; ++t) {
+    timers[t].paused = true;
+  }
+}
+
+void timer_resume_all(void)
+{
+  for(int t=0; t < TIMER_NTIMERS; ++t) {
+    timers[t].paused = false;
+  }
+}
@@ -24,6 +24,8 @@
 typedef struct
 {
   bool running;
+  /** @brief A paused timer ignores starts, stops, and resets. */
+  bool paused;
   double seconds;
   double start;
   double stop;
@@ -38,10 +40,13 @@ typedef enum
   TIMER_LVL0,   /* LEVEL 0 */
   TIMER_ALL,
   TIMER_CPD,
+  TIMER_TUCKER,
   TIMER_REORDER,
   TIMER_CONVERT,
   TIMER_LVL1,   /* LEVEL 1 */
   TIMER_MTTKRP,
+  TIMER_TTMC,
+  TIMER_SVD,
   TIMER_INV,
   TIMER_FIT,
   TIMER_MATMUL,
@@ -78,8 +83,8 @@ typedef enum
 
 
 /* globals */
-int timer_lvl;
-sp_timer_t timers[TIMER_NTIMERS];
+extern int timer_lvl;
+extern sp_timer_t timers[TIMER_NTIMERS];
 
 
 /******************************************************************************
@@ -107,6 +112,23 @@ void report_times(void);
 void timer_inc_verbose(void);
 
 
+#define timer_pause_all splatt_timer_pause_all
+/**
+* @brief Pause all of timers[]. The global timers are not thread-safe, so they
+*        must be paused while independent computations which use them (e.g.,
+*        concurrent CPD restarts) run in parallel.
+*/
+void timer_pause_all(void);
+
+
+#define timer_resume_all splatt_timer_resume_all
+/**
+* @brief Resume all of timers[] after timer_pause_all(). Timers which were
+*        running when paused continue to run.
+*/
+void timer_resume_all(void);
+
+
 
 /**
 * @brief Return the number of seconds since an unspecified time (e.g., Unix
@@ -146,6 +168,9 @@ static inline double monotonic_seconds()
 */
 static inline void timer_reset(sp_timer_t * const timer)
 {
+  if(timer->paused) {
+    return;
+  }
   timer->running = false;
   timer->seconds = 0;
   timer->start   = 0;
@@ -160,7 +185,7 @@ static inline void timer_reset(sp_timer_t * const timer)
 */
 static inline void timer_start(sp_timer_t * const timer)
 {
-  if(!timer->running) {
+  if(!timer->running && !timer->paused) {
     timer->running = true;
     timer->start = monotonic_seconds();
   }
@@ -174,6 +199,9 @@ static inline void timer_start(sp_timer_t * const timer)
 */
 static inline void timer_stop(sp_timer_t * const timer)
 {
+  if(timer->paused) {
+    return;
+  }
   timer->running = false;
   timer->stop = monotonic_seconds();
   timer->seconds += timer->stop - timer->start;
@@ -0,0 +1,160 @@
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "ttmc.h"
+#include "csf.h"
+#include "thd_info.h"
+#include "timer.h"
+#include "util.h"
+
+
+
+/******************************************************************************
+ * PRIVATE FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief Accumulate the TTMc of the subtree rooted at 'node' into buf[depth].
+*        buf[depth] must be zeroed by the caller.
+*
+* @param pt The CSF sparsity structure.
+* @param depth The level of 'node'.
+* @param node The node whose subtree we process.
+* @param nmodes The number of modes.
+* @param mvals The factor of each level.
+* @param ranks The number of columns of the factor of each level.
+* @param width width[d] is the length of buf[d], the product of ranks below d.
+* @param buf Per-level accumulation buffers.
+*/
+static void p_ttmc_subtree(
+    csf_sparsity const * const pt,
+    idx_t const depth,
+    idx_t const node,
+    idx_t const nmodes,
+    val_t const * const * const mvals,
+    idx_t const * const ranks,
+    idx_t const * const width,
+    val_t ** buf)
+{
+  val_t * const restrict out = buf[depth];
+  idx_t const start = pt->fptr[depth][node];
+  idx_t const end = pt->fptr[depth][node+1];
+
+  /* children are nonzeros: a scaled sum of leaf factor rows */
+  if(depth == nmodes - 2) {
+    idx_t const R = ranks[nmodes-1];
+    val_t const * const restrict vals = pt->vals;
+    idx_t const * const restrict inds = pt->fids[nmodes-1];
+    val_t const * const restrict lvals = mvals[nmodes-1];
+    for(idx_t x=start; x < end; ++x) {
+      val_t const v = vals[x];
+      val_t const * const restrict row = lvals + (inds[x] * R);
+      for(idx_t r=0; r < R; ++r) {
+        out[r] += v * row[r];
+      }
+    }
+    return;
+  }
+
+  /* out += kron(factor row of child, TTMc of child's subtree) */
+  idx_t const R = ranks[depth+1];
+  idx_t const W = width[depth+1];
+  val_t * const restrict child = buf[depth+1];
+  idx_t const * const restrict fids = pt->fids[depth+1];
+  for(idx_t c=start; c < end; ++c) {
+    memset(child, 0, W * sizeof(*child));
+    p_ttmc_subtree(pt, depth+1, c, nmodes, mvals, ranks, width, buf);
+
+    val_t const * const restrict urow = mvals[depth+1] + (fids[c] * R);
+    for(idx_t a=0; a < R; ++a) {
+      val_t const ua = urow[a];
+      if(ua == 0.) {
+        continue;
+      }
+      val_t * const restrict orow = out + (a * W);
+      for(idx_t b=0; b < W; ++b) {
+        orow[b] += ua * child[b];
+      }
+    }
+  }
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+idx_t ttmc_ncols(
+  splatt_csf const * const csf,
+  idx_t const * const ranks)
+{
+  idx_t ncols = 1;
+  for(idx_t d=1; d < csf->nmodes; ++d) {
+    ncols *= ranks[csf_depth_to_mode(csf, d)];
+  }
+  return ncols;
+}
+
+
+void ttmc_csf(
+  splatt_csf const * const csf,
+  matrix_t ** mats,
+  idx_t const * const partition,
+  matrix_t * const out,
+  double const * const opts)
+{
+  assert(csf->ntiles == 1);
+  idx_t const nmodes = csf->nmodes;
+  idx_t const root = csf_depth_to_mode(csf, 0);
+  csf_sparsity const * const pt = csf->pt;
+
+  /* factors, ranks, and accumulation widths by level */
+  val_t const * mvals[MAX_NMODES];
+  idx_t ranks[MAX_NMODES];
+  idx_t width[MAX_NMODES];
+  for(idx_t d=0; d < nmodes; ++d) {
+    idx_t const m = csf_depth_to_mode(csf, d);
+    mvals[d] = (d == 0) ? NULL : mats[m]->vals;
+    ranks[d] = mats[m]->J;
+  }
+  width[nmodes-1] = 1;
+  for(idx_t d=nmodes-1; d > 0; --d) {
+    width[d-1] = width[d] * ranks[d];
+  }
+  idx_t const ncols = width[0];
+  assert(out->I == csf->dims[root]);
+  assert(out->J == ncols);
+
+  val_t * const restrict ovals = out->vals;
+  memset(ovals, 0, out->I * ncols * sizeof(*ovals));
+  if(pt->vals == NULL) {
+    return;
+  }
+
+  timer_start(&timers[TIMER_TTMC]);
+  #pragma omp parallel num_threads((int) opts[SPLATT_OPTION_NTHREADS])
+  {
+    int const tid = splatt_omp_get_thread_num();
+
+    /* the root level accumulates directly into its output row */
+    val_t * buf[MAX_NMODES];
+    for(idx_t d=1; d < nmodes - 1; ++d) {
+      buf[d] = splatt_malloc(width[d] * sizeof(**buf));
+    }
+
+    /* each root slice is one output row, so no synchronization is needed */
+    idx_t const * const restrict rfids = pt->fids[0];
+    for(idx_t s=partition[tid]; s < partition[tid+1]; ++s) {
+      idx_t const fid = (rfids == NULL) ? s : rfids[s];
+      buf[0] = ovals + (fid * ncols);
+      p_ttmc_subtree(pt, 0, s, nmodes, mvals, ranks, width, buf);
+    }
+
+    for(idx_t d=1; d < nmodes - 1; ++d) {
+      splatt_free(buf[d]);
+    }
+  } /* end omp parallel */
+  timer_stop(&timers[TIMER_TTMC]);
+}
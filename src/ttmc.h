@@ -0,0 +1,64 @@
+#ifndef SPLATT_TTMC_H
+#define SPLATT_TTMC_H
+
+#include "base.h"
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "matrix.h"
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+#define ttmc_ncols splatt_ttmc_ncols
+/**
+* @brief The number of columns in the output of ttmc_csf(), which is the
+*        product of the ranks of every mode except the root of 'csf'.
+*
+* @param csf The CSF tensor.
+* @param ranks The number of columns of each factor.
+*
+* @return The number of columns.
+*/
+idx_t ttmc_ncols(
+  splatt_csf const * const csf,
+  idx_t const * const ranks);
+
+
+#define ttmc_csf splatt_ttmc_csf
+/**
+* @brief Compute a tensor-times-matrix chain (TTMc) along every mode except
+*        the root of a CSF tensor:
+*
+*          Y_(n) = X_(n) (U_N kron ... kron U_1), skipping U_n
+*
+*        where n is the root mode. Each output row is a root slice of the CSF,
+*        so slices are processed in parallel without synchronization.
+*        Kronecker products are accumulated up the tree like the Hadamard
+*        products of MTTKRP, which saves work on shared fibers.
+*
+*        Columns of Y follow the CSF levels: the column of (r_1, ..., r_{N-1}),
+*        where r_d indexes the factor of level d, is
+*        ((r_1 * R_2 + r_2) * R_3 + ...) + r_{N-1}.
+*
+* @param csf The CSF tensor, which must not be tiled.
+* @param mats The factors. mats[m] has csf->dims[m] rows. mats of the root
+*             mode is not accessed.
+* @param partition The partitioning of root slices among threads, from
+*                  csf_partition_1d().
+* @param[out] out The result, with csf->dims[root] rows and ttmc_ncols()
+*                 columns.
+* @param opts SPLATT options array. This uses SPLATT_OPTION_NTHREADS.
+*/
+void ttmc_csf(
+  splatt_csf const * const csf,
+  matrix_t ** mats,
+  idx_t const * const partition,
+  matrix_t * const out,
+  double const * const opts);
+
+#endif
@@ -0,0 +1,471 @@
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "tucker.h"
+#include "csf.h"
+#include "splatt_lapack.h"
+#include "timer.h"
+#include "ttmc.h"
+#include "util.h"
+
+#include <math.h>
+
+
+
+/******************************************************************************
+ * PRIVATE FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief Compute the leading left singular vectors of a dense matrix with
+*        LAPACK's SVD. The row-major A is the column-major A^T, so we ask for
+*        the right singular vectors of A^T instead of transposing.
+*
+* @param A The row-major matrix to decompose. It is not modified.
+* @param nrows The number of rows in A.
+* @param ncols The number of columns in A.
+* @param[out] U The leading U->J left singular vectors.
+*/
+static void p_svd_svecs(
+    val_t const * const A,
+    idx_t const nrows,
+    idx_t const ncols,
+    matrix_t * const U)
+{
+  idx_t const rank = U->J;
+  idx_t const k = SS_MIN(nrows, ncols);
+
+  /* gesvd overwrites its input */
+  val_t * acopy = splatt_malloc(nrows * ncols * sizeof(*acopy));
+  par_memcpy(acopy, A, nrows * ncols * sizeof(*acopy));
+  val_t * svals = splatt_malloc(k * sizeof(*svals));
+  val_t * vt = splatt_malloc(k * nrows * sizeof(*vt));
+
+  char jobu = 'N';
+  char jobvt = 'S';
+  splatt_blas_int M = (splatt_blas_int) ncols;
+  splatt_blas_int N = (splatt_blas_int) nrows;
+  splatt_blas_int lda = M;
+  splatt_blas_int ldu = 1;
+  splatt_blas_int ldvt = (splatt_blas_int) k;
+  splatt_blas_int info;
+  val_t udummy;
+
+  /* workspace query */
+  splatt_blas_int lwork = -1;
+  val_t worksize;
+  SPLATT_BLAS(gesvd)(&jobu, &jobvt, &M, &N, acopy, &lda, svals, &udummy, &ldu,
+      vt, &ldvt, &worksize, &lwork, &info);
+  lwork = (splatt_blas_int) worksize;
+  val_t * work = splatt_malloc(lwork * sizeof(*work));
+
+  SPLATT_BLAS(gesvd)(&jobu, &jobvt, &M, &N, acopy, &lda, svals, &udummy, &ldu,
+      vt, &ldvt, work, &lwork, &info);
+  if(info) {
+    fprintf(stderr, "SPLATT: DGESVD returned %d\n", info);
+  }
+
+  /* the rows of column-major VT are the columns of U */
+  val_t * const restrict uvals = U->vals;
+  #pragma omp parallel for schedule(static)
+  for(idx_t i=0; i < nrows; ++i) {
+    for(idx_t r=0; r < rank; ++r) {
+      uvals[r + (i*rank)] = vt[r + (i*k)];
+    }
+  }
+
+  splatt_free(work);
+  splatt_free(vt);
+  splatt_free(svals);
+  splatt_free(acopy);
+}
+
+
+/**
+* @brief Compute the leading left singular vectors of a tall dense matrix from
+*        the eigendecomposition of its small Gram matrix A^T A = V S^2 V^T, as
+*        U = A V S^-1. This costs a single pass over A, versus the
+*        orthogonal factorization of all of A that the SVD requires.
+*
+* @param A The row-major matrix to decompose.
+* @param nrows The number of rows in A.
+* @param ncols The number of columns in A.
+* @param[out] U The leading U->J left singular vectors.
+*
+* @return False if a needed singular value is too small to recover its vector
+*         accurately from the Gram matrix. U is then not modified.
+*/
+static bool p_gram_svecs(
+    val_t const * const A,
+    idx_t const nrows,
+    idx_t const ncols,
+    matrix_t * const U)
+{
+  idx_t const rank = U->J;
+  idx_t const P = ncols;
+
+  /* A^T A, in the lower triangle of the column-major result */
+  val_t * gram = splatt_malloc(P * P * sizeof(*gram));
+  char uplo = 'L';
+  char trans = 'N'; /* actually A^T * A due to row-major ordering */
+  splatt_blas_int N = (splatt_blas_int) P;
+  splatt_blas_int K = (splatt_blas_int) nrows;
+  val_t alpha = 1.;
+  val_t beta = 0.;
+  SPLATT_BLAS(syrk)(&uplo, &trans, &N, &K, &alpha, (val_t *) A, &N, &beta,
+      gram, &N);
+
+  /* eigenvalues are ascending and eigenvectors overwrite 'gram' */
+  char jobz = 'V';
+  splatt_blas_int info;
+  val_t * evals = splatt_malloc(P * sizeof(*evals));
+  splatt_blas_int lwork = -1;
+  val_t worksize;
+  SPLATT_BLAS(syev)(&jobz, &uplo, &N, gram, &N, evals, &worksize, &lwork,
+      &info);
+  lwork = (splatt_blas_int) worksize;
+  val_t * work = splatt_malloc(lwork * sizeof(*work));
+  SPLATT_BLAS(syev)(&jobz, &uplo, &N, gram, &N, evals, work, &lwork, &info);
+  splatt_free(work);
+
+  /* squaring the singular values squares their relative precision */
+  val_t const smallest = evals[P - rank];
+  if(info || smallest <= 1e-8 * evals[P-1]) {
+    if(info) {
+      fprintf(stderr, "SPLATT: DSYEV returned %d\n", info);
+    }
+    splatt_free(evals);
+    splatt_free(gram);
+    return false;
+  }
+
+  /* leading eigenvectors, scaled by 1/sigma, largest first */
+  val_t * V = splatt_malloc(P * rank * sizeof(*V));
+  for(idx_t r=0; r < rank; ++r) {
+    idx_t const col = P - 1 - r;
+    val_t const scale = 1. / sqrt(evals[col]);
+    for(idx_t p=0; p < P; ++p) {
+      V[r + (p*rank)] = gram[p + (col*P)] * scale;
+    }
+  }
+
+  /* U = A V */
+  val_t * const restrict uvals = U->vals;
+  #pragma omp parallel for schedule(static)
+  for(idx_t i=0; i < nrows; ++i) {
+    val_t * const restrict urow = uvals + (i * rank);
+    val_t const * const restrict arow = A + (i * P);
+    for(idx_t r=0; r < rank; ++r) {
+      urow[r] = 0.;
+    }
+    for(idx_t p=0; p < P; ++p) {
+      val_t const a = arow[p];
+      val_t const * const restrict vrow = V + (p * rank);
+      for(idx_t r=0; r < rank; ++r) {
+        urow[r] += a * vrow[r];
+      }
+    }
+  }
+
+  splatt_free(V);
+  splatt_free(evals);
+  splatt_free(gram);
+  return true;
+}
+
+
+/**
+* @brief Form the core G_(n) = U_n^T Y from the TTMc of mode n and fold it
+*        into a dense tensor. The columns of Y follow the CSF levels, so they
+*        are permuted to the natural mode order.
+*
+* @param csf The CSF tensor that Y was computed from.
+* @param U The (updated) factor of the root mode of 'csf'.
+* @param Y The TTMc of the root mode of 'csf'.
+* @param ranks The rank of each mode.
+* @param[out] core The dense core, with the last mode varying fastest.
+*
+* @return The squared Frobenius norm of the core.
+*/
+static val_t p_form_core(
+    splatt_csf const * const csf,
+    matrix_t const * const U,
+    matrix_t const * const Y,
+    idx_t const * const ranks,
+    val_t * const core)
+{
+  idx_t const nmodes = csf->nmodes;
+  idx_t const root = csf_depth_to_mode(csf, 0);
+  idx_t const R = U->J;
+  idx_t const I = Y->I;
+  idx_t const ncols = Y->J;
+
+  /* stride of each mode in the core */
+  idx_t stride[MAX_NMODES];
+  stride[nmodes-1] = 1;
+  for(idx_t m=nmodes-1; m > 0; --m) {
+    stride[m-1] = stride[m] * ranks[m];
+  }
+
+  val_t const * const restrict uvals = U->vals;
+  val_t const * const restrict yvals = Y->vals;
+  val_t normsq = 0.;
+
+  #pragma omp parallel reduction(+:normsq)
+  {
+    val_t * grow = splatt_malloc(ncols * sizeof(*grow));
+
+    #pragma omp for schedule(static)
+    for(idx_t a=0; a < R; ++a) {
+      /* row 'a' of U^T Y */
+      for(idx_t c=0; c < ncols; ++c) {
+        grow[c] = 0.;
+      }
+      for(idx_t i=0; i < I; ++i) {
+        val_t const u = uvals[a + (i*R)];
+        val_t const * const restrict yrow = yvals + (i * ncols);
+        for(idx_t c=0; c < ncols; ++c) {
+          grow[c] += u * yrow[c];
+        }
+      }
+
+      /* scatter to the core, decoding the column with the leaf fastest */
+      for(idx_t c=0; c < ncols; ++c) {
+        idx_t rem = c;
+        idx_t offset = a * stride[root];
+        for(idx_t d=nmodes-1; d > 0; --d) {
+          idx_t const m = csf_depth_to_mode(csf, d);
+          offset += (rem % ranks[m]) * stride[m];
+          rem /= ranks[m];
+        }
+        core[offset] = grow[c];
+        normsq += grow[c] * grow[c];
+      }
+    }
+
+    splatt_free(grow);
+  } /* end omp parallel */
+
+  return normsq;
+}
+
+
+/**
+* @brief Reduce each rank to at most the mode's dimension and the product of
+*        the other ranks. Larger ranks cannot be captured by HOOI, since the
+*        TTMc of a mode has only that many rows and columns.
+*
+* @param nmodes The number of modes.
+* @param dims The dimension of each mode.
+* @param[out] ranks The ranks to reduce.
+*/
+static void p_clamp_ranks(
+    idx_t const nmodes,
+    idx_t const * const dims,
+    idx_t * const ranks)
+{
+  for(idx_t m=0; m < nmodes; ++m) {
+    ranks[m] = SS_MIN(ranks[m], dims[m]);
+  }
+
+  /* reducing one rank can constrain the others */
+  bool changed = true;
+  while(changed) {
+    changed = false;
+    for(idx_t m=0; m < nmodes; ++m) {
+      idx_t others = 1;
+      for(idx_t n=0; n < nmodes; ++n) {
+        if(n != m) {
+          others *= ranks[n];
+        }
+      }
+      if(ranks[m] > others) {
+        ranks[m] = others;
+        changed = true;
+      }
+    }
+  }
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+void tucker_leading_svecs(
+    val_t const * const A,
+    idx_t const nrows,
+    idx_t const ncols,
+    matrix_t * const U)
+{
+  timer_start(&timers[TIMER_SVD]);
+  assert(U->J <= SS_MIN(nrows, ncols));
+
+  if(ncols >= nrows || !p_gram_svecs(A, nrows, ncols, U)) {
+    p_svd_svecs(A, nrows, ncols, U);
+  }
+
+  timer_stop(&timers[TIMER_SVD]);
+}
+
+
+double tucker_hooi_iterate(
+  splatt_csf const * const tensors,
+  matrix_t ** mats,
+  val_t * const core,
+  double const * const opts)
+{
+  idx_t const nmodes = tensors->nmodes;
+  idx_t const nthreads = (idx_t) opts[SPLATT_OPTION_NTHREADS];
+
+  idx_t ranks[MAX_NMODES];
+  for(idx_t m=0; m < nmodes; ++m) {
+    ranks[m] = mats[m]->J;
+  }
+
+  /* one TTMc buffer, reshaped for each mode */
+  idx_t * parts[MAX_NMODES];
+  idx_t ncols[MAX_NMODES];
+  idx_t maxsize = 0;
+  for(idx_t m=0; m < nmodes; ++m) {
+    parts[m] = csf_partition_1d(tensors + m, 0, nthreads);
+    ncols[m] = ttmc_ncols(tensors + m, ranks);
+    maxsize = SS_MAX(maxsize, tensors->dims[m] * ncols[m]);
+  }
+  matrix_t * ttmc = mat_alloc(maxsize, 1);
+
+  val_t const ttnormsq = csf_frobsq(tensors);
+
+  double fit = 0.;
+  double oldfit = 0.;
+  sp_timer_t itertime;
+  sp_timer_t modetime[MAX_NMODES];
+  timer_start(&timers[TIMER_TUCKER]);
+
+  idx_t const niters = (idx_t) opts[SPLATT_OPTION_NITER];
+  for(idx_t it=0; it < niters; ++it) {
+    timer_fstart(&itertime);
+    for(idx_t m=0; m < nmodes; ++m) {
+      timer_fstart(&modetime[m]);
+      ttmc->I = tensors->dims[m];
+      ttmc->J = ncols[m];
+
+      ttmc_csf(tensors + m, mats, parts[m], ttmc, opts);
+      tucker_leading_svecs(ttmc->vals, ttmc->I, ttmc->J, mats[m]);
+      timer_stop(&modetime[m]);
+    }
+
+    /* the last TTMc is still in the buffer */
+    val_t const gnormsq = p_form_core(tensors + (nmodes-1), mats[nmodes-1],
+        ttmc, ranks, core);
+    if(ttnormsq > 0.) {
+      fit = 1. - sqrt(SS_MAX(ttnormsq - gnormsq, 0.) / ttnormsq);
+    } else {
+      fit = 1.;
+    }
+    timer_stop(&itertime);
+
+    if(opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_NONE) {
+      printf("  its = %3"SPLATT_PF_IDX" (%0.3fs)  fit = %0.5f  delta = %+0.4e\n",
+          it+1, itertime.seconds, fit, fit - oldfit);
+      if(opts[SPLATT_OPTION_VERBOSITY] > SPLATT_VERBOSITY_LOW) {
+        for(idx_t m=0; m < nmodes; ++m) {
+          printf("     mode = %1"SPLATT_PF_IDX" (%0.3fs)\n", m+1,
+              modetime[m].seconds);
+        }
+      }
+    }
+
+    if(fit == 1. ||
+        (it > 0 && fabs(fit - oldfit) < opts[SPLATT_OPTION_TOLERANCE])) {
+      break;
+    }
+    oldfit = fit;
+  }
+  timer_stop(&timers[TIMER_TUCKER]);
+
+  mat_free(ttmc);
+  for(idx_t m=0; m < nmodes; ++m) {
+    splatt_free(parts[m]);
+  }
+
+  return fit;
+}
+
+
+
+/******************************************************************************
+ * API FUNCTIONS
+ *****************************************************************************/
+
+int splatt_tucker_hooi(
+    splatt_csf const * const tensors,
+    splatt_idx_t const * const ranks,
+    double const * const options,
+    splatt_tucker * factored)
+{
+  if(options[SPLATT_OPTION_CSF_ALLOC] != SPLATT_CSF_ALLMODE) {
+    fprintf(stderr, "SPLATT ERROR: Tucker requires SPLATT_CSF_ALLMODE.\n");
+    return SPLATT_ERROR_BADINPUT;
+  }
+
+  idx_t const nmodes = tensors->nmodes;
+  for(idx_t m=0; m < nmodes; ++m) {
+    if(tensors[m].ntiles != 1 || csf_depth_to_mode(tensors + m, 0) != m) {
+      fprintf(stderr, "SPLATT ERROR: Tucker requires untiled CSF tensors "
+          "rooted at each mode.\n");
+      return SPLATT_ERROR_BADINPUT;
+    }
+    if(ranks[m] == 0) {
+      fprintf(stderr, "SPLATT ERROR: Tucker rank of mode %"SPLATT_PF_IDX
+          " must be positive.\n", m+1);
+      return SPLATT_ERROR_BADINPUT;
+    }
+  }
+
+  idx_t myranks[MAX_NMODES];
+  idx_t coresize = 1;
+  for(idx_t m=0; m < nmodes; ++m) {
+    myranks[m] = ranks[m];
+  }
+  p_clamp_ranks(nmodes, tensors->dims, myranks);
+  for(idx_t m=0; m < nmodes; ++m) {
+    coresize *= myranks[m];
+  }
+
+  /* random orthonormal initialization */
+  matrix_t * mats[MAX_NMODES];
+  for(idx_t m=0; m < nmodes; ++m) {
+    matrix_t * rmat = mat_rand(tensors->dims[m], myranks[m]);
+    mats[m] = mat_alloc(tensors->dims[m], myranks[m]);
+    tucker_leading_svecs(rmat->vals, rmat->I, rmat->J, mats[m]);
+    mat_free(rmat);
+  }
+
+  val_t * core = splatt_malloc(coresize * sizeof(*core));
+  factored->fit = tucker_hooi_iterate(tensors, mats, core, options);
+
+  /* store output */
+  factored->nmodes = nmodes;
+  factored->core = core;
+  for(idx_t m=0; m < nmodes; ++m) {
+    factored->dims[m] = tensors->dims[m];
+    factored->ranks[m] = myranks[m];
+    factored->factors[m] = mats[m]->vals;
+    splatt_free(mats[m]); /* just the matrix_t ptr, data is in factored */
+  }
+
+  return SPLATT_SUCCESS;
+}
+
+
+void splatt_free_tucker(
+    splatt_tucker * factored)
+{
+  splatt_free(factored->core);
+  for(idx_t m=0; m < factored->nmodes; ++m) {
+    splatt_free(factored->factors[m]);
+  }
+}
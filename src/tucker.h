@@ -0,0 +1,63 @@
+#ifndef SPLATT_TUCKER_H
+#define SPLATT_TUCKER_H
+
+#include "base.h"
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "matrix.h"
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+#define tucker_leading_svecs splatt_tucker_leading_svecs
+/**
+* @brief Compute the leading left singular vectors of a dense matrix. The
+*        TTMc of a mode is usually tall and skinny, in which case we use the
+*        eigendecomposition of its Gram matrix and fall back to the SVD if it
+*        is not accurate enough.
+*
+* @param A The row-major matrix to decompose. It is not modified.
+* @param nrows The number of rows in A.
+* @param ncols The number of columns in A.
+* @param[out] U The leading U->J left singular vectors, with U->J at most
+*               min(nrows, ncols).
+*/
+void tucker_leading_svecs(
+    val_t const * const A,
+    idx_t const nrows,
+    idx_t const ncols,
+    matrix_t * const U);
+
+
+#define tucker_hooi_iterate splatt_tucker_hooi_iterate
+/**
+* @brief Compute the Tucker decomposition with higher-order orthogonal
+*        iteration. Each mode n is updated as:
+*
+*          Y = X_(n) (U_N kron ... kron U_1), skipping U_n   (TTMc)
+*          U_n = the leading mats[n]->J left singular vectors of Y
+*
+*        The core is formed from the final TTMc, G_(N) = U_N^T Y.
+*
+* @param tensors The CSF tensors to factor, one per mode, with tensors[m]
+*                rooted at mode m and untiled.
+* @param mats [IN/OUT] The factors, which must be initialized with orthonormal
+*             columns. mats[m]->J is the rank of mode m and may not exceed
+*             mats[m]->I or the product of the other ranks.
+* @param[out] core The core tensor, with the last mode varying fastest.
+* @param opts SPLATT options array.
+*
+* @return The final fit, 1 - ||X - [[G; U_1, ..., U_N]]|| / ||X||.
+*/
+double tucker_hooi_iterate(
+  splatt_csf const * const tensors,
+  matrix_t ** mats,
+  val_t * const core,
+  double const * const opts);
+
+#endif
@@ -105,9 +105,13 @@ int * get_primes(
       }
     }
 
-    /* realloc if necessary */
+    /* grow if necessary */
     if(size == np) {
-      p = (int *) realloc(p, size * 2 * sizeof(int));
+      int * bigger = (int *) splatt_malloc(size * 2 * sizeof(int));
+      memcpy(bigger, p, size * sizeof(int));
+      splatt_free(p);
+      p = bigger;
+      size *= 2;
     }
 
     p[np++] = i;
@@ -11,3 +11,41 @@ CTEST(base, alloc_aligned)
   splatt_free(ptr);
 }
 
+
+
+CTEST(base, alloc_hugepage)
+{
+  size_t const bytes = 2 * SPLATT_HUGEPAGE_BYTES;
+  char * ptr = splatt_malloc(bytes);
+  ASSERT_EQUAL((uintptr_t) 0, (uintptr_t)ptr % SPLATT_HUGEPAGE_BYTES);
+  ptr[0] = 1;
+  ptr[bytes-1] = 1;
+  splatt_free(ptr);
+}
+
+
+CTEST(base, mem_usage)
+{
+  size_t start;
+  size_t peak;
+  splatt_mem_usage(SPLATT_MEM_MATRIX, &start, &peak);
+
+  size_t const bytes = 2 * SPLATT_MEM_TRACK_BYTES;
+  void * ptr = splatt_malloc_tag(bytes, SPLATT_MEM_MATRIX);
+
+  size_t curr;
+  splatt_mem_usage(SPLATT_MEM_MATRIX, &curr, &peak);
+  ASSERT_TRUE(curr == start + bytes);
+  ASSERT_TRUE(peak >= curr);
+
+  /* small allocations are not tracked */
+  void * small = splatt_malloc_tag(8, SPLATT_MEM_MATRIX);
+  splatt_mem_usage(SPLATT_MEM_MATRIX, &curr, &peak);
+  ASSERT_TRUE(curr == start + bytes);
+  splatt_free(small);
+
+  splatt_free(ptr);
+  splatt_mem_usage(SPLATT_MEM_MATRIX, &curr, &peak);
+  ASSERT_TRUE(curr == start);
+  ASSERT_TRUE(peak >= start + bytes);
+}
@@ -0,0 +1,131 @@
+
+#include "../src/cmtf.h"
+#include "../src/csf.h"
+#include "../src/sptensor.h"
+
+#include "ctest/ctest.h"
+#include "splatt_test.h"
+
+#include <math.h>
+
+
+/* the coupled matrix is CM_DIM x CM_COLS */
+#define CM_DIM 10
+#define CM_COLS 7
+#define CM_RANK 2
+
+
+CTEST_DATA(cmtf)
+{
+  double * opts;
+  matrix_t * truth[3];
+  matrix_t * side;
+  splatt_csf * csf;
+  spmatrix_t * coupled[3];
+};
+
+
+CTEST_SETUP(cmtf)
+{
+  data->opts = splatt_default_opts();
+  data->opts[SPLATT_OPTION_NITER] = 200;
+  data->opts[SPLATT_OPTION_TOLERANCE] = 1e-10;
+  data->opts[SPLATT_OPTION_VERBOSITY] = SPLATT_VERBOSITY_NONE;
+
+  srand(1);
+  for(idx_t m=0; m < 3; ++m) {
+    data->truth[m] = mat_alloc(CM_DIM, CM_RANK);
+    for(idx_t x=0; x < CM_DIM * CM_RANK; ++x) {
+      data->truth[m]->vals[x] = 0.1 + ((val_t) rand() / (val_t) RAND_MAX);
+    }
+  }
+  data->side = mat_alloc(CM_COLS, CM_RANK);
+  for(idx_t x=0; x < CM_COLS * CM_RANK; ++x) {
+    data->side->vals[x] = 0.1 + ((val_t) rand() / (val_t) RAND_MAX);
+  }
+
+  idx_t const dims[3] = {CM_DIM, CM_DIM, CM_DIM};
+  sptensor_t * tt = lowrank_tensor(dims, CM_RANK, data->truth);
+  data->csf = csf_alloc(tt, data->opts);
+  tt_free(tt);
+
+  /* Y = A_0 V^T, stored sparse */
+  spmatrix_t * Y = spmat_alloc(CM_DIM, CM_COLS, CM_DIM * CM_COLS);
+  idx_t nnz = 0;
+  for(idx_t i=0; i < CM_DIM; ++i) {
+    Y->rowptr[i] = nnz;
+    for(idx_t c=0; c < CM_COLS; ++c) {
+      val_t v = 0.;
+      for(idx_t r=0; r < CM_RANK; ++r) {
+        v += data->truth[0]->vals[r + (i*CM_RANK)] *
+             data->side->vals[r + (c*CM_RANK)];
+      }
+      Y->colind[nnz] = c;
+      Y->vals[nnz++] = v;
+    }
+  }
+  Y->rowptr[CM_DIM] = nnz;
+  Y->nnz = nnz;
+
+  data->coupled[0] = Y;
+  data->coupled[1] = NULL;
+  data->coupled[2] = NULL;
+}
+
+
+CTEST_TEARDOWN(cmtf)
+{
+  for(idx_t m=0; m < 3; ++m) {
+    mat_free(data->truth[m]);
+  }
+  mat_free(data->side);
+  spmat_free(data->coupled[0]);
+  csf_free(data->csf, data->opts);
+  splatt_free_opts(data->opts);
+}
+
+
+CTEST2(cmtf, bad_input)
+{
+  splatt_kruskal model;
+  matrix_t * side[3];
+  data->coupled[0]->I = CM_DIM - 1;
+  ASSERT_EQUAL(SPLATT_ERROR_BADINPUT, cmtf_factorize(data->csf,
+      data->coupled, CM_RANK, data->opts, &model, side));
+  data->coupled[0]->I = CM_DIM;
+}
+
+
+CTEST2(cmtf, factorize)
+{
+  splatt_kruskal model;
+  matrix_t * side[3];
+  srand(1);
+  ASSERT_EQUAL(SPLATT_SUCCESS, cmtf_factorize(data->csf, data->coupled,
+      CM_RANK, data->opts, &model, side));
+  ASSERT_TRUE(model.fit > 0.99);
+  ASSERT_NOT_NULL(side[0]);
+  ASSERT_NULL(side[1]);
+  ASSERT_NULL(side[2]);
+  ASSERT_EQUAL(CM_COLS, side[0]->I);
+
+  /* the reported fit matches the coupled matrix's own residual */
+  spmatrix_t const * const Y = data->coupled[0];
+  double err = 0.;
+  double norm = 0.;
+  for(idx_t i=0; i < CM_DIM; ++i) {
+    for(idx_t x=Y->rowptr[i]; x < Y->rowptr[i+1]; ++x) {
+      val_t v = 0.;
+      for(idx_t r=0; r < CM_RANK; ++r) {
+        v += model.factors[0][r + (i*CM_RANK)] *
+             side[0]->vals[r + (Y->colind[x]*CM_RANK)];
+      }
+      err += (Y->vals[x] - v) * (Y->vals[x] - v);
+      norm += Y->vals[x] * Y->vals[x];
+    }
+  }
+  ASSERT_TRUE(sqrt(err / norm) < 0.01);
+
+  mat_free(side[0]);
+  splatt_free_kruskal(&model);
+}
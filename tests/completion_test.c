@@ -0,0 +1,159 @@
+
+#include "../src/completion.h"
+#include "../src/sptensor.h"
+
+#include "ctest/ctest.h"
+#include "splatt_test.h"
+
+#include <math.h>
+
+
+#define TC_DIM 30
+#define TC_RANK 2
+
+
+/**
+* @brief Sample 'nnz' distinct entries of a random low-rank tensor.
+*
+* @param nnz The number of entries to sample.
+* @param offset Which entries to take (lets us make disjoint train/test sets).
+* @param truth The true factors.
+*
+* @return The sampled tensor.
+*/
+static sptensor_t * p_sample(
+    idx_t const nnz,
+    idx_t const offset,
+    matrix_t ** truth)
+{
+  idx_t const dims[3] = {TC_DIM, TC_DIM, TC_DIM};
+  sptensor_t * full = lowrank_tensor(dims, TC_RANK, truth);
+
+  sptensor_t * tt = tt_alloc(nnz, 3);
+  for(idx_t m=0; m < 3; ++m) {
+    tt->dims[m] = TC_DIM;
+  }
+
+  /* a fixed stride through the (TC_DIM^3) entries visits each one once */
+  for(idx_t n=0; n < nnz; ++n) {
+    idx_t const id = ((offset + n) * 7919) % full->nnz;
+    for(idx_t m=0; m < 3; ++m) {
+      tt->ind[m][n] = full->ind[m][id];
+    }
+    tt->vals[n] = full->vals[id];
+  }
+
+  tt_free(full);
+  return tt;
+}
+
+
+CTEST_DATA(completion)
+{
+  double * opts;
+  matrix_t * truth[MAX_NMODES];
+  sptensor_t * train;
+  sptensor_t * validate;
+  double baseline;
+};
+
+
+CTEST_SETUP(completion)
+{
+  data->opts = splatt_default_opts();
+  data->opts[SPLATT_OPTION_NITER] = 50;
+  data->opts[SPLATT_OPTION_TOLERANCE] = 0.;
+  data->opts[SPLATT_OPTION_REGULARIZE] = 1e-4;
+  data->opts[SPLATT_OPTION_VERBOSITY] = SPLATT_VERBOSITY_NONE;
+
+  srand(1);
+  for(idx_t m=0; m < 3; ++m) {
+    data->truth[m] = mat_alloc(TC_DIM, TC_RANK);
+    for(idx_t x=0; x < TC_DIM * TC_RANK; ++x) {
+      data->truth[m]->vals[x] = 0.5 + ((val_t) rand() / (val_t) RAND_MAX);
+    }
+  }
+
+  /* observe 30% of the entries, hold out another 5% */
+  idx_t const total = TC_DIM * TC_DIM * TC_DIM;
+  idx_t const ntrain = (3 * total) / 10;
+  data->train = p_sample(ntrain, 0, data->truth);
+  data->validate = p_sample(total / 20, ntrain, data->truth);
+
+  /* the RMSE of always predicting the mean */
+  double mean = 0.;
+  for(idx_t n=0; n < data->train->nnz; ++n) {
+    mean += data->train->vals[n];
+  }
+  mean /= data->train->nnz;
+  double err = 0.;
+  for(idx_t n=0; n < data->validate->nnz; ++n) {
+    err += (data->validate->vals[n] - mean) * (data->validate->vals[n] - mean);
+  }
+  data->baseline = sqrt(err / data->validate->nnz);
+}
+
+
+CTEST_TEARDOWN(completion)
+{
+  for(idx_t m=0; m < 3; ++m) {
+    mat_free(data->truth[m]);
+  }
+  tt_free(data->train);
+  tt_free(data->validate);
+  splatt_free_opts(data->opts);
+}
+
+
+CTEST2(completion, rmse)
+{
+  /* the true model is exact */
+  ASSERT_DBL_NEAR_TOL(0., tc_rmse(data->validate, data->truth, data->opts),
+      1e-6);
+
+  /* perturbing one entry of the model is seen */
+  data->truth[0]->vals[0] += 1.;
+  ASSERT_TRUE(tc_rmse(data->train, data->truth, data->opts) > 0.);
+}
+
+
+CTEST2(completion, als)
+{
+  splatt_kruskal model;
+  srand(1);
+  ASSERT_EQUAL(SPLATT_SUCCESS, tc_complete(data->train, data->validate,
+      TC_RANK, SPLATT_TC_ALS, data->opts, &model));
+  ASSERT_TRUE(model.fit < 0.1 * data->baseline);
+  ASSERT_DBL_NEAR_TOL(model.fit,
+      tc_rmse(data->validate, (matrix_t *[]) {
+          &(matrix_t){TC_DIM, TC_RANK, model.factors[0], 1},
+          &(matrix_t){TC_DIM, TC_RANK, model.factors[1], 1},
+          &(matrix_t){TC_DIM, TC_RANK, model.factors[2], 1}}, data->opts),
+      1e-8);
+  splatt_free_kruskal(&model);
+}
+
+
+CTEST2(completion, ccd)
+{
+  splatt_kruskal model;
+  srand(1);
+  ASSERT_EQUAL(SPLATT_SUCCESS, tc_complete(data->train, data->validate,
+      TC_RANK, SPLATT_TC_CCD, data->opts, &model));
+  ASSERT_TRUE(model.fit < 0.1 * data->baseline);
+  splatt_free_kruskal(&model);
+}
+
+
+CTEST2(completion, sgd)
+{
+  data->opts[SPLATT_OPTION_LEARNRATE] = 1e-2;
+
+  splatt_kruskal model;
+  srand(1);
+  ASSERT_EQUAL(SPLATT_SUCCESS, tc_complete(data->train, data->validate,
+      TC_RANK, SPLATT_TC_SGD, data->opts, &model));
+  ASSERT_TRUE(isfinite(model.fit));
+  ASSERT_TRUE(model.fit < 0.5 * data->baseline);
+  splatt_free_kruskal(&model);
+}
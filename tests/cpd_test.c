@@ -0,0 +1,648 @@
+
+#include "../src/sptensor.h"
+#include "../src/csf.h"
+#include "../src/cpd.h"
+#include "../src/cprand.h"
+#include "../src/cpapr.h"
+#include "../src/io.h"
+#include "../src/timer.h"
+
+#include "ctest/ctest.h"
+#include "splatt_test.h"
+
+/* API includes */
+#include "../include/splatt.h"
+
+#include <math.h>
+
+
+CTEST_DATA(cpd)
+{
+  double * opts;
+  splatt_idx_t ntensors;
+  sptensor_t * tensors[MAX_DSETS];
+};
+
+CTEST_SETUP(cpd)
+{
+  data->opts = splatt_default_opts();
+  data->opts[SPLATT_OPTION_NITER] = 10;
+  data->opts[SPLATT_OPTION_VERBOSITY] = SPLATT_VERBOSITY_NONE;
+
+  data->ntensors = sizeof(datasets) / sizeof(datasets[0]);
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    data->tensors[i] = tt_read(datasets[i]);
+  }
+}
+
+CTEST_TEARDOWN(cpd)
+{
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    tt_free(data->tensors[i]);
+  }
+  splatt_free_opts(data->opts);
+}
+
+
+CTEST2(cpd, warm_start)
+{
+  idx_t const rank = 5;
+
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    splatt_csf * csf = csf_alloc(data->tensors[i], data->opts);
+
+    splatt_kruskal cold;
+    ASSERT_EQUAL(SPLATT_SUCCESS, splatt_cpd_als(csf, rank, data->opts, &cold));
+
+    /* resuming from a converged(ish) factorization should not lose fit */
+    splatt_kruskal warm;
+    ASSERT_EQUAL(SPLATT_SUCCESS,
+        splatt_cpd_als_warm(csf, rank, data->opts, &cold, &warm));
+    ASSERT_TRUE(warm.fit >= cold.fit - 1e-6);
+
+    /* a larger rank is also accepted */
+    splatt_kruskal bigger;
+    ASSERT_EQUAL(SPLATT_SUCCESS,
+        splatt_cpd_als_warm(csf, rank+2, data->opts, &cold, &bigger));
+    ASSERT_EQUAL(rank+2, bigger.rank);
+
+    /* but a smaller one is not */
+    splatt_kruskal smaller;
+    ASSERT_EQUAL(SPLATT_ERROR_BADINPUT,
+        splatt_cpd_als_warm(csf, rank-1, data->opts, &cold, &smaller));
+
+    splatt_free_kruskal(&cold);
+    splatt_free_kruskal(&warm);
+    splatt_free_kruskal(&bigger);
+    csf_free(csf, data->opts);
+  }
+}
+
+
+CTEST2(cpd, warm_start_growth)
+{
+  idx_t const rank = 4;
+
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    sptensor_t * const tt = data->tensors[i];
+    splatt_csf * csf = csf_alloc(tt, data->opts);
+
+    splatt_kruskal cold;
+    ASSERT_EQUAL(SPLATT_SUCCESS, splatt_cpd_als(csf, rank, data->opts, &cold));
+
+    /* pretend the first mode has grown by chopping rows from init */
+    idx_t const olddim = cold.dims[0];
+    cold.dims[0] = olddim / 2;
+
+    splatt_kruskal warm;
+    ASSERT_EQUAL(SPLATT_SUCCESS,
+        splatt_cpd_als_warm(csf, rank, data->opts, &cold, &warm));
+    ASSERT_EQUAL(olddim, warm.dims[0]);
+    for(idx_t x=0; x < olddim * rank; ++x) {
+      ASSERT_TRUE(isfinite(warm.factors[0][x]));
+    }
+    ASSERT_TRUE(warm.fit > 0.);
+
+    /* init cannot be larger than the tensor */
+    cold.dims[0] = olddim + 1;
+    splatt_kruskal bad;
+    ASSERT_EQUAL(SPLATT_ERROR_BADINPUT,
+        splatt_cpd_als_warm(csf, rank, data->opts, &cold, &bad));
+
+    splatt_free_kruskal(&cold);
+    splatt_free_kruskal(&warm);
+    csf_free(csf, data->opts);
+  }
+}
+
+
+CTEST2(cpd, checkpoint_restart)
+{
+  idx_t const rank = 4;
+  char const * const fname = "tmp.chkpt";
+
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    /* tiny tensors are fit exactly in one iteration */
+    if(data->tensors[i]->nnz < 100) {
+      continue;
+    }
+    splatt_csf * csf = csf_alloc(data->tensors[i], data->opts);
+
+    /* run three iterations, checkpointing each one */
+    data->opts[SPLATT_OPTION_NITER] = 3;
+    data->opts[SPLATT_OPTION_TOLERANCE] = 0.;
+    cpd_checkpoint * chkpt = chkpt_alloc(fname, 1, 0.);
+    splatt_kruskal first;
+    ASSERT_EQUAL(SPLATT_SUCCESS,
+        cpd_als_chkpt(csf, rank, data->opts, NULL, chkpt, &first));
+    chkpt_free(chkpt);
+
+    /* the checkpoint should describe the final iteration */
+    chkpt = chkpt_alloc(fname, 0, 0.);
+    splatt_kruskal saved;
+    ASSERT_EQUAL(SPLATT_SUCCESS, chkpt_read(chkpt, &saved));
+    ASSERT_EQUAL(3, chkpt->start_it);
+    ASSERT_DBL_NEAR_TOL(first.fit, chkpt->start_fit, 1e-12);
+    ASSERT_EQUAL(csf->nmodes, saved.nmodes);
+    ASSERT_EQUAL(rank, saved.rank);
+    for(idx_t m=0; m < csf->nmodes; ++m) {
+      ASSERT_EQUAL(csf->dims[m], saved.dims[m]);
+    }
+
+    /* resume for three more and make sure we did not start over */
+    data->opts[SPLATT_OPTION_NITER] = 6;
+    splatt_kruskal resumed;
+    ASSERT_EQUAL(SPLATT_SUCCESS,
+        cpd_als_chkpt(csf, rank, data->opts, &saved, chkpt, &resumed));
+    ASSERT_TRUE(resumed.fit >= first.fit - 1e-6);
+
+    chkpt_free(chkpt);
+    splatt_free_kruskal(&first);
+    splatt_free_kruskal(&saved);
+    splatt_free_kruskal(&resumed);
+    csf_free(csf, data->opts);
+  }
+
+  remove(fname);
+}
+
+
+/**
+* @brief Run CPD-ALS from a fixed seed and count its iterations, which are
+*        recorded by a checkpoint written after every one.
+*/
+static idx_t p_cpd_iters(
+    splatt_csf const * const csf,
+    idx_t const rank,
+    double const * const opts,
+    splatt_kruskal * const factored)
+{
+  char const * const fname = "tmp.chkpt";
+
+  srand(1);
+  cpd_checkpoint * chkpt = chkpt_alloc(fname, 1, 0.);
+  ASSERT_EQUAL(SPLATT_SUCCESS,
+      cpd_als_chkpt(csf, rank, opts, NULL, chkpt, factored));
+  chkpt_free(chkpt);
+
+  chkpt = chkpt_alloc(fname, 0, 0.);
+  splatt_kruskal saved;
+  ASSERT_EQUAL(SPLATT_SUCCESS, chkpt_read(chkpt, &saved));
+  idx_t const its = chkpt->start_it;
+  splatt_free_kruskal(&saved);
+  chkpt_free(chkpt);
+  remove(fname);
+
+  return its;
+}
+
+
+CTEST2(cpd, linesearch)
+{
+  /* ALS crawls on a model with strongly correlated (positive) columns, which
+   * is where extrapolation should pay off */
+  idx_t const rank = 3;
+  idx_t const dims[3] = {30, 30, 30};
+  srand(1);
+  matrix_t * truth[3];
+  for(idx_t m=0; m < 3; ++m) {
+    truth[m] = mat_alloc(dims[m], rank);
+    for(idx_t x=0; x < dims[m] * rank; ++x) {
+      truth[m]->vals[x] = 0.1 + ((val_t) rand() / (val_t) RAND_MAX);
+    }
+  }
+  sptensor_t * tt = lowrank_tensor(dims, rank, truth);
+  splatt_csf * csf = csf_alloc(tt, data->opts);
+
+  data->opts[SPLATT_OPTION_NITER] = 1000;
+  data->opts[SPLATT_OPTION_TOLERANCE] = 1e-6;
+
+  /* unconstrained, then with AO-ADMM, whose duals must move with the
+   * factors for the extrapolated state to be consistent */
+  for(int l1=0; l1 < 2; ++l1) {
+    data->opts[SPLATT_OPTION_L1] = (double) l1;
+
+    data->opts[SPLATT_OPTION_LINESEARCH] = 0;
+    splatt_kruskal plain;
+    idx_t const plain_its = p_cpd_iters(csf, rank, data->opts, &plain);
+
+    data->opts[SPLATT_OPTION_LINESEARCH] = 1;
+    splatt_kruskal factored;
+    idx_t const ls_its = p_cpd_iters(csf, rank, data->opts, &factored);
+
+    /* extrapolating from the same start should converge sooner */
+    if(!l1) {
+      ASSERT_TRUE(ls_its < plain_its);
+    }
+    ASSERT_TRUE(factored.fit >= plain.fit - 1e-4);
+    ASSERT_TRUE(factored.fit <= 1. + 1e-8);
+    for(idx_t m=0; m < factored.nmodes; ++m) {
+      for(idx_t x=0; x < factored.dims[m] * rank; ++x) {
+        ASSERT_TRUE(isfinite(factored.factors[m][x]));
+      }
+    }
+
+    splatt_free_kruskal(&plain);
+    splatt_free_kruskal(&factored);
+  }
+
+  csf_free(csf, data->opts);
+  tt_free(tt);
+  for(idx_t m=0; m < 3; ++m) {
+    mat_free(truth[m]);
+  }
+}
+
+
+CTEST2(cpd, multistart)
+{
+  idx_t const rank = 4;
+  data->opts[SPLATT_OPTION_NTHREADS] = 2;
+
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    splatt_csf * csf = csf_alloc(data->tensors[i], data->opts);
+
+    srand(1);
+    splatt_kruskal single;
+    ASSERT_EQUAL(SPLATT_SUCCESS,
+        splatt_cpd_als(csf, rank, data->opts, &single));
+
+    /* the first start is the same as a single run, so we can only improve */
+    srand(1);
+    splatt_kruskal best;
+    double const mttkrp_seconds = timers[TIMER_MTTKRP].seconds;
+    ASSERT_EQUAL(SPLATT_SUCCESS,
+        splatt_cpd_als_multistart(csf, rank, 3, data->opts, &best));
+    ASSERT_EQUAL(rank, best.rank);
+    ASSERT_TRUE(best.fit >= single.fit - 1e-10);
+
+    /* concurrent starts leave the (unsynchronized) global timers alone */
+    ASSERT_DBL_NEAR_TOL(mttkrp_seconds, timers[TIMER_MTTKRP].seconds, 0.);
+    ASSERT_FALSE(timers[TIMER_MTTKRP].paused);
+
+    splatt_kruskal none;
+    ASSERT_EQUAL(SPLATT_ERROR_BADINPUT,
+        splatt_cpd_als_multistart(csf, rank, 0, data->opts, &none));
+
+    splatt_free_kruskal(&single);
+    splatt_free_kruskal(&best);
+    csf_free(csf, data->opts);
+  }
+}
+
+
+CTEST2(cpd, rank_sweep)
+{
+  splatt_idx_t const ranks[] = {2, 3, 3, 5};
+  idx_t const nranks = sizeof(ranks) / sizeof(ranks[0]);
+
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    splatt_csf * csf = csf_alloc(data->tensors[i], data->opts);
+
+    splatt_kruskal factored[4];
+    double seconds[4];
+    ASSERT_EQUAL(SPLATT_SUCCESS, splatt_cpd_als_sweep(csf, ranks, nranks,
+        data->opts, factored, seconds));
+    for(idx_t r=0; r < nranks; ++r) {
+      ASSERT_EQUAL(ranks[r], factored[r].rank);
+      ASSERT_TRUE(isfinite(factored[r].fit));
+      ASSERT_TRUE(seconds[r] >= 0.);
+    }
+
+    /* a repeated rank resumes from the previous one */
+    ASSERT_TRUE(factored[2].fit >= factored[1].fit - 1e-6);
+
+    for(idx_t r=0; r < nranks; ++r) {
+      splatt_free_kruskal(factored + r);
+    }
+
+    /* ranks cannot decrease */
+    splatt_idx_t const bad[] = {3, 2};
+    ASSERT_EQUAL(SPLATT_ERROR_BADINPUT,
+        splatt_cpd_als_sweep(csf, bad, 2, data->opts, factored, NULL));
+
+    csf_free(csf, data->opts);
+  }
+}
+
+
+CTEST2(cpd, rank_sweep_sparse)
+{
+  splatt_idx_t const ranks[] = {2, 3, 6};
+  idx_t const nranks = sizeof(ranks) / sizeof(ranks[0]);
+
+  /* every factor keeps a sparse pattern, which must grow with the rank */
+  data->opts[SPLATT_OPTION_NNCPD] = 1;
+  data->opts[SPLATT_OPTION_SPFACTOR] = 1.;
+  data->opts[SPLATT_OPTION_NTHREADS] = 2;
+
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    splatt_csf * csf = csf_alloc(data->tensors[i], data->opts);
+
+    splatt_kruskal factored[3];
+    ASSERT_EQUAL(SPLATT_SUCCESS, splatt_cpd_als_sweep(csf, ranks, nranks,
+        data->opts, factored, NULL));
+    for(idx_t r=0; r < nranks; ++r) {
+      ASSERT_EQUAL(ranks[r], factored[r].rank);
+      ASSERT_TRUE(isfinite(factored[r].fit));
+      splatt_free_kruskal(factored + r);
+    }
+
+    csf_free(csf, data->opts);
+  }
+}
+
+
+CTEST2(cpd, mem_balanced)
+{
+  idx_t const rank = 5;
+  data->opts[SPLATT_OPTION_NTHREADS] = 2;
+  data->opts[SPLATT_OPTION_TILE] = SPLATT_DENSETILE;
+
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    size_t before;
+    size_t after;
+    size_t peak;
+    splatt_mem_usage(SPLATT_MEM_NTAGS, &before, &peak);
+
+    /* every tracked allocation is returned with splatt_free() */
+    splatt_csf * csf = csf_alloc(data->tensors[i], data->opts);
+    splatt_kruskal factored;
+    ASSERT_EQUAL(SPLATT_SUCCESS,
+        splatt_cpd_als(csf, rank, data->opts, &factored));
+    splatt_free_kruskal(&factored);
+    csf_free(csf, data->opts);
+
+    splatt_mem_usage(SPLATT_MEM_NTAGS, &after, &peak);
+    ASSERT_TRUE(after == before);
+    ASSERT_TRUE(peak > before);
+  }
+}
+
+
+CTEST2(cpd, cprand_exact)
+{
+  idx_t const rank = 5;
+  data->opts[SPLATT_OPTION_FITFREQ] = 1;
+  data->opts[SPLATT_OPTION_NSAMPLES] = 1e9;
+  data->opts[SPLATT_OPTION_CSF_ALLOC] = SPLATT_CSF_ALLMODE;
+
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    splatt_csf * csf = csf_alloc(data->tensors[i], data->opts);
+    splatt_csf * leaves = cprand_csf_alloc(data->tensors[i], data->opts);
+
+    /* sampling every fiber is just ALS */
+    splatt_kruskal als;
+    srand(1);
+    ASSERT_EQUAL(SPLATT_SUCCESS, splatt_cpd_als(csf, rank, data->opts, &als));
+
+    splatt_kruskal sketched;
+    srand(1);
+    ASSERT_EQUAL(SPLATT_SUCCESS,
+        cprand_cpd(leaves, rank, data->opts, &sketched));
+    ASSERT_DBL_NEAR_TOL(als.fit, sketched.fit, 1e-6);
+
+    splatt_free_kruskal(&als);
+    splatt_free_kruskal(&sketched);
+    csf_free(leaves, data->opts);
+    csf_free(csf, data->opts);
+  }
+}
+
+
+CTEST2(cpd, cprand_restore)
+{
+  /* A tensor of ones in which every index of every mode appears in exactly
+   * DIM non-zeros, each fiber holding one of them. From a constant start, a
+   * sketch recovers the sampled rows exactly, so the whole sketched step must
+   * match an exact ALS step -- including the rows no sample touched. */
+  idx_t const DIM = 20;
+  idx_t const nmodes = 3;
+  sptensor_t * tt = tt_alloc(DIM * DIM, nmodes);
+  for(idx_t m=0; m < nmodes; ++m) {
+    tt->dims[m] = DIM;
+  }
+  for(idx_t i=0; i < DIM; ++i) {
+    for(idx_t j=0; j < DIM; ++j) {
+      tt->ind[0][j + (i*DIM)] = i;
+      tt->ind[1][j + (i*DIM)] = j;
+      tt->ind[2][j + (i*DIM)] = (i + j) % DIM;
+      tt->vals[j + (i*DIM)] = 1.;
+    }
+  }
+
+  data->opts[SPLATT_OPTION_NITER] = 1;
+  data->opts[SPLATT_OPTION_FITFREQ] = 100;
+  data->opts[SPLATT_OPTION_CSF_ALLOC] = SPLATT_CSF_ALLMODE;
+  splatt_csf * leaves = cprand_csf_alloc(tt, data->opts);
+
+  rank_info rinfo;
+  rinfo.rank = 0;
+
+  /* exact ALS, then a sketch which leaves most rows unsampled */
+  double const nsamples[2] = {1e9, 5};
+  matrix_t * mats[2][MAX_NMODES+1];
+  val_t lambda[2];
+  for(idx_t s=0; s < 2; ++s) {
+    for(idx_t m=0; m < nmodes; ++m) {
+      mats[s][m] = mat_alloc(DIM, 1);
+      for(idx_t i=0; i < DIM; ++i) {
+        mats[s][m]->vals[i] = 0.5;
+      }
+    }
+    mats[s][MAX_NMODES] = mat_alloc(DIM, 1);
+
+    data->opts[SPLATT_OPTION_NSAMPLES] = nsamples[s];
+    srand(1);
+    cprand_iterate(leaves, mats[s], lambda + s, 1, &rinfo, data->opts);
+  }
+
+  ASSERT_DBL_NEAR_TOL(lambda[0], lambda[1], 1e-8);
+  for(idx_t m=0; m < nmodes; ++m) {
+    for(idx_t i=0; i < DIM; ++i) {
+      ASSERT_DBL_NEAR_TOL(mats[0][m]->vals[i], mats[1][m]->vals[i], 1e-8);
+    }
+  }
+
+  for(idx_t s=0; s < 2; ++s) {
+    for(idx_t m=0; m < nmodes; ++m) {
+      mat_free(mats[s][m]);
+    }
+    mat_free(mats[s][MAX_NMODES]);
+  }
+  csf_free(leaves, data->opts);
+  tt_free(tt);
+}
+
+
+CTEST2(cpd, cprand)
+{
+  idx_t const rank = 5;
+  data->opts[SPLATT_OPTION_NSAMPLES] = 100;
+  data->opts[SPLATT_OPTION_CSF_ALLOC] = SPLATT_CSF_ALLMODE;
+
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    splatt_csf * leaves = cprand_csf_alloc(data->tensors[i], data->opts);
+
+    splatt_kruskal factored;
+    ASSERT_EQUAL(SPLATT_SUCCESS,
+        cprand_cpd(leaves, rank, data->opts, &factored));
+    ASSERT_TRUE(factored.fit <= 1. + 1e-8);
+    for(idx_t m=0; m < factored.nmodes; ++m) {
+      for(idx_t x=0; x < factored.dims[m] * rank; ++x) {
+        ASSERT_TRUE(isfinite(factored.factors[m][x]));
+      }
+    }
+
+    splatt_free_kruskal(&factored);
+    csf_free(leaves, data->opts);
+  }
+}
+
+
+CTEST2(cpd, nncpd)
+{
+  idx_t const rank = 5;
+  data->opts[SPLATT_OPTION_NNCPD] = 1;
+
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    splatt_csf * csf = csf_alloc(data->tensors[i], data->opts);
+
+    splatt_kruskal factored;
+    ASSERT_EQUAL(SPLATT_SUCCESS,
+        splatt_cpd_als(csf, rank, data->opts, &factored));
+    ASSERT_TRUE(isfinite(factored.fit));
+    ASSERT_TRUE(factored.fit <= 1. + 1e-8);
+    for(idx_t m=0; m < factored.nmodes; ++m) {
+      for(idx_t x=0; x < factored.dims[m] * rank; ++x) {
+        ASSERT_TRUE(factored.factors[m][x] >= 0.);
+      }
+    }
+
+    splatt_free_kruskal(&factored);
+    csf_free(csf, data->opts);
+  }
+}
+
+
+CTEST2(cpd, l1)
+{
+  idx_t const rank = 5;
+  data->opts[SPLATT_OPTION_L1] = 1e-2;
+
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    splatt_csf * csf = csf_alloc(data->tensors[i], data->opts);
+
+    splatt_kruskal factored;
+    ASSERT_EQUAL(SPLATT_SUCCESS,
+        splatt_cpd_als(csf, rank, data->opts, &factored));
+    ASSERT_TRUE(isfinite(factored.fit));
+    for(idx_t m=0; m < factored.nmodes; ++m) {
+      for(idx_t x=0; x < factored.dims[m] * rank; ++x) {
+        ASSERT_TRUE(isfinite(factored.factors[m][x]));
+      }
+    }
+
+    splatt_free_kruskal(&factored);
+    csf_free(csf, data->opts);
+  }
+}
+
+
+CTEST2(cpd, hals)
+{
+  idx_t const rank = 5;
+  data->opts[SPLATT_OPTION_NNCPD] = 1;
+  data->opts[SPLATT_OPTION_NNSOLVER] = SPLATT_NNSOLVER_HALS;
+
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    splatt_csf * csf = csf_alloc(data->tensors[i], data->opts);
+
+    splatt_kruskal factored;
+    ASSERT_EQUAL(SPLATT_SUCCESS,
+        splatt_cpd_als(csf, rank, data->opts, &factored));
+    ASSERT_TRUE(isfinite(factored.fit));
+    ASSERT_TRUE(factored.fit <= 1. + 1e-8);
+    for(idx_t m=0; m < factored.nmodes; ++m) {
+      for(idx_t x=0; x < factored.dims[m] * rank; ++x) {
+        ASSERT_TRUE(factored.factors[m][x] >= 0.);
+      }
+    }
+
+    splatt_free_kruskal(&factored);
+    csf_free(csf, data->opts);
+  }
+}
+
+
+CTEST2(cpd, svd_init)
+{
+  idx_t const rank = 5;
+  data->opts[SPLATT_OPTION_INIT] = SPLATT_INIT_SVD;
+  data->opts[SPLATT_OPTION_NITER] = 1;
+
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    splatt_csf * csf = csf_alloc(data->tensors[i], data->opts);
+
+    splatt_kruskal factored;
+    ASSERT_EQUAL(SPLATT_SUCCESS,
+        splatt_cpd_als(csf, rank, data->opts, &factored));
+    ASSERT_TRUE(isfinite(factored.fit));
+    ASSERT_TRUE(factored.fit <= 1. + 1e-8);
+    for(idx_t m=0; m < factored.nmodes; ++m) {
+      for(idx_t x=0; x < factored.dims[m] * rank; ++x) {
+        ASSERT_TRUE(isfinite(factored.factors[m][x]));
+      }
+    }
+
+    splatt_free_kruskal(&factored);
+    csf_free(csf, data->opts);
+  }
+}
+
+
+CTEST2(cpd, cpapr)
+{
+  idx_t const rank = 5;
+  data->opts[SPLATT_OPTION_CSF_ALLOC] = SPLATT_CSF_ALLMODE;
+
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    /* Poisson models need non-negative data */
+    sptensor_t * const tt = data->tensors[i];
+    for(idx_t n=0; n < tt->nnz; ++n) {
+      tt->vals[n] = fabs(tt->vals[n]);
+    }
+    splatt_csf * csf = csf_alloc(tt, data->opts);
+
+    data->opts[SPLATT_OPTION_NITER] = 1;
+    splatt_kruskal first;
+    srand(1);
+    ASSERT_EQUAL(SPLATT_SUCCESS, cpapr_cpd(csf, rank, data->opts, &first));
+
+    data->opts[SPLATT_OPTION_NITER] = 10;
+    splatt_kruskal factored;
+    srand(1);
+    ASSERT_EQUAL(SPLATT_SUCCESS, cpapr_cpd(csf, rank, data->opts, &factored));
+
+    /* multiplicative updates never decrease the likelihood */
+    ASSERT_TRUE(isfinite(factored.fit));
+    ASSERT_TRUE(factored.fit >= first.fit - 1e-6 * fabs(first.fit));
+
+    /* factors are non-negative with columns that sum to one */
+    for(idx_t m=0; m < factored.nmodes; ++m) {
+      for(idx_t f=0; f < rank; ++f) {
+        double sum = 0.;
+        for(idx_t r=0; r < factored.dims[m]; ++r) {
+          val_t const v = factored.factors[m][f + (r*rank)];
+          ASSERT_TRUE(v >= 0.);
+          sum += v;
+        }
+        ASSERT_DBL_NEAR_TOL(1., sum, 1e-4);
+      }
+    }
+
+    splatt_free_kruskal(&first);
+    splatt_free_kruskal(&factored);
+    csf_free(csf, data->opts);
+  }
+}
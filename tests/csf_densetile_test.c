@@ -55,9 +55,9 @@ CTEST2(csf_densetile, csf_one_fill5)
     }
   }
 
-  free(nnzptr);
+  splatt_free(nnzptr);
   csf_free(cs, opts);
-  free(opts);
+  splatt_free_opts(opts);
 }
 
 
@@ -101,7 +101,7 @@ CTEST2(csf_densetile, csf_one_fill1)
     }
   }
 
-  free(nnzptr);
+  splatt_free(nnzptr);
   csf_free(cs, opts);
-  free(opts);
+  splatt_free_opts(opts);
 }
@@ -25,7 +25,7 @@ CTEST_SETUP(csf_one_init)
 CTEST_TEARDOWN(csf_one_init)
 {
   tt_free(data->tt);
-  free(data->opts);
+  splatt_free_opts(data->opts);
 }
 
 CTEST2(csf_one_init, fill)
@@ -201,3 +201,33 @@ CTEST2(csf_one_init, dense_tiled_normsq)
     ASSERT_DBL_NEAR_TOL(gold_norm, mynorm, 1e-5);
   }
 }
+
+
+CTEST2(csf_one_init, placed)
+{
+  /* placing the tree for several threads must not change it */
+  splatt_csf * gold = csf_alloc(data->tt, data->opts);
+  data->opts[SPLATT_OPTION_NTHREADS] = 3;
+  splatt_csf * cs = csf_alloc(data->tt, data->opts);
+
+  idx_t const nmodes = cs->nmodes;
+  csf_sparsity const * const gpt = gold->pt;
+  csf_sparsity const * const pt = cs->pt;
+  for(idx_t m=0; m < nmodes; ++m) {
+    ASSERT_EQUAL(gpt->nfibs[m], pt->nfibs[m]);
+    if(m < nmodes-1) {
+      ASSERT_EQUAL(0, memcmp(gpt->fptr[m], pt->fptr[m],
+          (pt->nfibs[m]+1) * sizeof(**(pt->fptr))));
+    }
+    if(gpt->fids[m] == NULL) {
+      ASSERT_NULL(pt->fids[m]);
+    } else {
+      ASSERT_EQUAL(0, memcmp(gpt->fids[m], pt->fids[m],
+          pt->nfibs[m] * sizeof(**(pt->fids))));
+    }
+  }
+  ASSERT_EQUAL(0, memcmp(gpt->vals, pt->vals, cs->nnz * sizeof(*(pt->vals))));
+
+  csf_free(gold, data->opts);
+  csf_free(cs, data->opts);
+}
@@ -0,0 +1,198 @@
+
+#include "../src/gcp.h"
+#include "../src/sptensor.h"
+
+#include "ctest/ctest.h"
+#include "splatt_test.h"
+
+#include <math.h>
+
+
+#define GC_DIM 12
+#define GC_RANK 2
+
+
+/**
+* @brief Evaluate a Kruskal tensor at one coordinate.
+*/
+static val_t p_kruskal_val(
+    splatt_kruskal const * const model,
+    idx_t const i,
+    idx_t const j,
+    idx_t const k)
+{
+  idx_t const R = model->rank;
+  val_t v = 0.;
+  for(idx_t r=0; r < R; ++r) {
+    v += model->lambda[r] *
+        model->factors[0][r + (i*R)] *
+        model->factors[1][r + (j*R)] *
+        model->factors[2][r + (k*R)];
+  }
+  return v;
+}
+
+
+/**
+* @brief Build a GC_DIM^3 tensor from a random low-rank model. Entries are
+*        kept if 'binary' is false, and otherwise replaced with a draw from
+*        Bernoulli(sigmoid(value)), keeping only the ones.
+*/
+static sptensor_t * p_lowrank(
+    bool const binary)
+{
+  idx_t const dims[3] = {GC_DIM, GC_DIM, GC_DIM};
+  matrix_t * truth[3];
+  for(idx_t m=0; m < 3; ++m) {
+    truth[m] = mat_alloc(GC_DIM, GC_RANK);
+    for(idx_t x=0; x < GC_DIM * GC_RANK; ++x) {
+      val_t const u = (val_t) rand() / (val_t) RAND_MAX;
+      truth[m]->vals[x] = binary ? (4. * u) - 2. : 0.2 + u;
+    }
+  }
+
+  sptensor_t * tt = lowrank_tensor(dims, GC_RANK, truth);
+  for(idx_t m=0; m < 3; ++m) {
+    mat_free(truth[m]);
+  }
+  if(!binary) {
+    return tt;
+  }
+
+  idx_t n = 0;
+  for(idx_t x=0; x < tt->nnz; ++x) {
+    val_t const p = 1. / (1. + exp(-tt->vals[x]));
+    if((val_t) rand() / (val_t) RAND_MAX >= p) {
+      continue;
+    }
+    for(idx_t m=0; m < 3; ++m) {
+      tt->ind[m][n] = tt->ind[m][x];
+    }
+    tt->vals[n++] = 1.;
+  }
+  tt->nnz = n;
+  return tt;
+}
+
+
+CTEST_DATA(gcp)
+{
+  double * opts;
+};
+
+
+CTEST_SETUP(gcp)
+{
+  data->opts = splatt_default_opts();
+  data->opts[SPLATT_OPTION_VERBOSITY] = SPLATT_VERBOSITY_NONE;
+  data->opts[SPLATT_OPTION_NITER] = 100;
+  data->opts[SPLATT_OPTION_TOLERANCE] = 1e-6;
+  data->opts[SPLATT_OPTION_LEARNRATE] = 1e-2;
+  srand(1);
+}
+
+
+CTEST_TEARDOWN(gcp)
+{
+  splatt_free_opts(data->opts);
+}
+
+
+CTEST2(gcp, loss_derivs)
+{
+  val_t const xs[] = {0., 1., 2.5};
+  val_t const ms[] = {0.3, 1., 4.};
+  val_t const h = 1e-6;
+
+  for(idx_t l=0; l <= SPLATT_LOSS_GAMMA; ++l) {
+    gcp_loss const * const loss = gcp_get_loss((splatt_loss_type) l);
+    ASSERT_NOT_NULL(loss);
+
+    splatt_loss_type which;
+    ASSERT_TRUE(gcp_parse_loss(loss->name, &which));
+    ASSERT_EQUAL(l, which);
+
+    for(idx_t a=0; a < 3; ++a) {
+      for(idx_t b=0; b < 3; ++b) {
+        val_t const x = xs[a];
+        val_t const m = ms[b];
+        val_t const fd = (loss->func(x, m + h) - loss->func(x, m - h)) /
+            (2. * h);
+        ASSERT_DBL_NEAR_TOL(fd, loss->deriv(x, m), 1e-5 * (1. + fabs(fd)));
+      }
+    }
+  }
+
+  splatt_loss_type which;
+  ASSERT_FALSE(gcp_parse_loss("nope", &which));
+  ASSERT_NULL(gcp_get_loss((splatt_loss_type) (SPLATT_LOSS_GAMMA + 1)));
+}
+
+
+CTEST2(gcp, bad_input)
+{
+  sptensor_t * tt = p_lowrank(false);
+  splatt_kruskal model;
+  data->opts[SPLATT_OPTION_LOSS] = SPLATT_LOSS_GAMMA + 1;
+  ASSERT_EQUAL(SPLATT_ERROR_BADINPUT, gcp_cpd(tt, GC_RANK, data->opts,
+      &model));
+  tt_free(tt);
+}
+
+
+CTEST2(gcp, gaussian)
+{
+  sptensor_t * tt = p_lowrank(false);
+  splatt_kruskal model;
+  data->opts[SPLATT_OPTION_LOSS] = SPLATT_LOSS_GAUSSIAN;
+  ASSERT_EQUAL(SPLATT_SUCCESS, gcp_cpd(tt, GC_RANK, data->opts, &model));
+
+  double err = 0.;
+  double norm = 0.;
+  for(idx_t x=0; x < tt->nnz; ++x) {
+    val_t const v = p_kruskal_val(&model, tt->ind[0][x], tt->ind[1][x],
+        tt->ind[2][x]);
+    err += (tt->vals[x] - v) * (tt->vals[x] - v);
+    norm += tt->vals[x] * tt->vals[x];
+  }
+  ASSERT_TRUE(sqrt(err / norm) < 0.05);
+
+  splatt_free_kruskal(&model);
+  tt_free(tt);
+}
+
+
+CTEST2(gcp, bernoulli)
+{
+  sptensor_t * tt = p_lowrank(true);
+  splatt_kruskal model;
+  data->opts[SPLATT_OPTION_LOSS] = SPLATT_LOSS_BERNOULLI;
+  ASSERT_EQUAL(SPLATT_SUCCESS, gcp_cpd(tt, GC_RANK, data->opts, &model));
+
+  /* compare the exact loss against the best constant model */
+  gcp_loss const * const loss = gcp_get_loss(SPLATT_LOSS_BERNOULLI);
+  val_t const total = GC_DIM * GC_DIM * GC_DIM;
+  val_t const p = (val_t) tt->nnz / total;
+  val_t const logit = log(p / (1. - p));
+
+  double model_loss = 0.;
+  double const_loss = 0.;
+  for(idx_t i=0; i < GC_DIM; ++i) {
+    for(idx_t j=0; j < GC_DIM; ++j) {
+      for(idx_t k=0; k < GC_DIM; ++k) {
+        model_loss += loss->func(0., p_kruskal_val(&model, i, j, k));
+        const_loss += loss->func(0., logit);
+      }
+    }
+  }
+  for(idx_t x=0; x < tt->nnz; ++x) {
+    val_t const m = p_kruskal_val(&model, tt->ind[0][x], tt->ind[1][x],
+        tt->ind[2][x]);
+    model_loss += loss->func(1., m) - loss->func(0., m);
+    const_loss += loss->func(1., logit) - loss->func(0., logit);
+  }
+  ASSERT_TRUE(model_loss < 0.85 * const_loss);
+
+  splatt_free_kruskal(&model);
+  tt_free(tt);
+}
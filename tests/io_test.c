@@ -89,3 +89,37 @@ CTEST2(io, binary_io)
   /* delete temporary file */
   remove(TMP_FILE);
 }
+
+
+CTEST2(io, mat_io)
+{
+  idx_t const I = 17;
+  idx_t const J = 5;
+  matrix_t * gold = mat_rand(I, J);
+
+  mat_write(gold, TMP_FILE);
+  matrix_t * mat = mat_read(TMP_FILE);
+  ASSERT_NOT_NULL(mat);
+
+  ASSERT_EQUAL(gold->I, mat->I);
+  ASSERT_EQUAL(gold->J, mat->J);
+  for(idx_t x=0; x < I * J; ++x) {
+    /* mat_write() uses 8 digits of precision */
+    ASSERT_DBL_NEAR_TOL(gold->vals[x], mat->vals[x], 1e-7);
+  }
+
+  /* vectors are single-column matrices */
+  idx_t len;
+  vec_write(gold->vals, I, TMP_FILE);
+  val_t * vec = vec_read(TMP_FILE, &len);
+  ASSERT_NOT_NULL(vec);
+  ASSERT_EQUAL(I, len);
+  for(idx_t i=0; i < I; ++i) {
+    ASSERT_DBL_NEAR_TOL(gold->vals[i], vec[i], 1e-5);
+  }
+
+  splatt_free(vec);
+  mat_free(mat);
+  mat_free(gold);
+  remove(TMP_FILE);
+}
@@ -87,3 +87,138 @@ CTEST2(matrix, matmul)
   }
 }
 
+
+
+CTEST2(matrix, fused_update)
+{
+  idx_t const nmodes = 3;
+  idx_t const R = 5;
+  idx_t const I = 5000; /* several row blocks */
+  rank_info rinfo;
+  rinfo.rank = 0;
+  thd_info * thds = thd_init(data->nthreads, 1, (R * sizeof(val_t)) + 64);
+
+  matrix_t * aTa[MAX_NMODES+1];
+  matrix_t * gold_aTa[MAX_NMODES+1];
+  for(idx_t m=0; m < nmodes; ++m) {
+    matrix_t * factor = mat_rand(50 + m, R);
+    aTa[m] = mat_alloc(R, R);
+    gold_aTa[m] = mat_alloc(R, R);
+    mat_aTa(factor, aTa[m], &rinfo, thds, data->nthreads);
+    memcpy(gold_aTa[m]->vals, aTa[m]->vals, R * R * sizeof(val_t));
+    mat_free(factor);
+  }
+  aTa[MAX_NMODES] = mat_alloc(R, R);
+  gold_aTa[MAX_NMODES] = mat_alloc(R, R);
+
+  matrix_t * rhs = mat_rand(I, R);
+  matrix_t * A = mat_alloc(I, R);
+  matrix_t * gold = mat_alloc(I, R);
+  val_t lambda[R];
+  val_t gold_lambda[R];
+#if SPLATT_VAL_TYPEWIDTH == 32
+  double const tol = 1e-4;
+#else
+  double const tol = 1e-8;
+#endif
+
+  splatt_mat_norm const norms[] = { MAT_NORM_2, MAT_NORM_MAX };
+  for(idx_t n=0; n < 2; ++n) {
+    idx_t const mode = n;
+
+    /* unfused sequence */
+    memcpy(gold->vals, rhs->vals, I * R * sizeof(val_t));
+    mat_solve_normals(mode, nmodes, gold_aTa, gold, 0.);
+    mat_normalize(gold, gold_lambda, norms[n], &rinfo, thds, data->nthreads);
+    mat_aTa(gold, gold_aTa[mode], &rinfo, thds, data->nthreads);
+
+    mat_fused_update(mode, nmodes, aTa, rhs, A, lambda, norms[n], 0., &rinfo,
+        thds, data->nthreads);
+
+    ASSERT_EQUAL(I, A->I);
+    for(idx_t j=0; j < R; ++j) {
+      ASSERT_DBL_NEAR_TOL(gold_lambda[j], lambda[j], tol * gold_lambda[j]);
+    }
+    for(idx_t x=0; x < I * R; ++x) {
+      ASSERT_DBL_NEAR_TOL(gold->vals[x], A->vals[x], tol);
+    }
+    /* only the upper triangle (row-major) is stored */
+    for(idx_t i=0; i < R; ++i) {
+      for(idx_t j=i; j < R; ++j) {
+        ASSERT_DBL_NEAR_TOL(gold_aTa[mode]->vals[j+(i*R)],
+            aTa[mode]->vals[j+(i*R)], tol);
+      }
+    }
+  }
+
+  for(idx_t m=0; m < nmodes; ++m) {
+    mat_free(aTa[m]);
+    mat_free(gold_aTa[m]);
+  }
+  mat_free(aTa[MAX_NMODES]);
+  mat_free(gold_aTa[MAX_NMODES]);
+  mat_free(rhs);
+  mat_free(A);
+  mat_free(gold);
+  thd_free(thds, data->nthreads);
+}
+
+
+
+CTEST2(matrix, sparse_matmul)
+{
+  /* a sparse copy of a dense matrix with some entries dropped */
+  matrix_t const * const D = data->mats[2];
+  idx_t const I = D->I;
+  idx_t const K = D->J;
+  spmatrix_t * A = spmat_alloc(I, K, I * K);
+  idx_t nnz = 0;
+  for(idx_t i=0; i < I; ++i) {
+    A->rowptr[i] = nnz;
+    for(idx_t k=0; k < K; ++k) {
+      if((i + k) % 3 == 0) {
+        A->colind[nnz] = k;
+        A->vals[nnz++] = D->vals[k + (i*K)];
+      }
+    }
+  }
+  A->rowptr[I] = nnz;
+  A->nnz = nnz;
+
+  matrix_t * B = mat_rand(K, 6);
+  matrix_t * C = mat_alloc(I, 6);
+  spmat_matmul(A, B, C);
+
+  for(idx_t i=0; i < I; ++i) {
+    for(idx_t j=0; j < 6; ++j) {
+      val_t gold = 0.;
+      for(idx_t k=0; k < K; ++k) {
+        if((i + k) % 3 == 0) {
+          gold += D->vals[k + (i*K)] * B->vals[j + (k*6)];
+        }
+      }
+      ASSERT_DBL_NEAR_TOL(gold, C->vals[j + (i*6)], 1e-4);
+    }
+  }
+
+  /* the transpose has the same entries, with sorted columns */
+  spmatrix_t * At = spmat_transpose(A);
+  ASSERT_EQUAL(K, At->I);
+  ASSERT_EQUAL(I, At->J);
+  ASSERT_EQUAL(nnz, At->nnz);
+  for(idx_t k=0; k < K; ++k) {
+    for(idx_t x=At->rowptr[k]; x < At->rowptr[k+1]; ++x) {
+      idx_t const i = At->colind[x];
+      if(x > At->rowptr[k]) {
+        ASSERT_TRUE(At->colind[x-1] < i);
+      }
+      ASSERT_EQUAL(0, (i + k) % 3);
+      ASSERT_DBL_NEAR_TOL(D->vals[k + (i*K)], At->vals[x], 0.);
+    }
+  }
+
+  spmat_free(A);
+  spmat_free(At);
+  mat_free(B);
+  mat_free(C);
+}
@@ -72,6 +72,9 @@ static void p_csf_mttkrp(
 
       /* compute MTTKRP */
       splatt_mttkrp_ws * ws = splatt_mttkrp_alloc_ws(cs, nfactors, opts);
+      for(idx_t f=0; f < tt->nmodes; ++f) {
+        mttkrp_refresh_factor(ws, mats[i][f], f);
+      }
       mttkrp_csf(cs, mats[i], m, thds, ws, opts);
       splatt_mttkrp_free_ws(ws);
 
@@ -258,3 +261,79 @@ CTEST2(mttkrp, csf_two_densetile_alldepth)
   }
 }
 
+
+/*
+ * Sparse factors
+ */
+CTEST2(mttkrp, csf_sparse_factors)
+{
+  /* zero out most of each factor, including some entire rows */
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    for(idx_t m=0; m < data->tensors[i]->nmodes; ++m) {
+      matrix_t * const A = data->mats[i][m];
+      for(idx_t x=0; x < A->I * A->J; ++x) {
+        if(x % 5 != 0 || (x / A->J) % 3 == 0) {
+          A->vals[x] = 0.;
+        }
+      }
+    }
+  }
+
+  double * opts = splatt_default_opts();
+  opts[SPLATT_OPTION_NTHREADS]   = 7;
+  opts[SPLATT_OPTION_SPFACTOR]   = 1.;
+  opts[SPLATT_OPTION_NNCPD]      = 1.;
+
+  opts[SPLATT_OPTION_CSF_ALLOC]  = SPLATT_CSF_ALLMODE;
+  opts[SPLATT_OPTION_TILE]       = SPLATT_NOTILE;
+  opts[SPLATT_OPTION_TILELEVEL]  = 0;
+  p_csf_mttkrp(opts, data->tensors, data->ntensors, data->mats, data->gold,
+      data->nfactors);
+
+  /* exercise the locked kernels */
+  opts[SPLATT_OPTION_CSF_ALLOC]  = SPLATT_CSF_ONEMODE;
+  opts[SPLATT_OPTION_PRIVTHRESH] = 0.;
+  p_csf_mttkrp(opts, data->tensors, data->ntensors, data->mats, data->gold,
+      data->nfactors);
+
+  opts[SPLATT_OPTION_CSF_ALLOC]  = SPLATT_CSF_TWOMODE;
+  opts[SPLATT_OPTION_TILE]       = SPLATT_DENSETILE;
+  for(splatt_idx_t t=0; t <= SPLATT_MAX_NMODES; ++t) {
+    opts[SPLATT_OPTION_TILELEVEL]  = t;
+    p_csf_mttkrp(opts, data->tensors, data->ntensors, data->mats, data->gold,
+        data->nfactors);
+  }
+
+  splatt_free_opts(opts);
+}
+
+
+CTEST2(mttkrp, sparse_factor_contract)
+{
+  sptensor_t * const tt = data->tensors[0];
+  ASSERT_EQUAL(3, tt->nmodes);
+  matrix_t * const A = data->mats[0][0];
+  memset(A->vals, 0, A->I * A->J * sizeof(val_t));
+
+  double * opts = splatt_default_opts();
+  opts[SPLATT_OPTION_SPFACTOR] = 1.;
+  splatt_csf * cs = csf_alloc(tt, opts);
+
+  /* unconstrained factors are never scanned */
+  splatt_mttkrp_ws * ws = splatt_mttkrp_alloc_ws(cs, data->nfactors, opts);
+  mttkrp_refresh_factor(ws, A, 0);
+  ASSERT_FALSE(ws->is_sparse_factor[0]);
+  splatt_mttkrp_free_ws(ws);
+
+  /* constrained factors keep a pattern until it is invalidated */
+  opts[SPLATT_OPTION_NNCPD] = 1.;
+  ws = splatt_mttkrp_alloc_ws(cs, data->nfactors, opts);
+  mttkrp_refresh_factor(ws, A, 0);
+  ASSERT_TRUE(ws->is_sparse_factor[0]);
+  mttkrp_invalidate_factor(ws, 0);
+  ASSERT_FALSE(ws->is_sparse_factor[0]);
+  splatt_mttkrp_free_ws(ws);
+
+  csf_free(cs, opts);
+  splatt_free_opts(opts);
+}
@@ -37,9 +37,9 @@ CTEST2(mutex, alloc)
   ASSERT_EQUAL(SPLATT_DEFAULT_NLOCKS, pool->num_locks);
   ASSERT_EQUAL(SPLATT_DEFAULT_LOCK_PAD, pool->pad_size);
 #ifdef _OPENMP
-  ASSERT_NOT_NULL(pool->locks);
+  ASSERT_NOT_NULL((void *) pool->locks);
 #else
-  ASSERT_NULL(pool->locks);
+  ASSERT_NULL((void *) pool->locks);
 #endif
 
   mutex_free(pool);
@@ -55,15 +55,64 @@ CTEST2(mutex, alloc_custom)
   ASSERT_EQUAL(10, pool->num_locks);
   ASSERT_EQUAL(100, pool->pad_size);
 #ifdef _OPENMP
-  ASSERT_NOT_NULL(pool->locks);
+  ASSERT_NOT_NULL((void *) pool->locks);
 #else
-  ASSERT_NULL(pool->locks);
+  ASSERT_NULL((void *) pool->locks);
 #endif
 
   mutex_free(pool);
 }
 
 
+CTEST2(mutex, alloc_sized)
+{
+  /* short modes get one lock per row */
+  mutex_pool * pool = mutex_alloc_sized(50, 4);
+  ASSERT_EQUAL(50, pool->num_locks);
+  mutex_free(pool);
+
+  /* long modes scale with the thread count */
+  pool = mutex_alloc_sized(1000000, 64);
+  ASSERT_EQUAL(64 * SPLATT_LOCKS_PER_THREAD, pool->num_locks);
+  mutex_free(pool);
+
+  pool = mutex_alloc_sized(1000000, 1);
+  ASSERT_EQUAL(SPLATT_DEFAULT_NLOCKS, pool->num_locks);
+  mutex_free(pool);
+}
+
+
+CTEST2(mutex, translate)
+{
+  int const nlocks = 64;
+  int seen[64];
+
+  /* IDs below the pool size have dedicated locks */
+  for(int l=0; l < nlocks; ++l) {
+    seen[l] = 0;
+  }
+  for(int id=0; id < nlocks; ++id) {
+    int const lock = mutex_translate_id(id, nlocks, 1);
+    ASSERT_TRUE(lock >= 0 && lock < nlocks);
+    ++seen[lock];
+  }
+  for(int l=0; l < nlocks; ++l) {
+    ASSERT_EQUAL(1, seen[l]);
+  }
+
+  /* IDs a multiple of the pool size apart do not pile onto one lock */
+  for(int l=0; l < nlocks; ++l) {
+    seen[l] = 0;
+  }
+  for(int b=0; b < nlocks; ++b) {
+    ++seen[mutex_translate_id(3 + (b * nlocks), nlocks, 1)];
+  }
+  for(int l=0; l < nlocks; ++l) {
+    ASSERT_TRUE(seen[l] <= 1);
+  }
+}
+
+
 #ifdef _OPENMP
 CTEST2(mutex, omp_lock)
 {
@@ -90,3 +139,36 @@ CTEST2(mutex, omp_lock)
 }
 #endif
 
+
+
+#ifdef SPLATT_LOCK_STATS
+CTEST2(mutex, lock_stats)
+{
+  mutex_pool * pool = mutex_alloc_custom(4, 1);
+
+  int nthreads = 1;
+  #pragma omp parallel num_threads(2)
+  {
+    #pragma omp master
+    nthreads = omp_get_num_threads();
+
+    for(int x=0; x < data->num_incs; ++x) {
+      mutex_set_lock(pool, x);
+      mutex_unset_lock(pool, x);
+    }
+  }
+
+  unsigned long long lock_total = 0;
+  for(int l=0; l < pool->num_locks; ++l) {
+    lock_total += pool->lock_stats[l].acquires;
+  }
+  unsigned long long thread_total = 0;
+  for(int t=0; t < pool->num_thread_stats; ++t) {
+    thread_total += pool->thread_stats[t].stats.acquires;
+  }
+  ASSERT_EQUAL(nthreads * data->num_incs, (int) lock_total);
+  ASSERT_EQUAL(nthreads * data->num_incs, (int) thread_total);
+
+  mutex_free(pool);
+}
+#endif
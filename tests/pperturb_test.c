@@ -0,0 +1,190 @@
+
+#include "../src/pperturb.h"
+#include "../src/cpd.h"
+#include "../src/csf.h"
+#include "../src/io.h"
+#include "../src/mttkrp.h"
+#include "../src/sptensor.h"
+
+#include "ctest/ctest.h"
+#include "splatt_test.h"
+
+#include <math.h>
+
+
+#define PP_RANK 4
+
+
+/**
+* @brief The relative Frobenius distance between two matrices.
+*/
+static double p_rel_err(
+    matrix_t const * const gold,
+    matrix_t const * const test)
+{
+  double err = 0.;
+  double norm = 0.;
+  for(idx_t x=0; x < gold->I * gold->J; ++x) {
+    double const diff = gold->vals[x] - test->vals[x];
+    err += diff * diff;
+    norm += gold->vals[x] * gold->vals[x];
+  }
+  return (norm > 0.) ? sqrt(err / norm) : sqrt(err);
+}
+
+
+/**
+* @brief The largest relative error of pp_mttkrp() over all modes, after each
+*        factor is perturbed by 'eps' from the factors it was built with.
+*/
+static double p_pp_error(
+    sptensor_t * const tt,
+    splatt_csf const * const csf,
+    matrix_t ** mats,
+    double const eps)
+{
+  idx_t const nmodes = tt->nmodes;
+
+  pp_ws * ws = pp_alloc(csf, PP_RANK);
+  pp_build(ws, mats);
+
+  matrix_t * saved[MAX_NMODES];
+  for(idx_t m=0; m < nmodes; ++m) {
+    saved[m] = mat_alloc(tt->dims[m], PP_RANK);
+    memcpy(saved[m]->vals, mats[m]->vals,
+        tt->dims[m] * PP_RANK * sizeof(val_t));
+    for(idx_t x=0; x < tt->dims[m] * PP_RANK; ++x) {
+      mats[m]->vals[x] += eps * (((val_t) (x % 7) / 7.) - 0.5);
+    }
+    pp_delta(ws, mats[m], m);
+  }
+
+  idx_t maxdim = 0;
+  for(idx_t m=0; m < nmodes; ++m) {
+    maxdim = SS_MAX(maxdim, tt->dims[m]);
+  }
+  double maxerr = 0.;
+  matrix_t * approx = mat_alloc(maxdim, PP_RANK);
+  for(idx_t m=0; m < nmodes; ++m) {
+    mats[MAX_NMODES]->I = tt->dims[m];
+    approx->I = tt->dims[m];
+    mttkrp_stream(tt, mats, m);
+    pp_mttkrp(ws, mats, m, approx);
+    maxerr = SS_MAX(maxerr, p_rel_err(mats[MAX_NMODES], approx));
+  }
+
+  /* restore the original factors */
+  for(idx_t m=0; m < nmodes; ++m) {
+    memcpy(mats[m]->vals, saved[m]->vals,
+        tt->dims[m] * PP_RANK * sizeof(val_t));
+    mat_free(saved[m]);
+  }
+  mat_free(approx);
+  pp_free(ws);
+  return maxerr;
+}
+
+
+CTEST_DATA(pperturb)
+{
+  double * opts;
+  idx_t ntensors;
+  sptensor_t * tensors[MAX_DSETS];
+  matrix_t * mats[MAX_DSETS][MAX_NMODES+1];
+};
+
+
+CTEST_SETUP(pperturb)
+{
+  data->opts = splatt_default_opts();
+  data->opts[SPLATT_OPTION_VERBOSITY] = SPLATT_VERBOSITY_NONE;
+
+  data->ntensors = sizeof(datasets) / sizeof(datasets[0]);
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    sptensor_t * const tt = tt_read(datasets[i]);
+    data->tensors[i] = tt;
+
+    idx_t maxdim = 0;
+    for(idx_t m=0; m < tt->nmodes; ++m) {
+      data->mats[i][m] = mat_rand(tt->dims[m], PP_RANK);
+      maxdim = SS_MAX(maxdim, tt->dims[m]);
+    }
+    data->mats[i][MAX_NMODES] = mat_alloc(maxdim, PP_RANK);
+  }
+}
+
+
+CTEST_TEARDOWN(pperturb)
+{
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    for(idx_t m=0; m < data->tensors[i]->nmodes; ++m) {
+      mat_free(data->mats[i][m]);
+    }
+    mat_free(data->mats[i][MAX_NMODES]);
+    tt_free(data->tensors[i]);
+  }
+  splatt_free_opts(data->opts);
+}
+
+
+CTEST2(pperturb, exact_at_snapshot)
+{
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    sptensor_t * const tt = data->tensors[i];
+    splatt_csf * csf = csf_alloc(tt, data->opts);
+    if(tt->nmodes < 3) {
+      ASSERT_NULL(pp_alloc(csf, PP_RANK));
+    } else {
+      ASSERT_TRUE(p_pp_error(tt, csf, data->mats[i], 0.) < 1e-12);
+    }
+    csf_free(csf, data->opts);
+  }
+}
+
+
+CTEST2(pperturb, second_order_error)
+{
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    sptensor_t * const tt = data->tensors[i];
+    if(tt->nmodes < 3) {
+      continue;
+    }
+    splatt_csf * csf = csf_alloc(tt, data->opts);
+
+    /* shrinking the change 10x should shrink the error about 100x */
+    double const big = p_pp_error(tt, csf, data->mats[i], 1e-2);
+    double const small = p_pp_error(tt, csf, data->mats[i], 1e-3);
+    ASSERT_TRUE(big < 1e-2);
+    ASSERT_TRUE(small < big / 50.);
+
+    csf_free(csf, data->opts);
+  }
+}
+
+
+CTEST2(pperturb, cpd_fit)
+{
+  /* a dense 10x9x8 tensor of exact rank 3 */
+  idx_t const dims[3] = {10, 9, 8};
+  matrix_t * truth[3];
+  for(idx_t m=0; m < 3; ++m) {
+    truth[m] = mat_rand(dims[m], 3);
+  }
+  sptensor_t * tt = lowrank_tensor(dims, 3, truth);
+  for(idx_t m=0; m < 3; ++m) {
+    mat_free(truth[m]);
+  }
+
+  data->opts[SPLATT_OPTION_NITER] = 200;
+  data->opts[SPLATT_OPTION_TOLERANCE] = 1e-10;
+  data->opts[SPLATT_OPTION_PPTOL] = 0.1;
+  splatt_csf * csf = csf_alloc(tt, data->opts);
+
+  splatt_kruskal model;
+  ASSERT_EQUAL(SPLATT_SUCCESS, splatt_cpd_als(csf, 3, data->opts, &model));
+  ASSERT_TRUE(model.fit > 0.999);
+
+  splatt_free_kruskal(&model);
+  csf_free(csf, data->opts);
+  tt_free(tt);
+}
@@ -165,7 +165,7 @@ CTEST2(sort_tensor, tiled_sort)
         }
       }
     }
-    free(nnzptr);
+    splatt_free(nnzptr);
   }
 }
 
@@ -1,6 +1,9 @@
 #ifndef SPLATT_TEST_H
 #define SPLATT_TEST_H
 
+#include "../src/sptensor.h"
+#include "../src/matrix.h"
+
 /* DATASET(med.tns) will return "/tests/tensors/med.tns" */
 #define DATASET_(x) SPLATT_TEST_DATASETS #x
 #define DATASET(x) DATASET_(x)
@@ -27,4 +30,45 @@ static char const * const graphs[] = {
 };
 #define MAX_GRAPHS 16
 
+
+/**
+* @brief Build the dense three-mode tensor of a Kruskal model with unit
+*        weights. Entries are stored in row-major order, so the entry at
+*        (i,j,k) is non-zero number k + dims[2]*(j + (dims[1]*i)).
+*
+* @param dims The dimensions of the tensor.
+* @param rank The rank of the model.
+* @param truth The factors, truth[m] being dims[m] x rank.
+*
+* @return The tensor, to be freed with tt_free().
+*/
+static inline sptensor_t * lowrank_tensor(
+    idx_t const * const dims,
+    idx_t const rank,
+    matrix_t * const * const truth)
+{
+  sptensor_t * tt = tt_alloc(dims[0] * dims[1] * dims[2], 3);
+  idx_t n = 0;
+  for(idx_t i=0; i < dims[0]; ++i) {
+    for(idx_t j=0; j < dims[1]; ++j) {
+      for(idx_t k=0; k < dims[2]; ++k) {
+        val_t v = 0.;
+        for(idx_t r=0; r < rank; ++r) {
+          v += truth[0]->vals[r + (i*rank)] *
+               truth[1]->vals[r + (j*rank)] *
+               truth[2]->vals[r + (k*rank)];
+        }
+        tt->ind[0][n] = i;
+        tt->ind[1][n] = j;
+        tt->ind[2][n] = k;
+        tt->vals[n++] = v;
+      }
+    }
+  }
+  for(idx_t m=0; m < 3; ++m) {
+    tt->dims[m] = dims[m];
+  }
+  return tt;
+}
+
 #endif
@@ -0,0 +1,190 @@
+
+#include "../src/stream.h"
+#include "../src/sptensor.h"
+
+#include "ctest/ctest.h"
+#include "splatt_test.h"
+
+#include <math.h>
+
+
+#define ST_DIM 12
+#define ST_STEPS 40
+#define ST_RANK 2
+
+
+/**
+* @brief Build the dense time slices [first, first+nsteps) of a low-rank tensor
+*        whose time mode is the last one. Time indices are local to the batch.
+*
+* @param truth The true factors.
+* @param first The first time step.
+* @param nsteps The number of time steps.
+*
+* @return The batch.
+*/
+static sptensor_t * p_batch(
+    matrix_t ** truth,
+    idx_t const first,
+    idx_t const nsteps)
+{
+  /* the batch's time factor is a window of rows of the true one */
+  matrix_t window;
+  window.I = nsteps;
+  window.J = ST_RANK;
+  window.vals = truth[2]->vals + (first * ST_RANK);
+  window.rowmajor = 1;
+
+  matrix_t * batch[3] = {truth[0], truth[1], &window};
+  idx_t const dims[3] = {ST_DIM, ST_DIM, nsteps};
+  return lowrank_tensor(dims, ST_RANK, batch);
+}
+
+
+CTEST_DATA(stream)
+{
+  double * opts;
+  matrix_t * truth[3];
+};
+
+
+CTEST_SETUP(stream)
+{
+  data->opts = splatt_default_opts();
+  data->opts[SPLATT_OPTION_NITER] = 50;
+  data->opts[SPLATT_OPTION_TOLERANCE] = 1e-8;
+  data->opts[SPLATT_OPTION_VERBOSITY] = SPLATT_VERBOSITY_NONE;
+
+  srand(1);
+  idx_t const dims[] = { ST_DIM, ST_DIM, ST_STEPS };
+  for(idx_t m=0; m < 3; ++m) {
+    data->truth[m] = mat_alloc(dims[m], ST_RANK);
+    for(idx_t x=0; x < dims[m] * ST_RANK; ++x) {
+      data->truth[m]->vals[x] = 0.1 + ((val_t) rand() / (val_t) RAND_MAX);
+    }
+  }
+}
+
+
+CTEST_TEARDOWN(stream)
+{
+  for(idx_t m=0; m < 3; ++m) {
+    mat_free(data->truth[m]);
+  }
+  splatt_free_opts(data->opts);
+}
+
+
+CTEST2(stream, bad_input)
+{
+  sptensor_t * first = p_batch(data->truth, 0, 10);
+  ASSERT_NULL(stream_alloc(first, ST_RANK, 3, data->opts));
+  data->opts[SPLATT_OPTION_FORGET] = 0.;
+  ASSERT_NULL(stream_alloc(first, ST_RANK, 2, data->opts));
+  tt_free(first);
+}
+
+
+CTEST2(stream, track)
+{
+  sptensor_t * first = p_batch(data->truth, 0, 10);
+  stream_cpd * stream = stream_alloc(first, ST_RANK, 2, data->opts);
+  tt_free(first);
+  ASSERT_NOT_NULL(stream);
+  ASSERT_TRUE(stream->fit > 0.99);
+
+  for(idx_t t=10; t < ST_STEPS; t += 5) {
+    sptensor_t * batch = p_batch(data->truth, t, 5);
+    double const fit = stream_add(stream, batch, NULL);
+    tt_free(batch);
+    ASSERT_TRUE(fit > 0.99);
+    ASSERT_EQUAL(t + 5, stream->dims[2]);
+  }
+
+  /* an empty batch appends zero rows */
+  sptensor_t * empty = tt_alloc(0, 3);
+  empty->dims[0] = ST_DIM;
+  empty->dims[1] = ST_DIM;
+  empty->dims[2] = 2;
+  stream_add(stream, empty, NULL);
+  tt_free(empty);
+  ASSERT_EQUAL(ST_STEPS + 2, stream->dims[2]);
+  for(idx_t x=ST_STEPS * ST_RANK; x < (ST_STEPS + 2) * ST_RANK; ++x) {
+    ASSERT_DBL_NEAR_TOL(0., stream->factors[2]->vals[x], 0.);
+  }
+
+  splatt_kruskal model;
+  stream_to_kruskal(stream, &model);
+  ASSERT_EQUAL(ST_STEPS + 2, model.dims[2]);
+  for(idx_t f=0; f < ST_RANK; ++f) {
+    ASSERT_TRUE(model.lambda[f] > 0.);
+  }
+  splatt_free_kruskal(&model);
+  stream_free(stream);
+}
+
+
+CTEST2(stream, window)
+{
+  data->opts[SPLATT_OPTION_FORGET] = 0.9;
+  data->opts[SPLATT_OPTION_WINDOW] = 2;
+
+  sptensor_t * first = p_batch(data->truth, 0, 10);
+  stream_cpd * stream = stream_alloc(first, ST_RANK, 2, data->opts);
+  tt_free(first);
+  ASSERT_NOT_NULL(stream);
+
+  /* the window wraps around several times */
+  for(idx_t t=10; t < ST_STEPS; t += 5) {
+    sptensor_t * batch = p_batch(data->truth, t, 5);
+    idx_t niters;
+    double const fit = stream_add(stream, batch, &niters);
+    tt_free(batch);
+    ASSERT_TRUE(niters > 0);
+    ASSERT_TRUE(fit > 0.99);
+  }
+  stream_free(stream);
+}
+
+
+CTEST2(stream, grow)
+{
+  /* the last rows of mode 0 only appear after the first batch */
+  idx_t const seen = ST_DIM - 3;
+  sptensor_t * first = p_batch(data->truth, 0, 10);
+  idx_t keep = 0;
+  for(idx_t n=0; n < first->nnz; ++n) {
+    if(first->ind[0][n] < seen) {
+      for(idx_t m=0; m < 3; ++m) {
+        first->ind[m][keep] = first->ind[m][n];
+      }
+      first->vals[keep++] = first->vals[n];
+    }
+  }
+  first->nnz = keep;
+  first->dims[0] = seen;
+
+  stream_cpd * stream = stream_alloc(first, ST_RANK, 2, data->opts);
+  tt_free(first);
+  ASSERT_NOT_NULL(stream);
+  ASSERT_EQUAL(seen, stream->dims[0]);
+
+  for(idx_t t=10; t < ST_STEPS; t += 5) {
+    sptensor_t * batch = p_batch(data->truth, t, 5);
+    double const fit = stream_add(stream, batch, NULL);
+    tt_free(batch);
+    ASSERT_TRUE(isfinite(fit));
+    ASSERT_TRUE(fit > 0.8);
+    ASSERT_EQUAL(ST_DIM, stream->dims[0]);
+  }
+
+  /* the new rows were filled in */
+  for(idx_t i=seen; i < ST_DIM; ++i) {
+    val_t norm = 0.;
+    for(idx_t r=0; r < ST_RANK; ++r) {
+      norm += fabs(stream->factors[0]->vals[r + (i*ST_RANK)]);
+    }
+    ASSERT_TRUE(norm > 0.);
+  }
+  stream_free(stream);
+}
@@ -0,0 +1,113 @@
+#include "../src/base.h"
+#include "../src/thd_info.h"
+#include "ctest/ctest.h"
+#include "splatt_test.h"
+
+
+CTEST(thd_info, scratch_aligned)
+{
+  idx_t const nthreads = 3;
+  thd_info * thds = thd_init(nthreads, 3, (idx_t) 10, (idx_t) 0, (idx_t) 100);
+
+  for(idx_t t=0; t < nthreads; ++t) {
+    ASSERT_EQUAL(3, thds[t].nscratch);
+    for(idx_t s=0; s < 3; ++s) {
+      ASSERT_EQUAL((uintptr_t) 0, (uintptr_t) thds[t].scratch[s] % 64);
+    }
+    /* every array gets its own cache line(s) */
+    ASSERT_TRUE((char *) thds[t].scratch[1] >= (char *) thds[t].scratch[0] + 64);
+    ASSERT_TRUE((char *) thds[t].scratch[2] >= (char *) thds[t].scratch[1] + 64);
+
+    /* zeroed */
+    char const * const buf = thds[t].scratch[2];
+    for(idx_t x=0; x < 100; ++x) {
+      ASSERT_EQUAL(0, buf[x]);
+    }
+  }
+
+  thd_free(thds, nthreads);
+}
+
+
+CTEST(thd_info, arena)
+{
+  thd_info * thds = thd_init(1, 0);
+  thd_info * const thd = thds;
+
+  /* the first reservations spill */
+  size_t const mark = thd_arena_mark(thd);
+  char * a = thd_arena_reserve(thd, 10);
+  char * b = thd_arena_reserve(thd, 1000);
+  ASSERT_EQUAL((uintptr_t) 0, (uintptr_t) a % 64);
+  ASSERT_EQUAL((uintptr_t) 0, (uintptr_t) b % 64);
+  memset(a, 1, 10);
+  memset(b, 2, 1000);
+  ASSERT_EQUAL(1, a[9]);
+  thd_arena_release(thd, mark);
+
+  /* ...and the arena then grows to fit them contiguously */
+  a = thd_arena_reserve(thd, 10);
+  b = thd_arena_reserve(thd, 1000);
+  ASSERT_TRUE(a == thd->arena);
+  ASSERT_TRUE(b == a + 64);
+  ASSERT_NULL(thd->spill);
+
+  /* LIFO release reuses the same memory */
+  size_t const inner = thd_arena_mark(thd);
+  char * c = thd_arena_reserve(thd, 8);
+  thd_arena_release(thd, inner);
+  ASSERT_TRUE(c == thd_arena_reserve(thd, 8));
+  thd_arena_release(thd, mark);
+
+  thd_free(thds, 1);
+}
+
+
+
+CTEST(thd_info, reduce)
+{
+  idx_t const nelems = 37;
+  for(int nthreads=1; nthreads <= 5; ++nthreads) {
+    thd_info * thds = thd_init(nthreads, 1, (idx_t) (nelems * sizeof(val_t)));
+
+    /* thread t holds (t+1) * (i+1) */
+    int nteam = 1;
+    #pragma omp parallel num_threads(nthreads)
+    {
+      int const tid = splatt_omp_get_thread_num();
+      #pragma omp master
+      nteam = splatt_omp_get_num_threads();
+
+      val_t * const mine = (val_t *) thds[tid].scratch[0];
+      for(idx_t i=0; i < nelems; ++i) {
+        mine[i] = (val_t) ((tid + 1) * (i + 1));
+      }
+      thd_reduce(thds, 0, nelems, REDUCE_SUM);
+    }
+    val_t const * const out = (val_t *) thds[0].scratch[0];
+    for(idx_t i=0; i < nelems; ++i) {
+      ASSERT_DBL_NEAR_TOL((double) (nteam * (nteam + 1) / 2 * (i + 1)),
+          (double) out[i], 0.);
+    }
+
+    /* thread t holds (t + i) % 7 */
+    #pragma omp parallel num_threads(nthreads)
+    {
+      int const tid = splatt_omp_get_thread_num();
+      val_t * const mine = (val_t *) thds[tid].scratch[0];
+      for(idx_t i=0; i < nelems; ++i) {
+        mine[i] = (val_t) ((tid + i) % 7);
+      }
+      thd_reduce(thds, 0, nelems, REDUCE_MAX);
+    }
+    for(idx_t i=0; i < nelems; ++i) {
+      idx_t best = 0;
+      for(int t=0; t < nteam; ++t) {
+        best = SS_MAX(best, (t + i) % 7);
+      }
+      ASSERT_DBL_NEAR_TOL((double) best, (double) out[i], 0.);
+    }
+
+    thd_free(thds, nthreads);
+  }
+}
@@ -51,7 +51,7 @@ CTEST2(tile_dense, no_missing_nnz)
 
   idx_t * ptr = tt_densetile(data->tt, data->tile_dims);
   ASSERT_EQUAL(data->tt->nnz, ptr[data->ntiles]);
-  free(ptr);
+  splatt_free(ptr);
 
   for(idx_t m=0; m < data->tt->nmodes; ++m) {
     sptensor_t const * const tt = data->tt;
@@ -114,7 +114,7 @@ CTEST2(tile_dense, no_missing_nnz_traverse)
   for(idx_t m=0; m < data->tt->nmodes; ++m) {
     ASSERT_EQUAL(0, cksums[m]);
   }
-  free(ptr);
+  splatt_free(ptr);
 }
 
 
@@ -157,7 +157,7 @@ CTEST2(tile_dense, check_tile_bounds)
       id = get_next_tileid(id, data->tile_dims, tt->nmodes, 0, i);
     }
   }
-  free(ptr);
+  splatt_free(ptr);
 }
 
 
@@ -201,6 +201,6 @@ CTEST2(tile_dense, check_tile_bounds_weirddims)
       id = get_next_tileid(id, data->tile_dims, tt->nmodes, 0, i);
     }
   }
-  free(ptr);
+  splatt_free(ptr);
 }
 
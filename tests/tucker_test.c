@@ -0,0 +1,254 @@
+
+#include "../src/tucker.h"
+#include "../src/ttmc.h"
+#include "../src/csf.h"
+#include "../src/io.h"
+#include "../src/sptensor.h"
+#include "../src/util.h"
+
+#include "ctest/ctest.h"
+#include "splatt_test.h"
+
+#include <math.h>
+
+
+#define TK_NMODES 3
+static idx_t const tk_dims[TK_NMODES] = {9, 8, 7};
+static idx_t const tk_ranks[TK_NMODES] = {2, 3, 2};
+
+
+CTEST_DATA(tucker)
+{
+  double * opts;
+  idx_t ntensors;
+  sptensor_t * tensors[MAX_DSETS];
+  sptensor_t * lowtt;
+  splatt_csf * lowrank;
+};
+
+
+CTEST_SETUP(tucker)
+{
+  data->opts = splatt_default_opts();
+  data->opts[SPLATT_OPTION_CSF_ALLOC] = SPLATT_CSF_ALLMODE;
+  data->opts[SPLATT_OPTION_TILE] = SPLATT_NOTILE;
+  data->opts[SPLATT_OPTION_NITER] = 50;
+  data->opts[SPLATT_OPTION_TOLERANCE] = 1e-10;
+  data->opts[SPLATT_OPTION_VERBOSITY] = SPLATT_VERBOSITY_NONE;
+
+  data->ntensors = sizeof(datasets) / sizeof(datasets[0]);
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    data->tensors[i] = tt_read(datasets[i]);
+  }
+
+  /* a dense tensor with exact multilinear rank tk_ranks */
+  srand(1);
+  matrix_t * U[TK_NMODES];
+  for(idx_t m=0; m < TK_NMODES; ++m) {
+    U[m] = mat_rand(tk_dims[m], tk_ranks[m]);
+  }
+  idx_t const R0 = tk_ranks[0];
+  idx_t const R1 = tk_ranks[1];
+  idx_t const R2 = tk_ranks[2];
+  val_t * G = splatt_malloc(R0 * R1 * R2 * sizeof(*G));
+  fill_rand(G, R0 * R1 * R2);
+
+  /* expand the core into a Kruskal model: one column per core entry */
+  idx_t const R = R0 * R1 * R2;
+  matrix_t * truth[TK_NMODES];
+  for(idx_t m=0; m < TK_NMODES; ++m) {
+    truth[m] = mat_alloc(tk_dims[m], R);
+  }
+  for(idx_t a=0; a < R0; ++a) {
+    for(idx_t b=0; b < R1; ++b) {
+      for(idx_t c=0; c < R2; ++c) {
+        idx_t const r = c + R2*(b + (R1*a));
+        for(idx_t i=0; i < tk_dims[0]; ++i) {
+          truth[0]->vals[r + (i*R)] = G[r] * U[0]->vals[a + (i*R0)];
+        }
+        for(idx_t j=0; j < tk_dims[1]; ++j) {
+          truth[1]->vals[r + (j*R)] = U[1]->vals[b + (j*R1)];
+        }
+        for(idx_t k=0; k < tk_dims[2]; ++k) {
+          truth[2]->vals[r + (k*R)] = U[2]->vals[c + (k*R2)];
+        }
+      }
+    }
+  }
+  sptensor_t * tt = lowrank_tensor(tk_dims, R, truth);
+  for(idx_t m=0; m < TK_NMODES; ++m) {
+    mat_free(truth[m]);
+    mat_free(U[m]);
+  }
+  splatt_free(G);
+
+  data->lowtt = tt;
+  data->lowrank = csf_alloc(tt, data->opts);
+}
+
+
+CTEST_TEARDOWN(tucker)
+{
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    tt_free(data->tensors[i]);
+  }
+  tt_free(data->lowtt);
+  csf_free(data->lowrank, data->opts);
+  splatt_free_opts(data->opts);
+}
+
+
+CTEST2(tucker, ttmc)
+{
+  idx_t const nthreads = (idx_t) data->opts[SPLATT_OPTION_NTHREADS];
+
+  for(idx_t i=0; i < data->ntensors; ++i) {
+    sptensor_t * const tt = data->tensors[i];
+    idx_t const nmodes = tt->nmodes;
+    splatt_csf * csf = csf_alloc(tt, data->opts);
+
+    idx_t ranks[MAX_NMODES];
+    matrix_t * mats[MAX_NMODES];
+    for(idx_t m=0; m < nmodes; ++m) {
+      ranks[m] = 2 + (m % 2);
+      mats[m] = mat_rand(tt->dims[m], ranks[m]);
+    }
+
+    for(idx_t m=0; m < nmodes; ++m) {
+      splatt_csf const * const root = csf + m;
+      ASSERT_EQUAL(m, csf_depth_to_mode(root, 0));
+      idx_t const ncols = ttmc_ncols(root, ranks);
+      matrix_t * Y = mat_alloc(tt->dims[m], ncols);
+      idx_t * parts = csf_partition_1d(root, 0, nthreads);
+      ttmc_csf(root, mats, parts, Y, data->opts);
+
+      /* accumulate each nonzero into every column of its row */
+      matrix_t * gold = mat_alloc(tt->dims[m], ncols);
+      memset(gold->vals, 0, tt->dims[m] * ncols * sizeof(val_t));
+      for(idx_t x=0; x < tt->nnz; ++x) {
+        val_t * const grow = gold->vals + (tt->ind[m][x] * ncols);
+        for(idx_t c=0; c < ncols; ++c) {
+          val_t v = tt->vals[x];
+          idx_t rem = c;
+          for(idx_t d=nmodes-1; d > 0; --d) {
+            idx_t const mode = csf_depth_to_mode(root, d);
+            v *= mats[mode]->vals[(rem % ranks[mode]) +
+                (tt->ind[mode][x] * ranks[mode])];
+            rem /= ranks[mode];
+          }
+          grow[c] += v;
+        }
+      }
+
+      for(idx_t x=0; x < tt->dims[m] * ncols; ++x) {
+        ASSERT_DBL_NEAR_TOL(gold->vals[x], Y->vals[x],
+            1e-8 * (1. + fabs(gold->vals[x])));
+      }
+
+      splatt_free(parts);
+      mat_free(gold);
+      mat_free(Y);
+    }
+
+    for(idx_t m=0; m < nmodes; ++m) {
+      mat_free(mats[m]);
+    }
+    csf_free(csf, data->opts);
+  }
+}
+
+
+CTEST2(tucker, bad_input)
+{
+  splatt_tucker model;
+  idx_t ranks[TK_NMODES] = {2, 3, 2};
+
+  data->opts[SPLATT_OPTION_CSF_ALLOC] = SPLATT_CSF_ONEMODE;
+  ASSERT_EQUAL(SPLATT_ERROR_BADINPUT, splatt_tucker_hooi(data->lowrank,
+      ranks, data->opts, &model));
+  data->opts[SPLATT_OPTION_CSF_ALLOC] = SPLATT_CSF_ALLMODE;
+
+  ranks[1] = 0;
+  ASSERT_EQUAL(SPLATT_ERROR_BADINPUT, splatt_tucker_hooi(data->lowrank,
+      ranks, data->opts, &model));
+}
+
+
+CTEST2(tucker, hooi)
+{
+  splatt_tucker model;
+  ASSERT_EQUAL(SPLATT_SUCCESS, splatt_tucker_hooi(data->lowrank, tk_ranks,
+      data->opts, &model));
+  ASSERT_TRUE(model.fit > 0.999);
+  ASSERT_EQUAL(TK_NMODES, model.nmodes);
+
+  /* factors are orthonormal */
+  for(idx_t m=0; m < TK_NMODES; ++m) {
+    idx_t const R = model.ranks[m];
+    ASSERT_EQUAL(tk_ranks[m], R);
+    ASSERT_EQUAL(tk_dims[m], model.dims[m]);
+    for(idx_t a=0; a < R; ++a) {
+      for(idx_t b=0; b < R; ++b) {
+        val_t dot = 0.;
+        for(idx_t i=0; i < model.dims[m]; ++i) {
+          dot += model.factors[m][a + (i*R)] * model.factors[m][b + (i*R)];
+        }
+        ASSERT_DBL_NEAR_TOL((a == b) ? 1. : 0., dot, 1e-8);
+      }
+    }
+  }
+
+  /* reconstruct one entry from the core and factors */
+  val_t est = 0.;
+  idx_t const R0 = model.ranks[0];
+  idx_t const R1 = model.ranks[1];
+  idx_t const R2 = model.ranks[2];
+  idx_t const i = 3, j = 5, k = 2;
+  for(idx_t a=0; a < R0; ++a) {
+    for(idx_t b=0; b < R1; ++b) {
+      for(idx_t c=0; c < R2; ++c) {
+        est += model.core[c + R2*(b + (R1*a))] *
+            model.factors[0][a + (i*R0)] *
+            model.factors[1][b + (j*R1)] *
+            model.factors[2][c + (k*R2)];
+      }
+    }
+  }
+  sptensor_t const * const tt = data->lowtt;
+  val_t truth = 0.;
+  for(idx_t x=0; x < tt->nnz; ++x) {
+    if(tt->ind[0][x] == i && tt->ind[1][x] == j && tt->ind[2][x] == k) {
+      truth = tt->vals[x];
+    }
+  }
+  ASSERT_DBL_NEAR_TOL(truth, est, 1e-6 * (1. + fabs(truth)));
+
+  splatt_free_tucker(&model);
+}
+
+
+CTEST2(tucker, clamp)
+{
+  /* mode 1 cannot exceed the product of the other ranks */
+  splatt_tucker model;
+  idx_t ranks[TK_NMODES] = {1, 5, 2};
+  ASSERT_EQUAL(SPLATT_SUCCESS, splatt_tucker_hooi(data->lowrank, ranks,
+      data->opts, &model));
+  ASSERT_EQUAL(1, model.ranks[0]);
+  ASSERT_EQUAL(2, model.ranks[1]);
+  ASSERT_EQUAL(2, model.ranks[2]);
+  splatt_free_tucker(&model);
+
+  /* nor can any rank exceed its dimension */
+  ranks[0] = 20;
+  ranks[1] = 20;
+  ranks[2] = 20;
+  ASSERT_EQUAL(SPLATT_SUCCESS, splatt_tucker_hooi(data->lowrank, ranks,
+      data->opts, &model));
+  for(idx_t m=0; m < TK_NMODES; ++m) {
+    ASSERT_EQUAL(tk_dims[m], model.ranks[m]);
+  }
+  /* full rank captures everything */
+  ASSERT_TRUE(model.fit > 0.9999);
+  splatt_free_tucker(&model);
+}